@@ -0,0 +1,89 @@
+#ifndef ACCESS_DECISION_H
+#define ACCESS_DECISION_H
+
+#include <Arduino.h>
+
+/**
+ * Модуль AccessDecision.h
+ * Решение «открывать ли ворота» для брелока (RF) и входящего звонка/SMS (GSM)
+ * и его учёт: метрики и запись в журнал доступа (AuditLog).
+ *
+ * RF: ключ списка ищется по отпечатку пакета (keyMatches) — с допуском по
+ * частоте приёмника (±1 МГц) и по TE (±40%), по bitString (короткие — точно,
+ * длинные — на 95%), по коду при другом протоколе и по вхождению одной
+ * bitString в другую (CAME 24 / X10 20). Затем — включён ли ключ и пускает ли
+ * его расписание сейчас.
+ * GSM: номер в индексе PhoneIndex, разрешён ли канал (звонок/SMS) и
+ * расписание; маска ворот — из того же индекса.
+ *
+ * Без обращений к радио, UART и сети: собирается и на хосте — симулятор
+ * ворот (sim/gate_sim) принимает решения этим же кодом.
+ * Вызывать под StateLock (список ключей, PhoneIndex, Schedule).
+ */
+namespace AccessDecision {
+  enum Outcome : uint8_t {
+    OPEN = 0,
+    UNKNOWN,          // ключа нет в списке / номер не доверен для канала
+    DISABLED,         // ключ в списке, но отключён
+    OUT_OF_SCHEDULE   // не его часы (или время ещё не получено)
+  };
+
+  // Отпечаток ключа: сохранённого в списке или только что принятого
+  struct Signature {
+    const char* protocol;
+    const char* bitString;  // "0101…", "" — нет (RAW)
+    int bitLength;
+    uint32_t code;          // младшие 32 бита
+    float te;               // мкс, 0 — неизвестен
+    float frequency;        // МГц; у принятого — текущая частота приёмника
+  };
+
+  /**
+   * Доля совпавших позиций от длины более длинной строки не меньше minSimilarity
+   */
+  bool bitStringsSimilar(const char* a, const char* b, float minSimilarity);
+
+  bool keyMatches(const Signature& saved, const Signature& received);
+
+  /**
+   * Первый ключ списка, подходящий к пакету
+   * @param signatureOf - отпечаток элемента списка: Signature(const Item&)
+   * @return индекс в списке, -1 — нет
+   */
+  template <typename List, typename SignatureOf>
+  int findKey(const List& keys, const Signature& received, SignatureOf signatureOf) {
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (keyMatches(signatureOf(keys[i]), received)) return (int)i;
+    }
+    return -1;
+  }
+
+  /**
+   * Пускает ли расписание scheduleId сейчас (Schedule по часу недели TimeSource)
+   */
+  bool scheduleAllows(uint8_t scheduleId, unsigned long nowMs);
+
+  /**
+   * RF: решение по результату findKey (found < 0 — ключа нет)
+   */
+  Outcome decideKey(int found, bool enabled, uint8_t scheduleId, unsigned long nowMs);
+
+  /**
+   * Учёт решения RF: метрика и запись в журнал доступа (UNKNOWN — только метрика).
+   * OPEN — после того, как команда воротам поставлена в очередь.
+   */
+  void recordKey(Outcome outcome, uint32_t code, int rssi, uint32_t latencyUs);
+
+  /**
+   * GSM: решение по номеру для канала (звонок/SMS)
+   * @param gates - если не nullptr и номер в списке, сюда — его маска ворот
+   */
+  Outcome decidePhone(const char* number, bool isCall, unsigned long nowMs, uint8_t* gates = nullptr);
+
+  /**
+   * Учёт решения GSM: метрика и запись в журнал доступа
+   */
+  void recordPhone(Outcome outcome, const String& number);
+}
+
+#endif // ACCESS_DECISION_H
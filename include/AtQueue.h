@@ -0,0 +1,122 @@
+#ifndef AT_QUEUE_H
+#define AT_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "AtTokenizer.h"
+#include "GsmPort.h"
+
+/**
+ * Модуль AtQueue.h
+ * Асинхронная очередь AT-команд модема: конфигурация, ATH и опрос состояния
+ * (уровень сигнала, регистрация в сети) не перебивают друг друга.
+ *
+ *  - три полосы приоритета: URGENT (ATH) вперёд NORMAL (конфигурация),
+ *    NORMAL вперёд BACKGROUND (опрос состояния);
+ *  - в работе одна команда (SIM800L не принимает следующую до ответа);
+ *    следующая уходит в UART сразу по финальному ответу предыдущей,
+ *    в том же проходе разбора;
+ *  - финальный ответ — OK / ERROR / +CME ERROR / +CMS ERROR; строка-ответ
+ *    запроса (+CSQ:, +CREG:) отдаётся колбэку onInfo;
+ *  - у каждой команды свой таймаут и число повторов (ERROR и таймаут
+ *    повторяются, потом onDone с результатом);
+ *  - URC (RING, +CLIP, +CMT) очередь не забирает — consume() вернёт false,
+ *    и строка уходит обработчику звонков/SMS даже посреди команды.
+ *
+ * Без зависимостей от Arduino: время передаётся снаружи (millis()).
+ */
+namespace At {
+  enum Priority : uint8_t {
+    PRIORITY_URGENT = 0,  // сброс звонка
+    PRIORITY_NORMAL,      // проба и конфигурация модема
+    PRIORITY_BACKGROUND,  // периодический опрос
+    PRIORITY_COUNT
+  };
+
+  enum Result : uint8_t {
+    RESULT_OK = 0,
+    RESULT_ERROR,    // ERROR / +CME ERROR / +CMS ERROR после всех повторов
+    RESULT_TIMEOUT   // нет ответа после всех повторов
+  };
+
+  class CommandQueue {
+  public:
+    static const size_t MAX_COMMAND = 32;
+    static const int LANE_SIZE = 6;
+
+    typedef void (*InfoFn)(const Tokenizer& line);
+    typedef void (*DoneFn)(int tag, Result result);
+
+    struct Request {
+      const char* text = nullptr;          // копируется в очередь
+      Priority priority = PRIORITY_NORMAL;
+      uint32_t timeoutMs = 2000;
+      uint8_t retries = 0;                 // повторов после первой попытки
+      Kind infoKind = KIND_OTHER;          // строка-ответ запроса, KIND_OTHER — нет
+      InfoFn onInfo = nullptr;
+      DoneFn onDone = nullptr;
+      int tag = 0;                         // возвращается в onDone
+    };
+
+    CommandQueue();
+
+    void attach(GsmPort* port);
+
+    /**
+     * Поставить команду в очередь (уходит сразу, если модем свободен).
+     * @return false — полоса приоритета заполнена, команда не принята
+     */
+    bool submit(const Request& request, uint32_t nowMs);
+
+    /**
+     * Строка от модема. Вызывать на каждую строку до обработки URC.
+     * @return true — строка — ответ текущей команды (дальше не разбирать)
+     */
+    bool consume(const Tokenizer& line, uint32_t nowMs);
+
+    /**
+     * Таймауты и повторы. Вызывать на каждой итерации loop().
+     */
+    void poll(uint32_t nowMs);
+
+    /**
+     * Сбросить всё без колбэков (смена скорости, потеря модема).
+     * Запоздавший ответ на снятую команду засчитается следующей — поэтому
+     * после clear() начинают с пробы "AT", а не с команды с последствиями.
+     */
+    void clear();
+
+    bool idle() const { return !active; }
+    int pending() const;
+    bool contains(const char* text) const;  // в работе или в очереди
+
+  private:
+    struct Slot {
+      char text[MAX_COMMAND];
+      uint32_t timeoutMs;
+      uint8_t retriesLeft;
+      Kind infoKind;
+      InfoFn onInfo;
+      DoneFn onDone;
+      int tag;
+    };
+
+    struct Lane {
+      Slot slots[LANE_SIZE];
+      uint8_t head;
+      uint8_t count;
+    };
+
+    void sendNext(uint32_t nowMs);
+    void transmit(uint32_t nowMs);
+    void finish(Result result, uint32_t nowMs);
+
+    GsmPort* port;
+    Lane lanes[PRIORITY_COUNT];
+    Slot current;
+    bool active;
+    uint32_t sentAt;
+  };
+}
+
+#endif // AT_QUEUE_H
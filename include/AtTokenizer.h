@@ -0,0 +1,107 @@
+#ifndef AT_TOKENIZER_H
+#define AT_TOKENIZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Модуль AtTokenizer.h
+ * Потоковый разбор ответов и URC модема (SIM800L) без выделения памяти.
+ *
+ * Байты идут в фиксированный буфер строки, и всё считается по ходу приёма:
+ *  - тип строки — проходом по префиксному дереву (строится один раз из
+ *    таблицы ключевых слов): OK, ERROR, RING, +CLIP:, +CMT:, +CME/+CMS ERROR:, +CSQ:, +CREG:,
+ *    +CCLK:;
+ *  - поля после "<префикс>:" — границы запоминаются по мере прихода байт,
+ *    кавычки снимаются, запятая внутри кавычек поле не делит
+ *    (+CMT: "+7999...","","24/07/05,12:00:00+12" — три поля);
+ *  - доля печатаемых символов — счётчиком (мусор при подборе скорости → KIND_JUNK);
+ *    корректные последовательности UTF-8 (кириллица в тексте SMS) — печатаемые.
+ * Поля и строка отдаются как View — указатель в буфер токенизатора, валидный
+ * до следующего feed().
+ *
+ * Без зависимостей от Arduino — собирается и на хосте (проверка на записанном
+ * потоке байт).
+ */
+namespace At {
+  enum Kind : uint8_t {
+    KIND_OTHER = 0,  // эхо команд, "Call Ready", тело SMS и прочее
+    KIND_OK,
+    KIND_ERROR,
+    KIND_RING,
+    KIND_CLIP,       // +CLIP: "<номер>",<тип>,...
+    KIND_CMT,        // +CMT: "<номер>","<имя>","<время>" (следом строка — текст)
+    KIND_CME_ERROR,  // +CME ERROR: <код>
+    KIND_CMS_ERROR,  // +CMS ERROR: <код>
+    KIND_CSQ,        // +CSQ: <rssi>,<ber> (ответ на AT+CSQ)
+    KIND_CREG,       // +CREG: <n>,<stat> (ответ на AT+CREG?)
+    KIND_CCLK,       // +CCLK: "<yy/MM/dd,hh:mm:ss±zz>" (ответ на AT+CCLK?)
+    KIND_JUNK        // мало печатаемых символов или строка длиннее буфера
+  };
+
+  struct View {
+    const char* data;
+    uint16_t len;
+
+    bool empty() const { return len == 0; }
+    bool equals(const View& other) const;
+    bool equals(const char* text) const;
+    /**
+     * Копия в out с завершающим нулём (обрезается по outSize)
+     * @return длина скопированного
+     */
+    size_t copyTo(char* out, size_t outSize) const;
+  };
+
+  class Tokenizer {
+  public:
+    static const size_t MAX_LINE = 256;
+    static const int MAX_FIELDS = 8;
+
+    Tokenizer();
+
+    /**
+     * Очередной байт из UART.
+     * @return true — строка завершена (непустая), доступны kind()/line()/field()
+     */
+    bool feed(char c);
+
+    /**
+     * Сброс недособранной строки (смена скорости UART)
+     */
+    void reset();
+
+    Kind kind() const { return lineKind; }
+    View line() const { return {buf, (uint16_t)len}; }
+    int fieldCount() const { return fields; }
+    View field(int index) const;
+
+  private:
+    void startLine();
+    void finishLine();
+    void countPrintable(uint8_t c);
+
+    char buf[MAX_LINE];
+    size_t len;
+    bool complete;      // последняя строка выдана — следующий байт начинает новую
+    bool overflow;
+    size_t printable;
+    uint8_t utf8Left;   // сколько байт продолжения UTF-8 ещё ждём
+    uint8_t utf8Bytes;  // длина текущей последовательности UTF-8
+    uint8_t node;       // текущий узел префиксного дерева (0 — корень)
+    bool trieDead;      // строка разошлась с деревом
+    Kind matched;       // последний пройденный префикс-терминал
+    bool exactOnly;     // matched требует точного совпадения строки
+    size_t matchedLen;
+    Kind lineKind;
+
+    // Поля после двоеточия префикса
+    bool inPayload;
+    bool inQuotes;
+    int fields;
+    uint16_t fieldStart[MAX_FIELDS];
+    uint16_t fieldEnd[MAX_FIELDS];
+  };
+}
+
+#endif // AT_TOKENIZER_H
@@ -0,0 +1,129 @@
+#ifndef AUDIT_LOG_H
+#define AUDIT_LOG_H
+
+#include <Arduino.h>
+#include <vector>
+
+/**
+ * Модуль AuditLog.h
+ * Журнал доступа: каждое решение об открытии ворот — запись фиксированного
+ * размера (16 байт) в кольцевом файле /audit.bin на SPIFFS; выборка по
+ * времени, источнику и субъекту — без разбора текстового лога.
+ *
+ * Файл: [заголовок: 256 байт][страница 0]...[страница PAGE_COUNT-1], в
+ * странице RECORDS_PER_PAGE записей. Страница — временная корзина: время
+ * первой записи каждой страницы держится в RAM, запрос по диапазону времени
+ * сразу переходит к нужной странице, а не сканирует кольцо.
+ *
+ * Время — «секунды устройства»: монотонны и между перезагрузками (после
+ * старта отсчёт продолжается от последней записи), но это не календарное
+ * время — часов реального времени в устройстве нет. Ответ /api/audit
+ * содержит текущее значение now, по нему клиент переводит записи в своё время.
+ *
+ * record() можно звать из любой задачи: запись только кладётся в небольшую
+ * очередь в RAM, во флеш её переносит flush() из задачи HTTP — на пути
+ * решения об открытии обращений к флешу нет.
+ */
+namespace AuditLog {
+  enum Source : uint8_t {
+    SOURCE_RF = 1,
+    SOURCE_GSM = 2,
+    SOURCE_HTTP = 3
+  };
+
+  enum Decision : uint8_t {
+    DECISION_OPENED = 0,
+    DECISION_DISABLED = 1,  // ключ в базе, но отключён
+    DECISION_DENIED = 2,    // номер не доверен
+    DECISION_OUT_OF_SCHEDULE = 3  // в базе, но сейчас не его часы (или время неизвестно)
+  };
+
+  struct Record {
+    uint32_t time;       // секунды устройства
+    uint32_t subject;    // код ключа (RF), phoneId номера (GSM), 0 (HTTP)
+    uint16_t latencyUs;  // от приёма до решения (насыщение 65535)
+    int8_t rssi;         // дБм, 0 — нет
+    uint8_t source;      // Source
+    uint8_t decision;    // Decision
+    uint8_t boot;        // младший байт номера загрузки
+    uint16_t reserved;
+  };
+  static_assert(sizeof(Record) == 16, "AuditLog::Record должен занимать 16 байт");
+
+  static const uint32_t RECORDS_PER_PAGE = 16;   // 256 байт — страница SPIFFS
+  static const uint32_t PAGE_COUNT = 64;
+  static const uint32_t CAPACITY = RECORDS_PER_PAGE * PAGE_COUNT;
+
+  // Использование по субъекту (ключу/номеру) — по записям, что есть в кольце;
+  // субъект без открытий в кольце в статистику не попадает
+  struct SubjectStats {
+    uint8_t source;
+    uint32_t subject;
+    uint32_t opened;     // число открытий
+    uint32_t lastUsed;   // время последнего открытия (секунды устройства)
+  };
+
+  /**
+   * Открытие (создание) файла, построение индекса страниц и статистики.
+   * Вызывать после SPIFFS.begin().
+   */
+  void init();
+
+  /**
+   * Событие доступа. Не трогает флеш; очередь полна — запись теряется
+   * (учитывается в dropped()).
+   */
+  void record(Source source, uint32_t subject, int rssi, Decision decision, uint32_t latencyUs = 0);
+
+  /**
+   * Перенос очереди во флеш. Вызывать из задачи HTTP.
+   */
+  void flush();
+
+  /**
+   * @return текущее время устройства, секунды
+   */
+  uint32_t now();
+  uint8_t bootNumber();
+
+  /**
+   * Идентификатор номера телефона: хеш последних 10 цифр (форматы
+   * +7…/8…/7… одного номера дают один id)
+   */
+  uint32_t phoneId(const String& number);
+
+  // Номера записей — монотонные (seq): [oldest(), head())
+  uint32_t head();
+  uint32_t oldest();
+
+  /**
+   * @return номер первой записи страницы, в которую попадает время time
+   *         (по индексу страниц в RAM, без чтения файла)
+   */
+  uint32_t seekTime(uint32_t time);
+
+  /**
+   * Последовательное чтение записей со страничным буфером.
+   * Только из задачи HTTP (как и flush()).
+   */
+  class Reader {
+  public:
+    explicit Reader(uint32_t fromSeq) : seq(fromSeq) {}
+    bool next(Record& record);
+    uint32_t position() const { return seq; }
+  private:
+    uint32_t seq;
+    uint32_t bufStart = 0;
+    uint32_t bufCount = 0;
+    Record buf[RECORDS_PER_PAGE];
+  };
+
+  std::vector<SubjectStats> stats();
+
+  uint32_t dropped();
+
+  const char* sourceName(uint8_t source);
+  const char* decisionName(uint8_t decision);
+}
+
+#endif // AUDIT_LOG_H
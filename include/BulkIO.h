@@ -0,0 +1,90 @@
+#ifndef BULK_IO_H
+#define BULK_IO_H
+
+#include <Arduino.h>
+#include <functional>
+
+/**
+ * Модуль BulkIO.h
+ * Потоковый разбор массового импорта (CSV / NDJSON) и экранирование экспорта.
+ *
+ * Тело загрузки приходит кусками по ~1.4 КБ (HTTPUpload::buf) — целиком в RAM
+ * его не держим: LineReader собирает из кусков строки в фиксированном буфере
+ * и отдаёт их по одной. Сами записи (ключи/телефоны) разбирает main.cpp —
+ * модуль ничего не знает о SystemState.
+ */
+namespace BulkIO {
+  enum class Format { NDJSON, CSV };
+
+  // Максимальная длина одной строки импорта (ключ с длинным rawData помещается)
+  static const size_t MAX_LINE = 768;
+  // Максимум полей в CSV-строке
+  static const int MAX_FIELDS = 16;
+
+  /**
+   * Колбэк готовой строки. line — без \r\n, NUL-терминирована,
+   * можно модифицировать на месте (splitCsv так и делает).
+   * @return false — прекратить разбор (ошибка валидации)
+   */
+  typedef std::function<bool(char* line, size_t len)> LineFn;
+
+  /**
+   * Сборщик строк из произвольно нарезанного потока байт.
+   * Для CSV (setCsvQuotes) \n внутри поля в кавычках — часть поля, а не
+   * конец записи: экспорт так кавычит имена и rawData с переводом строки.
+   * В NDJSON перевод строки внутри строки JSON всегда экранирован.
+   */
+  class LineReader {
+  public:
+    void reset();
+    void setCsvQuotes(bool on) { csvQuotes = on; }
+
+    /**
+     * Скормить очередной кусок тела. Для каждой полной строки зовёт onLine.
+     * @return false — строка длиннее MAX_LINE или onLine вернул false
+     */
+    bool feed(const uint8_t* data, size_t len, const LineFn& onLine);
+
+    /**
+     * Дочитать последнюю строку без завершающего \n (конец загрузки).
+     */
+    bool finish(const LineFn& onLine);
+
+    bool overflowed() const { return overflow; }
+
+  private:
+    char buf[MAX_LINE + 1];
+    size_t len = 0;
+    bool overflow = false;
+    bool csvQuotes = false;
+    bool inQuotes = false;  // "" внутри поля переключает дважды — состояние не меняется
+
+    bool emit(const LineFn& onLine);
+  };
+
+  /**
+   * Определение формата по имени файла, при неоднозначности — по первому
+   * непустому символу ('{' → NDJSON, иначе CSV).
+   */
+  Format detectFormat(const String& filename, const uint8_t* head, size_t len);
+
+  /**
+   * Разбиение CSV-строки на месте: поля в кавычках, "" внутри кавычек, разделитель ',' или ';'.
+   * @return количество полей (не больше maxFields)
+   */
+  int splitCsv(char* line, char* fields[], int maxFields);
+
+  /**
+   * Разбор логического значения из CSV: 1/0, true/false, yes/no, да/нет.
+   * @param out - результат, если значение распознано
+   * @return false, если строка не похожа на bool
+   */
+  bool parseBool(const char* s, bool& out);
+
+  /**
+   * Экранирование поля для CSV-экспорта (кавычки, если есть , ; " или перевод строки)
+   */
+  String csvField(const String& s);
+}
+
+#endif // BULK_IO_H
@@ -78,6 +78,20 @@ public:
     // Получить счетчик прерываний (для отладки)
     static unsigned long getInterruptCount();
     
+    // Отвод принятых импульсов (визуализатор). Вызывается из checkReceived()
+    // до декодирования, буфер валиден только на время вызова. nullptr — выключен.
+    typedef void (*PulseTap)(const volatile unsigned long* timings, const volatile bool* levels,
+                             int count, int rssi);
+    static void setPulseTap(PulseTap tap);
+
+    // micros() конца последнего принятого пакета (отсчёт задержки до реле)
+    static unsigned long getLastSignalMicros();
+
+    // Вызывается из ISR, когда буфер импульсов готов к разбору (будит loop).
+    // Функция должна быть IRAM_ATTR. nullptr — выключен.
+    typedef void (*SignalReadyHook)();
+    static void setSignalReadyHook(SignalReadyHook hook);
+
     // Callback для обработки прерывания
     static void IRAM_ATTR onInterrupt();
 
@@ -88,6 +102,8 @@ private:
     static volatile bool receivedFlag;
     static ReceivedKey lastKey;
     static int gdo0PinNumber;
+    static PulseTap pulseTap;
+    static volatile SignalReadyHook signalReadyHook;
 
     // Работа в RAW (direct) режиме
     static bool configureForRawMode();
@@ -110,6 +126,8 @@ private:
     static volatile unsigned long interruptCounter;
     static volatile bool firstEdgeCaptured;
     static volatile bool lastSignalLevel;
+    static volatile unsigned long signalReadyAt;  // ISR: момент готовности буфера
+    static unsigned long lastSignalAt;            // копия для разбираемого пакета
     static unsigned long lastDetectionTime;
     static uint32_t lastDetectionHash;
     static uint32_t lastDetectionCode;  // Последний декодированный код
@@ -0,0 +1,110 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <Arduino.h>
+
+/**
+ * Модуль EventBus.h
+ * Внутренняя шина событий между подсистемами и задачами FreeRTOS.
+ *
+ * Источник публикует типизированное событие, а выполняет его подписчик
+ * в своей задаче — без прямых вызовов между задачами и без StateLock:
+ *   gate_command — «открыть ворота» (RF, GSM, HTTP) с маской ворот → задача
+ *                  loop (единственный владелец GateControl и счётчика открытий);
+ *   gate_phase   — смена фазы одних ворот (loop) → задача http (событие gate_status).
+ *
+ * У каждого подписчика своя преаллоцированная очередь на QUEUE_CAPACITY
+ * событий — MpmcRing (ограниченная MPMC Вьюкова): публиковать можно из
+ * любой задачи без блокировок и без heap. Очередь полна — событие для этого
+ * подписчика отбрасывается и учитывается. Подписчиков не больше
+ * MAX_SUBSCRIBERS, так что публикация — не больше MAX_SUBSCRIBERS копий.
+ *
+ * subscribe() — только в setup(), до запуска задач. dispatch() вызывает
+ * задача-владелец подписки; обработчики выполняются в ней.
+ *
+ * В /metrics: gate_bus_published_total, gate_bus_dropped_total,
+ * gate_bus_queue_depth_max (по темам), gate_bus_queue_depth (по подписчикам).
+ */
+namespace EventBus {
+  enum Topic : uint8_t {
+    TOPIC_GATE_COMMAND = 0,
+    TOPIC_GATE_PHASE,
+    TOPIC_COUNT
+  };
+
+  inline uint32_t topicBit(Topic topic) { return 1u << topic; }
+
+  // Кто открывает ворота (значения как у AuditLog::Source)
+  enum Source : uint8_t {
+    SOURCE_RF = 1,
+    SOURCE_GSM = 2,
+    SOURCE_HTTP = 3
+  };
+
+  struct GateCommand {
+    Source source;
+    uint8_t gates;  // бит i — ворота i (маска ключа/телефона, ворота запроса HTTP)
+  };
+
+  // Имена — строковые литералы GateControl (phaseName/nextDirName)
+  struct GatePhase {
+    uint8_t gate;
+    const char* phase;
+    const char* next;
+    float position;
+  };
+
+  struct Event {
+    Topic topic;
+    uint32_t timestamp;  // millis() публикации
+    union {
+      GateCommand gateCommand;
+      GatePhase gatePhase;
+    };
+  };
+
+  typedef void (*Handler)(const Event& event);
+  // Разбудить задачу-подписчика после публикации (например, Scheduler::wake)
+  typedef void (*Notify)();
+
+  static const int MAX_SUBSCRIBERS = 4;
+  static const uint32_t QUEUE_CAPACITY = 16;  // степень двойки
+
+  /**
+   * Подписка на набор тем (маска topicBit). Только из setup().
+   * @return id подписчика, -1 — нет слота
+   */
+  int subscribe(const char* name, uint32_t topics, Handler handler, Notify notify = nullptr);
+
+  /**
+   * @return false — событие не дошло хотя бы до одного подписчика темы
+   *         (очередь полна) или подписчиков нет
+   */
+  bool publish(const Event& event);
+  bool publishGateCommand(Source source, uint8_t gates);
+  void publishGatePhase(uint8_t gate, const char* phase, const char* next, float position);
+
+  /**
+   * Выполнить обработчик для накопившихся событий подписчика
+   * (из задачи-владельца). Не больше maxEvents за вызов.
+   * @return сколько событий обработано
+   */
+  int dispatch(int subscriber, int maxEvents = QUEUE_CAPACITY);
+
+  struct TopicStats {
+    uint32_t published;
+    uint32_t delivered;  // поставлено в очереди подписчиков
+    uint32_t dropped;    // очередь подписчика была полна
+    uint32_t maxDepth;   // наибольшая глубина очереди при постановке
+  };
+
+  const char* topicName(Topic topic);
+  TopicStats topicStats(Topic topic);
+
+  /**
+   * Метрики шины в формате OpenMetrics (без "# EOF")
+   */
+  void writeMetrics(Print& out);
+}
+
+#endif // EVENT_BUS_H
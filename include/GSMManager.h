@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <functional>
+#include "GsmPort.h"
 
 /**
  * Модуль GSMManager.h
@@ -12,6 +13,9 @@
  * Белый список хранится в main.cpp (systemState.phones, управляется через веб-UI),
  * поэтому модуль не имеет своего хранилища — main.cpp передаёт колбэки.
  *
+ * Заодно модуль — источник времени для расписаний: часы сети оператора
+ * (AT+CCLK?) уходят в TimeSource.
+ *
  * Используются только NET (антенна), VCC, GND, RXD, TXD модуля.
  * Микрофон/динамик/DTR/RING не задействованы.
  */
@@ -20,15 +24,17 @@ namespace GSMManager {
    * Колбэк проверки номера по белому списку.
    * @param number - номер в том виде, как его прислал модуль (+CLIP/+CMT)
    * @param isCall - true = входящий звонок (флаг callEnabled), false = SMS (smsEnabled)
-   * @return true, если номер доверенный для этого канала
+   * @return маска ворот номера (бит i — ворота i), если номер доверенный для
+   *         этого канала; 0 — не доверен
    */
-  typedef std::function<bool(const String& number, bool isCall)> TrustedCheckFn;
+  typedef std::function<uint8_t(const String& number, bool isCall)> TrustedCheckFn;
 
   /**
    * Колбэк открытия ворот.
-   * @param source - описание источника для логов ("Звонок +7...", "SMS +7...")
+   * @param source - описание источника для логов ("звонок +7...", "SMS +7...")
+   * @param gates - маска ворот, которую вернул trustedCheck
    */
-  typedef std::function<void(const String& source)> GateOpenFn;
+  typedef std::function<void(const String& source, uint8_t gates)> GateOpenFn;
 
   /**
    * Инициализация GSM модуля (неблокирующая — реальная настройка SIM800L
@@ -40,6 +46,11 @@ namespace GSMManager {
    */
   void init(int rxPin, int txPin, TrustedCheckFn trustedCheck, GateOpenFn gateOpen);
 
+  /**
+   * То же на произвольном порту (симулятор модема на хосте, см. sim/)
+   */
+  void init(GsmPort* port, TrustedCheckFn trustedCheck, GateOpenFn gateOpen);
+
   /**
    * Обработка GSM событий (инициализация модуля, +CLIP, +CMT).
    * Вызывать на каждой итерации loop(). Не блокирует.
@@ -50,6 +61,16 @@ namespace GSMManager {
    * @return true, если SIM800L ответил и сконфигурирован (АОН + SMS в UART)
    */
   bool isReady();
+
+  /**
+   * Состояние модема по последнему опросу (AT+CSQ / AT+CREG? раз в 30 с в READY)
+   */
+  struct Health {
+    int signal;         // rssi 0..31 из +CSQ (99 — неизвестно), -1 — ещё не опрошен
+    int registration;   // stat из +CREG: 1 дома, 5 роуминг, 2 поиск, 3 отказ; -1 — нет данных
+    uint32_t polledAt;  // millis() последнего успешного опроса, 0 — не было
+  };
+  Health getHealth();
 }
 
 #endif // GSM_MANAGER_H
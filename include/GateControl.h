@@ -12,57 +12,103 @@
  * Полный цикл ведёт прошивка: держим канал «открыть» время открытия →
  * пауза «открыто» → держим канал «закрыть» время закрытия.
  * Оба канала никогда не активны одновременно (interlock).
+ *
+ * Один контроллер может вести несколько ворот (въезд, выезд, калитка):
+ * каждый Gate — своя пара реле, свои тайминги и своё пошаговое состояние.
+ * Объект не выделяет памяти и не держит задач: update() — сравнение времени
+ * фазы, для ворот в покое или в стопе — сразу выход, так что опрос всех
+ * ворот на каждой итерации loop() ничего заметного не стоит.
  */
 namespace GateControl {
-  /**
-   * Инициализация управления воротами
-   * @param openPin - GPIO ключа реле K1 (канал «открыть»)
-   * @param closePin - GPIO ключа реле K2 (канал «закрыть»)
-   */
-  void init(int openPin, int closePin);
-
-  /**
-   * Запуск/шаг цикла ворот (неблокирующий, обслуживается в update()).
-   * Пошаговая логика команд, как у штатных приводов:
-   * покой — открытие; во время движения (открытие/закрытие) — стоп;
-   * из стопа — движение в обратную сторону через защитную паузу 500 мс
-   * (мёртвое время против мгновенного реверса мотора);
-   * в паузе «открыто» — закрытие, не дожидаясь автозакрытия.
-   * @param openMs - время удержания канала «открыть», мс
-   * @param stayMs - пауза «открыто» до автозакрытия, мс
-   * @param closeMs - время удержания канала «закрыть», мс
-   */
-  void startCycle(unsigned long openMs, unsigned long stayMs, unsigned long closeMs);
-
-  /**
-   * Обслуживание цикла — переключение фаз по таймерам.
-   * Должна вызываться на каждой итерации loop().
-   */
-  void update();
-
-  /**
-   * @return true, пока цикл не завершён (любая фаза кроме покоя)
-   */
-  bool isCycleActive();
-
-  /**
-   * Имя текущей фазы для UI/API:
-   * "closed" | "opening" | "open" | "closing" | "stopped".
-   * Переходная пауза реверса отдаётся как целевое движение.
-   */
-  const char* phaseName();
-
-  /**
-   * Что сделает следующая команда из фазы "stopped": "open" | "close"
-   */
-  const char* nextDirName();
-
-  /**
-   * Текущая позиция створки по времени хода: 0.0 = закрыто, 1.0 = открыто.
-   * Во время движения считается на лету, в остальных фазах — зафиксирована.
-   * После стопа движение в любую сторону идёт остаток пути, а не полный тайминг.
-   */
-  float positionNow();
+  // Верхняя граница числа ворот (маски ворот ключей и телефонов — 4 бита)
+  static const int MAX_GATES = 4;
+
+  class Gate {
+  public:
+    /**
+     * Инициализация ворот
+     * @param id - номер ворот (0..MAX_GATES-1), для журнала
+     * @param openPin - GPIO ключа реле K1 (канал «открыть»)
+     * @param closePin - GPIO ключа реле K2 (канал «закрыть»)
+     */
+    void begin(uint8_t id, int openPin, int closePin);
+
+    /**
+     * Запуск/шаг цикла ворот (неблокирующий, обслуживается в update()).
+     * Пошаговая логика команд, как у штатных приводов:
+     * покой — открытие; во время движения (открытие/закрытие) — стоп;
+     * из стопа — движение в обратную сторону через защитную паузу 500 мс
+     * (мёртвое время против мгновенного реверса мотора);
+     * в паузе «открыто» — закрытие, не дожидаясь автозакрытия.
+     * @param openMs - время удержания канала «открыть», мс
+     * @param stayMs - пауза «открыто» до автозакрытия, мс
+     * @param closeMs - время удержания канала «закрыть», мс
+     */
+    void startCycle(unsigned long openMs, unsigned long stayMs, unsigned long closeMs);
+
+    /**
+     * Обслуживание цикла — переключение фаз по таймерам.
+     * Вызывать на каждой итерации loop(); now — millis() этой итерации
+     * (один на все ворота).
+     */
+    void update(unsigned long now);
+
+    /**
+     * @return true, пока цикл не завершён (любая фаза кроме покоя)
+     */
+    bool isCycleActive() const;
+
+    /**
+     * Имя текущей фазы для UI/API:
+     * "closed" | "opening" | "open" | "closing" | "stopped".
+     * Переходная пауза реверса отдаётся как целевое движение.
+     */
+    const char* phaseName() const;
+
+    /**
+     * Что сделает следующая команда из фазы "stopped": "open" | "close"
+     */
+    const char* nextDirName() const;
+
+    /**
+     * Текущая позиция створки по времени хода: 0.0 = закрыто, 1.0 = открыто.
+     * Во время движения считается на лету, в остальных фазах — зафиксирована.
+     * После стопа движение в любую сторону идёт остаток пути, а не полный тайминг.
+     */
+    float positionNow() const;
+
+    uint8_t id() const { return gateId; }
+
+  private:
+    // Фазы цикла: открытие (канал 1) → открыто (оба выкл) → закрытие (канал 2).
+    // Пошаговая логика команд: движение → STOPPED → движение в обратную сторону.
+    // REVERSE_PAUSE — защитная пауза перед сменой направления:
+    // мгновенный реверс мотора без мёртвого времени даёт бросок тока.
+    enum class Phase : uint8_t { IDLE, OPENING, WAITING, CLOSING, STOPPED, REVERSE_PAUSE };
+
+    void setChannels(bool open, bool close);
+    void enterPhase(Phase next);
+    void freezePosition();
+    String logPrefix() const;
+
+    int openPin = -1;
+    int closePin = -1;
+    uint8_t gateId = 0;
+    Phase phase = Phase::IDLE;
+    Phase nextDir = Phase::OPENING;   // Куда ехать после STOPPED/REVERSE_PAUSE
+
+    unsigned long phaseStart = 0;     // Начало текущей фазы (millis)
+    unsigned long openDuration = 0;   // Время полного хода на открытие, мс
+    unsigned long stayDuration = 0;   // Пауза «открыто», мс
+    unsigned long closeDuration = 0;  // Время полного хода на закрытие, мс
+
+    // Позиция створки по времени хода: 0.0 = закрыто, 1.0 = открыто.
+    // Фаза движения длится остаток пути, а не полный тайминг: приоткрыли на 60% —
+    // закрытие займёт 60% времени закрытия (и симметрично для недозакрытых).
+    float position = 0.0f;
+    float phaseStartPos = 0.0f;       // Позиция на входе в фазу движения
+    unsigned long phaseDuration = 0;  // Длительность текущей фазы движения, мс
+  };
 }
 
 #endif // GATE_CONTROL_H
@@ -0,0 +1,26 @@
+#ifndef GSM_PORT_H
+#define GSM_PORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Модуль GsmPort.h
+ * Последовательный порт модема для GSMManager. На устройстве — UART2
+ * (HardwareSerial), на хосте — симулятор SIM800L (sim/ModemSim), который
+ * проигрывает сценарии URC с задержками, ошибками и шумом.
+ */
+class GsmPort {
+public:
+  virtual ~GsmPort() {}
+
+  virtual void begin(uint32_t baud) = 0;
+  // Смена скорости при поиске модуля (без переоткрытия порта)
+  virtual void setBaud(uint32_t baud) = 0;
+
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual void write(const char* data, size_t len) = 0;
+};
+
+#endif // GSM_PORT_H
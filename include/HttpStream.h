@@ -0,0 +1,98 @@
+#ifndef HTTP_STREAM_H
+#define HTTP_STREAM_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include <ArduinoJson.h>
+
+/**
+ * Модуль HttpStream.h
+ * Потоковый ответ HTTP (Transfer-Encoding: chunked) поверх синхронного WebServer.
+ *
+ * ChunkedWriter копит вывод в небольшом фиксированном буфере и отправляет его
+ * чанком при заполнении: память не зависит от размера ответа (списки на сотни
+ * записей не собираются целиком в String).
+ *
+ * Это Print — в него можно печатать и serializeJson(doc, writer).
+ */
+class ChunkedWriter : public Print {
+public:
+  explicit ChunkedWriter(WebServer& server) : server(server) {}
+  ~ChunkedWriter() { end(); }
+
+  /**
+   * Отправка заголовков (длина неизвестна → chunked).
+   * Дополнительные заголовки (sendHeader) нужно выставить ДО begin().
+   */
+  void begin(int code, const char* contentType);
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* data, size_t len) override;
+  using Print::write;
+
+  /**
+   * Досылка буфера и завершающего нулевого чанка. Повторный вызов безопасен.
+   */
+  void end();
+
+  /**
+   * @return суммарно отправлено байт тела
+   */
+  size_t bytesSent() const { return total; }
+
+private:
+  static const size_t BUF_SIZE = 1024; // ~ один TCP-сегмент: меньше накладных на чанки
+
+  WebServer& server;
+  char buf[BUF_SIZE];
+  size_t len = 0;
+  size_t total = 0;
+  bool started = false;
+  bool finished = false;
+
+  void flush();
+};
+
+/**
+ * Потоковый JSON-массив: "[", записи через запятую, "]".
+ * Каждая запись собирается в один переиспользуемый JsonDocument и сразу
+ * сериализуется в ChunkedWriter — в heap одновременно живёт только одна
+ * запись, сколько бы их ни было в списке.
+ *
+ *   JsonArrayStream stream(server);
+ *   stream.begin();
+ *   for (...) stream.add([&](JsonObject obj) { obj["code"] = ...; });
+ *   stream.end();
+ */
+class JsonArrayStream {
+public:
+  explicit JsonArrayStream(WebServer& server) : out(server) {}
+  ~JsonArrayStream() { end(); }
+
+  void begin(int code = 200);
+
+  template <typename Fill>
+  void add(Fill fill) {
+    item.clear();
+    fill(item.to<JsonObject>());
+    if (count > 0) out.write(',');
+    serializeJson(item, out);
+    count++;
+  }
+
+  /**
+   * Закрывающая скобка и завершение chunked-ответа. Повторный вызов безопасен.
+   */
+  void end();
+
+  size_t size() const { return count; }
+  size_t bytesSent() const { return out.bytesSent(); }
+
+private:
+  ChunkedWriter out;
+  JsonDocument item;
+  size_t count = 0;
+  bool closed = false;
+};
+
+#endif // HTTP_STREAM_H
@@ -0,0 +1,69 @@
+#ifndef LOG_QUEUE_H
+#define LOG_QUEUE_H
+
+#include <Arduino.h>
+
+/**
+ * Модуль LogQueue.h
+ * Асинхронный конвейер логов: вызывающий только кладёт запись фиксированного
+ * размера в преаллоцированную lock-free очередь, а в Serial, WebSocket и
+ * файл лога её выводит отдельная низкоприоритетная задача.
+ *
+ * Вызов не выделяет память, не пишет во флеш и никогда не блокируется —
+ * его можно делать и на пути распознавания брелока в loop(): очередь полна —
+ * запись отбрасывается и учитывается в счётчике потерь.
+ *
+ * Очередь — MpmcRing (ограниченная MPMC Вьюкова), запись форматируется прямо
+ * в захваченную ячейку. Пишут loop() и httpTask одновременно, читает
+ * задача вывода.
+ *
+ *   post()   — готовая короткая строка (копируется, до MSG_LEN байт)
+ *   postf()  — printf прямо в ячейку очереди (без heap)
+ */
+namespace LogQueue {
+  enum Level : uint8_t {
+    LEVEL_INFO = 0,
+    LEVEL_SUCCESS,
+    LEVEL_WARNING,
+    LEVEL_ERROR
+  };
+
+  // Куда выводить запись (битовая маска)
+  enum Sink : uint8_t {
+    SINK_SERIAL = 1 << 0,
+    SINK_WS     = 1 << 1,  // событие "log" (тема log шины WsBus)
+    SINK_FILE   = 1 << 2   // файл лога (/api/system/log)
+  };
+
+  static const size_t MSG_LEN = 120;
+
+  typedef void (*FileSink)(const char* message);
+
+  /**
+   * Подготовка очереди. Вызывать первой строкой setup(): записи до init()
+   * отбрасываются.
+   */
+  void init();
+
+  /**
+   * Запуск задачи вывода (после Serial.begin и WsBus::init)
+   * @param fileSink - запись строки в файл лога
+   */
+  void start(FileSink fileSink);
+
+  void post(Level level, uint8_t sinks, const char* message);
+  void postf(Level level, uint8_t sinks, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+  /**
+   * Уровень по имени типа лога ("info", "success", "warning", "error")
+   */
+  Level levelFromName(const char* type);
+  const char* levelName(Level level);
+
+  /**
+   * @return сколько записей потеряно из-за переполнения очереди
+   */
+  uint32_t dropped();
+}
+
+#endif // LOG_QUEUE_H
@@ -0,0 +1,103 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * Модуль Metrics.h
+ * Метрики для мониторинга (/metrics, формат OpenMetrics): гистограммы
+ * длительностей, счётчики событий радио и GSM, показатели heap и стеков задач.
+ *
+ * Запись дешёвая и без блокировок: гистограмма — фиксированные корзины по
+ * степеням двойки микросекунд (1 мкс … 8,4 с), наблюдение — индекс корзины
+ * через clz и три атомарных инкремента. Память выделяется один раз:
+ * гистограммы обработчиков HTTP берутся из статического пула при
+ * регистрации маршрутов.
+ */
+namespace Metrics {
+  static const int BUCKETS = 24;  // верхние границы 2^0 … 2^23 мкс, плюс +Inf
+
+  class Histogram {
+  public:
+    void observe(uint32_t us);
+    /**
+     * Вывод в формате OpenMetrics (без строк # TYPE/# HELP)
+     * @param labels - метки без скобок ("handler=\"/api/keys\"") или nullptr
+     */
+    void write(Print& out, const char* name, const char* labels) const;
+    uint32_t count() const { return total.load(std::memory_order_relaxed); }
+  private:
+    std::atomic<uint32_t> buckets[BUCKETS + 1] = {};
+    std::atomic<uint32_t> total{0};
+    std::atomic<uint32_t> sumLow{0};   // сумма, мкс: младшие 32 бита
+    std::atomic<uint32_t> sumHigh{0};  // перенос
+  };
+
+  enum HistogramId : uint8_t {
+    HIST_LOOP = 0,         // итерация loop()
+    HIST_STATE_SAVE,       // saveSystemState()
+    HIST_RF_DECODE,        // прогон буфера импульсов через декодеры
+    HIST_PRESS_TO_RELAY,   // конец пакета брелока → включение реле
+    HIST_COUNT
+  };
+
+  enum CounterId : uint8_t {
+    RF_BUFFERS = 0,        // буферов импульсов отдано декодерам
+    RF_WEAK,               // отброшено по RSSI
+    RF_DECODED,            // распознан протокол
+    RF_GATE_OPENS,
+    RF_KEY_DISABLED,
+    RF_OUT_OF_SCHEDULE,    // ключ вне своего расписания (или время неизвестно)
+    RF_UNKNOWN_KEY,
+    RF_DUPLICATES,
+    GSM_CALLS,
+    GSM_SMS,
+    GSM_GATE_OPENS,
+    GSM_REJECTED,          // номер не в белом списке
+    GSM_OUT_OF_SCHEDULE,   // номер в списке, но вне своего расписания
+    COUNTER_COUNT
+  };
+
+  void observe(HistogramId id, uint32_t us);
+  void inc(CounterId id);
+
+  /**
+   * Гистограмма длительности обработчика HTTP (вызывать при регистрации
+   * маршрутов в setup). nullptr — пул исчерпан.
+   */
+  Histogram* httpHistogram(const char* path);
+
+  /**
+   * Задача, чей минимум свободного стека попадёт в метрики
+   */
+  void registerTask(const char* name, TaskHandle_t handle);
+
+  /**
+   * Метрики другого модуля (семейства OpenMetrics без "# EOF"), выводятся
+   * в конце write(). Регистрировать в setup().
+   */
+  typedef void (*Writer)(Print& out);
+  void registerWriter(Writer writer);
+
+  /**
+   * Все метрики в формате OpenMetrics, с завершающим "# EOF"
+   */
+  void write(Print& out);
+
+  // Длительность области видимости → гистограмма
+  class ScopedTimer {
+  public:
+    explicit ScopedTimer(HistogramId id) : id(id), start(micros()) {}
+    ~ScopedTimer() { observe(id, micros() - start); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+  private:
+    HistogramId id;
+    uint32_t start;
+  };
+}
+
+#endif // METRICS_H
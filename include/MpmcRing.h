@@ -0,0 +1,114 @@
+#ifndef MPMC_RING_H
+#define MPMC_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * Модуль MpmcRing.h
+ * Ограниченная lock-free очередь MPMC (Вьюков) на преаллоцированном массиве.
+ * У каждой ячейки свой номер последовательности: писатель захватывает ячейку
+ * одним CAS по позиции записи, читатель — по позиции чтения. Без heap и без
+ * блокировок; очередь полна — запись не ставится (решает вызывающий).
+ *
+ * Используют LogQueue (запись лога — прямо в ячейку через claim()/commit(),
+ * в том числе из ISR) и EventBus (очередь каждого подписчика, push()/pop()).
+ *
+ * CAPACITY — степень двойки. Перед использованием — reset() (номера ячеек).
+ */
+template <typename T, uint32_t CAPACITY>
+class MpmcRing {
+  static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY — степень двойки");
+
+public:
+  void reset() {
+    for (uint32_t i = 0; i < CAPACITY; i++) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueuePos.store(0, std::memory_order_relaxed);
+    dequeuePos.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * Захват ячейки под запись; после заполнения — commit(pos).
+   * @return nullptr — очередь полна
+   */
+  T* IRAM_ATTR claim(uint32_t& pos) {
+    pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell* cell = &cells[pos & MASK];
+      uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+      int32_t diff = (int32_t)(seq - pos);
+      if (diff == 0) {
+        if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          return &cell->value;
+        }
+      } else if (diff < 0) {
+        return nullptr;
+      } else {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void IRAM_ATTR commit(uint32_t pos) {
+    cells[pos & MASK].sequence.store(pos + 1, std::memory_order_release);
+  }
+
+  /**
+   * Копия value в очередь
+   * @param depth - если не nullptr, сюда — глубина очереди после постановки
+   * @return false — очередь полна
+   */
+  bool push(const T& value, uint32_t* depth = nullptr) {
+    uint32_t pos;
+    T* slot = claim(pos);
+    if (!slot) return false;
+    *slot = value;
+    commit(pos);
+    if (depth) *depth = pos + 1 - dequeuePos.load(std::memory_order_relaxed);
+    return true;
+  }
+
+  /**
+   * @return false — пусто (или писатель ещё не зафиксировал ячейку)
+   */
+  bool pop(T& out) {
+    uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell* cell = &cells[pos & MASK];
+      uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+      int32_t diff = (int32_t)(seq - (pos + 1));
+      if (diff == 0) {
+        if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          out = cell->value;
+          cell->sequence.store(pos + CAPACITY, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Сколько записей ждёт чтения (приблизительно при одновременной записи)
+  uint32_t depth() const {
+    return enqueuePos.load(std::memory_order_relaxed) - dequeuePos.load(std::memory_order_relaxed);
+  }
+
+private:
+  static const uint32_t MASK = CAPACITY - 1;
+
+  struct Cell {
+    std::atomic<uint32_t> sequence;
+    T value;
+  };
+
+  Cell cells[CAPACITY];
+  std::atomic<uint32_t> enqueuePos;
+  std::atomic<uint32_t> dequeuePos;
+};
+
+#endif // MPMC_RING_H
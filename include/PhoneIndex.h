@@ -0,0 +1,55 @@
+#ifndef PHONE_INDEX_H
+#define PHONE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Модуль PhoneIndex.h
+ * Индекс белого списка телефонов для проверки входящих звонков и SMS.
+ *
+ * Номера нормализуются один раз, при изменении списка: ключ — последние
+ * 10 цифр (короткие сервисные номера — все цифры) вместе с их количеством,
+ * плюс флаги каналов, маска ворот и id расписания, всё в одном uint64_t.
+ * Массив отсортирован по ключу, проверка номера (+CLIP/+CMT) — одна
+ * нормализация и бинарный поиск, без выделения памяти. 1000 номеров — 8 КБ.
+ *
+ * Сравнение как у phoneNumbersMatch: +79991234567 / 89991234567 /
+ * 79991234567 — один номер; при повторах действует первая запись списка.
+ *
+ * Доступ — под StateLock (как и к systemState.phones).
+ */
+namespace PhoneIndex {
+  enum Channel : uint8_t {
+    CHANNEL_CALL = 1,
+    CHANNEL_SMS = 2
+  };
+
+  // Маска ворот записи: бит i — ворота i (GateControl::MAX_GATES)
+  static const int GATE_BITS = 4;
+  // id расписания доступа записи (Schedule::ID_BITS), 0 — без ограничений
+  static const int SCHEDULE_BITS = 4;
+
+  /**
+   * Нормализованный ключ номера, 0 — в номере нет цифр
+   */
+  uint64_t keyOf(const char* number);
+
+  /**
+   * Перестроение: begin(n), add() на каждую запись в порядке списка, commit()
+   */
+  void begin(size_t expected);
+  void add(const char* number, uint8_t channels, uint8_t gates = 1, uint8_t schedule = 0);
+  void commit();
+
+  /**
+   * @param gates - если не nullptr, сюда — маска ворот найденного номера
+   * @param schedule - если не nullptr, сюда — id его расписания
+   * @return каналы (CHANNEL_*) найденного номера; -1 — номера нет в списке
+   */
+  int lookup(const char* number, uint8_t* gates = nullptr, uint8_t* schedule = nullptr);
+
+  size_t size();
+}
+
+#endif // PHONE_INDEX_H
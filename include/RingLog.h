@@ -0,0 +1,76 @@
+#ifndef RING_LOG_H
+#define RING_LOG_H
+
+#include <Arduino.h>
+
+/**
+ * Модуль RingLog.h
+ * Журнал событий во флеше (SPIFFS) — кольцевой файл фиксированного размера.
+ *
+ * Файл создаётся один раз нужного размера и дальше не переписывается:
+ *
+ *   [заголовок: 1 страница][страница 0][страница 1]...[страница PAGE_COUNT-1]
+ *
+ * Запись строки — одна запись данных и одна запись заголовка, без
+ * перезаписи файла. Страницы по PAGE_SIZE байт (страница SPIFFS); строка
+ * страницу не пересекает: не помещается в остаток — остаток забивается
+ * нулями и строка начинается со следующей страницы. Поэтому самая старая
+ * сохранённая страница всегда начинается с целой строки.
+ *
+ * Смещения — логические, монотонные (байты от создания файла): head — куда
+ * пишется следующая строка, tail — начало самой старой сохранённой страницы.
+ * Курсор клиента остаётся верным и после перехода через конец кольца; если
+ * его данные уже затёрты, чтение начинается с tail.
+ */
+namespace RingLog {
+  static const size_t PAGE_SIZE = 256;
+  static const size_t PAGE_COUNT = 128;          // 32 КБ данных
+  static const size_t CAPACITY = PAGE_SIZE * PAGE_COUNT;
+
+  /**
+   * Открытие (или создание) файла лога. Вызывать после SPIFFS.begin().
+   * Старый /log.txt удаляется.
+   */
+  void init();
+
+  /**
+   * Строка лога с префиксом времени "[1h05m] ". Длиннее страницы — обрезается.
+   */
+  void append(const char* message);
+
+  uint32_t head();
+  uint32_t tail();
+
+  /**
+   * Чтение логического диапазона [offset, head) в buf (паддинг-нули
+   * пропускаются не здесь — их отбрасывает Reader).
+   * @param offset - логическое смещение; меньше tail — сдвигается на tail
+   * @return прочитано байт; offset — фактическое начало прочитанного
+   */
+  size_t read(uint32_t& offset, uint8_t* buf, size_t len);
+
+  /**
+   * @return смещение начала последних n строк
+   */
+  uint32_t lastLinesOffset(size_t n);
+
+  /**
+   * Построчное чтение от заданного смещения до head (на момент вызова
+   * readLine). Память — только буфер страницы и сама строка.
+   */
+  class Reader {
+  public:
+    explicit Reader(uint32_t from);
+    bool readLine(String& line);
+    uint32_t position() const { return pos; }
+    void seek(uint32_t offset);
+  private:
+    bool fill();
+    uint32_t pos;          // смещение следующего непрочитанного байта
+    uint32_t bufStart = 0; // смещение buf[0]
+    size_t bufLen = 0;
+    uint8_t buf[PAGE_SIZE];
+  };
+}
+
+#endif // RING_LOG_H
@@ -0,0 +1,83 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Модуль Schedule.h
+ * Расписания доступа: когда ключ или телефон открывает ворота
+ * (подрядчики — по будням с 8 до 18, часть брелоков — не ночью).
+ *
+ * Расписание задаётся текстом и компилируется при сохранении в битовую
+ * карту недели: 168 часовых слотов (7 дней × 24 ч, понедельник 00:00 —
+ * слот 0). Проверка на пути решения об открытии — одна проверка бита,
+ * без разбора строк и календарной арифметики.
+ *
+ * Текст — правила через ';', применяются по порядку:
+ *   <дни> [<часы>]      разрешить
+ *   !<дни> [<часы>]     запретить (поверх предыдущих правил)
+ * дни — '*' или список через ',' из дней и диапазонов: mon-fri, sat,sun
+ * (или пн..вс); часы — H-H, конец не входит: 8-18 — с 8:00 до 17:59;
+ * 22-6 — через полночь, до 5:59 следующего дня. Без часов — сутки.
+ * Примеры: "mon-fri 8-18", "*; !* 23-6".
+ *
+ * Расписания именованные: ключи и телефоны ссылаются на имя, у всех записей
+ * с одним именем — одна карта (телефоны с общим расписанием — группа).
+ * Таблица скомпилированных карт перестраивается begin()/add(), как PhoneIndex;
+ * id 0 — без ограничений, MISSING — ссылка на несуществующее расписание.
+ *
+ * Без зависимостей от Arduino — собирается и на хосте (sim/).
+ * Доступ к таблице — под StateLock.
+ */
+namespace Schedule {
+  static const int SLOTS = 7 * 24;
+  static const int WORDS = (SLOTS + 31) / 32;
+
+  // id расписания в записи индекса: 4 бита (PhoneIndex), 0 — всегда можно
+  static const int ID_BITS = 4;
+  static const uint8_t ALWAYS = 0;
+  static const uint8_t MISSING = (1 << ID_BITS) - 1;
+  static const int MAX_SCHEDULES = MISSING - 1;  // id 1..MAX_SCHEDULES
+
+  struct Week {
+    uint32_t words[WORDS];
+  };
+
+  /**
+   * Разбор текста расписания в карту недели
+   * @param error - если не nullptr, при ошибке — что не так (строка-константа)
+   * @return false — синтаксическая ошибка, week не определена
+   */
+  bool compile(const char* rules, Week& week, const char** error = nullptr);
+
+  /**
+   * Слот недели для местного времени (секунды от 1970-01-01 00:00 местного)
+   */
+  int slotOf(uint32_t localSeconds);
+
+  inline bool allows(const Week& week, int slot) {
+    return slot >= 0 && slot < SLOTS && ((week.words[slot >> 5] >> (slot & 31)) & 1u);
+  }
+
+  /**
+   * Число разрешённых часов в неделе (для UI)
+   */
+  int hours(const Week& week);
+
+  /**
+   * Перестроение таблицы: begin(), add() на каждое расписание по порядку
+   * @return id расписания в таблице; MISSING — таблица полна
+   */
+  void begin();
+  uint8_t add(const Week& week);
+
+  /**
+   * Решение по записи: ALWAYS — да при любом времени; иначе нужен слот
+   * (время известно, slot >= 0) и бит в карте. Время неизвестно или
+   * расписания нет — нет (fail-closed).
+   */
+  bool allowed(uint8_t id, int slot);
+}
+
+#endif // SCHEDULE_H
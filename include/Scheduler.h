@@ -0,0 +1,76 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * Модуль Scheduler.h
+ * Периодические и разовые задания задачи loop() по дедлайнам
+ * (WiFi, RSSI визуализатора, очистка, диагностика, сброс счётчика открытий…).
+ *
+ *  - задания регистрируются в setup() (every — периодическое, after — разовое)
+ *    и лежат в min-куче по дедлайну: runDue() смотрит только на вершину;
+ *  - на каждое задание — число запусков, суммарное и максимальное время
+ *    (в /metrics: gate_job_runs_total, gate_job_cpu_seconds_total,
+ *    gate_job_max_seconds, плюс gate_loop_idle_seconds_total);
+ *  - sleep() усыпляет задачу loop до ближайшего дедлайна, но не дольше
+ *    интервала опроса; будят её wake()/wakeFromIsr() (готов пакет CC1101).
+ *
+ * Регистрация и отмена — только из задачи loop (и setup() до её цикла).
+ * Задания выполняются из runDue() в loop() вне StateLock итерации: каждое
+ * берёт его само и только на то, что трогает (запись во флеш — без него).
+ */
+namespace Scheduler {
+  typedef void (*JobFn)();
+
+  static const int MAX_JOBS = 16;
+
+  /**
+   * Периодическое задание. Первый запуск — через periodMs.
+   * @return id задания, -1 — нет свободных слотов
+   */
+  int every(const char* name, uint32_t periodMs, JobFn fn);
+
+  /**
+   * Разовое задание через delayMs (слот освобождается после запуска)
+   */
+  int after(const char* name, uint32_t delayMs, JobFn fn);
+
+  void cancel(int id);
+
+  /**
+   * Выполнить все задания с наступившим дедлайном
+   */
+  void runDue();
+
+  /**
+   * Сон задачи до ближайшего дедлайна, wake() или maxMs — что раньше
+   */
+  void sleep(uint32_t maxMs);
+
+  /**
+   * Разбудить задачу, спящую в sleep() (из другой задачи / из ISR)
+   */
+  void wake();
+  void IRAM_ATTR wakeFromIsr();
+
+  struct JobStats {
+    const char* name;
+    uint32_t runs;
+    uint64_t totalUs;
+    uint32_t maxUs;
+  };
+
+  int jobCount();
+  bool jobStats(int id, JobStats& out);  // false — слот пуст
+  uint64_t idleUs();
+
+  /**
+   * Метрики заданий в формате OpenMetrics (без "# EOF")
+   */
+  void writeMetrics(Print& out);
+}
+
+#endif // SCHEDULER_H
@@ -0,0 +1,123 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <Arduino.h>
+#include "GateControl.h"
+
+/**
+ * Модуль Settings.h
+ * Реестр настроек: тип и границы каждой, применение к железу, уведомление
+ * об изменении и отложенная запись во флеш.
+ *
+ *  - значения живут в полях systemState (их читает весь код),
+ *    но пишутся только через set(): проверка границ, применение к железу
+ *    (CC1101Manager::setFrequency и т.п.), запись поля;
+ *  - подписчики получают маску изменившихся настроек (Batch — одна маска на
+ *    группу изменений) и перечитывают только своё;
+ *  - изменение помечает реестр грязным; commitDue() (задание Scheduler)
+ *    говорит «пора писать» через 1,5 с после последнего изменения, но не
+ *    позже 10 с после первого — серия правок стоит одну запись во флеш.
+ *    Пишет сам вызывающий (saveSystemState, без StateLock) и сообщает
+ *    итог в commitDone();
+ *    Любой saveSystemState() (ключи, телефоны) заодно сохраняет и настройки
+ *    (markCommitted()).
+ *
+ * Тайминги — у каждых ворот свои: три id подряд на ворота, id для ворот
+ * gate — gateSetting(GATE_OPEN_SEC, gate) и т.д.
+ *
+ * Вызывать под StateLock — как и любое обращение к systemState.
+ */
+namespace Settings {
+  static const uint8_t GATE_FIELDS = 3;  // открытие, пауза, закрытие
+
+  enum Id : uint8_t {
+    FREQUENCY = 0,     // МГц, 300-928
+    BIT_RATE,          // кбит/с
+    FREQ_DEVIATION,    // кГц
+    RX_BANDWIDTH,      // кГц
+    OUTPUT_POWER,      // дБм
+    GATE_OPEN_SEC,     // ворота 1: ход на открытие, 1-60 с
+    GATE_STAY_SEC,     // ворота 1: пауза «открыто», 1-300 с
+    GATE_CLOSE_SEC,    // ворота 1: ход на закрытие, 1-60 с
+    // ... те же три поля ворот 2..MAX_GATES
+    LEARNING_MODE = GATE_OPEN_SEC + GATE_FIELDS * GateControl::MAX_GATES,  // не сохраняется
+    TIME_ZONE,         // часовой пояс расписаний доступа, минуты к UTC
+    COUNT
+  };
+  static_assert(COUNT <= 32, "Маска изменений Settings — uint32_t");
+
+  enum Type : uint8_t { TYPE_FLOAT, TYPE_INT, TYPE_BOOL };
+
+  enum Result : uint8_t {
+    RESULT_CHANGED = 0,
+    RESULT_UNCHANGED,      // то же значение — ни применения, ни записи
+    RESULT_OUT_OF_RANGE,   // вне границ (или дробное для целой)
+    RESULT_REJECTED        // железо не приняло (applier вернул false)
+  };
+
+  inline uint32_t bit(Id id) { return 1u << id; }
+
+  // Тайминг ворот gate: field — GATE_OPEN_SEC / GATE_STAY_SEC / GATE_CLOSE_SEC
+  inline Id gateSetting(Id field, int gate) { return (Id)(field + gate * GATE_FIELDS); }
+
+  // Применить новое значение к железу до записи в поле; false — отказ
+  typedef bool (*Applier)(float value);
+  // Маска bit(Id) изменившихся настроек
+  typedef void (*Listener)(uint32_t changed);
+
+  /**
+   * Привязка настройки к полю systemState (в setup(), после загрузки)
+   */
+  void bindFloat(Id id, float* field, Applier apply = nullptr);
+  void bindInt(Id id, int* field, Applier apply = nullptr);
+  void bindBool(Id id, bool* field, Applier apply = nullptr);
+
+  void subscribe(Listener listener);
+
+  const char* name(Id id);
+  Type type(Id id);
+  float get(Id id);
+
+  /**
+   * Только проверка границ (для всё-или-ничего по нескольким полям)
+   */
+  Result check(Id id, float value);
+  Result set(Id id, float value);
+
+  /**
+   * Группа изменений: уведомление одной маской в конце внешнего Batch
+   */
+  class Batch {
+  public:
+    Batch();
+    ~Batch();
+    Batch(const Batch&) = delete;
+    Batch& operator=(const Batch&) = delete;
+  };
+
+  /**
+   * Подошёл ли срок отложенной записи (периодическое задание loop())
+   */
+  bool commitDue();
+
+  /**
+   * Итог записи по commitDue(): успех считается в stats().commits,
+   * сбой — повтор после следующей паузы
+   */
+  void commitDone(bool ok);
+
+  /**
+   * Состояние записано целиком (вызывается из saveSystemState при успехе)
+   */
+  void markCommitted();
+
+  bool dirty();
+
+  struct Stats {
+    uint32_t changes;   // изменений сохраняемых настроек
+    uint32_t commits;   // записей, сделанных реестром
+  };
+  Stats stats();
+}
+
+#endif // SETTINGS_H
@@ -0,0 +1,64 @@
+#ifndef SIGNAL_STREAM_H
+#define SIGNAL_STREAM_H
+
+#include <Arduino.h>
+#include <WebSocketsServer.h>
+
+/**
+ * Модуль SignalStream.h
+ * Бинарный WebSocket-канал для визуализатора сигнала: прореженные отсчёты
+ * RSSI и сырые последовательности импульсов, принятые CC1101.
+ *
+ *  - канал включается клиентом явно — подпиской на тему "signal" шины
+ *    WsBus; без подписчиков кадры не собираются вовсе;
+ *  - loop() (ядро 1) только кладёт готовый кадр в маленькую очередь,
+ *    рассылает httpTask (ядро 0) — медленный TCP не тормозит радио;
+ *  - у каждого клиента свой token bucket по байтам: не хватает токенов —
+ *    кадр для этого клиента выбрасывается, а не ждёт. Полная очередь
+ *    вытесняет самый старый кадр.
+ *
+ * Формат кадров (little-endian):
+ *   RSSI:     [0]=0x01 [1]=N [2..3]=интервал отсчётов, мс [4..7]=частота, кГц
+ *             [8..8+N) — int8 RSSI, дБм
+ *   Импульсы: [0]=0x02 [1]=флаги (бит 0 — обрезано) [2..3]=N [4]=int8 RSSI
+ *             [5]=0 [6..7]=номер пакета, далее N × uint16:
+ *             бит 15 — уровень, биты 0..14 — длительность в мкс (насыщение 32767)
+ */
+namespace SignalStream {
+  static const uint8_t FRAME_RSSI = 0x01;
+  static const uint8_t FRAME_PULSES = 0x02;
+
+  static const unsigned long RSSI_SAMPLE_MS = 20; // 50 Гц
+  static const uint8_t RSSI_SAMPLES_PER_FRAME = 10; // кадр раз в 200 мс
+  static const int MAX_PULSES_PER_FRAME = 512;
+
+  /**
+   * @return true, если есть хотя бы один подписчик (иначе данные не собираем)
+   */
+  bool active();
+
+  /**
+   * Отсчёт RSSI (loop, раз в RSSI_SAMPLE_MS). Кадр уходит в очередь,
+   * когда накопится RSSI_SAMPLES_PER_FRAME отсчётов.
+   */
+  void sampleRssi(int rssi, float frequencyMHz);
+
+  /**
+   * Принятая последовательность импульсов (из CC1101Manager::checkReceived
+   * через setPulseTap). Длиннее MAX_PULSES_PER_FRAME — обрезается с флагом.
+   */
+  void pushPulses(const volatile unsigned long* timings, const volatile bool* levels,
+                  int count, int rssi);
+
+  /**
+   * Рассылка очереди подписчикам. Вызывать из httpTask под Sync::WsLock.
+   */
+  void drain(WebSocketsServer& ws);
+
+  /**
+   * @return сколько кадров отброшено (переполнение очереди или бюджета клиента)
+   */
+  uint32_t droppedFrames();
+}
+
+#endif // SIGNAL_STREAM_H
@@ -0,0 +1,73 @@
+#ifndef STATE_STORE_H
+#define STATE_STORE_H
+
+#include <Arduino.h>
+#include <functional>
+
+/**
+ * Модуль StateStore.h
+ * Хранение JSON-состояния системы в разделе NVS "userdata" с защитой от
+ * обрыва питания во время записи.
+ *
+ * Два слота A/B: "body0"/"body1" (сам JSON) и маленькие заголовки
+ * "hdr0"/"hdr1" (magic, версия, поколение, длина, CRC32 тела, CRC32 заголовка).
+ *  - Запись всегда идёт в НЕактивный слот: сначала тело, затем заголовок
+ *    с поколением +1. Заголовок — точка фиксации: пока он не записан, при
+ *    загрузке победит старый слот.
+ *  - Загрузка читает только заголовки, выбирает самое новое валидное поколение
+ *    и проверяет CRC тела. Не сошлось (или JSON не разобрался) — берётся
+ *    второй слот. Второе тело читается только в этом случае.
+ *  - Blob "state" прежнего формата (один blob, перезапись на месте) читается
+ *    один раз для миграции и удаляется после первой успешной записи в слот
+ *    (места в userdata на три копии не хватит).
+ */
+namespace StateStore {
+  enum class LoadResult {
+    OK,       // загружен валидный слот
+    FALLBACK, // новейший слот повреждён, загружен предыдущий
+    LEGACY,   // слотов нет, загружен старый blob "state" (миграция)
+    EMPTY,    // хранилище пустое (первый запуск)
+    CORRUPT   // данные есть, но ни один слот не прошёл проверку
+  };
+
+  /**
+   * Проверка содержимого слота вызывающей стороной (разбор JSON).
+   * @return false — слот считается повреждённым, пробуется следующий
+   */
+  typedef std::function<bool(const String& json)> AcceptFn;
+
+  /**
+   * Инициализация раздела userdata (вызывается один раз в setup, до load)
+   */
+  void init();
+
+  /**
+   * Загрузка самого нового валидного слота.
+   * @param accept - вызывается с телом каждого кандидата (новейший первым),
+   *                 пока не вернёт true
+   */
+  LoadResult load(AcceptFn accept);
+
+  /**
+   * Атомарная (на уровне слотов) запись состояния в неактивный слот.
+   * @return true, если тело и заголовок записаны и зафиксированы
+   */
+  bool save(const String& json);
+
+  /**
+   * @return номер активного слота (0/1) или -1, если слотов ещё нет
+   */
+  int activeSlot();
+
+  /**
+   * @return поколение активного слота (растёт на 1 при каждой записи)
+   */
+  uint32_t generation();
+
+  /**
+   * @return текстовое имя результата загрузки для логов и /api/system/info
+   */
+  const char* resultName(LoadResult result);
+}
+
+#endif // STATE_STORE_H
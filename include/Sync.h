@@ -0,0 +1,65 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+/**
+ * Модуль Sync.h
+ * Блокировки между задачей loop() (ядро 1: CC1101, GSM, ворота) и задачей
+ * HTTP/WebSocket (ядро 0).
+ *
+ * StateLock — systemState, GateControl и CC1101Manager (SPI радио). Держать
+ * только на время чтения/изменения данных, НЕ на время отправки ответа
+ * клиенту: зависший телефон не должен тормозить распознавание брелоков.
+ * WsLock — WebSocketsServer (библиотека не потокобезопасна).
+ * StoreLock — запись снимка состояния в NVS (StateStore): снимок делается
+ * под StateLock, пишется уже без него, но под StoreLock — по порядку снимков.
+ *
+ * Все рекурсивные. Порядок захвата: StateLock → WsLock и StateLock →
+ * StoreLock, не наоборот (под WsLock и StoreLock состояние не трогаем —
+ * иначе взаимная блокировка).
+ * До Sync::init() (однопоточный setup) блокировки — пустые операции.
+ */
+namespace Sync {
+  /**
+   * Создание мьютексов. Вызывать в setup() до запуска задачи HTTP.
+   */
+  void init();
+
+  SemaphoreHandle_t stateMutex();
+  SemaphoreHandle_t wsMutex();
+  SemaphoreHandle_t storeMutex();
+
+  class Lock {
+  public:
+    explicit Lock(SemaphoreHandle_t m) : mutex(m) {
+      if (mutex) xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    }
+    ~Lock() {
+      if (mutex) xSemaphoreGiveRecursive(mutex);
+    }
+    Lock(const Lock&) = delete;
+    Lock& operator=(const Lock&) = delete;
+  private:
+    SemaphoreHandle_t mutex;
+  };
+
+  class StateLock : public Lock {
+  public:
+    StateLock() : Lock(stateMutex()) {}
+  };
+
+  class WsLock : public Lock {
+  public:
+    WsLock() : Lock(wsMutex()) {}
+  };
+
+  class StoreLock : public Lock {
+  public:
+    StoreLock() : Lock(storeMutex()) {}
+  };
+}
+
+#endif // SYNC_H
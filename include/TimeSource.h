@@ -0,0 +1,76 @@
+#ifndef TIME_SOURCE_H
+#define TIME_SOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Модуль TimeSource.h
+ * Календарное время для расписаний доступа (Schedule.h).
+ *
+ * Часов реального времени в устройстве нет, поэтому время приходит извне:
+ *  - GSM: часы SIM800L (AT+CCLK?), если оператор передаёт время сети (NITZ,
+ *    AT+CLTS=1) — GSMManager опрашивает их в READY;
+ *  - NTP, пока есть WiFi (main.cpp).
+ * Модуль хранит опорную точку «UTC ↔ millis()» последней синхронизации и
+ * считает от неё; время модема без сети (2004 год и т.п.) отбрасывается.
+ * Пока опоры нет, weekSlot() = -1 — записи с расписанием не открывают
+ * (fail-closed), записи без расписания работают как раньше.
+ *
+ * millis() передаётся параметром: на хосте (sim/) время — виртуальные часы.
+ * Без зависимостей от Arduino. Доступ — под StateLock.
+ */
+namespace TimeSource {
+  enum Origin : uint8_t {
+    ORIGIN_NONE = 0,
+    ORIGIN_GSM,
+    ORIGIN_NTP
+  };
+
+  // Время раньше 2024-01-01 — не настоящее (часы модема без сети)
+  static const uint32_t MIN_VALID_UTC = 1704067200;
+
+  /**
+   * Новая опорная точка
+   * @param utc - секунды UTC от 1970-01-01
+   * @param nowMs - millis() в момент, к которому относится utc
+   * @return false — время не похоже на настоящее или это GSM, а NTP-опора
+   *         моложе 2 ч; опора не сменилась
+   */
+  bool sync(uint32_t utc, Origin origin, uint32_t nowMs);
+
+  /**
+   * Часовой пояс расписаний, минуты к UTC (Москва — 180)
+   */
+  void setZone(int minutes);
+  int zone();
+
+  bool synced();
+  Origin origin();
+  const char* originName(Origin origin);
+  uint32_t syncedAtMs();  // millis() последней синхронизации
+
+  /**
+   * @return секунды UTC сейчас; 0 — время неизвестно
+   */
+  uint32_t utcNow(uint32_t nowMs);
+
+  /**
+   * @return слот недели (Schedule::slotOf) по местному времени; -1 — время неизвестно
+   */
+  int weekSlot(uint32_t nowMs);
+
+  /**
+   * Разбор ответа AT+CCLK?: "yy/MM/dd,hh:mm:ss±zz" (зона — четверти часа,
+   * время — местное) в секунды UTC
+   * @return false — не формат +CCLK
+   */
+  bool parseCclk(const char* text, size_t len, uint32_t& utc);
+
+  /**
+   * Секунды от 1970-01-01 для даты/времени по григорианскому календарю
+   */
+  uint32_t fromCivil(int year, int month, int day, int hour, int minute, int second);
+}
+
+#endif // TIME_SOURCE_H
@@ -0,0 +1,166 @@
+#ifndef WS_BUS_H
+#define WS_BUS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WebSocketsServer.h>
+
+/**
+ * Модуль WsBus.h
+ * Шина событий WebSocket с подписками клиентов на темы.
+ *
+ * Клиент объявляет нужные темы, событие сериализуется один раз в общий буфер
+ * и рассылается только подписчикам; нет подписчиков — нет и сериализации.
+ *
+ * Темы и события:
+ *   log    — log
+ *   gate   — gate_status
+ *   wifi   — wifi_status, wifi_scan
+ *   keys   — key_received, key_added
+ *   data   — generation (изменение коллекций)
+ *   signal — бинарный канал визуализатора (SignalStream)
+ *   system — прочие события
+ *
+ * Команды клиента (текстом):
+ *   {"cmd":"subscribe","topics":["gate","log"]}   — добавить темы
+ *   {"cmd":"unsubscribe","topics":["log"]}        — убрать темы
+ *   {"cmd":"topics","topics":["gate"]}            — заменить набор целиком
+ * Вместо "topics" можно передать одну строку "topic".
+ *
+ * Новый клиент подписан на всё, кроме signal: клиенту без команд подписки
+ * приходят все события.
+ *
+ * События-состояния (wifi_status, gate_status) идут через publishState():
+ * шина помнит последнее значение, одинаковое не рассылает, всплеск изменений
+ * в пределах окна склеивает в одно и отправляет только изменившиеся поля:
+ *   {"event":"wifi_status","data":{"rssi":-61},"delta":true}
+ * Удалённое поле приходит как null. Полный снимок — "delta":false; его же
+ * получает каждый новый клиент сразу после подключения.
+ *
+ * Отправка блокирует задачу до ухода кадра всем клиентам, поэтому рассылают
+ * только из httpTask. Остальные задачи (loop(): распознавание брелоков,
+ * WiFi) ставят событие в очередь отправки post()/postf()/postState() —
+ * преаллоцированный MpmcRing на OUTBOX_CAPACITY кадров, без WsLock и без heap;
+ * разошлёт их flush() в httpTask. Очередь полна или данные длиннее
+ * OUTBOX_DATA_LEN — событие теряется и учитывается (outboxDropped).
+ *
+ * Входящие кадры ограничены token bucket на клиента (сверх лимита — не
+ * разбираются, только считаются — тоже по клиентам, с адресом: видно, кто
+ * шлёт лишнее).
+ */
+namespace WsBus {
+  enum Topic : uint8_t {
+    TOPIC_LOG    = 1 << 0,
+    TOPIC_GATE   = 1 << 1,
+    TOPIC_WIFI   = 1 << 2,
+    TOPIC_KEYS   = 1 << 3,
+    TOPIC_DATA   = 1 << 4,
+    TOPIC_SIGNAL = 1 << 5,
+    TOPIC_SYSTEM = 1 << 6
+  };
+
+  static const uint8_t DEFAULT_TOPICS = TOPIC_LOG | TOPIC_GATE | TOPIC_WIFI |
+                                        TOPIC_KEYS | TOPIC_DATA | TOPIC_SYSTEM;
+
+  struct Stats {
+    uint32_t sent;            // кадров отправлено (по клиентам)
+    uint32_t suppressed;      // состояние не изменилось — не отправлено
+    uint32_t coalesced;       // изменение поглощено следующим в том же окне
+    uint32_t inboundReceived;
+    uint32_t inboundDropped;  // сверх лимита входящих
+    uint32_t outboxDropped;   // не поставлено в очередь отправки
+  };
+
+  static const uint32_t OUTBOX_CAPACITY = 8;  // степень двойки
+  static const size_t OUTBOX_DATA_LEN = 640;  // key_received со 128-битным ключом
+
+  // Подключённый клиент: с какого адреса и сколько прислал входящих
+  struct ClientStats {
+    uint8_t client;
+    uint32_t ip;              // IPv4, как uint32_t(IPAddress)
+    unsigned long connectedAt;
+    uint32_t inboundReceived;
+    uint32_t inboundDropped;
+  };
+
+  void init(WebSocketsServer* ws);
+
+  /**
+   * Окно склейки для события-состояния (0 — отправлять сразу, только без повторов)
+   */
+  void setCoalesceWindow(const char* event, uint16_t windowMs);
+
+  // Из обработчика событий WebSocketsServer (httpTask, под WsLock)
+  void clientConnected(uint8_t client);
+  void clientDisconnected(uint8_t client);
+
+  /**
+   * Разбор команды подписки
+   * @return true, если это была команда шины (иначе — не наше сообщение)
+   */
+  bool handleCommand(uint8_t client, JsonDocument& cmd);
+
+  /**
+   * @return тема события по имени (неизвестные — TOPIC_SYSTEM)
+   */
+  Topic topicOf(const char* event);
+
+  /**
+   * @return битовая маска номеров клиентов, подписанных на тему
+   */
+  uint32_t subscribers(Topic topic);
+
+  inline bool hasSubscribers(Topic topic) {
+    return subscribers(topic) != 0;
+  }
+
+  /**
+   * Публикация события {"event":..., "data":...}. data — готовый JSON.
+   * Потокобезопасно (берёт WsLock), но ждёт отправки — только из httpTask.
+   */
+  void publish(const char* event, const char* data);
+
+  /**
+   * Публикация события-состояния: json — полный объект (плоский). Клиентам
+   * уходит только разница с последним отправленным значением.
+   */
+  void publishState(const char* event, const char* json);
+
+  /**
+   * Событие в очередь отправки (из любой задачи, не ждёт клиентов).
+   * event — строковый литерал, data — готовый JSON (копируется).
+   * @return false — событие потеряно (очередь полна / data не помещается)
+   */
+  bool post(const char* event, const char* data);
+
+  /**
+   * То же, JSON форматируется printf прямо в ячейку очереди
+   */
+  bool postf(const char* event, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+  /**
+   * Событие-состояние в очередь отправки; разошлёт его publishState() в httpTask
+   */
+  bool postState(const char* event, const char* json);
+
+  /**
+   * Рассылка очереди отправки и склеенных изменений, чьё окно истекло.
+   * Вызывать из httpTask.
+   */
+  void flush();
+
+  /**
+   * Входящий кадр от клиента: true — обрабатывать, false — сверх лимита
+   */
+  bool allowInbound(uint8_t client);
+
+  Stats stats();
+
+  /**
+   * Счётчики подключённых клиентов
+   * @return сколько записано в out (не больше max)
+   */
+  int clientStats(ClientStats* out, int max);
+}
+
+#endif // WS_BUS_H
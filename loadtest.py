@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+# Нагрузочный тест веб-интерфейса: проверяет, что HTTP-нагрузка не влияет
+# на распознавание брелоков (loopMaxUs / rfDecisionMaxUs из /api/system/info).
+# Чтение списков, запись (добавить/изменить/удалить телефон — каждая запись
+# blob'а в NVS), зависший HTTP-клиент, зависший WebSocket-клиент (подписан на
+# всё, кадры не читает) и тело сверх лимита (ожидается 413).
+# Использование: python3 loadtest.py 192.168.4.1 [секунд] [потоков] [пишущих]
+import base64
+import json
+import os
+import socket
+import sys
+import threading
+import time
+import urllib.error
+import urllib.request
+
+host = sys.argv[1] if len(sys.argv) > 1 else '192.168.4.1'
+duration = int(sys.argv[2]) if len(sys.argv) > 2 else 30
+workers = int(sys.argv[3]) if len(sys.argv) > 3 else 4
+writers = int(sys.argv[4]) if len(sys.argv) > 4 else 1
+
+ENDPOINTS = [
+    '/api/keys',
+    '/api/phones',
+    '/api/gate/config',
+    '/api/system/log?limit=50',
+    '/api/wifi/scan',
+]
+
+latencies = []
+write_latencies = []
+errors = 0
+lock = threading.Lock()
+stop = threading.Event()
+
+
+def get(path, timeout=10):
+    with urllib.request.urlopen(f'http://{host}{path}', timeout=timeout) as r:
+        return r.read()
+
+
+def send(method, path, body, timeout=10):
+    data = body if isinstance(body, bytes) else json.dumps(body).encode()
+    req = urllib.request.Request(f'http://{host}{path}', data=data, method=method,
+                                 headers={'Content-Type': 'application/json'})
+    with urllib.request.urlopen(req, timeout=timeout) as r:
+        return r.read()
+
+
+def system_info():
+    return json.loads(get('/api/system/info'))
+
+
+def worker(n):
+    global errors
+    i = n
+    while not stop.is_set():
+        path = ENDPOINTS[i % len(ENDPOINTS)]
+        i += 1
+        start = time.monotonic()
+        try:
+            get(path)
+            with lock:
+                latencies.append((time.monotonic() - start) * 1000)
+        except Exception:
+            with lock:
+                errors += 1
+
+
+def writer(n):
+    # Свой тестовый номер на поток: добавить → изменить → удалить по кругу
+    global errors
+    number = f'+7000000{n:04d}'
+    steps = [
+        ('POST', '/api/phones', {'number': number, 'smsEnabled': True, 'callEnabled': False}),
+        ('PUT', '/api/phones/update', {'id': number, 'callEnabled': True}),
+        ('POST', '/api/phones/delete', {'id': number}),
+    ]
+    i = 0
+    while not stop.is_set():
+        method, path, body = steps[i % len(steps)]
+        i += 1
+        start = time.monotonic()
+        try:
+            send(method, path, body)
+            with lock:
+                write_latencies.append((time.monotonic() - start) * 1000)
+        except Exception:
+            with lock:
+                errors += 1
+
+
+def oversized_body():
+    try:
+        send('POST', '/api/phones', b'{"number":"' + b'1' * 8192 + b'"}')
+    except urllib.error.HTTPError as e:
+        return e.code
+    except Exception:
+        return None
+    return 200
+
+
+def slow_client():
+    # Клиент, который отправил начало запроса и замолчал
+    while not stop.is_set():
+        try:
+            s = socket.create_connection((host, 80), timeout=5)
+            s.sendall(b'GET /api/keys HTTP/1.1\r\nHost: ' + host.encode() + b'\r\n')
+            stop.wait(10)
+            s.close()
+        except Exception:
+            stop.wait(1)
+
+
+def stalled_ws_client():
+    # WebSocket-клиент, который подписан на все темы и не читает кадры:
+    # приёмный буфер минимальный, окно TCP быстро закрывается, sendTXT ждёт
+    while not stop.is_set():
+        try:
+            s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+            s.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 256)
+            s.settimeout(5)
+            s.connect((host, 81))
+            key = base64.b64encode(os.urandom(16)).decode()
+            s.sendall((f'GET / HTTP/1.1\r\nHost: {host}:81\r\nUpgrade: websocket\r\n'
+                       f'Connection: Upgrade\r\nSec-WebSocket-Key: {key}\r\n'
+                       f'Sec-WebSocket-Version: 13\r\n\r\n').encode())
+            s.recv(256)  # ответ рукопожатия, дальше не читаем
+            payload = b'{"cmd":"topics","topics":["log","gate","wifi","keys","data","system"]}'
+            mask = os.urandom(4)
+            s.sendall(bytes([0x81, 0x80 | len(payload)]) + mask +
+                      bytes(b ^ mask[i % 4] for i, b in enumerate(payload)))
+            stop.wait(duration + 15)
+            s.close()
+        except Exception:
+            stop.wait(1)
+
+
+def sample_timings(seconds):
+    loop_max = rf_max = outbox_dropped = 0
+    end = time.monotonic() + seconds
+    while time.monotonic() < end:
+        try:
+            info = system_info()
+            loop_max = max(loop_max, info.get('loopMaxUs', 0))
+            rf_max = max(rf_max, info.get('rfDecisionMaxUs', 0))
+            outbox_dropped = info.get('wsOutboxDropped', 0)
+        except Exception:
+            pass
+        time.sleep(1)
+    return loop_max, rf_max, outbox_dropped
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+print(f"=== Нагрузочный тест {host}: {duration} с, {workers} читающих, {writers} пишущих потоков ===")
+print("Замер без нагрузки (10 с)...")
+base_loop, base_rf, base_dropped = sample_timings(10)
+
+threads = [threading.Thread(target=worker, args=(n,), daemon=True) for n in range(workers)]
+threads += [threading.Thread(target=writer, args=(n,), daemon=True) for n in range(writers)]
+threads.append(threading.Thread(target=slow_client, daemon=True))
+threads.append(threading.Thread(target=stalled_ws_client, daemon=True))
+for t in threads:
+    t.start()
+print("Замер под нагрузкой...")
+load_loop, load_rf, load_dropped = sample_timings(duration)
+stop.set()
+for t in threads:
+    t.join(timeout=15)
+# Тестовые номера, оставшиеся после остановки посреди круга
+for n in range(writers):
+    try:
+        send('POST', '/api/phones/delete', {'id': f'+7000000{n:04d}'})
+    except Exception:
+        pass
+
+print(f"\nЗапросов: чтение {len(latencies)}, запись {len(write_latencies)}, ошибок: {errors}")
+for name, values in (('чтение', latencies), ('запись', write_latencies)):
+    if values:
+        print(f"Латентность ({name}), мс: p50={percentile(values, 50):.0f} "
+              f"p95={percentile(values, 95):.0f} p99={percentile(values, 99):.0f} "
+              f"max={max(values):.0f}")
+print(f"Тело 8 КБ: HTTP {oversized_body()} (ожидается 413)")
+print(f"loop() max, мкс:      без нагрузки {base_loop}, под нагрузкой {load_loop}")
+print(f"RF решение max, мкс:  без нагрузки {base_rf}, под нагрузкой {load_rf}")
+print(f"WS событий потеряно (очередь отправки): {load_dropped - base_dropped}")
+print("Нажимайте брелок во время теста, чтобы rfDecisionMaxUs был непустым")
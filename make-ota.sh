@@ -18,6 +18,11 @@ rm -rf data/*
 cp -r smart-gate-frontend/build/* data/
 rm -f data/asset-manifest.json data/robots.txt data/manifest.json data/favicon.ico data/logo*.png
 rm -f data/static/css/*.map data/static/js/*.map data/static/js/*.LICENSE.txt
+# gzip на месте (имя без .gz: лимит пути SPIFFS 31 символ). Прошивка узнаёт
+# сжатый файл по сигнатуре и отдаёт его с Content-Encoding: gzip.
+find data -type f \( -name '*.js' -o -name '*.css' -o -name '*.html' \) | while read -r f; do
+  gzip -9 -n -c "$f" > "$f.tmp" && mv "$f.tmp" "$f"
+done
 
 echo "📦 Сборка образа SPIFFS..."
 platformio run --target buildfs
@@ -0,0 +1,185 @@
+#include "ModemSim.h"
+#include <time.h>
+
+ModemSim::ModemSim(const Config& cfg) : config(cfg), rng(cfg.seed ? cfg.seed : 1) {}
+
+void ModemSim::begin(uint32_t baud) {
+  hostBaud = baud;
+}
+
+void ModemSim::setBaud(uint32_t baud) {
+  hostBaud = baud;
+}
+
+uint8_t ModemSim::nextRandom() {
+  // xorshift32 — воспроизводимый шум при одинаковом seed
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return (uint8_t)rng;
+}
+
+void ModemSim::schedule(uint64_t atMs, const std::string& bytes) {
+  outgoing.emplace(atMs, bytes);
+}
+
+void ModemSim::emitLine(uint64_t atMs, const std::string& line) {
+  schedule(atMs, "\r\n" + line + "\r\n");
+}
+
+void ModemSim::emitRaw(uint64_t atMs, const std::string& bytes) {
+  schedule(atMs, bytes);
+}
+
+void ModemSim::noise(uint64_t atMs, size_t bytes) {
+  std::string junk;
+  for (size_t i = 0; i < bytes; i++) junk += (char)(0x80 | nextRandom());
+  schedule(atMs, junk);
+}
+
+void ModemSim::call(uint64_t atMs, const std::string& number, int rings, uint32_t periodMs, bool withClip) {
+  calls.push_back({number, rings, periodMs, withClip, atMs, false});
+}
+
+void ModemSim::sms(uint64_t atMs, const std::string& number, const std::string& text) {
+  emitLine(atMs, "+CMT: \"" + number + "\",\"\",\"24/07/05,12:00:00+12\"");
+  schedule(atMs, text + "\r\n");
+}
+
+void ModemSim::failCommand(const std::string& command, int times) {
+  failing[command] += times;
+}
+
+void ModemSim::dropCommand(const std::string& command, int times) {
+  dropping[command] += times;
+}
+
+void ModemSim::pump() {
+  uint64_t now = HostClock::nowMs();
+
+  for (Call& c : calls) {
+    while (c.ringsLeft > 0 && c.nextRingMs <= now) {
+      emitLine(c.nextRingMs, "RING");
+      if (c.withClip && clipEnabled) {
+        emitLine(c.nextRingMs, "+CLIP: \"" + c.number + "\",145,\"\",0,\"\",0");
+      }
+      c.nextRingMs += c.periodMs;
+      c.ringsLeft--;
+      c.ringing = c.ringsLeft > 0;
+    }
+  }
+
+  bool garbled = hostBaud != config.baud;
+  uint64_t byteUs = 10000000ULL / config.baud;
+  while (!outgoing.empty() && outgoing.begin()->first <= now) {
+    uint64_t lineUs = std::max(lineFreeUs, outgoing.begin()->first * 1000);
+    for (char ch : outgoing.begin()->second) {
+      // Чужая скорость: вместо байта — мусор (как при реальном рассогласовании)
+      rx.push_back(garbled ? (char)(0x80 | nextRandom()) : ch);
+      if (config.uartTiming) {
+        lineUs += byteUs;
+        rxReadyUs.push_back(lineUs);
+      }
+    }
+    lineFreeUs = lineUs;
+    outgoing.erase(outgoing.begin());
+  }
+}
+
+int ModemSim::available() {
+  pump();
+  if (!config.uartTiming) return (int)rx.size();
+  int ready = 0;
+  while (ready < (int)rxReadyUs.size() && rxReadyUs[ready] <= HostClock::nowUs) ready++;
+  return ready;
+}
+
+int ModemSim::read() {
+  pump();
+  if (rx.empty()) return -1;
+  if (config.uartTiming) {
+    if (rxReadyUs.front() > HostClock::nowUs) return -1;
+    rxReadyUs.pop_front();
+  }
+  char c = rx.front();
+  rx.pop_front();
+  return (uint8_t)c;
+}
+
+void ModemSim::write(const char* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    char c = data[i];
+    if (c == '\r' || c == '\n') {
+      if (!commandBuf.empty()) handleCommand(commandBuf);
+      commandBuf.clear();
+    } else {
+      commandBuf += c;
+    }
+  }
+}
+
+// Часы модема: "yy/MM/dd,hh:mm:ss±zz", время местное
+std::string ModemSim::clockText(uint64_t nowMs) const {
+  // Без времени сети SIM800L считает от 2004-01-01 00:00 с момента включения
+  const int64_t MODEM_EPOCH = 1072915200;
+  int quarters = 0;
+  int64_t local = MODEM_EPOCH + (int64_t)(nowMs / 1000);
+  if (networkTime && config.networkUtc != 0) {
+    quarters = config.zoneQuarters;
+    local = (int64_t)config.networkUtc + (int64_t)(nowMs / 1000) + quarters * 15 * 60;
+  }
+  time_t t = (time_t)local;
+  struct tm parts;
+  gmtime_r(&t, &parts);
+  char text[64];
+  snprintf(text, sizeof(text), "%02d/%02d/%02d,%02d:%02d:%02d%c%02d", parts.tm_year % 100,
+           parts.tm_mon + 1, parts.tm_mday, parts.tm_hour, parts.tm_min, parts.tm_sec,
+           quarters < 0 ? '-' : '+', quarters < 0 ? -quarters : quarters);
+  return text;
+}
+
+void ModemSim::handleCommand(const std::string& command) {
+  uint64_t now = HostClock::nowMs();
+  // Ещё грузится или скорость не та — команда не понята
+  if (now < config.bootMs || hostBaud != config.baud) return;
+  received.push_back(command);
+
+  uint64_t replyAt = now + config.replyDelayMs;
+  if (echo) schedule(now, command + "\r");
+
+  auto drop = dropping.find(command);
+  if (drop != dropping.end() && drop->second > 0) {
+    drop->second--;
+    return;
+  }
+  auto fail = failing.find(command);
+  if (fail != failing.end() && fail->second > 0) {
+    fail->second--;
+    emitLine(replyAt, "ERROR");
+    return;
+  }
+
+  if (command == "ATE0") {
+    echo = false;
+  } else if (command == "AT+CLIP=1") {
+    clipEnabled = true;
+  } else if (command == "AT+CSQ") {
+    emitLine(replyAt, "+CSQ: " + std::to_string(config.signal) + ",0");
+  } else if (command == "AT+CREG?") {
+    emitLine(replyAt, "+CREG: 0," + std::to_string(config.registration));
+  } else if (command == "AT+CLTS=1") {
+    networkTime = true;
+  } else if (command == "AT+CCLK?") {
+    emitLine(replyAt, "+CCLK: \"" + clockText(now) + "\"");
+  } else if (command == "ATH") {
+    hangupCount++;
+    for (Call& c : calls) {
+      if (c.ringing) c.ringsLeft = 0;  // текущий звонок сброшен
+      c.ringing = false;
+    }
+  } else if (command != "AT" && command.compare(0, 3, "AT+") != 0) {
+    emitLine(replyAt, "ERROR");
+    return;
+  }
+  emitLine(replyAt, "OK");
+}
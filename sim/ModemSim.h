@@ -0,0 +1,101 @@
+#ifndef MODEM_SIM_H
+#define MODEM_SIM_H
+
+#include <Arduino.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "GsmPort.h"
+
+/**
+ * Симулятор SIM800L для хоста: реализует GsmPort, отвечает на команды
+ * конфигурации GSMManager и по виртуальным часам (HostClock) выдаёт
+ * запланированные URC.
+ *
+ * Что умеет:
+ *  - своя скорость UART: пока GSMManager перебирает BAUDS[] не на той
+ *    скорости, модем команд не понимает, а его вывод приходит мусором;
+ *  - задержка загрузки (молчит bootMs) и задержка ответа на команду;
+ *  - эхо до ATE0, +CLIP только после AT+CLIP=1;
+ *  - ERROR или отсутствие ответа на заданную команду (fail/drop);
+ *  - звонок: RING (+CLIP) с периодом, пока не придёт ATH или не кончатся гудки;
+ *  - SMS (+CMT и строка текста), произвольная строка, шум;
+ *  - ответы на AT+CSQ и AT+CREG? (уровень сигнала и регистрация из Config);
+ *  - часы AT+CCLK?: после AT+CLTS=1 — время сети из Config (networkUtc),
+ *    иначе (или без времени сети) — часы с 2004 года, как у SIM800L без NITZ;
+ *  - uartTiming: байты приходят хосту не разом, а со скоростью UART
+ *    (10 бит на байт) — для задержек «звонок → реле» в gate_sim.
+ */
+class ModemSim : public GsmPort {
+public:
+  struct Config {
+    uint32_t baud = 9600;
+    uint32_t bootMs = 0;         // молчит после старта
+    uint32_t replyDelayMs = 20;  // от команды до ответа
+    uint32_t seed = 1;           // шум и мусор на чужой скорости
+    int signal = 18;             // ответ +CSQ
+    int registration = 1;        // stat в ответе +CREG
+    bool uartTiming = false;     // темп приёма — скорость UART
+    uint32_t networkUtc = 0;     // время сети (UTC) в момент 0 виртуальных часов, 0 — нет
+    int zoneQuarters = 12;       // зона в ответе +CCLK, четверти часа (+3 ч)
+  };
+
+  explicit ModemSim(const Config& config);
+
+  // GsmPort
+  void begin(uint32_t baud) override;
+  void setBaud(uint32_t baud) override;
+  int available() override;
+  int read() override;
+  void write(const char* data, size_t len) override;
+
+  // Сценарий (время — мс виртуальных часов)
+  void emitLine(uint64_t atMs, const std::string& line);
+  void emitRaw(uint64_t atMs, const std::string& bytes);
+  void noise(uint64_t atMs, size_t bytes);
+  void call(uint64_t atMs, const std::string& number, int rings, uint32_t periodMs, bool withClip);
+  void sms(uint64_t atMs, const std::string& number, const std::string& text);
+  void failCommand(const std::string& command, int times);  // ответ ERROR
+  void dropCommand(const std::string& command, int times);  // без ответа
+
+  // Наблюдение
+  const std::vector<std::string>& commands() const { return received; }
+  int hangups() const { return hangupCount; }
+
+private:
+  struct Call {
+    std::string number;
+    int ringsLeft;
+    uint32_t periodMs;
+    bool withClip;
+    uint64_t nextRingMs;
+    bool ringing;  // уже звонит — ATH его сбросит
+  };
+
+  void schedule(uint64_t atMs, const std::string& bytes);
+  void pump();              // перенос наступивших событий в приёмный буфер
+  void handleCommand(const std::string& command);
+  std::string clockText(uint64_t nowMs) const;
+  uint8_t nextRandom();
+
+  Config config;
+  uint32_t hostBaud = 0;
+  uint32_t rng;
+  bool echo = true;
+  bool clipEnabled = false;
+  bool networkTime = false;  // AT+CLTS=1
+  int hangupCount = 0;
+
+  std::multimap<uint64_t, std::string> outgoing;  // время → байты
+  std::deque<char> rx;                            // уже «пришло» хосту
+  std::deque<uint64_t> rxReadyUs;                 // с uartTiming: когда байт дочитан
+  uint64_t lineFreeUs = 0;                        // конец последнего байта на линии
+  std::string commandBuf;
+  std::vector<std::string> received;
+  std::vector<Call> calls;
+  std::map<std::string, int> failing;
+  std::map<std::string, int> dropping;
+};
+
+#endif // MODEM_SIM_H
@@ -0,0 +1,83 @@
+// Бенчмарк: от прихода строки +CLIP до вызова GateOpenFn.
+//
+//   build/bench_call_to_open [итераций] [--max-p99-us N]
+//
+// Меряется процессорное время хоста на разбор URC, проверку номера,
+// дедупликацию и ATH — то, что меняется при правке GSMManager/AtTokenizer.
+// Время передачи байт по UART (9600 бод ≈ 1 мс на символ) сюда не входит:
+// оно одинаково для любой реализации и на хосте не воспроизводится.
+// С --max-p99-us код выхода 1, если p99 выше порога (регрессия).
+
+#include <Arduino.h>
+#include <chrono>
+#include <vector>
+#include "GSMManager.h"
+#include "ModemSim.h"
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+  int iterations = 10000;
+  double maxP99Us = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--max-p99-us") == 0 && i + 1 < argc) maxP99Us = atof(argv[++i]);
+    else iterations = atoi(argv[i]);
+  }
+  if (iterations <= 0) iterations = 10000;
+
+  ModemSim::Config config;
+  config.replyDelayMs = 0;
+  ModemSim modem(config);
+
+  bool opened = false;
+  GSMManager::init(
+    &modem,
+    [](const String& number, bool) { return (uint8_t)(number.size() > 0 && number[0] == '+'); },
+    [&opened](const String&, uint8_t) { opened = true; });
+
+  // Конфигурация модема до READY
+  for (int ms = 0; ms < 1000 && !GSMManager::isReady(); ms++) {
+    GSMManager::handleGSM();
+    HostClock::advanceMs(1);
+  }
+  if (!GSMManager::isReady()) {
+    fprintf(stderr, "модем не вышел в READY\n");
+    return 2;
+  }
+
+  std::vector<double> samples;
+  samples.reserve(iterations);
+  char line[64];
+  for (int i = 0; i < iterations; i++) {
+    // Уникальный номер — дедупликация звонков не срабатывает
+    snprintf(line, sizeof(line), "+CLIP: \"+7999%07d\",145,\"\",0,\"\",0", i);
+    modem.emitLine(HostClock::nowMs(), line);
+    opened = false;
+
+    Clock::time_point start = Clock::now();
+    GSMManager::handleGSM();
+    Clock::time_point end = Clock::now();
+
+    if (!opened) {
+      fprintf(stderr, "итерация %d: ворота не открыты\n", i);
+      return 2;
+    }
+    samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    HostClock::advanceMs(1);
+  }
+
+  std::sort(samples.begin(), samples.end());
+  auto pct = [&samples](double p) {
+    size_t index = (size_t)(p * (samples.size() - 1));
+    return samples[index];
+  };
+  double p99 = pct(0.99);
+  printf("call→open, %d итераций (мкс): min %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+         iterations, samples.front(), pct(0.5), pct(0.9), p99, samples.back());
+
+  if (maxP99Us > 0 && p99 > maxP99Us) {
+    printf("FAIL: p99 %.2f мкс > порога %.2f мкс\n", p99, maxP99Us);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,1146 @@
+// Симулятор контроллера ворот на виртуальном времени: сутки трафика за секунды.
+//
+//   build/gate_sim days/workday.txt [-v] [--timeline relay.csv]
+//
+// Собирается из настоящих модулей прошивки — GateControl (реле), EventBus,
+// Scheduler, Settings, PhoneIndex, Schedule, TimeSource, AccessDecision,
+// RingLog и AuditLog (SPIFFS в памяти, host/HostFs.cpp), GSMManager (с ModemSim
+// вместо UART2) и декодеров SubGhz — и крутит их в порядке processLoop() из
+// main.cpp, со сном loop() через Scheduler::sleep(). Сам main.cpp на хосте не
+// собирается (WebServer, WiFi, ArduinoJson, RadioLib), поэтому его клей повторён
+// здесь: обработчики HTTP — те же вызовы шины, реестра настроек и журналов,
+// приём CC1101 — подача импульсов в SubGhzMultiDecoder с подавлением повторов
+// 5 с, как в CC1101Manager. Решение по ключу и номеру, его метрики и запись в
+// журнал доступа — AccessDecision, тот же код, что в прошивке: ключ ищется с
+// допусками по частоте, TE и bitString, команда уходит воротам из маски
+// ключа/телефона, если пускает его расписание. Пакеты двух брелоков,
+// перекрывшиеся в эфире, теряются оба. UART модема — со скоростью 9600 бод.
+// Время обработки на хосте в виртуальное время не входит: задержки — это
+// ожидание в очередях, сне loop() и UART модема.
+//
+// Формат сценария — по команде на строку, '#' — комментарий. Время: 500ms,
+// 90s, 15m, 2h, 1d или время суток [<N>d]HH:MM[:SS] от начала прогона.
+//   seed <n>
+//   gates <N>                                          число ворот (1, GATE_COUNT прошивки)
+//   gate <открытие>/<пауза>/<закрытие> [gate=N]        тайминги ворот N (0), с
+//   schedule <имя> <правила...>                        расписание доступа (Schedule.h), до key/phone
+//   key <имя> came <hex> [disabled|unknown] [gates=M] [schedule=S]  брелок CAME (unknown — нет в базе)
+//   key <имя> trace <файл> [disabled|unknown] [gates=M] [schedule=S]  импульсы: +мкс HIGH, -мкс LOW
+//   phone <номер> call|sms|both [gates=M] [schedule=S] M — маска ворот (бит i — ворота i), 1
+//   modem delay=<мс> seed=<n> uart=on|off              (до первого run)
+//   clock <ГГГГ-ММ-ДД> gsm|ntp|none [zone=<мин>]      календарь: 0 виртуальных часов — местная
+//                                                       полночь даты; время приходит от сети
+//                                                       GSM (AT+CCLK?), сразу по NTP или не приходит
+//   at <время> <действие>                               разовое
+//   every <период> [jitter=<время>] [from=HH:MM] [to=HH:MM] <действие>
+//                                                       каждый день в окне from..to
+//   run <время>                                         прогнать до момента
+//   expect <метрика> <=|>=|==|<|> <число>
+// Действия:
+//   rf <ключ> [repeats=N]                 нажатие брелока: N пакетов подряд (4)
+//   call <номер> [rings=N]
+//   sms <номер> <текст...>
+//   http open [gate=N]
+//   http set [gate=N] <поле>=<значение>...  одним запросом (имена полей — как в API)
+//
+// Метрики: opens_rf, opens_gsm, opens_http, relay_open_on, relay_close_on (все
+// ворота), gate<N>_commands, gate<N>_relay_open_on, gate<N>_relay_close_on,
+// gate<N>_relay_open_s (K1 под током, с),
+// interlock_violations, flash_writes (сумма), flash_writes_settings,
+// flash_writes_gate_count, flash_writes_log, flash_writes_audit (страницы
+// SPIFFS RingLog и AuditLog, без создания файлов), rf_unknown, rf_disabled, rf_duplicates, rf_collisions,
+// rf_out_of_schedule, gsm_out_of_schedule, time_synced (1 — время известно), bus_dropped,
+// heap_peak_bytes, latency_<rf|gsm|http>_<p50|p99|max>_ms.
+//
+// Код выхода: 0 — все expect выполнены, 1 — нет, 2 — ошибка сценария.
+
+#include <Arduino.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <vector>
+#include "AccessDecision.h"
+#include "AuditLog.h"
+#include "EventBus.h"
+#include "GSMManager.h"
+#include "GateControl.h"
+#include "PhoneIndex.h"
+#include "RingLog.h"
+#include <SPIFFS.h>
+#include "Schedule.h"
+#include "Scheduler.h"
+#include "Settings.h"
+#include "SubGhzDecoder.h"
+#include "TimeSource.h"
+#include "ModemSim.h"
+
+// --- Куча: пик живых байт, выделенных кодом прошивки ---
+// Выделения самого симулятора (сценарий, отчёт, ModemSim) не считаются.
+namespace {
+  bool heapTracking = false;
+  size_t heapLive = 0;
+  size_t heapPeak = 0;
+
+  struct alignas(16) AllocHeader {
+    size_t size;
+    bool tracked;
+  };
+
+  // Переключение учёта на время блока: true — работает прошивка
+  struct HeapScope {
+    bool saved;
+    explicit HeapScope(bool firmware) : saved(heapTracking) { heapTracking = firmware; }
+    ~HeapScope() { heapTracking = saved; }
+  };
+}
+
+// noinline: иначе GCC встраивает их в вызывающий код и ругается на h - 1
+__attribute__((noinline)) void* operator new(size_t size) {
+  AllocHeader* h = (AllocHeader*)malloc(size + sizeof(AllocHeader));
+  if (!h) throw std::bad_alloc();
+  h->size = size;
+  h->tracked = heapTracking;
+  if (heapTracking) {
+    heapLive += size;
+    if (heapLive > heapPeak) heapPeak = heapLive;
+  }
+  return h + 1;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+  if (!p) return;
+  AllocHeader* h = (AllocHeader*)p - 1;
+  if (h->tracked) heapLive -= h->size;
+  free(h);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+
+namespace {
+  const uint64_t DAY_MS = 86400000ULL;
+  const int MAX_GATES = GateControl::MAX_GATES;
+  // Пары реле ворот, как GATE_PINS в main.cpp
+  const uint8_t GATE_PINS[MAX_GATES][2] = {{12, 13}, {25, 26}, {27, 14}, {32, 33}};
+
+  // Константы прошивки (main.cpp, CC1101Manager.cpp)
+  const uint32_t LOOP_POLL_MS = 10;
+  const unsigned long GATE_COUNT_SAVE_INTERVAL_MS = 300000;
+  const unsigned long DECODED_DUPLICATE_SUPPRESS_MS = 5000;
+  const int RF_RSSI = -60;  // уровень сигнала не моделируется
+  const int MAX_BITS = 128;
+
+  // --- Состояние «прошивки» (поля systemState, которые трогает loop) ---
+  struct {
+    float currentFrequency = 433.92f;
+    float bitRate = 3.79f;
+    float freqDeviation = 5.2f;
+    float rxBandwidth = 58.0f;
+    int outputPower = 10;
+    struct {
+      int openSec = 3;
+      int staySec = 15;
+      int closeSec = 3;
+    } gateConfig[MAX_GATES];
+    bool learningMode = false;
+    int timeZoneMin = 180;
+    uint32_t gateOpenCount = 0;
+  } systemState;
+
+  int gateCount = 1;
+  GateControl::Gate gates[MAX_GATES];
+  int gateSubscriber = -1;
+  int uiSubscriber = -1;
+  bool gateCountDirty = false;
+  uint64_t lastDecodedCode = 0;
+  unsigned long lastDecodedAt = 0;
+  SubGhzMultiDecoder decoder;
+
+  // --- Мир вокруг: сценарий ---
+  struct Key {
+    std::string name;
+    std::vector<int32_t> pulses;  // +HIGH / -LOW, мкс
+    uint64_t packetUs = 0;
+    const char* protocol = nullptr;  // как его распознаёт декодер
+    uint32_t code = 0;               // младшие 32 бита, как KeyEntry::code
+    int bits = 0;
+    std::string bitString;
+    float te = 0;
+    float frequency = 0;             // частота приёмника при обучении
+    bool registered = true;
+    bool enabled = true;
+    uint8_t gates = 1;
+    uint8_t schedule = Schedule::ALWAYS;
+  };
+
+  struct Action {
+    enum Kind { RF, CALL, SMS, HTTP_OPEN, HTTP_SET } kind;
+    int key = -1;
+    int repeats = 4;
+    std::string number;
+    int rings = 3;
+    std::string text;
+    int gate = 0;
+    std::vector<std::pair<Settings::Id, float>> settings;
+  };
+
+  struct Generator {
+    uint64_t periodMs;
+    uint64_t jitterMs;
+    uint64_t fromMs;
+    uint64_t toMs;
+    uint64_t nextMs;
+    Action action;
+  };
+
+  struct Packet {
+    int key;
+    uint64_t pressUs;  // начало нажатия — от него считается задержка RF
+    bool collided;     // перекрылся в эфире с пакетом другого брелока
+  };
+
+  std::vector<Key> keys;
+  std::vector<size_t> keyBase;  // зарегистрированные ключи — systemState.keys433
+  std::vector<Generator> generators;
+  std::multimap<uint64_t, Action> actions;   // мс → действие
+  std::multimap<uint64_t, Packet> packets;   // мкс конца пакета → пакет
+  struct Phone {
+    uint8_t channels;
+    uint8_t gates;
+    uint8_t schedule;
+  };
+  std::map<std::string, Phone> phones;
+  std::vector<std::pair<std::string, Schedule::Week>> schedules;  // id — позиция + 1
+  TimeSource::Origin clockOrigin = TimeSource::ORIGIN_NONE;
+  uint32_t clockUtc = 0;  // UTC в момент 0 виртуальных часов
+  std::map<std::string, uint64_t> lastGsmAt;  // номер → начало звонка/SMS, мкс
+  std::unique_ptr<ModemSim> modem;
+  ModemSim::Config modemConfig;
+  uint32_t rng = 1;
+  FILE* timeline = nullptr;
+  int failures = 0;
+  bool started = false;
+  uint64_t loopIterations = 0;
+  double wallSeconds = 0;
+
+  // --- Наблюдения ---
+  const int SOURCES = 4;  // индекс = EventBus::Source
+  const char* const SOURCE_NAMES[SOURCES] = {"", "rf", "gsm", "http"};
+  std::vector<uint64_t> pendingSince[SOURCES];  // FIFO времени запросов, мкс
+  std::vector<uint32_t> latencyUs[SOURCES];
+  uint32_t opens[SOURCES] = {0};
+  uint32_t rfUnknown = 0;
+  uint32_t rfDisabled = 0;
+  uint32_t rfDuplicates = 0;
+  uint32_t rfUndecoded = 0;
+  uint32_t rfCollisions = 0;
+  uint32_t rfOutOfSchedule = 0;
+  uint32_t gsmOutOfSchedule = 0;
+  uint64_t maxPacketUs = 0;
+  uint32_t flashWritesSettings = 0;
+  uint32_t flashWritesGateCount = 0;
+  // Страницы SPIFFS журналов (RingLog, AuditLog) после создания файлов:
+  // файлы полного размера создаются один раз, при первой загрузке
+  uint32_t logPagesAtStart = 0;
+  uint32_t auditPagesAtStart = 0;
+  uint32_t gateCommands[MAX_GATES] = {0};
+
+  struct Relay {
+    const char* name;
+    uint8_t level = LOW;
+    uint32_t switchesOn = 0;
+    uint64_t onSinceUs = 0;
+    uint64_t energizedUs = 0;
+  };
+  // [ворота][0 — K1 «открыть», 1 — K2 «закрыть»]
+  Relay relays[MAX_GATES][2] = {{{"K1"}, {"K2"}}, {{"K1"}, {"K2"}}, {{"K1"}, {"K2"}}, {{"K1"}, {"K2"}}};
+  uint32_t interlockViolations = 0;
+
+  uint32_t nextRandom() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+  }
+
+  // --- Перехватчики: GPIO, UART модема, сон loop() ---
+
+  void onGpioWrite(uint8_t pin, uint8_t level) {
+    HeapScope scope(false);
+    int gate = -1;
+    Relay* relay = nullptr;
+    for (int g = 0; g < MAX_GATES && !relay; g++) {
+      for (int c = 0; c < 2; c++) {
+        if (GATE_PINS[g][c] == pin) {
+          gate = g;
+          relay = &relays[g][c];
+        }
+      }
+    }
+    if (!relay || relay->level == level) return;
+    relay->level = level;
+    if (level == HIGH) {
+      relay->switchesOn++;
+      relay->onSinceUs = HostClock::nowUs;
+    } else {
+      relay->energizedUs += HostClock::nowUs - relay->onSinceUs;
+    }
+    if (relays[gate][0].level == HIGH && relays[gate][1].level == HIGH) interlockViolations++;
+    if (timeline) {
+      fprintf(timeline, "%llu.%03llu,%d,%s,%d\n", (unsigned long long)(HostClock::nowUs / 1000),
+              (unsigned long long)(HostClock::nowUs % 1000), gate, relay->name, level);
+    }
+  }
+
+  // UART модема: байты ModemSim — не куча прошивки
+  class UntrackedPort : public GsmPort {
+  public:
+    explicit UntrackedPort(GsmPort* inner) : inner(inner) {}
+    void begin(uint32_t baud) override { HeapScope s(false); inner->begin(baud); }
+    void setBaud(uint32_t baud) override { HeapScope s(false); inner->setBaud(baud); }
+    int available() override { HeapScope s(false); return inner->available(); }
+    int read() override { HeapScope s(false); return inner->read(); }
+    void write(const char* data, size_t len) override { HeapScope s(false); inner->write(data, len); }
+  private:
+    GsmPort* inner;
+  };
+  std::unique_ptr<UntrackedPort> port;
+
+  uint64_t nextExternalUs() {
+    uint64_t next = UINT64_MAX;
+    if (!actions.empty()) next = actions.begin()->first * 1000;
+    if (!packets.empty()) next = std::min(next, packets.begin()->first);
+    return next;
+  }
+
+  // Сон loop(): до таймаута или до ближайшего внешнего события
+  // (готовый пакет CC1101 будит её из ISR, запрос HTTP — через шину)
+  bool sleepUntilEvent(TickType_t ticks) {
+    uint64_t target = HostClock::nowUs + (uint64_t)ticks * 1000;
+    uint64_t next = nextExternalUs();
+    if (next < target) {
+      if (next > HostClock::nowUs) HostClock::nowUs = next;
+      return true;
+    }
+    HostClock::nowUs = target;
+    return false;
+  }
+
+  // --- Клей main.cpp ---
+
+  bool saveSystemState() {
+    // Запись во флеш — считается, но ничего не стоит во времени
+    Settings::markCommitted();
+    return true;
+  }
+
+  void jobGateCountFlush() {
+    if (!gateCountDirty) return;
+    flashWritesGateCount++;
+    if (saveSystemState()) gateCountDirty = false;
+  }
+
+  void jobSettingsCommit() {
+    if (!Settings::commitDue()) return;
+    flashWritesSettings++;
+    Settings::commitDone(saveSystemState());
+  }
+
+  bool applyTimeZone(float minutes) {
+    TimeSource::setZone((int)minutes);
+    return true;
+  }
+
+  uint32_t flashWritesLog() {
+    return HostFs::pageWrites("/log.bin") - logPagesAtStart;
+  }
+
+  uint32_t flashWritesAudit() {
+    return HostFs::pageWrites("/audit.bin") - auditPagesAtStart;
+  }
+
+  uint32_t flashWrites() {
+    return flashWritesSettings + flashWritesGateCount + flashWritesLog() + flashWritesAudit();
+  }
+
+  void noteRequest(EventBus::Source source, uint64_t sinceUs) {
+    HeapScope scope(false);
+    pendingSince[source].push_back(sinceUs);
+  }
+
+  void onGateCommand(const EventBus::Event& event) {
+    uint8_t mask = event.gateCommand.gates & ((1u << gateCount) - 1);
+    if (mask == 0) return;
+    for (int i = 0; i < gateCount; i++) {
+      if (!(mask & (1u << i))) continue;
+      const auto& cfg = systemState.gateConfig[i];
+      gates[i].startCycle((unsigned long)cfg.openSec * 1000UL, (unsigned long)cfg.staySec * 1000UL,
+                          (unsigned long)cfg.closeSec * 1000UL);
+      gateCommands[i]++;
+    }
+    systemState.gateOpenCount++;
+    gateCountDirty = true;
+
+    HeapScope scope(false);
+    int source = event.gateCommand.source;
+    opens[source]++;
+    if (!pendingSince[source].empty()) {
+      latencyUs[source].push_back((uint32_t)(HostClock::nowUs - pendingSince[source].front()));
+      pendingSince[source].erase(pendingSince[source].begin());
+    }
+  }
+
+  void onGatePhase(const EventBus::Event&) {
+    // В прошивке — событие gate_status в WebSocket; здесь только разбор очереди
+  }
+
+  void broadcastGateStatus() {
+    static const char* lastPhase[MAX_GATES] = {};
+    for (int i = 0; i < gateCount; i++) {
+      const char* current = gates[i].phaseName();
+      if (current != lastPhase[i]) {
+        lastPhase[i] = current;
+        EventBus::publishGatePhase(i, current, gates[i].nextDirName(), gates[i].positionNow());
+      }
+    }
+  }
+
+  // bitString пакета — старший бит первым, выше 64-го из data_2 (CC1101Manager)
+  void bitStringOf(const SubGhzDecoderResult& r, char* out) {
+    int n = std::min(r.bitCount, MAX_BITS);
+    for (int i = 0; i < n; i++) {
+      int b = r.bitCount - 1 - i;
+      uint64_t src = b >= 64 ? r.data_2 : r.data;
+      out[i] = ((src >> (b >= 64 ? b - 64 : b)) & 1) ? '1' : '0';
+    }
+    out[n] = '\0';
+  }
+
+  AccessDecision::Signature signatureOf(size_t index) {
+    const Key& key = keys[index];
+    return {key.protocol, key.bitString.c_str(), key.bits, key.code, key.te, key.frequency};
+  }
+
+  // Приём CC1101: пакет целиком через декодеры, повтор того же кода в окне 5 с
+  // подавляется (CC1101Manager), затем решение processLoop()
+  void receiveRf() {
+    if (packets.empty() || packets.begin()->first > HostClock::nowUs) return;
+    Packet packet = packets.begin()->second;
+    {
+      HeapScope scope(false);
+      packets.erase(packets.begin());
+    }
+
+    if (packet.collided) {
+      rfCollisions++;
+      return;
+    }
+
+    const Key& sent = keys[packet.key];
+    SubGhzDecoderResult result{};
+    decoder.resetAll();
+    for (int32_t pulse : sent.pulses) {
+      SubGhzDecoderResult r = decoder.feed(pulse > 0, (unsigned long)(pulse > 0 ? pulse : -pulse));
+      if (r.ready) {
+        result = r;
+        break;
+      }
+    }
+    if (!result.ready) {
+      rfUndecoded++;
+      return;
+    }
+
+    unsigned long now = millis();
+    if (result.data == lastDecodedCode && now - lastDecodedAt < DECODED_DUPLICATE_SUPPRESS_MS) {
+      rfDuplicates++;
+      return;
+    }
+    lastDecodedCode = result.data;
+    lastDecodedAt = now;
+
+    // Решение — AccessDecision, как processLoop() в main.cpp
+    char bits[MAX_BITS + 1];
+    bitStringOf(result, bits);
+    AccessDecision::Signature received = {result.protocol, bits, result.bitCount,
+                                          (uint32_t)(result.data & 0xFFFFFFFF), result.te,
+                                          systemState.currentFrequency};
+    int found = AccessDecision::findKey(keyBase, received, signatureOf);
+    const Key* match = found >= 0 ? &keys[keyBase[found]] : nullptr;
+    AccessDecision::Outcome outcome =
+      AccessDecision::decideKey(found, match && match->enabled, match ? match->schedule : Schedule::ALWAYS, now);
+    uint32_t latency = (uint32_t)(HostClock::nowUs - packet.pressUs);
+    switch (outcome) {
+      case AccessDecision::UNKNOWN: rfUnknown++; break;
+      case AccessDecision::DISABLED: rfDisabled++; break;
+      case AccessDecision::OUT_OF_SCHEDULE: rfOutOfSchedule++; break;
+      case AccessDecision::OPEN:
+        if (!EventBus::publishGateCommand(EventBus::SOURCE_RF, match->gates)) return;
+        noteRequest(EventBus::SOURCE_RF, packet.pressUs);
+        EventBus::dispatch(gateSubscriber);
+        break;
+    }
+    AccessDecision::recordKey(outcome, received.code, RF_RSSI, latency);
+    if (outcome == AccessDecision::OPEN) {
+      char line[96];
+      snprintf(line, sizeof(line), "Ворота: %s RSSI:%d", match->name.c_str(), RF_RSSI);
+      RingLog::append(line);
+    }
+  }
+
+  void processLoop() {
+    EventBus::dispatch(gateSubscriber);
+    unsigned long now = millis();
+    for (int i = 0; i < gateCount; i++) gates[i].update(now);
+    broadcastGateStatus();
+    receiveRf();
+    GSMManager::handleGSM();
+    EventBus::dispatch(gateSubscriber);
+  }
+
+  // --- Внешние события ---
+
+  void deliver(const Action& action) {
+    uint64_t nowMs = HostClock::nowMs();
+    switch (action.kind) {
+      case Action::RF: {
+        HeapScope scope(false);
+        const Key& key = keys[action.key];
+        for (int r = 0; r < action.repeats; r++) {
+          uint64_t endUs = HostClock::nowUs + (r + 1) * key.packetUs;
+          uint64_t startUs = endUs - key.packetUs;
+          bool collided = false;
+          // Пакеты в эфире, перекрывающие [startUs, endUs)
+          for (auto it = packets.upper_bound(startUs); it != packets.end() && it->first < endUs + maxPacketUs; ++it) {
+            if (it->first - keys[it->second.key].packetUs < endUs) {
+              it->second.collided = true;
+              collided = true;
+            }
+          }
+          packets.emplace(endUs, Packet{action.key, HostClock::nowUs, collided});
+        }
+        break;
+      }
+      case Action::CALL: {
+        HeapScope scope(false);
+        lastGsmAt[action.number] = HostClock::nowUs;
+        modem->call(nowMs, action.number, action.rings, 4000, true);
+        break;
+      }
+      case Action::SMS: {
+        HeapScope scope(false);
+        lastGsmAt[action.number] = HostClock::nowUs;
+        modem->sms(nowMs, action.number, action.text);
+        break;
+      }
+      case Action::HTTP_OPEN:
+        // handleGateTrigger() в задаче http
+        if (!EventBus::publishGateCommand(EventBus::SOURCE_HTTP, 1u << action.gate)) break;
+        noteRequest(EventBus::SOURCE_HTTP, HostClock::nowUs);
+        AuditLog::record(AuditLog::SOURCE_HTTP, 0, 0, AuditLog::DECISION_OPENED);
+        RingLog::append("Ворота активированы (API)");
+        break;
+      case Action::HTTP_SET: {
+        // handleGateConfig() / handleCC1101Settings()
+        Settings::Batch batch;
+        for (const auto& s : action.settings) Settings::set(s.first, s.second);
+        break;
+      }
+    }
+  }
+
+  void deliverDue() {
+    while (!actions.empty() && actions.begin()->first <= HostClock::nowMs()) {
+      Action action;
+      {
+        HeapScope scope(false);
+        action = actions.begin()->second;
+        actions.erase(actions.begin());
+      }
+      deliver(action);
+    }
+  }
+
+  void start() {
+    if (started) return;
+    started = true;
+    HeapScope scope(true);
+
+    HostGpio::onWrite = onGpioWrite;
+    HostRtos::sleepHook = sleepUntilEvent;
+
+    Settings::bindFloat(Settings::FREQUENCY, &systemState.currentFrequency);
+    Settings::bindFloat(Settings::BIT_RATE, &systemState.bitRate);
+    Settings::bindFloat(Settings::FREQ_DEVIATION, &systemState.freqDeviation);
+    Settings::bindFloat(Settings::RX_BANDWIDTH, &systemState.rxBandwidth);
+    Settings::bindInt(Settings::OUTPUT_POWER, &systemState.outputPower);
+    for (int i = 0; i < MAX_GATES; i++) {
+      auto& cfg = systemState.gateConfig[i];
+      Settings::bindInt(Settings::gateSetting(Settings::GATE_OPEN_SEC, i), &cfg.openSec);
+      Settings::bindInt(Settings::gateSetting(Settings::GATE_STAY_SEC, i), &cfg.staySec);
+      Settings::bindInt(Settings::gateSetting(Settings::GATE_CLOSE_SEC, i), &cfg.closeSec);
+    }
+    Settings::bindBool(Settings::LEARNING_MODE, &systemState.learningMode);
+    Settings::bindInt(Settings::TIME_ZONE, &systemState.timeZoneMin, applyTimeZone);
+
+    RingLog::init();
+    AuditLog::init();
+    logPagesAtStart = HostFs::pageWrites("/log.bin");
+    auditPagesAtStart = HostFs::pageWrites("/audit.bin");
+    {
+      HeapScope simScope(false);
+      for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i].registered) keyBase.push_back(i);
+      }
+    }
+
+    Schedule::begin();
+    for (const auto& s : schedules) Schedule::add(s.second);
+    PhoneIndex::begin(phones.size());
+    for (const auto& p : phones) PhoneIndex::add(p.first.c_str(), p.second.channels, p.second.gates, p.second.schedule);
+    PhoneIndex::commit();
+
+    // Время: NTP — сразу при старте (WiFi уже есть), GSM — когда прошивка
+    // спросит часы модема; без источника расписания не пускают никого
+    TimeSource::setZone(systemState.timeZoneMin);
+    if (clockOrigin == TimeSource::ORIGIN_NTP) TimeSource::sync(clockUtc, TimeSource::ORIGIN_NTP, millis());
+    if (clockOrigin == TimeSource::ORIGIN_GSM) {
+      modemConfig.networkUtc = clockUtc;
+      modemConfig.zoneQuarters = systemState.timeZoneMin / 15;
+    }
+
+    for (int i = 0; i < gateCount; i++) gates[i].begin(i, GATE_PINS[i][0], GATE_PINS[i][1]);
+
+    {
+      HeapScope simScope(false);
+      modem.reset(new ModemSim(modemConfig));
+      port.reset(new UntrackedPort(modem.get()));
+    }
+    GSMManager::init(
+      port.get(),
+      [](const String& number, bool isCall) {
+        // gsmTrustedCheck()
+        uint8_t gates = 0;
+        AccessDecision::Outcome outcome = AccessDecision::decidePhone(number.c_str(), isCall, millis(), &gates);
+        if (outcome == AccessDecision::OPEN) return gates;
+        AccessDecision::recordPhone(outcome, number);
+        if (outcome == AccessDecision::OUT_OF_SCHEDULE) gsmOutOfSchedule++;
+        return (uint8_t)0;
+      },
+      [](const String& source, uint8_t gates) {
+        // gsmGateOpen(); source — "звонок +7…" / "SMS +7…"
+        uint64_t since = HostClock::nowUs;
+        {
+          HeapScope scope(false);
+          for (const auto& g : lastGsmAt) {
+            if (source.size() >= g.first.size() &&
+                source.compare(source.size() - g.first.size(), g.first.size(), g.first) == 0) {
+              since = g.second;
+            }
+          }
+        }
+        if (!EventBus::publishGateCommand(EventBus::SOURCE_GSM, gates)) return;
+        noteRequest(EventBus::SOURCE_GSM, since);
+        AccessDecision::recordPhone(AccessDecision::OPEN, source);
+        char line[96];
+        snprintf(line, sizeof(line), "Ворота: %s", source.c_str());
+        RingLog::append(line);
+      });
+
+    Scheduler::every("gate_count_flush", GATE_COUNT_SAVE_INTERVAL_MS, jobGateCountFlush);
+    Scheduler::every("settings_commit", 250, jobSettingsCommit);
+    gateSubscriber = EventBus::subscribe("gate", EventBus::topicBit(EventBus::TOPIC_GATE_COMMAND),
+                                         onGateCommand, Scheduler::wake);
+    uiSubscriber = EventBus::subscribe("ui", EventBus::topicBit(EventBus::TOPIC_GATE_PHASE), onGatePhase);
+  }
+
+  void expandGenerators(uint64_t untilMs) {
+    for (Generator& g : generators) {
+      for (;;) {
+        uint64_t tod = g.nextMs % DAY_MS;
+        if (tod < g.fromMs) g.nextMs += g.fromMs - tod;
+        else if (tod >= g.toMs) g.nextMs += DAY_MS - tod + g.fromMs;
+        if (g.nextMs >= untilMs) break;
+        uint64_t at = g.nextMs + (g.jitterMs ? nextRandom() % g.jitterMs : 0);
+        actions.emplace(at, g.action);
+        g.nextMs += g.periodMs;
+      }
+    }
+  }
+
+  void runUntil(uint64_t untilMs) {
+    start();
+    expandGenerators(untilMs);
+    auto wallStart = std::chrono::steady_clock::now();
+    while (HostClock::nowMs() < untilMs) {
+      HeapScope scope(true);
+      deliverDue();
+      processLoop();
+      Scheduler::runDue();  // в loop() — после StateLock итерации
+      EventBus::dispatch(uiSubscriber);  // задача http
+      AuditLog::flush();
+      loopIterations++;
+      Scheduler::sleep(LOOP_POLL_MS);
+    }
+    wallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  }
+
+  // --- Отчёт ---
+
+  uint32_t percentile(std::vector<uint32_t> samples, double p) {
+    if (samples.empty()) return 0;
+    std::sort(samples.begin(), samples.end());
+    size_t index = (size_t)(p * (samples.size() - 1) + 0.5);
+    return samples[index];
+  }
+
+  bool metric(const std::string& name, double& value) {
+    for (int s = 1; s < SOURCES; s++) {
+      std::string src = SOURCE_NAMES[s];
+      if (name == "opens_" + src) { value = opens[s]; return true; }
+      if (name == "latency_" + src + "_p50_ms") { value = percentile(latencyUs[s], 0.5) / 1000.0; return true; }
+      if (name == "latency_" + src + "_p99_ms") { value = percentile(latencyUs[s], 0.99) / 1000.0; return true; }
+      if (name == "latency_" + src + "_max_ms") { value = percentile(latencyUs[s], 1.0) / 1000.0; return true; }
+    }
+    uint32_t relayOn[2] = {0, 0};
+    for (int g = 0; g < MAX_GATES; g++) {
+      std::string prefix = "gate" + std::to_string(g) + "_";
+      if (name == prefix + "commands") { value = gateCommands[g]; return true; }
+      if (name == prefix + "relay_open_on") { value = relays[g][0].switchesOn; return true; }
+      if (name == prefix + "relay_close_on") { value = relays[g][1].switchesOn; return true; }
+      if (name == prefix + "relay_open_s") { value = relays[g][0].energizedUs / 1e6; return true; }
+      relayOn[0] += relays[g][0].switchesOn;
+      relayOn[1] += relays[g][1].switchesOn;
+    }
+    uint32_t busDropped = 0;
+    for (int t = 0; t < EventBus::TOPIC_COUNT; t++) busDropped += EventBus::topicStats((EventBus::Topic)t).dropped;
+    const std::map<std::string, double> plain = {
+      {"relay_open_on", relayOn[0]},
+      {"relay_close_on", relayOn[1]},
+      {"interlock_violations", interlockViolations},
+      {"flash_writes", flashWrites()},
+      {"flash_writes_settings", flashWritesSettings},
+      {"flash_writes_gate_count", flashWritesGateCount},
+      {"flash_writes_log", flashWritesLog()},
+      {"flash_writes_audit", flashWritesAudit()},
+      {"rf_unknown", rfUnknown},
+      {"rf_disabled", rfDisabled},
+      {"rf_duplicates", rfDuplicates},
+      {"rf_collisions", rfCollisions},
+      {"rf_out_of_schedule", rfOutOfSchedule},
+      {"gsm_out_of_schedule", gsmOutOfSchedule},
+      {"time_synced", TimeSource::synced() ? 1.0 : 0.0},
+      {"bus_dropped", busDropped},
+      {"heap_peak_bytes", (double)heapPeak},
+    };
+    auto it = plain.find(name);
+    if (it == plain.end()) return false;
+    value = it->second;
+    return true;
+  }
+
+  void report() {
+    double days = HostClock::nowUs / 1000.0 / DAY_MS;
+    double speedup = wallSeconds > 0 ? HostClock::nowUs / 1e6 / wallSeconds : 0;
+    printf("виртуальное время %.2f сут. за %.2f с (x%.0f), итераций loop: %llu\n",
+           days, wallSeconds, speedup, (unsigned long long)loopIterations);
+    for (int g = 0; g < gateCount; g++) {
+      const Relay& k1 = relays[g][0];
+      const Relay& k2 = relays[g][1];
+      printf("ворота %d: команд %u; K1 (открыть) %u включений, под током %.0f с; "
+             "K2 (закрыть) %u включений, под током %.0f с\n",
+             g, gateCommands[g], k1.switchesOn, k1.energizedUs / 1e6, k2.switchesOn, k2.energizedUs / 1e6);
+    }
+    printf("одновременно K1 и K2: %u\n", interlockViolations);
+    printf("команды ворот: rf %u, gsm %u, http %u\n", opens[1], opens[2], opens[3]);
+    printf("пакеты rf: неизвестных %u, отключённых %u, повторов %u, коллизий %u, не распознано %u\n",
+           rfUnknown, rfDisabled, rfDuplicates, rfCollisions, rfUndecoded);
+    printf("вне расписания: rf %u, gsm %u; время: %s\n", rfOutOfSchedule, gsmOutOfSchedule,
+           TimeSource::originName(TimeSource::origin()));
+    printf("задержка запрос → реле, мс:   n      p50      p90      p99      max\n");
+    for (int s = 1; s < SOURCES; s++) {
+      const std::vector<uint32_t>& l = latencyUs[s];
+      printf("  %-4s %24zu %8.1f %8.1f %8.1f %8.1f\n", SOURCE_NAMES[s], l.size(),
+             percentile(l, 0.5) / 1000.0, percentile(l, 0.9) / 1000.0,
+             percentile(l, 0.99) / 1000.0, percentile(l, 1.0) / 1000.0);
+    }
+    uint32_t writes = flashWrites();
+    printf("записей во флеш: %u (настройки %u, счётчик открытий %u, страниц лога %u, журнала доступа %u), "
+           "%.1f в сутки\n",
+           writes, flashWritesSettings, flashWritesGateCount, flashWritesLog(), flashWritesAudit(),
+           days > 0 ? writes / days : 0);
+    for (int t = 0; t < EventBus::TOPIC_COUNT; t++) {
+      EventBus::TopicStats st = EventBus::topicStats((EventBus::Topic)t);
+      printf("шина %-12s опубликовано %u, потеряно %u, глубина до %u\n",
+             EventBus::topicName((EventBus::Topic)t), st.published, st.dropped, st.maxDepth);
+    }
+    printf("куча прошивки: пик %zu байт, сейчас %zu\n", heapPeak, heapLive);
+  }
+
+  // --- Разбор сценария ---
+
+  std::map<std::string, std::string> parseOptions(std::istringstream& in) {
+    std::map<std::string, std::string> options;
+    std::string token;
+    while (in >> token) {
+      size_t eq = token.find('=');
+      if (eq == std::string::npos) options[token] = "";
+      else options[token.substr(0, eq)] = token.substr(eq + 1);
+    }
+    return options;
+  }
+
+  // 500ms, 90s, 15m, 2h, 1d или [<N>d]HH:MM[:SS]; false — не разобрать
+  bool parseTime(const std::string& text, uint64_t& ms) {
+    size_t colon = text.find(':');
+    if (colon != std::string::npos) {
+      uint64_t days = 0;
+      size_t start = 0;
+      size_t d = text.find('d');
+      if (d != std::string::npos && d < colon) {
+        days = std::stoull(text.substr(0, d));
+        start = d + 1;
+      }
+      int h = 0, m = 0, s = 0;
+      if (sscanf(text.c_str() + start, "%d:%d:%d", &h, &m, &s) < 2) return false;
+      ms = days * DAY_MS + ((uint64_t)h * 3600 + m * 60 + s) * 1000;
+      return true;
+    }
+    char* end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    std::string unit = end ? end : "";
+    if (end == text.c_str()) return false;
+    double scale = unit == "ms" ? 1 : unit == "s" ? 1000 : unit == "m" ? 60000 :
+                   unit == "h" ? 3600000 : unit == "d" ? (double)DAY_MS : -1;
+    if (scale < 0) return false;
+    ms = (uint64_t)(value * scale);
+    return true;
+  }
+
+  // id расписания по имени (как scheduleIdOf в main.cpp); -1 — нет такого
+  int findSchedule(const std::string& name) {
+    for (size_t i = 0; i < schedules.size(); i++) {
+      if (schedules[i].first == name) return (int)i + 1;
+    }
+    return -1;
+  }
+
+  int findKey(const std::string& name) {
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (keys[i].name == name) return (int)i;
+    }
+    return -1;
+  }
+
+  // Пакет CAME: пауза 56 TE, стартовый бит, биты (0 — TE/2TE, 1 — 2TE/TE), пауза
+  std::vector<int32_t> cameTrace(uint64_t code, int bits) {
+    const int32_t te = 320;
+    std::vector<int32_t> pulses = {-56 * te, te, -2 * te};
+    for (int i = bits - 1; i >= 0; i--) {
+      bool one = (code >> i) & 1;
+      pulses.push_back(one ? 2 * te : te);
+      pulses.push_back(one ? -te : -2 * te);
+    }
+    pulses.push_back(te);
+    pulses.push_back(-56 * te);
+    return pulses;
+  }
+
+  // Ключ «обучается», как в прошивке: запоминается то, что выдал декодер
+  bool learnKey(Key& key) {
+    key.packetUs = 0;
+    for (int32_t p : key.pulses) key.packetUs += (uint64_t)(p > 0 ? p : -p);
+    decoder.resetAll();
+    for (int32_t p : key.pulses) {
+      SubGhzDecoderResult r = decoder.feed(p > 0, (unsigned long)(p > 0 ? p : -p));
+      if (r.ready) {
+        char bits[MAX_BITS + 1];
+        bitStringOf(r, bits);
+        key.protocol = r.protocol;
+        key.code = (uint32_t)(r.data & 0xFFFFFFFF);
+        key.bits = r.bitCount;
+        key.bitString = bits;
+        key.te = r.te;
+        key.frequency = systemState.currentFrequency;
+        return key.packetUs > 0;
+      }
+    }
+    return false;
+  }
+
+  bool parseAction(std::istringstream& in, Action& action) {
+    std::string kind;
+    if (!(in >> kind)) return false;
+    if (kind == "rf") {
+      std::string name;
+      in >> name;
+      action.kind = Action::RF;
+      action.key = findKey(name);
+      auto options = parseOptions(in);
+      if (options.count("repeats")) action.repeats = std::stoi(options["repeats"]);
+      return action.key >= 0 && action.repeats > 0;
+    }
+    if (kind == "call") {
+      action.kind = Action::CALL;
+      in >> action.number;
+      auto options = parseOptions(in);
+      if (options.count("rings")) action.rings = std::stoi(options["rings"]);
+      return !action.number.empty();
+    }
+    if (kind == "sms") {
+      action.kind = Action::SMS;
+      in >> action.number;
+      std::getline(in >> std::ws, action.text);
+      return !action.number.empty();
+    }
+    if (kind == "http") {
+      std::string what;
+      in >> what;
+      auto options = parseOptions(in);
+      if (options.count("gate")) {
+        action.gate = std::stoi(options["gate"]);
+        options.erase("gate");
+        if (action.gate < 0 || action.gate >= MAX_GATES) return false;
+      }
+      if (what == "open") {
+        action.kind = Action::HTTP_OPEN;
+        return options.empty();
+      }
+      if (what != "set") return false;
+      action.kind = Action::HTTP_SET;
+      for (const auto& o : options) {
+        int id = 0;
+        while (id < Settings::COUNT && o.first != Settings::name((Settings::Id)id)) id++;
+        if (id == Settings::COUNT || o.second.empty()) return false;
+        // Имя тайминга находит ворота 0 — сдвиг на ворота запроса
+        if (id >= Settings::GATE_OPEN_SEC && id < Settings::LEARNING_MODE) {
+          id = Settings::gateSetting((Settings::Id)id, action.gate);
+        }
+        action.settings.push_back({(Settings::Id)id, std::stof(o.second)});
+      }
+      return !action.settings.empty();
+    }
+    return false;
+  }
+
+  bool execute(const std::string& line) {
+    std::istringstream in(line);
+    std::string cmd;
+    if (!(in >> cmd) || cmd[0] == '#') return true;
+
+    if (cmd == "seed") {
+      in >> rng;
+      if (rng == 0) rng = 1;
+      return true;
+    }
+    if (cmd == "gates") {
+      in >> gateCount;
+      return !started && gateCount >= 1 && gateCount <= MAX_GATES;
+    }
+    if (cmd == "gate") {
+      std::string spec;
+      in >> spec;
+      auto options = parseOptions(in);
+      int gate = options.count("gate") ? std::stoi(options["gate"]) : 0;
+      if (started || gate < 0 || gate >= MAX_GATES) return false;
+      auto& cfg = systemState.gateConfig[gate];
+      return sscanf(spec.c_str(), "%d/%d/%d", &cfg.openSec, &cfg.staySec, &cfg.closeSec) == 3;
+    }
+    if (cmd == "modem") {
+      if (started) return false;
+      auto options = parseOptions(in);
+      if (options.count("delay")) modemConfig.replyDelayMs = std::stoul(options["delay"]);
+      if (options.count("seed")) modemConfig.seed = std::stoul(options["seed"]);
+      if (options.count("uart")) modemConfig.uartTiming = options["uart"] != "off";
+      return true;
+    }
+    if (cmd == "schedule") {
+      std::string name, rules;
+      in >> name;
+      std::getline(in >> std::ws, rules);
+      Schedule::Week week;
+      const char* error = nullptr;
+      if (started || name.empty() || findSchedule(name) > 0 ||
+          schedules.size() >= (size_t)Schedule::MAX_SCHEDULES) {
+        return false;
+      }
+      if (!Schedule::compile(rules.c_str(), week, &error)) {
+        fprintf(stderr, "расписание %s: %s\n", name.c_str(), error);
+        return false;
+      }
+      schedules.push_back({name, week});
+      return true;
+    }
+    if (cmd == "clock") {
+      std::string date, origin;
+      int year, month, day;
+      if (started || !(in >> date >> origin) || sscanf(date.c_str(), "%d-%d-%d", &year, &month, &day) != 3) {
+        return false;
+      }
+      auto options = parseOptions(in);
+      if (options.count("zone")) systemState.timeZoneMin = std::stoi(options["zone"]);
+      clockUtc = TimeSource::fromCivil(year, month, day, 0, 0, 0) - systemState.timeZoneMin * 60;
+      clockOrigin = origin == "gsm" ? TimeSource::ORIGIN_GSM : origin == "ntp" ? TimeSource::ORIGIN_NTP :
+                    TimeSource::ORIGIN_NONE;
+      return origin == "gsm" || origin == "ntp" || origin == "none";
+    }
+    if (cmd == "key") {
+      Key key;
+      std::string kind, source;
+      if (!(in >> key.name >> kind >> source) || findKey(key.name) >= 0) return false;
+      if (kind == "came") {
+        key.pulses = cameTrace(std::stoull(source, nullptr, 16), 24);
+      } else if (kind == "trace") {
+        std::ifstream file(source);
+        int32_t pulse;
+        while (file >> pulse) key.pulses.push_back(pulse);
+      } else {
+        return false;
+      }
+      auto options = parseOptions(in);
+      key.enabled = !options.count("disabled");
+      key.registered = !options.count("unknown");
+      if (options.count("gates")) key.gates = (uint8_t)std::stoul(options["gates"], nullptr, 0);
+      if (options.count("schedule")) {
+        int id = findSchedule(options["schedule"]);
+        if (id < 0) return false;
+        key.schedule = (uint8_t)id;
+      }
+      if (!learnKey(key)) {
+        fprintf(stderr, "ключ %s: декодеры не распознали пакет\n", key.name.c_str());
+        return false;
+      }
+      maxPacketUs = std::max(maxPacketUs, key.packetUs);
+      keys.push_back(key);
+      return true;
+    }
+    if (cmd == "phone") {
+      std::string number, channel;
+      in >> number >> channel;
+      uint8_t channels = (channel == "call" ? PhoneIndex::CHANNEL_CALL : 0) |
+                         (channel == "sms" ? PhoneIndex::CHANNEL_SMS : 0) |
+                         (channel == "both" ? PhoneIndex::CHANNEL_CALL | PhoneIndex::CHANNEL_SMS : 0);
+      auto options = parseOptions(in);
+      uint8_t gateMask = options.count("gates") ? (uint8_t)std::stoul(options["gates"], nullptr, 0) : 1;
+      int schedule = options.count("schedule") ? findSchedule(options["schedule"]) : Schedule::ALWAYS;
+      if (started || number.empty() || !channels || !gateMask || schedule < 0) return false;
+      phones[number] = {channels, gateMask, (uint8_t)schedule};
+      return true;
+    }
+    if (cmd == "at") {
+      std::string when;
+      uint64_t atMs;
+      Action action;
+      if (!(in >> when) || !parseTime(when, atMs) || !parseAction(in, action)) return false;
+      actions.emplace(atMs, action);
+      return true;
+    }
+    if (cmd == "every") {
+      std::string periodText;
+      Generator g{0, 0, 0, DAY_MS, 0, Action()};
+      if (!(in >> periodText) || !parseTime(periodText, g.periodMs) || g.periodMs == 0) return false;
+      // Опции до действия: jitter=, from=, to=
+      std::string token;
+      std::streampos actionStart = in.tellg();
+      while (in >> token) {
+        size_t eq = token.find('=');
+        if (eq == std::string::npos) break;
+        uint64_t value;
+        if (!parseTime(token.substr(eq + 1), value)) return false;
+        std::string name = token.substr(0, eq);
+        if (name == "jitter") g.jitterMs = value;
+        else if (name == "from") g.fromMs = value % DAY_MS;
+        else if (name == "to") g.toMs = value % DAY_MS ? value % DAY_MS : DAY_MS;
+        else return false;
+        actionStart = in.tellg();
+      }
+      in.clear();
+      in.seekg(actionStart);
+      if (g.fromMs >= g.toMs || !parseAction(in, g.action)) return false;
+      g.nextMs = g.fromMs;
+      generators.push_back(g);
+      return true;
+    }
+    if (cmd == "run") {
+      std::string when;
+      uint64_t untilMs;
+      if (!(in >> when) || !parseTime(when, untilMs)) return false;
+      runUntil(untilMs);
+      return true;
+    }
+    if (cmd == "expect") {
+      std::string name, op;
+      double expected, actual;
+      if (!(in >> name >> op >> expected) || !metric(name, actual)) return false;
+      bool ok = op == "<=" ? actual <= expected : op == ">=" ? actual >= expected :
+                op == "==" ? actual == expected : op == "<" ? actual < expected :
+                op == ">" ? actual > expected : false;
+      char text[160];
+      snprintf(text, sizeof(text), "%s %s %g (было %g)", name.c_str(), op.c_str(), expected, actual);
+      printf("%s  %s\n", ok ? "PASS" : "FAIL", text);
+      if (!ok) failures++;
+      return true;
+    }
+    return false;
+  }
+}
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  modemConfig.uartTiming = true;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) {
+      HostSerial::verbose = true;
+    } else if (strcmp(argv[i], "--timeline") == 0 && i + 1 < argc) {
+      timeline = fopen(argv[++i], "w");
+      if (!timeline) {
+        fprintf(stderr, "не открыть %s\n", argv[i]);
+        return 2;
+      }
+      fprintf(timeline, "time_ms,gate,relay,level\n");
+    } else {
+      path = argv[i];
+    }
+  }
+  if (!path) {
+    fprintf(stderr, "usage: %s <scenario.txt> [-v] [--timeline relay.csv]\n", argv[0]);
+    return 2;
+  }
+
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "не открыть %s\n", path);
+    return 2;
+  }
+
+  printf("== %s\n", path);
+  std::string line;
+  bool reported = false;
+  int lineNo = 0;
+  while (std::getline(file, line)) {
+    lineNo++;
+    // Отчёт — перед первой проверкой
+    std::istringstream peek(line);
+    std::string cmd;
+    if (peek >> cmd && cmd == "expect" && !reported) {
+      report();
+      reported = true;
+    }
+    if (!execute(line)) {
+      fprintf(stderr, "%s:%d: не разобрать: %s\n", path, lineNo, line.c_str());
+      return 2;
+    }
+  }
+  if (!reported) report();
+  if (timeline) fclose(timeline);
+
+  printf("%s\n", failures ? "FAILED" : "OK");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Минимальная замена Arduino.h для сборки модулей прошивки на хосте (Linux):
+// String поверх std::string, виртуальные часы вместо millis()/micros(),
+// GPIO — в перехватчик симулятора, Serial — в stdout (только с HostSerial::verbose).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+template <typename T, typename L, typename H>
+inline T constrain(T value, L low, H high) { return value < low ? (T)low : value > high ? (T)high : value; }
+
+#define IRAM_ATTR
+
+class String : public std::string {
+public:
+  String() {}
+  String(const char* s) : std::string(s ? s : "") {}
+  String(const std::string& s) : std::string(s) {}
+  explicit String(int value) : std::string(std::to_string(value)) {}
+  explicit String(unsigned int value) : std::string(std::to_string(value)) {}
+  explicit String(long value) : std::string(std::to_string(value)) {}
+  explicit String(unsigned long value) : std::string(std::to_string(value)) {}
+  String(float value, unsigned char decimals) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, (double)value);
+    assign(buf);
+  }
+
+  unsigned int length() const { return (unsigned int)size(); }
+  bool concat(const char* s, unsigned int n) { append(s, n); return true; }
+  bool startsWith(const char* prefix) const { return compare(0, strlen(prefix), prefix) == 0; }
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r.append(b); return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r.append(b); return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r.append(b); return r; }
+
+// Виртуальное время симуляции: двигает только код на хосте
+namespace HostClock {
+  extern uint64_t nowUs;
+  inline void advanceMs(uint32_t ms) { nowUs += (uint64_t)ms * 1000; }
+  inline uint64_t nowMs() { return nowUs / 1000; }
+}
+
+inline unsigned long millis() { return (unsigned long)(HostClock::nowUs / 1000); }
+inline unsigned long micros() { return (unsigned long)HostClock::nowUs; }
+inline void delay(unsigned long ms) { HostClock::advanceMs(ms); }
+
+// GPIO: состояние выводов не хранится — каждую запись получает перехватчик
+// (симулятор ворот снимает по нему временную диаграмму реле)
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+
+namespace HostGpio {
+  typedef void (*WriteHook)(uint8_t pin, uint8_t level);
+  extern WriteHook onWrite;
+}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t pin, uint8_t level) {
+  if (HostGpio::onWrite) HostGpio::onWrite(pin, level);
+}
+
+// Print — для writeMetrics модулей (Scheduler, EventBus) и ChunkedWriter
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* data, size_t len) {
+    size_t n = 0;
+    while (len--) n += write(*data++);
+    return n;
+  }
+
+  size_t print(const char* s) {
+    size_t n = 0;
+    while (*s) n += write((uint8_t)*s++);
+    return n;
+  }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return print(buf);
+  }
+};
+
+class HostSerial {
+public:
+  static bool verbose;
+  void println(const String& s) { if (verbose) printf("%s\n", s.c_str()); }
+  void println(const char* s) { if (verbose) printf("%s\n", s); }
+  void print(const char* s) { if (verbose) printf("%s", s); }
+  void printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    if (!verbose) return;
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+  }
+};
+
+extern HostSerial Serial;
+
+#endif // HOST_ARDUINO_H
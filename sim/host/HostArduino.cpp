@@ -0,0 +1,48 @@
+#include <Arduino.h>
+#include <freertos/task.h>
+#include "infrastructure/Logger.h"
+#include "Metrics.h"
+
+uint64_t HostClock::nowUs = 0;
+bool HostSerial::verbose = false;
+HostSerial Serial;
+HostGpio::WriteHook HostGpio::onWrite = nullptr;
+HostRtos::SleepHook HostRtos::sleepHook = nullptr;
+bool HostRtos::notified = false;
+
+// Logger на хосте — сразу в stdout (без очереди LogQueue и WebSocket)
+WebSocketsServer* Logger::webSocketInstance = nullptr;
+
+void Logger::init(WebSocketsServer* ws) {
+  webSocketInstance = ws;
+}
+
+void Logger::log(String message, const char* type) {
+  Serial.printf("[%8lu] [%s] %s\n", millis(), type, message.c_str());
+}
+
+void Logger::info(String message) { log(message, "info"); }
+void Logger::success(String message) { log(message, "success"); }
+void Logger::warning(String message) { log(message, "warning"); }
+void Logger::error(String message) { log(message, "error"); }
+void Logger::sendLog(String message, const char* type) { log(message, type); }
+
+void Logger::logf(const char* type, const char* format, ...) {
+  char buffer[512];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  log(String(buffer), type);
+}
+
+// Счётчики Metrics — простой массив, симулятор читает их в отчёт
+namespace Metrics {
+  uint32_t hostCounters[COUNTER_COUNT] = {0};
+
+  void inc(CounterId id) {
+    if (id < COUNTER_COUNT) hostCounters[id]++;
+  }
+
+  void observe(HistogramId, uint32_t) {}
+}
@@ -0,0 +1,121 @@
+#include <SPIFFS.h>
+#include <stdlib.h>
+
+HostSpiffs SPIFFS;
+
+namespace {
+  struct Node {
+    char path[32];
+    uint8_t* data;
+    size_t size;
+    uint8_t* dirty;  // по байту на страницу: изменена после прошлого flush
+    uint32_t pageWrites;
+  };
+
+  const int MAX_FILES = 8;
+  Node nodes[MAX_FILES];
+
+  int find(const char* path) {
+    for (int i = 0; i < MAX_FILES; i++) {
+      if (nodes[i].path[0] && strcmp(nodes[i].path, path) == 0) return i;
+    }
+    return -1;
+  }
+
+  size_t pages(size_t bytes) {
+    return (bytes + HostFs::PAGE_SIZE - 1) / HostFs::PAGE_SIZE;
+  }
+
+  void clear(Node& n) {
+    free(n.data);
+    free(n.dirty);
+    n.data = nullptr;
+    n.dirty = nullptr;
+    n.size = 0;
+  }
+}
+
+namespace HostFs {
+  uint32_t pageWrites(const char* path) {
+    int i = find(path);
+    return i < 0 ? 0 : nodes[i].pageWrites;
+  }
+}
+
+size_t File::write(const uint8_t* data, size_t len) {
+  if (node < 0 || len == 0) return 0;
+  Node& n = nodes[node];
+  if (pos + len > n.size) {
+    size_t oldPages = pages(n.size);
+    n.data = (uint8_t*)realloc(n.data, pos + len);
+    if (pos > n.size) memset(n.data + n.size, 0, pos - n.size);
+    n.dirty = (uint8_t*)realloc(n.dirty, pages(pos + len));
+    memset(n.dirty + oldPages, 0, pages(pos + len) - oldPages);
+    n.size = pos + len;
+  }
+  memcpy(n.data + pos, data, len);
+  for (size_t p = pos / HostFs::PAGE_SIZE; p < pages(pos + len); p++) n.dirty[p] = 1;
+  pos += len;
+  return len;
+}
+
+size_t File::read(uint8_t* buf, size_t len) {
+  if (node < 0) return 0;
+  const Node& n = nodes[node];
+  size_t count = pos < n.size ? min(len, n.size - pos) : 0;
+  memcpy(buf, n.data + pos, count);
+  pos += count;
+  return count;
+}
+
+bool File::seek(uint32_t position) {
+  if (node < 0) return false;
+  pos = position;
+  return true;
+}
+
+size_t File::size() const {
+  return node < 0 ? 0 : nodes[node].size;
+}
+
+void File::flush() {
+  if (node < 0) return;
+  Node& n = nodes[node];
+  for (size_t p = 0; p < pages(n.size); p++) {
+    n.pageWrites += n.dirty[p];
+    n.dirty[p] = 0;
+  }
+}
+
+void File::close() {
+  flush();
+  node = -1;
+}
+
+File HostSpiffs::open(const char* path, const char* mode) {
+  File f;
+  int i = find(path);
+  if (mode[0] == 'w') {
+    if (i < 0) {
+      for (i = 0; i < MAX_FILES && nodes[i].path[0]; i++) {}
+      if (i == MAX_FILES || strlen(path) >= sizeof(nodes[i].path)) return f;
+      strcpy(nodes[i].path, path);
+    }
+    clear(nodes[i]);
+  }
+  if (i < 0) return f;
+  f.node = i;
+  return f;
+}
+
+bool HostSpiffs::exists(const char* path) {
+  return find(path) >= 0;
+}
+
+bool HostSpiffs::remove(const char* path) {
+  int i = find(path);
+  if (i < 0) return false;
+  clear(nodes[i]);
+  nodes[i] = Node();
+  return true;
+}
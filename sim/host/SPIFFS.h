@@ -0,0 +1,47 @@
+#ifndef HOST_SPIFFS_H
+#define HOST_SPIFFS_H
+
+#include <Arduino.h>
+
+// SPIFFS в памяти (RingLog, AuditLog на хосте). Данные файлов — через malloc,
+// мимо operator new: это флеш, а не куча прошивки.
+// Запись во флеш считается страницами SPIFFS (256 байт): flush() и close()
+// программируют каждую страницу файла, изменённую после прошлого flush, один раз.
+namespace HostFs {
+  static const size_t PAGE_SIZE = 256;
+
+  /**
+   * Страниц записано в файл path с начала прогона
+   */
+  uint32_t pageWrites(const char* path);
+}
+
+class File {
+public:
+  File() : node(-1), pos(0) {}
+
+  explicit operator bool() const { return node >= 0; }
+  size_t write(const uint8_t* data, size_t len);
+  size_t read(uint8_t* buf, size_t len);
+  bool seek(uint32_t position);
+  size_t size() const;
+  void flush();
+  void close();
+
+private:
+  friend class HostSpiffs;
+  int node;
+  size_t pos;
+};
+
+class HostSpiffs {
+public:
+  // "w" — пустой файл, "r"/"r+" — существующий
+  File open(const char* path, const char* mode = "r");
+  bool exists(const char* path);
+  bool remove(const char* path);
+};
+
+extern HostSpiffs SPIFFS;
+
+#endif // HOST_SPIFFS_H
@@ -0,0 +1,24 @@
+#ifndef HOST_WEB_SERVER_H
+#define HOST_WEB_SERVER_H
+
+#include <Arduino.h>
+
+// WebServer для HttpStream на хосте: ответ никуда не уходит, считаются
+// только байты тела и число чанков
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+class WebServer {
+public:
+  size_t bodyBytes = 0;
+  size_t chunks = 0;
+
+  void setContentLength(size_t) {}
+  void send(int, const char*, const std::string& body) { bodyBytes += body.size(); }
+  void sendContent(const char*, size_t len) {
+    bodyBytes += len;
+    chunks++;
+  }
+  void sendContent(const String& content) { sendContent(content.c_str(), content.size()); }
+};
+
+#endif // HOST_WEB_SERVER_H
@@ -0,0 +1,7 @@
+#ifndef HOST_WEBSOCKETS_SERVER_H
+#define HOST_WEBSOCKETS_SERVER_H
+
+// Logger.h ссылается на сервер WebSocket; на хосте его нет
+class WebSocketsServer {};
+
+#endif // HOST_WEBSOCKETS_SERVER_H
@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <Arduino.h>
+
+// Микросекунды от старта — виртуальные часы симуляции (AuditLog::now)
+inline int64_t esp_timer_get_time() { return (int64_t)HostClock::nowUs; }
+
+#endif // HOST_ESP_TIMER_H
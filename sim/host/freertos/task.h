@@ -0,0 +1,42 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include <Arduino.h>
+#include "FreeRTOS.h"
+
+// Уведомления задачи (Scheduler::sleep/wake). Сон двигает виртуальные часы:
+// по умолчанию на весь таймаут, симулятор ворот подменяет sleepHook, чтобы
+// проснуться к ближайшему внешнему событию (пакет CC1101, запрос HTTP).
+namespace HostRtos {
+  // Спать не дольше ticks; true — разбужены событием
+  typedef bool (*SleepHook)(TickType_t ticks);
+  extern SleepHook sleepHook;
+  extern bool notified;
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+  static int task;
+  return &task;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t ticks) {
+  if (HostRtos::notified) {
+    HostRtos::notified = false;
+    return 1;
+  }
+  if (HostRtos::sleepHook) return HostRtos::sleepHook(ticks) ? 1 : 0;
+  HostClock::advanceMs(ticks);
+  return 0;
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t) {
+  HostRtos::notified = true;
+  return pdTRUE;
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t* woken) {
+  HostRtos::notified = true;
+  if (woken) *woken = pdTRUE;
+}
+
+#endif // HOST_FREERTOS_TASK_H
@@ -0,0 +1,213 @@
+// Замер кучи: ответ /api/keys на N ключей — одним JsonDocument в String
+// (как было до JsonArrayStream) и потоком через JsonArrayStream.
+//
+//   build/json_stream_heap [ключей] [--max-stream-bytes N]
+//
+// Считаются все выделения за время ответа: malloc/realloc/free (ими
+// пользуется ArduinoJson) перехвачены линкером (--wrap), operator new идёт
+// через тот же malloc. Пик — максимум живых байт (malloc_usable_size, с
+// округлением аллокатора glibc — на ESP32 оно другое, сравнивать стоит
+// два способа между собой). Сам список ключей создаётся до замера и не входит.
+// С --max-stream-bytes код выхода 1, если пик потока выше порога (регрессия).
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <malloc.h>
+#include <new>
+#include <vector>
+#include "HttpStream.h"
+
+// --- Учёт кучи ---
+namespace {
+  bool tracking = false;
+  size_t live = 0;
+  size_t peak = 0;
+  size_t allocations = 0;
+
+  void noteAlloc(void* p) {
+    if (!p || !tracking) return;
+    live += malloc_usable_size(p);
+    if (live > peak) peak = live;
+    allocations++;
+  }
+
+  void noteFree(void* p) {
+    if (!p || !tracking) return;
+    size_t size = malloc_usable_size(p);
+    live = size < live ? live - size : 0;
+  }
+
+  struct Measure {
+    size_t peak;
+    size_t allocations;
+    size_t bodyBytes;
+    size_t chunks;
+  };
+}
+
+extern "C" {
+  void* __real_malloc(size_t size);
+  void* __real_realloc(void* p, size_t size);
+  void* __real_calloc(size_t n, size_t size);
+  void __real_free(void* p);
+
+  void* __wrap_malloc(size_t size) {
+    void* p = __real_malloc(size);
+    noteAlloc(p);
+    return p;
+  }
+
+  void* __wrap_calloc(size_t n, size_t size) {
+    void* p = __real_calloc(n, size);
+    noteAlloc(p);
+    return p;
+  }
+
+  void* __wrap_realloc(void* old, size_t size) {
+    noteFree(old);
+    void* p = __real_realloc(old, size);
+    noteAlloc(p);
+    return p;
+  }
+
+  void __wrap_free(void* p) {
+    noteFree(p);
+    __real_free(p);
+  }
+}
+
+// operator new из libstdc++ зовёт malloc внутри .so — мимо --wrap
+void* operator new(size_t size) {
+  void* p = malloc(size);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// --- Ключи: поля KeyEntry из main.cpp ---
+namespace {
+  struct Key {
+    uint32_t code;
+    std::string name;
+    bool enabled;
+    std::string protocol;
+    std::string bitString;
+    int bitLength;
+    float te;
+    float frequency;
+    std::string modulation;
+    std::string rawData;
+    int rssi;
+    unsigned long timestamp;
+    uint8_t gates;
+    std::string schedule;
+  };
+
+  std::vector<Key> makeKeys(size_t count) {
+    std::vector<Key> keys(count);
+    char buf[32];
+    for (size_t i = 0; i < count; i++) {
+      Key& key = keys[i];
+      key.code = 0x5A0000 + (uint32_t)i;
+      snprintf(buf, sizeof(buf), "Princeton-0x%x", key.code);
+      key.name = buf;
+      key.enabled = true;
+      key.protocol = "Princeton";
+      for (int b = 23; b >= 0; b--) key.bitString += (key.code >> b) & 1 ? '1' : '0';
+      key.bitLength = 24;
+      key.te = 350.0f;
+      key.frequency = 433.92f;
+      key.modulation = "AM650";
+      key.rawData = key.bitString;
+      key.rssi = -60;
+      key.timestamp = 1000 + i;
+      key.gates = 1;
+      key.schedule = i % 4 == 0 ? "будни" : "";
+    }
+    return keys;
+  }
+
+  // fillKeyJson() из main.cpp (все поля)
+  void fillKey(JsonObject obj, const Key& key) {
+    obj["code"] = key.code;
+    obj["name"] = key.name;
+    obj["enabled"] = key.enabled;
+    obj["protocol"] = key.protocol;
+    obj["bitString"] = key.bitString;
+    obj["bitLength"] = key.bitLength;
+    obj["te"] = key.te;
+    obj["frequency"] = key.frequency;
+    obj["modulation"] = key.modulation;
+    obj["rawData"] = key.rawData;
+    obj["rssi"] = key.rssi;
+    obj["timestamp"] = key.timestamp;
+    obj["gates"] = key.gates;
+    obj["schedule"] = key.schedule;
+  }
+
+  template <typename Respond>
+  Measure measure(Respond respond) {
+    WebServer server;
+    live = peak = allocations = 0;
+    tracking = true;
+    respond(server);
+    tracking = false;
+    return {peak, allocations, server.bodyBytes, server.chunks};
+  }
+
+  void report(const char* title, const Measure& m) {
+    printf("  %s\n    пик %zu байт, выделений %zu, тело %zu байт, чанков %zu\n",
+           title, m.peak, m.allocations, m.bodyBytes, m.chunks);
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t count = 1000;
+  size_t maxStreamBytes = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--max-stream-bytes") == 0 && i + 1 < argc) maxStreamBytes = strtoul(argv[++i], nullptr, 0);
+    else count = strtoul(argv[i], nullptr, 0);
+  }
+  if (count == 0) count = 1000;
+
+  const std::vector<Key> keys = makeKeys(count);
+
+  // До: весь массив в одном JsonDocument, затем целиком в String
+  Measure whole = measure([&keys](WebServer& server) {
+    JsonDocument doc;
+    JsonArray array = doc.to<JsonArray>();
+    for (const Key& key : keys) fillKey(array.add<JsonObject>(), key);
+    std::string response;
+    serializeJson(doc, response);
+    server.send(200, "application/json", response);
+  });
+
+  // После: запись за записью (копия ключа — как под StateLock в handleKeysAPI)
+  Measure stream = measure([&keys](WebServer& server) {
+    JsonArrayStream out(server);
+    out.begin();
+    for (size_t i = 0; i < keys.size(); i++) {
+      Key key = keys[i];
+      out.add([&key](JsonObject obj) { fillKey(obj, key); });
+    }
+    out.end();
+  });
+
+  printf("/api/keys, %zu ключей:\n", count);
+  report("до — JsonDocument + String:", whole);
+  report("после — JsonArrayStream:", stream);
+
+  if (whole.bodyBytes != stream.bodyBytes) {
+    printf("FAIL: тела разной длины (%zu и %zu)\n", whole.bodyBytes, stream.bodyBytes);
+    return 1;
+  }
+  if (maxStreamBytes > 0 && stream.peak > maxStreamBytes) {
+    printf("FAIL: пик потока %zu байт > порога %zu\n", stream.peak, maxStreamBytes);
+    return 1;
+  }
+  return 0;
+}
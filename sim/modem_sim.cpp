@@ -0,0 +1,240 @@
+// Прогон сценария SIM800L против настоящего GSMManager на виртуальных часах.
+//
+//   build/modem_sim scenarios/call_dedup.txt [-v]
+//
+// Формат сценария — по команде на строку, '#' — комментарий:
+//   modem baud=<бод> boot=<мс> delay=<мс> seed=<n>   параметры модема (до первого at/run)
+//   trust <номер> call|sms|both                      белый список
+//   at <мс> call <номер> [rings=N] [period=мс] [noclip]
+//   at <мс> sms <номер> <текст...>
+//   at <мс> noise <байт>
+//   at <мс> line <строка...>                         произвольный URC
+//   fail <команда> [раз]                             ответ ERROR
+//   drop <команда> [раз]                             без ответа
+//   run <мс>                                         крутить handleGSM() до этого времени
+//   expect ready by <мс>
+//   expect open <номер> count=<n>
+//   expect hangups <n>
+//   expect sent <команда> count=<n>                 сколько раз модем получил команду
+//
+// Код выхода: 0 — все expect выполнены, 1 — нет, 2 — ошибка сценария.
+
+#include <Arduino.h>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <vector>
+#include "GSMManager.h"
+#include "ModemSim.h"
+
+namespace {
+  struct Opening {
+    uint64_t atMs;
+    std::string source;
+  };
+
+  std::unique_ptr<ModemSim> modem;
+  ModemSim::Config modemConfig;
+  std::set<std::string> trustedCalls;
+  std::set<std::string> trustedSms;
+  std::vector<Opening> openings;
+  uint64_t readyAt = 0;
+  int failures = 0;
+
+  std::map<std::string, std::string> parseOptions(std::istringstream& in) {
+    std::map<std::string, std::string> options;
+    std::string token;
+    while (in >> token) {
+      size_t eq = token.find('=');
+      if (eq == std::string::npos) options[token] = "";
+      else options[token.substr(0, eq)] = token.substr(eq + 1);
+    }
+    return options;
+  }
+
+  std::string restOfLine(std::istringstream& in) {
+    std::string rest;
+    std::getline(in >> std::ws, rest);
+    return rest;
+  }
+
+  void ensureStarted() {
+    if (modem) return;
+    modem.reset(new ModemSim(modemConfig));
+    GSMManager::init(
+      modem.get(),
+      [](const String& number, bool isCall) {
+        return (uint8_t)((isCall ? trustedCalls : trustedSms).count(number) > 0);
+      },
+      [](const String& source, uint8_t) {
+        openings.push_back({HostClock::nowMs(), source});
+        printf("[%8llu] OPEN  %s\n", (unsigned long long)HostClock::nowMs(), source.c_str());
+      });
+  }
+
+  void runUntil(uint64_t untilMs) {
+    ensureStarted();
+    while (HostClock::nowMs() < untilMs) {
+      GSMManager::handleGSM();
+      if (!readyAt && GSMManager::isReady()) {
+        readyAt = HostClock::nowMs();
+        printf("[%8llu] READY\n", (unsigned long long)readyAt);
+      }
+      HostClock::advanceMs(1);
+    }
+  }
+
+  void check(bool ok, const std::string& what) {
+    printf("%s  %s\n", ok ? "PASS" : "FAIL", what.c_str());
+    if (!ok) failures++;
+  }
+
+  bool execute(const std::string& line) {
+    std::istringstream in(line);
+    std::string cmd;
+    if (!(in >> cmd) || cmd[0] == '#') return true;
+
+    if (cmd == "modem") {
+      if (modem) return false;  // параметры — только до старта
+      auto options = parseOptions(in);
+      if (options.count("baud")) modemConfig.baud = std::stoul(options["baud"]);
+      if (options.count("boot")) modemConfig.bootMs = std::stoul(options["boot"]);
+      if (options.count("delay")) modemConfig.replyDelayMs = std::stoul(options["delay"]);
+      if (options.count("seed")) modemConfig.seed = std::stoul(options["seed"]);
+      return true;
+    }
+    if (cmd == "trust") {
+      std::string number, channel;
+      in >> number >> channel;
+      if (channel == "call" || channel == "both") trustedCalls.insert(number);
+      if (channel == "sms" || channel == "both") trustedSms.insert(number);
+      return !number.empty();
+    }
+    if (cmd == "fail" || cmd == "drop") {
+      ensureStarted();
+      std::string command;
+      int times = 1;
+      in >> command >> times;
+      if (cmd == "fail") modem->failCommand(command, times);
+      else modem->dropCommand(command, times);
+      return !command.empty();
+    }
+    if (cmd == "at") {
+      ensureStarted();
+      uint64_t atMs;
+      std::string what;
+      if (!(in >> atMs >> what)) return false;
+      if (what == "call") {
+        std::string number;
+        in >> number;
+        auto options = parseOptions(in);
+        int rings = options.count("rings") ? std::stoi(options["rings"]) : 5;
+        uint32_t period = options.count("period") ? std::stoul(options["period"]) : 4000;
+        modem->call(atMs, number, rings, period, !options.count("noclip"));
+      } else if (what == "sms") {
+        std::string number;
+        in >> number;
+        modem->sms(atMs, number, restOfLine(in));
+      } else if (what == "noise") {
+        size_t bytes = 0;
+        in >> bytes;
+        modem->noise(atMs, bytes);
+      } else if (what == "line") {
+        modem->emitLine(atMs, restOfLine(in));
+      } else {
+        return false;
+      }
+      return true;
+    }
+    if (cmd == "run") {
+      uint64_t untilMs;
+      if (!(in >> untilMs)) return false;
+      runUntil(untilMs);
+      return true;
+    }
+    if (cmd == "expect") {
+      std::string what;
+      in >> what;
+      if (what == "ready") {
+        std::string by;
+        uint64_t limitMs;
+        if (!(in >> by >> limitMs)) return false;
+        check(readyAt && readyAt <= limitMs,
+              "ready by " + std::to_string(limitMs) + " (было " +
+              (readyAt ? std::to_string(readyAt) : std::string("нет")) + ")");
+      } else if (what == "open") {
+        std::string number;
+        in >> number;
+        auto options = parseOptions(in);
+        int expected = options.count("count") ? std::stoi(options["count"]) : 1;
+        int actual = 0;
+        for (const Opening& o : openings) {
+          if (o.source.size() >= number.size() &&
+              o.source.compare(o.source.size() - number.size(), number.size(), number) == 0) {
+            actual++;
+          }
+        }
+        check(actual == expected, "open " + number + " count=" + std::to_string(expected) +
+              " (было " + std::to_string(actual) + ")");
+      } else if (what == "sent") {
+        std::string command;
+        in >> command;
+        auto options = parseOptions(in);
+        int expected = options.count("count") ? std::stoi(options["count"]) : 1;
+        int actual = 0;
+        if (modem) {
+          for (const std::string& c : modem->commands()) actual += c == command;
+        }
+        check(actual == expected, "sent " + command + " count=" + std::to_string(expected) +
+              " (было " + std::to_string(actual) + ")");
+      } else if (what == "hangups") {
+        int expected;
+        if (!(in >> expected)) return false;
+        int actual = modem ? modem->hangups() : 0;
+        check(actual == expected, "hangups " + std::to_string(expected) +
+              " (было " + std::to_string(actual) + ")");
+      } else {
+        return false;
+      }
+      return true;
+    }
+    return false;
+  }
+}
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) HostSerial::verbose = true;
+    else path = argv[i];
+  }
+  if (!path) {
+    fprintf(stderr, "usage: %s <scenario.txt> [-v]\n", argv[0]);
+    return 2;
+  }
+
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "не открыть %s\n", path);
+    return 2;
+  }
+
+  printf("== %s\n", path);
+  std::string line;
+  int lineNo = 0;
+  while (std::getline(file, line)) {
+    lineNo++;
+    if (!execute(line)) {
+      fprintf(stderr, "%s:%d: не разобрать: %s\n", path, lineNo, line.c_str());
+      return 2;
+    }
+  }
+
+  if (modem) {
+    printf("команд модему: %zu, ATH: %d\n", modem->commands().size(), modem->hangups());
+  }
+  printf("%s\n", failures ? "FAILED" : "OK");
+  return failures ? 1 : 0;
+}
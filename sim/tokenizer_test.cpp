@@ -0,0 +1,204 @@
+// Проверка At::Tokenizer на записанных потоках байт.
+//
+//   build/tokenizer_test [прогонов] [-v]
+//
+// Каждый случай — поток байт и ожидаемые строки (тип, поля или текст).
+// Поток подаётся кусками случайной длины (как handleGSM читает то, что успело
+// прийти в UART), разбиение меняется от прогона к прогону (xorshift32, seed —
+// номер прогона), результат обязан совпадать. Плюс все случаи подряд одним
+// потоком — строка одного случая не должна влиять на следующую.
+// Код выхода 1 — есть расхождения.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "AtTokenizer.h"
+
+using namespace At;
+
+namespace {
+  struct Line {
+    Kind kind;
+    std::string text;                 // проверяется только для KIND_OTHER
+    std::vector<std::string> fields;  // для типов с полями
+  };
+
+  struct Case {
+    const char* name;
+    std::string input;
+    std::vector<Line> expected;
+  };
+
+  const char* kindName(Kind kind) {
+    static const char* names[] = {"OTHER", "OK", "ERROR", "RING", "CLIP", "CMT", "CME_ERROR",
+                                  "CMS_ERROR", "CSQ", "CREG", "CCLK", "JUNK"};
+    return kind <= KIND_JUNK ? names[kind] : "?";
+  }
+
+  std::string toString(const View& view) {
+    return std::string(view.data, view.len);
+  }
+
+  uint32_t rngState = 1;
+  uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+  }
+
+  // Поток — кусками по 1..maxChunk байт; строки снимаются сразу после feed() == true
+  std::vector<Line> run(const std::string& input, size_t maxChunk) {
+    Tokenizer tokenizer;
+    std::vector<Line> out;
+    size_t pos = 0;
+    while (pos < input.size()) {
+      size_t chunk = 1 + nextRandom() % maxChunk;
+      for (size_t end = pos + chunk; pos < end && pos < input.size(); pos++) {
+        if (!tokenizer.feed(input[pos])) continue;
+        Line line;
+        line.kind = tokenizer.kind();
+        if (line.kind == KIND_OTHER) line.text = toString(tokenizer.line());
+        for (int i = 0; i < tokenizer.fieldCount(); i++) line.fields.push_back(toString(tokenizer.field(i)));
+        out.push_back(line);
+      }
+    }
+    return out;
+  }
+
+  std::string describe(const std::vector<Line>& lines) {
+    std::string s;
+    for (const Line& line : lines) {
+      s += "  ";
+      s += kindName(line.kind);
+      if (line.kind == KIND_OTHER) s += " \"" + line.text + "\"";
+      for (const std::string& field : line.fields) s += " [" + field + "]";
+      s += "\n";
+    }
+    return s;
+  }
+
+  bool same(const std::vector<Line>& a, const std::vector<Line>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+      if (a[i].kind != b[i].kind || a[i].text != b[i].text || a[i].fields != b[i].fields) return false;
+    }
+    return true;
+  }
+
+  std::vector<Case> makeCases() {
+    std::vector<Case> cases;
+    cases.push_back({"ответы и пустые строки",
+                     "\r\n\r\nOK\r\n\r\nERROR\r\nRING\r\n",
+                     {{KIND_OK, "", {}}, {KIND_ERROR, "", {}}, {KIND_RING, "", {}}}});
+    cases.push_back({"OK/ERROR — только целая строка",
+                     "OKAY\r\nERRORS\r\nAT+CSQ\r\n",
+                     {{KIND_OTHER, "OKAY", {}}, {KIND_OTHER, "ERRORS", {}}, {KIND_OTHER, "AT+CSQ", {}}}});
+    cases.push_back({"+CLIP: номер и тип",
+                     "RING\r\n\r\n+CLIP: \"+79991234567\",145,\"\",0,\"\",0\r\n",
+                     {{KIND_RING, "", {}},
+                      {KIND_CLIP, "", {"+79991234567", "145", "", "0", "", "0"}}}});
+    cases.push_back({"+CMT: запятая в кавычках и текст SMS на кириллице",
+                     "+CMT: \"+79991234567\",\"\",\"24/07/05,12:00:00+12\"\r\n"
+                     "Открой ворота, пожалуйста\r\n",
+                     {{KIND_CMT, "", {"+79991234567", "", "24/07/05,12:00:00+12"}},
+                      {KIND_OTHER, "Открой ворота, пожалуйста", {}}}});
+    cases.push_back({"UTF-8: четырёхбайтные последовательности — печатаемые",
+                     "Ворота \xF0\x9F\x9A\xAA открыть \xF0\x9F\x94\x91\r\n",
+                     {{KIND_OTHER, "Ворота \xF0\x9F\x9A\xAA открыть \xF0\x9F\x94\x91", {}}}});
+    cases.push_back({"ошибки и ответы с числами",
+                     "+CME ERROR: 10\r\n+CMS ERROR: 500\r\n+CSQ: 18,0\r\n+CREG: 0,5\r\n"
+                     "+CCLK: \"24/07/05,12:00:00+12\"\r\n",
+                     {{KIND_CME_ERROR, "", {"10"}},
+                      {KIND_CMS_ERROR, "", {"500"}},
+                      {KIND_CSQ, "", {"18", "0"}},
+                      {KIND_CREG, "", {"0", "5"}},
+                      {KIND_CCLK, "", {"24/07/05,12:00:00+12"}}}});
+    cases.push_back({"пробелы вокруг полей и в конце строки",
+                     "  +CSQ:  18 , 0  \r\nOK   \r\n",
+                     {{KIND_CSQ, "", {"18", "0"}}, {KIND_OK, "", {}}}});
+
+    // Мусор при подборе скорости: байты со старшим битом и управляющие,
+    // в том числе \0 и обрывки UTF-8; следующая строка разбирается как обычно
+    std::string junk("\xFF\xFE\x80\x00\x13\xF0\x81\xC3\x1B\x92\x88\xE0\x80", 13);
+    cases.push_back({"мусор перед OK",
+                     junk + "\r\nOK\r\n",
+                     {{KIND_JUNK, "", {}}, {KIND_OK, "", {}}}});
+    std::string noise;
+    for (int i = 0; i < 40; i++) noise += (char)(0x80 | (i * 37 % 128));
+    cases.push_back({"шум без перевода строки склеивается с +CLIP",
+                     noise + "+CLIP: \"+79991234567\",145\r\nRING\r\n",
+                     {{KIND_JUNK, "", {}}, {KIND_RING, "", {}}}});
+
+    // Строка ровно в буфер — целая; на байт длиннее — KIND_JUNK до перевода строки
+    std::string full(Tokenizer::MAX_LINE, 'A');
+    cases.push_back({"строка ровно MAX_LINE", full + "\r\nOK\r\n",
+                     {{KIND_OTHER, full, {}}, {KIND_OK, "", {}}}});
+    cases.push_back({"переполнение строки", full + "B\r\nOK\r\n",
+                     {{KIND_JUNK, "", {}}, {KIND_OK, "", {}}}});
+    std::string longSms = "+CMT: \"+79991234567\",\"\",\"24/07/05,12:00:00+12\"\r\n";
+    for (int i = 0; i < 150; i++) longSms += "Ж";  // 300 байт
+    longSms += "\r\nRING\r\n";
+    cases.push_back({"длинный текст SMS на кириллице — переполнение",
+                     longSms,
+                     {{KIND_CMT, "", {"+79991234567", "", "24/07/05,12:00:00+12"}},
+                      {KIND_JUNK, "", {}},
+                      {KIND_RING, "", {}}}});
+    return cases;
+  }
+}
+
+int main(int argc, char** argv) {
+  int runs = 200;
+  bool verbose = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) verbose = true;
+    else runs = atoi(argv[i]);
+  }
+  if (runs <= 0) runs = 200;
+
+  std::vector<Case> cases = makeCases();
+  Case all = {"все случаи одним потоком", "", {}};
+  for (const Case& c : cases) {
+    all.input += c.input;
+    all.expected.insert(all.expected.end(), c.expected.begin(), c.expected.end());
+  }
+  cases.push_back(all);
+
+  int failures = 0;
+  for (const Case& c : cases) {
+    bool ok = true;
+    for (int r = 0; r < runs && ok; r++) {
+      rngState = (uint32_t)r * 2654435761u + 1;
+      // Первый прогон — куски до длины всего потока, дальше до 1..64 байт
+      size_t maxChunk = r == 0 ? c.input.size() : 1 + r % 64;
+      std::vector<Line> got = run(c.input, maxChunk);
+      if (!same(got, c.expected)) {
+        ok = false;
+        printf("FAIL  %s (прогон %d, куски до %zu байт)\nожидалось:\n%sполучено:\n%s", c.name, r,
+               maxChunk, describe(c.expected).c_str(), describe(got).c_str());
+      }
+    }
+    if (ok) printf("PASS  %s\n", c.name);
+    if (ok && verbose) printf("%s", describe(c.expected).c_str());
+    if (!ok) failures++;
+  }
+
+  // Смена скорости UART посреди строки: reset() отбрасывает недособранное
+  {
+    Tokenizer tokenizer;
+    const char* head = "+CLIP: \"+7999";
+    for (const char* p = head; *p; p++) tokenizer.feed(*p);
+    tokenizer.reset();
+    bool done = false;
+    for (const char* p = "OK\r\n"; *p; p++) done = tokenizer.feed(*p);
+    bool ok = done && tokenizer.kind() == KIND_OK && tokenizer.fieldCount() == 0;
+    printf("%s  reset() посреди строки\n", ok ? "PASS" : "FAIL");
+    if (!ok) failures++;
+  }
+
+  printf("%s\n", failures ? "FAILED" : "OK");
+  return failures ? 1 : 0;
+}
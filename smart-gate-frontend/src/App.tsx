@@ -71,6 +71,8 @@ export interface AppContextValue {
   apiCall: (endpoint: string, method?: string, data?: any) => Promise<any>;
   addLog: (message: string, type?: LogEntry['type']) => void;
   subscribe: (event: string, handler: WsEventHandler) => () => void;
+  // Отправка команды прошивке по WebSocket (подписка на бинарные каналы и т.п.)
+  sendWs: (msg: any) => void;
   connected: boolean;
   gateStatus: 'closed' | 'opening' | 'open' | 'closing' | 'stopped';
   gateTimings: GateTimings;
@@ -88,6 +90,7 @@ export const AppContext = createContext<AppContextValue>({
   apiCall: async () => ({}),
   addLog: () => {},
   subscribe: () => () => {},
+  sendWs: () => {},
   connected: false,
   gateStatus: 'closed',
   gateTimings: { openDuration: 3, stayOpen: 15, closeDuration: 3 },
@@ -112,6 +115,22 @@ const WS_URL = window.location.hostname === 'localhost'
 
 let logIdCounter = 0;
 
+// Кэш GET-ответов по ETag: повторный запрос уходит с If-None-Match,
+// на 304 прошивка не собирает JSON, а мы отдаём сохранённые данные.
+const etagCache = new Map<string, { etag: string; data: any }>();
+
+// Последние значения событий-состояний (wifi_status, gate_status). Прошивка
+// шлёт полный снимок ("delta": false) и дальше только изменившиеся поля
+// ("delta": true, удалённое поле — null); обработчики видят полный объект.
+const wsStateCache = new Map<string, any>();
+
+const applyStateFrame = (event: string, data: any, delta: boolean) => {
+  const merged = delta ? { ...(wsStateCache.get(event) || {}), ...data } : { ...data };
+  Object.keys(merged).forEach(k => { if (merged[k] === null) delete merged[k]; });
+  wsStateCache.set(event, merged);
+  return merged;
+};
+
 // --- Helpers ---
 function formatUptime(seconds: number): string {
   const d = Math.floor(seconds / 86400);
@@ -225,11 +244,15 @@ function App() {
 
   // --- API ---
   const apiCall = useCallback(async (endpoint: string, method = 'GET', data: any = null) => {
+    const cached = method === 'GET' ? etagCache.get(endpoint) : undefined;
+    const headers: Record<string, string> = { 'Content-Type': 'application/json' };
+    if (cached) headers['If-None-Match'] = cached.etag;
     const response = await fetch(`${BASE_URL}${endpoint}`, {
       method,
-      headers: { 'Content-Type': 'application/json' },
+      headers,
       body: data ? JSON.stringify(data) : null,
     });
+    if (response.status === 304 && cached) return cached.data;
     // Проверяем HTTP-статус: 4xx/5xx — это ошибка, а не «тихий успех».
     if (!response.ok) {
       let detail = '';
@@ -239,7 +262,10 @@ function App() {
       } catch {}
       throw new Error(detail || `HTTP ${response.status} ${response.statusText}`);
     }
-    return response.json();
+    const json = await response.json();
+    const etag = response.headers.get('ETag');
+    if (method === 'GET' && etag) etagCache.set(endpoint, { etag, data: json });
+    return json;
   }, []);
 
   // --- Counters (производные от реального состояния, а не от несуществующих WS-событий) ---
@@ -270,6 +296,11 @@ function App() {
     subscribersRef.current.get(event)?.forEach(handler => handler(data));
   }, []);
 
+  const sendWs = useCallback((msg: any) => {
+    const ws = wsRef.current;
+    if (ws && ws.readyState === WebSocket.OPEN) ws.send(JSON.stringify(msg));
+  }, []);
+
   // --- WebSocket ---
   useEffect(() => {
     let reconnectTimer: NodeJS.Timeout | null = null;
@@ -278,9 +309,12 @@ function App() {
     const connect = () => {
       if (!alive) return;
       const ws = new WebSocket(WS_URL);
+      ws.binaryType = 'arraybuffer';
       wsRef.current = ws;
 
       ws.onopen = () => {
+        // Темы, нужные оболочке на любой странице; signal включает KeyPage сама
+        ws.send(JSON.stringify({ cmd: 'topics', topics: ['log', 'gate', 'wifi', 'keys', 'data'] }));
         setConnected(true);
         addLog('Подключено к устройству', 'success');
         // Синхронизация фазы ворот при подключении/реконнекте
@@ -288,6 +322,7 @@ function App() {
       };
 
       ws.onclose = () => {
+        wsStateCache.clear(); // после реконнекта прошивка пришлёт свежие снимки
         setConnected(false);
         wsRef.current = null;
         if (alive) reconnectTimer = setTimeout(connect, 3000);
@@ -296,9 +331,17 @@ function App() {
       ws.onerror = () => {};
 
       ws.onmessage = (ev) => {
+        // Бинарные кадры — канал визуализатора (RSSI/импульсы), разбирает KeyPage
+        if (ev.data instanceof ArrayBuffer) {
+          emit('signal', ev.data);
+          return;
+        }
         try {
           const msg = JSON.parse(ev.data);
-          const { event, data } = msg;
+          const { event } = msg;
+          const data = typeof msg.delta === 'boolean'
+            ? applyStateFrame(event, msg.data, msg.delta)
+            : msg.data;
 
           switch (event) {
             case 'log':
@@ -321,6 +364,11 @@ function App() {
               showNotification(`Ключ сохранён: ${data.name || data.protocol}`, 'success');
               addLog(`Ключ сохранён: ${data.name} [${data.protocol}]`, 'success');
               break;
+            case 'generation':
+              // Коллекция изменилась (в т.ч. с другого устройства) — обновляем счётчики
+              if (data.collection === 'keys') refreshKeyCount();
+              if (data.collection === 'phones') refreshPhoneCount();
+              break;
             case 'key_received':
               addLog(`Сигнал: ${data.protocol || 'RAW'}, ${data.bitLength} бит, RSSI ${data.rssi}`, 'info');
               break;
@@ -391,7 +439,7 @@ function App() {
 
   // --- Context ---
   const ctx: AppContextValue = {
-    apiCall, addLog, subscribe, connected, gateStatus, gateTimings, setGateTimings, systemInfo,
+    apiCall, addLog, subscribe, sendWs, connected, gateStatus, gateTimings, setGateTimings, systemInfo,
     wifiInfo, wifiStatus, refreshKeyCount, refreshPhoneCount,
   };
 
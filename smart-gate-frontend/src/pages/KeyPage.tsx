@@ -56,6 +56,92 @@ const ProtoBadge: React.FC<{ protocol: string }> = ({ protocol }) => {
   );
 };
 
+// --- Бинарный канал signal (формат — SignalStream.h в прошивке) ---
+const FRAME_RSSI = 0x01;
+const FRAME_PULSES = 0x02;
+
+interface PulseTrain {
+  rssi: number;
+  truncated: boolean;
+  levels: boolean[];
+  durations: number[]; // мкс
+}
+
+type SignalFrame =
+  | { type: 'rssi'; samples: number[] }
+  | { type: 'pulses'; train: PulseTrain };
+
+const parseSignalFrame = (buf: ArrayBuffer): SignalFrame | null => {
+  if (buf.byteLength < 8) return null;
+  const v = new DataView(buf);
+  const type = v.getUint8(0);
+  if (type === FRAME_RSSI) {
+    const n = v.getUint8(1);
+    const samples: number[] = [];
+    for (let i = 0; i < n && 8 + i < buf.byteLength; i++) samples.push(v.getInt8(8 + i));
+    return { type: 'rssi', samples };
+  }
+  if (type === FRAME_PULSES) {
+    const n = v.getUint16(2, true);
+    const levels: boolean[] = [];
+    const durations: number[] = [];
+    for (let i = 0; i < n && 8 + i * 2 + 1 < buf.byteLength; i++) {
+      const p = v.getUint16(8 + i * 2, true);
+      levels.push((p & 0x8000) !== 0);
+      durations.push(p & 0x7fff);
+    }
+    return {
+      type: 'pulses',
+      train: { rssi: v.getInt8(4), truncated: (v.getUint8(1) & 1) !== 0, levels, durations },
+    };
+  }
+  return null;
+};
+
+// --- Осциллограмма последнего принятого пакета ---
+const PulseWaveform: React.FC<{ train: PulseTrain }> = ({ train }) => {
+  const canvasRef = useRef<HTMLCanvasElement>(null);
+
+  useEffect(() => {
+    const canvas = canvasRef.current;
+    const ctx = canvas?.getContext('2d');
+    if (!canvas || !ctx) return;
+    const W = canvas.width;
+    const H = canvas.height;
+    ctx.clearRect(0, 0, W, H);
+
+    const total = train.durations.reduce((a, b) => a + b, 0) || 1;
+    const hi = 8;
+    const lo = H - 14;
+    ctx.strokeStyle = '#60a5fa';
+    ctx.lineWidth = 1;
+    ctx.beginPath();
+    let t = 0;
+    train.durations.forEach((d, i) => {
+      const y = train.levels[i] ? hi : lo;
+      const x0 = (t / total) * W;
+      t += d;
+      const x1 = (t / total) * W;
+      if (i === 0) ctx.moveTo(x0, y); else ctx.lineTo(x0, y);
+      ctx.lineTo(x1, y);
+    });
+    ctx.stroke();
+
+    ctx.fillStyle = '#6f7690';
+    ctx.font = '10px monospace';
+    ctx.fillText(
+      `${train.durations.length}${train.truncated ? '+' : ''} имп · ${(total / 1000).toFixed(1)} мс · ${train.rssi} dBm`,
+      4, H - 2,
+    );
+  }, [train]);
+
+  return (
+    <div className="spectro">
+      <canvas ref={canvasRef} width={320} height={60} />
+    </div>
+  );
+};
+
 // --- Real RSSI spectrogram (scrolling waterfall like SDR) ---
 const RSSI_HISTORY_LEN = 160;
 
@@ -208,7 +294,7 @@ const SignalSpectrogram: React.FC<{
 
 // --- Main component ---
 const KeyPage: React.FC = () => {
-  const { apiCall, addLog, subscribe, refreshKeyCount } = useApp();
+  const { apiCall, addLog, subscribe, sendWs, connected, refreshKeyCount } = useApp();
   const [keys, setKeys] = useState<Key[]>([]);
   const [loading, setLoading] = useState(true);
   const [learning, setLearning] = useState(false);
@@ -217,6 +303,7 @@ const KeyPage: React.FC = () => {
   const [editName, setEditName] = useState('');
   const [signals, setSignals] = useState<SignalEvent[]>([]);
   const [rssiHistory, setRssiHistory] = useState<number[]>([]);
+  const [pulseTrain, setPulseTrain] = useState<PulseTrain | null>(null);
   const [frequency, setFrequency] = useState(433.92);
   const [freqInput, setFreqInput] = useState('');
   const [changingFreq, setChangingFreq] = useState(false);
@@ -271,16 +358,27 @@ const KeyPage: React.FC = () => {
           timestamp: Date.now(),
         }].slice(-20));
       }),
-      subscribe('rssi', (data: any) => {
-        // Real-time RSSI from CC1101 (streamed every 200ms in learning mode)
-        if (typeof data.rssi === 'number') {
-          setRssiHistory(prev => [...prev.slice(-(RSSI_HISTORY_LEN - 1)), data.rssi]);
+      subscribe('signal', (data: ArrayBuffer) => {
+        // Бинарные кадры: пачка RSSI раз в 200 мс (50 Гц) и сырые импульсы пакетов
+        const frame = parseSignalFrame(data);
+        if (frame?.type === 'rssi') {
+          const samples = frame.samples;
+          setRssiHistory(prev => [...prev, ...samples].slice(-RSSI_HISTORY_LEN));
+        } else if (frame?.type === 'pulses') {
+          setPulseTrain(frame.train);
         }
       }),
     ];
     return () => unsubs.forEach(fn => fn());
   }, [subscribe, loadKeys]);
 
+  // Канал signal включается явно и только на время обучения (и заново после реконнекта)
+  useEffect(() => {
+    if (!learning || !connected) return;
+    sendWs({ cmd: 'subscribe', topic: 'signal' });
+    return () => sendWs({ cmd: 'unsubscribe', topic: 'signal' });
+  }, [learning, connected, sendWs]);
+
   // Cleanup old signals
   useEffect(() => {
     const interval = setInterval(() => {
@@ -313,6 +411,7 @@ const KeyPage: React.FC = () => {
       setLearning(true);
       setSignals([]);
       setRssiHistory([]);
+      setPulseTrain(null);
       addLog('Режим обучения активирован', 'info');
     } catch {
       addLog('Ошибка активации обучения', 'error');
@@ -433,6 +532,7 @@ const KeyPage: React.FC = () => {
         <>
           {/* Real-time RSSI spectrogram */}
           <SignalSpectrogram rssiHistory={rssiHistory} signals={signals} frequency={frequency} />
+          {pulseTrain && <PulseWaveform train={pulseTrain} />}
 
           <div className="learning-bar">
             <div className="learning-dot" />
@@ -11,7 +11,7 @@ interface WiFiNetwork {
 }
 
 const WiFiPage: React.FC = () => {
-  const { apiCall, addLog, wifiInfo, wifiStatus } = useApp();
+  const { apiCall, addLog, subscribe, wifiInfo, wifiStatus } = useApp();
   const [networks, setNetworks] = useState<WiFiNetwork[]>([]);
   const [scanning, setScanning] = useState(false);
   const [connecting, setConnecting] = useState(false);
@@ -19,22 +19,39 @@ const WiFiPage: React.FC = () => {
   const [password, setPassword] = useState('');
   const [showPass, setShowPass] = useState(false);
 
+  // Прошивка сканирует асинхронно: ответ — последний известный список,
+  // свежий результат приходит событием wifi_scan.
   const scan = async () => {
     setScanning(true);
     try {
       const result = await apiCall('/api/wifi/scan');
-      if (Array.isArray(result)) {
-        setNetworks(result.sort((a, b) => b.rssi - a.rssi));
-        addLog(`Найдено сетей: ${result.length}`, 'success');
+      if (Array.isArray(result) && result.length > 0) {
+        setNetworks([...result].sort((a, b) => b.rssi - a.rssi));
+        setScanning(false);
       }
     } catch {
       addLog('Ошибка сканирования', 'error');
-    } finally {
       setScanning(false);
     }
   };
 
-  useEffect(() => { scan(); }, []);
+  useEffect(() => {
+    const unsubscribe = subscribe('wifi_scan', (data: any) => {
+      if (Array.isArray(data?.networks)) {
+        setNetworks([...data.networks].sort((a, b) => b.rssi - a.rssi));
+      }
+      setScanning(false);
+    });
+    scan();
+    return unsubscribe;
+  }, []);
+
+  // Событие могло потеряться (реконнект WS) — не крутим индикатор вечно
+  useEffect(() => {
+    if (!scanning) return;
+    const timer = setTimeout(() => setScanning(false), 20000);
+    return () => clearTimeout(timer);
+  }, [scanning]);
 
   // Единая точка подключения: блокирует параллельные запросы (иначе они срывают друг друга)
   // и одинаково отражает результат для открытых и защищённых сетей.
@@ -0,0 +1,140 @@
+#include "AccessDecision.h"
+#include "AuditLog.h"
+#include "Metrics.h"
+#include "PhoneIndex.h"
+#include "Schedule.h"
+#include "TimeSource.h"
+#include <string.h>
+
+namespace AccessDecision {
+  static const float FREQUENCY_TOLERANCE_MHZ = 1.0f;
+  static const float TE_TOLERANCE = 1.4f;            // ±40%
+  static const float LONG_KEY_SIMILARITY = 0.95f;
+  static const size_t MIN_CONTAINED_BITS = 12;
+
+  bool bitStringsSimilar(const char* a, const char* b, float minSimilarity) {
+    size_t lenA = strlen(a);
+    size_t lenB = strlen(b);
+    if (lenA == 0 || lenB == 0) return false;
+
+    // Сравниваем по минимальной длине, доля — от максимальной
+    size_t minLen = min(lenA, lenB);
+    size_t maxLen = max(lenA, lenB);
+    size_t matches = 0;
+    for (size_t i = 0; i < minLen; i++) {
+      if (a[i] == b[i]) matches++;
+    }
+    return (float)matches / maxLen >= minSimilarity;
+  }
+
+  static bool teClose(float saved, float received) {
+    if (saved <= 0 || received <= 0) return true;
+    float ratio = saved > received ? saved / received : received / saved;
+    return ratio <= TE_TOLERANCE;
+  }
+
+  // Один и тот же пульт может декодироваться как разные протоколы
+  // (CAME 24-bit vs X10 20-bit и т.д.) из-за нестабильности декодера:
+  // приоритет — bitString/код, протокол вторичен
+  bool keyMatches(const Signature& saved, const Signature& received) {
+    // 1. Частота должна совпадать
+    float freqDiff = saved.frequency > received.frequency ? saved.frequency - received.frequency
+                                                          : received.frequency - saved.frequency;
+    if (freqDiff > FREQUENCY_TOLERANCE_MHZ) return false;
+
+    size_t savedBits = strlen(saved.bitString);
+    size_t receivedBits = strlen(received.bitString);
+
+    // 2. Точное совпадение: протокол + bitString
+    if (strcmp(saved.protocol, received.protocol) == 0 && savedBits > 0 && receivedBits > 0) {
+      if (saved.bitLength <= 32) {
+        if (strcmp(saved.bitString, received.bitString) == 0) return true;
+      } else if (bitStringsSimilar(saved.bitString, received.bitString, LONG_KEY_SIMILARITY)) {
+        return true;
+      }
+    }
+
+    // 3. Совпадение по коду (протокол может быть другим)
+    if (saved.code != 0 && saved.code == received.code) {
+      return teClose(saved.te, received.te);
+    }
+
+    // 4. Одна bitString — начало или конец другой: тот же пульт, декодировано
+    // разное число бит (CAME 24 vs X10 20 — первые 20 бит одинаковые)
+    if (savedBits >= MIN_CONTAINED_BITS && receivedBits >= MIN_CONTAINED_BITS) {
+      const char* shorter = savedBits <= receivedBits ? saved.bitString : received.bitString;
+      const char* longer = savedBits <= receivedBits ? received.bitString : saved.bitString;
+      size_t shortLen = min(savedBits, receivedBits);
+      size_t longLen = max(savedBits, receivedBits);
+      if (strncmp(longer, shorter, shortLen) == 0 ||
+          strcmp(longer + (longLen - shortLen), shorter) == 0) {
+        if (!teClose(saved.te, received.te)) return false;
+        Serial.printf("[KeyMatch] Совпадение по bitString подстроке: saved=%s recv=%s\n",
+                      saved.protocol, received.protocol);
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // Время ещё не получено (ни GSM, ни NTP) — записи с расписанием не открывают
+  bool scheduleAllows(uint8_t scheduleId, unsigned long nowMs) {
+    return Schedule::allowed(scheduleId, TimeSource::weekSlot(nowMs));
+  }
+
+  Outcome decideKey(int found, bool enabled, uint8_t scheduleId, unsigned long nowMs) {
+    if (found < 0) return UNKNOWN;
+    if (!enabled) return DISABLED;
+    if (!scheduleAllows(scheduleId, nowMs)) return OUT_OF_SCHEDULE;
+    return OPEN;
+  }
+
+  void recordKey(Outcome outcome, uint32_t code, int rssi, uint32_t latencyUs) {
+    switch (outcome) {
+      case OPEN:
+        Metrics::inc(Metrics::RF_GATE_OPENS);
+        AuditLog::record(AuditLog::SOURCE_RF, code, rssi, AuditLog::DECISION_OPENED, latencyUs);
+        break;
+      case DISABLED:
+        Metrics::inc(Metrics::RF_KEY_DISABLED);
+        AuditLog::record(AuditLog::SOURCE_RF, code, rssi, AuditLog::DECISION_DISABLED, latencyUs);
+        break;
+      case OUT_OF_SCHEDULE:
+        Metrics::inc(Metrics::RF_OUT_OF_SCHEDULE);
+        AuditLog::record(AuditLog::SOURCE_RF, code, rssi, AuditLog::DECISION_OUT_OF_SCHEDULE, latencyUs);
+        break;
+      case UNKNOWN:
+        Metrics::inc(Metrics::RF_UNKNOWN_KEY);
+        break;
+    }
+  }
+
+  Outcome decidePhone(const char* number, bool isCall, unsigned long nowMs, uint8_t* gates) {
+    uint8_t scheduleId = Schedule::ALWAYS;
+    int channels = PhoneIndex::lookup(number, gates, &scheduleId);
+    if (channels < 0 || !(channels & (isCall ? PhoneIndex::CHANNEL_CALL : PhoneIndex::CHANNEL_SMS))) {
+      return UNKNOWN;
+    }
+    return scheduleAllows(scheduleId, nowMs) ? OPEN : OUT_OF_SCHEDULE;
+  }
+
+  // number может быть и "звонок +7…" / "SMS +7…": phoneId берёт только цифры
+  void recordPhone(Outcome outcome, const String& number) {
+    switch (outcome) {
+      case OPEN:
+        Metrics::inc(Metrics::GSM_GATE_OPENS);
+        AuditLog::record(AuditLog::SOURCE_GSM, AuditLog::phoneId(number), 0, AuditLog::DECISION_OPENED);
+        break;
+      case OUT_OF_SCHEDULE:
+        Metrics::inc(Metrics::GSM_OUT_OF_SCHEDULE);
+        AuditLog::record(AuditLog::SOURCE_GSM, AuditLog::phoneId(number), 0, AuditLog::DECISION_OUT_OF_SCHEDULE);
+        break;
+      case UNKNOWN:
+      case DISABLED:
+        Metrics::inc(Metrics::GSM_REJECTED);
+        AuditLog::record(AuditLog::SOURCE_GSM, AuditLog::phoneId(number), 0, AuditLog::DECISION_DENIED);
+        break;
+    }
+  }
+}
@@ -0,0 +1,117 @@
+#include "AtQueue.h"
+#include <string.h>
+
+namespace At {
+  CommandQueue::CommandQueue() : port(nullptr), active(false), sentAt(0) {
+    clear();
+  }
+
+  void CommandQueue::attach(GsmPort* gsmPort) {
+    port = gsmPort;
+  }
+
+  void CommandQueue::clear() {
+    for (Lane& lane : lanes) {
+      lane.head = 0;
+      lane.count = 0;
+    }
+    active = false;
+  }
+
+  int CommandQueue::pending() const {
+    int total = 0;
+    for (const Lane& lane : lanes) total += lane.count;
+    return total;
+  }
+
+  bool CommandQueue::contains(const char* text) const {
+    if (active && strcmp(current.text, text) == 0) return true;
+    for (const Lane& lane : lanes) {
+      for (int i = 0; i < lane.count; i++) {
+        if (strcmp(lane.slots[(lane.head + i) % LANE_SIZE].text, text) == 0) return true;
+      }
+    }
+    return false;
+  }
+
+  bool CommandQueue::submit(const Request& request, uint32_t nowMs) {
+    if (!request.text || request.priority >= PRIORITY_COUNT) return false;
+    if (strlen(request.text) >= MAX_COMMAND) return false;
+    Lane& lane = lanes[request.priority];
+    if (lane.count >= LANE_SIZE) return false;
+
+    Slot& slot = lane.slots[(lane.head + lane.count) % LANE_SIZE];
+    strcpy(slot.text, request.text);
+    slot.timeoutMs = request.timeoutMs;
+    slot.retriesLeft = request.retries;
+    slot.infoKind = request.infoKind;
+    slot.onInfo = request.onInfo;
+    slot.onDone = request.onDone;
+    slot.tag = request.tag;
+    lane.count++;
+
+    if (!active) sendNext(nowMs);
+    return true;
+  }
+
+  void CommandQueue::sendNext(uint32_t nowMs) {
+    for (Lane& lane : lanes) {
+      if (lane.count == 0) continue;
+      current = lane.slots[lane.head];
+      lane.head = (lane.head + 1) % LANE_SIZE;
+      lane.count--;
+      active = true;
+      transmit(nowMs);
+      return;
+    }
+  }
+
+  void CommandQueue::transmit(uint32_t nowMs) {
+    if (port) {
+      port->write(current.text, strlen(current.text));
+      port->write("\r\n", 2);
+    }
+    sentAt = nowMs;
+  }
+
+  void CommandQueue::finish(Result result, uint32_t nowMs) {
+    // Повтор той же команды — до колбэка, очередь не двигается
+    if (result != RESULT_OK && current.retriesLeft > 0) {
+      current.retriesLeft--;
+      transmit(nowMs);
+      return;
+    }
+    // Колбэк может поставить новые команды или очистить очередь —
+    // текущая к этому моменту уже снята
+    Slot done = current;
+    active = false;
+    if (done.onDone) done.onDone(done.tag, result);
+    if (!active) sendNext(nowMs);
+  }
+
+  bool CommandQueue::consume(const Tokenizer& line, uint32_t nowMs) {
+    if (!active) return false;
+    switch (line.kind()) {
+      case KIND_OK:
+        finish(RESULT_OK, nowMs);
+        return true;
+      case KIND_ERROR:
+      case KIND_CME_ERROR:
+      case KIND_CMS_ERROR:
+        finish(RESULT_ERROR, nowMs);
+        return true;
+      default:
+        if (current.infoKind != KIND_OTHER && line.kind() == current.infoKind) {
+          if (current.onInfo) current.onInfo(line);
+          return true;
+        }
+        return false;
+    }
+  }
+
+  void CommandQueue::poll(uint32_t nowMs) {
+    if (active && nowMs - sentAt > current.timeoutMs) {
+      finish(RESULT_TIMEOUT, nowMs);
+    }
+  }
+}
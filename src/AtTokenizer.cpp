@@ -0,0 +1,212 @@
+#include "AtTokenizer.h"
+#include <string.h>
+
+namespace At {
+  struct Keyword {
+    const char* text;
+    Kind kind;
+    bool exact;  // вся строка (OK), иначе префикс с полями после ':'
+  };
+
+  static const Keyword KEYWORDS[] = {
+    {"OK", KIND_OK, true},
+    {"ERROR", KIND_ERROR, true},
+    {"RING", KIND_RING, true},
+    {"+CLIP:", KIND_CLIP, false},
+    {"+CMT:", KIND_CMT, false},
+    {"+CME ERROR:", KIND_CME_ERROR, false},
+    {"+CMS ERROR:", KIND_CMS_ERROR, false},
+    {"+CSQ:", KIND_CSQ, false},
+    {"+CREG:", KIND_CREG, false},
+    {"+CCLK:", KIND_CCLK, false}
+  };
+
+  // Префиксное дерево: первый потомок + следующий брат, 0 — нет
+  struct Node {
+    char c;
+    uint8_t firstChild;
+    uint8_t next;
+    Kind kind;   // KIND_OTHER — не терминал
+    bool exact;
+  };
+
+  static const int MAX_NODES = 64;
+  static Node trie[MAX_NODES];
+  static int nodeCount = 0;
+
+  static uint8_t findChild(uint8_t parent, char c) {
+    for (uint8_t child = trie[parent].firstChild; child; child = trie[child].next) {
+      if (trie[child].c == c) return child;
+    }
+    return 0;
+  }
+
+  // Один раз на всё время работы, при создании первого токенизатора
+  static void buildTrie() {
+    if (nodeCount > 0) return;
+    trie[0] = {0, 0, 0, KIND_OTHER, false};
+    nodeCount = 1;
+    for (const Keyword& keyword : KEYWORDS) {
+      uint8_t node = 0;
+      for (const char* p = keyword.text; *p; p++) {
+        uint8_t child = findChild(node, *p);
+        if (!child) {
+          if (nodeCount >= MAX_NODES) return;
+          child = (uint8_t)nodeCount++;
+          trie[child] = {*p, 0, trie[node].firstChild, KIND_OTHER, false};
+          trie[node].firstChild = child;
+        }
+        node = child;
+      }
+      trie[node].kind = keyword.kind;
+      trie[node].exact = keyword.exact;
+    }
+  }
+
+  bool View::equals(const View& other) const {
+    return len == other.len && memcmp(data, other.data, len) == 0;
+  }
+
+  bool View::equals(const char* text) const {
+    return strlen(text) == len && memcmp(data, text, len) == 0;
+  }
+
+  size_t View::copyTo(char* out, size_t outSize) const {
+    if (outSize == 0) return 0;
+    size_t n = len < outSize - 1 ? len : outSize - 1;
+    memcpy(out, data, n);
+    out[n] = '\0';
+    return n;
+  }
+
+  Tokenizer::Tokenizer() {
+    buildTrie();
+    startLine();
+  }
+
+  void Tokenizer::reset() {
+    startLine();
+  }
+
+  void Tokenizer::startLine() {
+    len = 0;
+    complete = false;
+    overflow = false;
+    printable = 0;
+    utf8Left = 0;
+    node = 0;
+    trieDead = false;
+    matched = KIND_OTHER;
+    exactOnly = false;
+    matchedLen = 0;
+    lineKind = KIND_OTHER;
+    inPayload = false;
+    inQuotes = false;
+    fields = 0;
+  }
+
+  View Tokenizer::field(int index) const {
+    if (index < 0 || index >= fields) return {buf, 0};
+    return {buf + fieldStart[index], (uint16_t)(fieldEnd[index] - fieldStart[index])};
+  }
+
+  // Шум на линии — случайные байты со старшим битом; валидный UTF-8 из них
+  // складывается редко, а текст SMS на кириллице весь из таких последовательностей
+  void Tokenizer::countPrintable(uint8_t c) {
+    if (utf8Left > 0 && (c & 0xC0) == 0x80) {
+      if (--utf8Left == 0) printable += utf8Bytes;
+      return;
+    }
+    utf8Left = 0;
+    if (c >= 32 && c < 127) {
+      printable++;
+    } else if (c >= 0xC2 && c <= 0xDF) {
+      utf8Left = 1;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+      utf8Left = 2;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+      utf8Left = 3;
+    }
+    utf8Bytes = utf8Left + 1;
+  }
+
+  bool Tokenizer::feed(char c) {
+    if (complete) startLine();
+    if (c == '\r') return false;
+    if (c == '\n') {
+      if (len == 0 && !overflow) return false;  // пустая строка между ответами
+      finishLine();
+      complete = true;
+      return true;
+    }
+    if (len == 0 && c == ' ') return false;     // ведущие пробелы
+    if (len >= MAX_LINE) {
+      overflow = true;  // дальше до перевода строки — только отбрасываем
+      return false;
+    }
+
+    uint16_t i = (uint16_t)len;
+    buf[len++] = c;
+    countPrintable((uint8_t)c);
+
+    if (inPayload) {
+      int cur = fields - 1;
+      if (inQuotes) {
+        if (c == '"') inQuotes = false;
+        else fieldEnd[cur] = i + 1;
+      } else if (c == ',') {
+        if (fields < MAX_FIELDS) {
+          fieldStart[fields] = fieldEnd[fields] = i + 1;
+          fields++;
+        } else {
+          inPayload = false;  // лишние поля не нужны
+        }
+      } else if (c == '"' && fieldEnd[cur] == fieldStart[cur]) {
+        inQuotes = true;
+        fieldStart[cur] = fieldEnd[cur] = i + 1;
+      } else if (c == ' ' && fieldEnd[cur] == fieldStart[cur]) {
+        fieldStart[cur] = fieldEnd[cur] = i + 1;  // пробел перед значением
+      } else if (c != ' ') {
+        fieldEnd[cur] = i + 1;  // хвостовые пробелы в поле не входят
+      }
+      return false;
+    }
+
+    if (!trieDead) {
+      uint8_t child = findChild(node, c);
+      if (!child) {
+        trieDead = true;
+      } else {
+        node = child;
+        if (trie[child].kind != KIND_OTHER) {
+          matched = trie[child].kind;
+          exactOnly = trie[child].exact;
+          matchedLen = len;
+          if (!exactOnly) {
+            // Дальше — поля через запятую
+            inPayload = true;
+            fields = 1;
+            fieldStart[0] = fieldEnd[0] = (uint16_t)len;
+          }
+        }
+      }
+    }
+    return false;
+  }
+
+  void Tokenizer::finishLine() {
+    while (len > 0 && buf[len - 1] == ' ') len--;
+
+    if (overflow || printable * 10 < len * 7) {  // < 70% печатаемых
+      lineKind = KIND_JUNK;
+      fields = 0;
+      return;
+    }
+    if (matched != KIND_OTHER && (!exactOnly || len == matchedLen)) {
+      lineKind = matched;
+    } else {
+      lineKind = KIND_OTHER;
+      fields = 0;
+    }
+  }
+}
@@ -0,0 +1,279 @@
+#include "AuditLog.h"
+#include "Crc32.h"
+#include <SPIFFS.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <algorithm>
+
+namespace AuditLog {
+  static const char* AUDIT_FILE = "/audit.bin";
+  static const uint32_t MAGIC = 0x41554431; // "AUD1"
+  static const size_t HEADER_SIZE = 256;
+  static const size_t PENDING_SLOTS = 16;
+
+  struct Header {
+    uint32_t magic;
+    uint16_t recordSize;
+    uint16_t pageCount;
+    uint32_t head;       // записей записано за всё время
+    uint16_t boot;
+    uint16_t reserved;
+  };
+
+  // Очередь record() → flush(): любая задача → задача HTTP
+  static portMUX_TYPE pendingMux = portMUX_INITIALIZER_UNLOCKED;
+  static Record pending[PENDING_SLOTS];
+  static size_t pendingCount = 0;
+  static uint32_t droppedCount = 0;   // под pendingMux
+
+  // Дальше — только задача HTTP (и setup до её запуска)
+  static File file;
+  static Header header = {MAGIC, sizeof(Record), PAGE_COUNT, 0, 0, 0};
+  static bool ready = false;
+  static uint32_t pageFirstTime[PAGE_COUNT];  // индекс: время первой записи страницы
+  // По возрастанию (source, subject). Только субъекты с открытиями в кольце —
+  // не больше CAPACITY, отдельный предел не нужен
+  static std::vector<SubjectStats> subjects;
+
+  static uint32_t timeBase = 0;  // секунды устройства в момент загрузки
+
+  uint32_t now() {
+    return timeBase + (uint32_t)(esp_timer_get_time() / 1000000);
+  }
+
+  uint8_t bootNumber() {
+    return (uint8_t)header.boot;
+  }
+
+  uint32_t phoneId(const String& number) {
+    char digits[10];
+    size_t count = 0;
+    // Последние 10 цифр строки (кольцом, чтобы не искать длину заранее)
+    for (size_t i = 0; i < number.length(); i++) {
+      if (isdigit((unsigned char)number[i])) digits[count++ % 10] = number[i];
+    }
+    char ordered[10];
+    size_t n = min(count, (size_t)10);
+    for (size_t i = 0; i < n; i++) ordered[i] = digits[(count - n + i) % 10];
+    return crc32(ordered, n);
+  }
+
+  static uint32_t slotOffset(uint32_t seq) {
+    return HEADER_SIZE + (seq % CAPACITY) * sizeof(Record);
+  }
+
+  static void writeHeader() {
+    file.seek(0);
+    file.write((const uint8_t*)&header, sizeof(header));
+  }
+
+  uint32_t head() {
+    return header.head;
+  }
+
+  uint32_t oldest() {
+    if (header.head == 0) return 0;
+    uint32_t lastPage = (header.head - 1) / RECORDS_PER_PAGE;
+    uint32_t firstPage = lastPage >= PAGE_COUNT ? lastPage - PAGE_COUNT + 1 : 0;
+    return firstPage * RECORDS_PER_PAGE;
+  }
+
+  static std::vector<SubjectStats>::iterator findSubject(uint8_t source, uint32_t subject) {
+    return std::lower_bound(subjects.begin(), subjects.end(), std::make_pair(source, subject),
+                            [](const SubjectStats& s, const std::pair<uint8_t, uint32_t>& key) {
+                              return s.source != key.first ? s.source < key.first : s.subject < key.second;
+                            });
+  }
+
+  static void statsAdd(const Record& r) {
+    if (r.decision != DECISION_OPENED) return;
+    auto it = findSubject(r.source, r.subject);
+    if (it == subjects.end() || it->source != r.source || it->subject != r.subject) {
+      it = subjects.insert(it, {r.source, r.subject, 0, 0});
+    }
+    it->opened++;
+    if (r.time >= it->lastUsed) it->lastUsed = r.time;
+  }
+
+  // Запись уходит из кольца — из счётчика тоже; последнее открытие ушло —
+  // субъект убирается (после перезагрузки его бы и так не было)
+  static void statsRemove(const Record& r) {
+    if (r.decision != DECISION_OPENED) return;
+    auto it = findSubject(r.source, r.subject);
+    if (it == subjects.end() || it->source != r.source || it->subject != r.subject) return;
+    if (--it->opened == 0) subjects.erase(it);
+  }
+
+  static bool create() {
+    File f = SPIFFS.open(AUDIT_FILE, "w");
+    if (!f) return false;
+    uint8_t block[HEADER_SIZE] = {0};
+    f.write(block, HEADER_SIZE); // заголовок запишется после открытия
+    for (uint32_t i = 0; i < PAGE_COUNT; i++) f.write(block, RECORDS_PER_PAGE * sizeof(Record));
+    f.close();
+    header = {MAGIC, sizeof(Record), PAGE_COUNT, 0, 0, 0};
+    return true;
+  }
+
+  void init() {
+    bool valid = false;
+    if (SPIFFS.exists(AUDIT_FILE)) {
+      file = SPIFFS.open(AUDIT_FILE, "r+");
+      Header h;
+      if (file && file.size() == HEADER_SIZE + CAPACITY * sizeof(Record) &&
+          file.read((uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+          h.magic == MAGIC && h.recordSize == sizeof(Record) && h.pageCount == PAGE_COUNT) {
+        header = h;
+        valid = true;
+      } else if (file) {
+        file.close();
+      }
+    }
+    if (!valid) {
+      if (!create()) {
+        Serial.println("[ERROR] AuditLog: не удалось создать журнал доступа");
+        return;
+      }
+      file = SPIFFS.open(AUDIT_FILE, "r+");
+      if (!file) return;
+    }
+    header.boot++;
+    writeHeader();
+    file.flush();
+    ready = true;
+
+    // Индекс страниц и статистика — один проход по кольцу при старте
+    subjects.clear();
+    uint32_t lastTime = 0;
+    bool any = false;
+    Reader reader(oldest());
+    Record r;
+    while (reader.next(r)) {
+      uint32_t seq = reader.position() - 1;
+      if (seq % RECORDS_PER_PAGE == 0) pageFirstTime[(seq / RECORDS_PER_PAGE) % PAGE_COUNT] = r.time;
+      statsAdd(r);
+      lastTime = r.time;
+      any = true;
+    }
+    timeBase = any ? lastTime + 1 : 0;
+    Serial.printf("[OK] AuditLog: записей %u, загрузка %u\n",
+                  (unsigned)(header.head - oldest()), (unsigned)header.boot);
+  }
+
+  void record(Source source, uint32_t subject, int rssi, Decision decision, uint32_t latencyUs) {
+    Record r;
+    r.time = now();
+    r.subject = subject;
+    r.latencyUs = (uint16_t)min(latencyUs, (uint32_t)0xFFFF);
+    r.rssi = (int8_t)constrain(rssi, -128, 127);
+    r.source = source;
+    r.decision = decision;
+    r.boot = bootNumber();
+    r.reserved = 0;
+
+    portENTER_CRITICAL(&pendingMux);
+    if (pendingCount < PENDING_SLOTS) {
+      pending[pendingCount++] = r;
+    } else {
+      droppedCount++;
+    }
+    portEXIT_CRITICAL(&pendingMux);
+  }
+
+  static void append(const Record& r) {
+    uint32_t seq = header.head;
+    if (seq % RECORDS_PER_PAGE == 0) {
+      // Новая страница: если она занята прошлым кругом — её записи уходят из статистики
+      if (seq >= CAPACITY) {
+        Reader old(seq - CAPACITY);
+        Record gone;
+        for (uint32_t i = 0; i < RECORDS_PER_PAGE && old.next(gone); i++) statsRemove(gone);
+      }
+      pageFirstTime[(seq / RECORDS_PER_PAGE) % PAGE_COUNT] = r.time;
+    }
+    file.seek(slotOffset(seq));
+    file.write((const uint8_t*)&r, sizeof(r));
+    header.head++;
+    statsAdd(r);
+  }
+
+  void flush() {
+    if (!ready) return;
+    Record batch[PENDING_SLOTS];
+    size_t count;
+    portENTER_CRITICAL(&pendingMux);
+    count = pendingCount;
+    memcpy(batch, pending, count * sizeof(Record));
+    pendingCount = 0;
+    portEXIT_CRITICAL(&pendingMux);
+    if (count == 0) return;
+
+    for (size_t i = 0; i < count; i++) append(batch[i]);
+    writeHeader();
+    file.flush();
+  }
+
+  uint32_t seekTime(uint32_t time) {
+    uint32_t first = oldest();
+    if (header.head == 0) return first;
+    uint32_t firstPage = first / RECORDS_PER_PAGE;
+    uint32_t lastPage = (header.head - 1) / RECORDS_PER_PAGE;
+    uint32_t found = firstPage;
+    // Страницы упорядочены по времени: последняя, начавшаяся не позже time
+    for (uint32_t page = firstPage; page <= lastPage; page++) {
+      if (pageFirstTime[page % PAGE_COUNT] > time) break;
+      found = page;
+    }
+    return found * RECORDS_PER_PAGE;
+  }
+
+  bool Reader::next(Record& record) {
+    if (!ready) return false;
+    uint32_t first = oldest();
+    if (seq < first) seq = first;
+    if (seq >= header.head) return false;
+    if (seq < bufStart || seq >= bufStart + bufCount) {
+      // До конца страницы (страница не пересекает конец кольца)
+      uint32_t pageEnd = (seq / RECORDS_PER_PAGE + 1) * RECORDS_PER_PAGE;
+      uint32_t count = min(pageEnd, header.head) - seq;
+      file.seek(slotOffset(seq));
+      size_t got = file.read((uint8_t*)buf, count * sizeof(Record));
+      bufStart = seq;
+      bufCount = got / sizeof(Record);
+      if (bufCount == 0) return false;
+    }
+    record = buf[seq - bufStart];
+    seq++;
+    return true;
+  }
+
+  std::vector<SubjectStats> stats() {
+    return subjects;
+  }
+
+  uint32_t dropped() {
+    portENTER_CRITICAL(&pendingMux);
+    uint32_t value = droppedCount;
+    portEXIT_CRITICAL(&pendingMux);
+    return value;
+  }
+
+  const char* sourceName(uint8_t source) {
+    switch (source) {
+      case SOURCE_RF:   return "rf";
+      case SOURCE_GSM:  return "gsm";
+      case SOURCE_HTTP: return "http";
+      default:          return "unknown";
+    }
+  }
+
+  const char* decisionName(uint8_t decision) {
+    switch (decision) {
+      case DECISION_OPENED:   return "opened";
+      case DECISION_DISABLED: return "disabled";
+      case DECISION_DENIED:   return "denied";
+      case DECISION_OUT_OF_SCHEDULE: return "schedule";
+      default:                return "unknown";
+    }
+  }
+}
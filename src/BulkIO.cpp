@@ -0,0 +1,131 @@
+#include <Arduino.h>
+#include "BulkIO.h"
+
+namespace BulkIO {
+  void LineReader::reset() {
+    len = 0;
+    overflow = false;
+    csvQuotes = false;
+    inQuotes = false;
+  }
+
+  bool LineReader::emit(const LineFn& onLine) {
+    // Хвостовой \r (CRLF из Excel/Windows) отрезаем
+    while (len > 0 && (buf[len - 1] == '\r' || buf[len - 1] == ' ')) len--;
+    buf[len] = '\0';
+    size_t n = len;
+    len = 0;
+    if (n == 0) return true; // пустые строки пропускаем
+    return onLine(buf, n);
+  }
+
+  bool LineReader::feed(const uint8_t* data, size_t n, const LineFn& onLine) {
+    if (overflow) return false;
+    for (size_t i = 0; i < n; i++) {
+      char c = (char)data[i];
+      if (csvQuotes && c == '"') inQuotes = !inQuotes;
+      if (c == '\n' && !inQuotes) {
+        if (!emit(onLine)) return false;
+        continue;
+      }
+      if (len >= MAX_LINE) {
+        // Строка не влезла в буфер — это не «обрезать и идти дальше»:
+        // обрезанная запись молча сохранилась бы с битыми данными
+        overflow = true;
+        return false;
+      }
+      buf[len++] = c;
+    }
+    return true;
+  }
+
+  bool LineReader::finish(const LineFn& onLine) {
+    if (overflow) return false;
+    return emit(onLine);
+  }
+
+  Format detectFormat(const String& filename, const uint8_t* head, size_t len) {
+    if (filename.endsWith(".csv") || filename.endsWith(".CSV")) return Format::CSV;
+    if (filename.endsWith(".ndjson") || filename.endsWith(".jsonl") || filename.endsWith(".json")) {
+      return Format::NDJSON;
+    }
+    for (size_t i = 0; i < len; i++) {
+      char c = (char)head[i];
+      if (c == ' ' || c == '\t' || c == '\r' || c == '\n') continue;
+      // BOM UTF-8 (EF BB BF) — пропускаем
+      if ((uint8_t)c == 0xEF || (uint8_t)c == 0xBB || (uint8_t)c == 0xBF) continue;
+      return c == '{' ? Format::NDJSON : Format::CSV;
+    }
+    return Format::CSV;
+  }
+
+  int splitCsv(char* line, char* fields[], int maxFields) {
+    int count = 0;
+    char* p = line;
+    // BOM в начале файла
+    if ((uint8_t)p[0] == 0xEF && (uint8_t)p[1] == 0xBB && (uint8_t)p[2] == 0xBF) p += 3;
+
+    while (count < maxFields) {
+      char* out = p;
+      fields[count++] = out;
+      if (*p == '"') {
+        // Поле в кавычках: "" → ", разделитель внутри не считается
+        p++;
+        while (*p) {
+          if (*p == '"') {
+            if (p[1] == '"') { *out++ = '"'; p += 2; continue; }
+            p++;
+            break;
+          }
+          *out++ = *p++;
+        }
+        // Мусор между закрывающей кавычкой и разделителем игнорируем
+        while (*p && *p != ',' && *p != ';') p++;
+      } else {
+        while (*p && *p != ',' && *p != ';') *out++ = *p++;
+      }
+      bool more = (*p == ',' || *p == ';');
+      if (more) p++;
+      *out = '\0';
+      // Обрезка пробелов по краям
+      char* f = fields[count - 1];
+      while (*f == ' ') f++;
+      size_t fl = strlen(f);
+      while (fl > 0 && f[fl - 1] == ' ') f[--fl] = '\0';
+      fields[count - 1] = f;
+      if (!more) break;
+    }
+    return count;
+  }
+
+  bool parseBool(const char* s, bool& out) {
+    if (!s || !*s) return false;
+    if (!strcmp(s, "1") || !strcasecmp(s, "true") || !strcasecmp(s, "yes") || !strcmp(s, "да")) {
+      out = true;
+      return true;
+    }
+    if (!strcmp(s, "0") || !strcasecmp(s, "false") || !strcasecmp(s, "no") || !strcmp(s, "нет")) {
+      out = false;
+      return true;
+    }
+    return false;
+  }
+
+  String csvField(const String& s) {
+    bool needQuotes = false;
+    for (unsigned int i = 0; i < s.length(); i++) {
+      char c = s[i];
+      if (c == ',' || c == ';' || c == '"' || c == '\n' || c == '\r') { needQuotes = true; break; }
+    }
+    if (!needQuotes) return s;
+    String out;
+    out.reserve(s.length() + 4);
+    out += '"';
+    for (unsigned int i = 0; i < s.length(); i++) {
+      if (s[i] == '"') out += '"';
+      out += s[i];
+    }
+    out += '"';
+    return out;
+  }
+}
@@ -1,6 +1,7 @@
 #include "CC1101Manager.h"
 #include "SubGhzProtocols.h"
 #include "SubGhzDecoder.h"
+#include "Metrics.h"
 #include <math.h>
 #include <algorithm>
 
@@ -60,6 +61,7 @@ ModulationType CC1101Manager::currentModulation = MODULATION_ASK_OOK;
 volatile bool CC1101Manager::receivedFlag = false;
 ReceivedKey CC1101Manager::lastKey;
 int CC1101Manager::gdo0PinNumber = -1;
+CC1101Manager::PulseTap CC1101Manager::pulseTap = nullptr;
 
 // Буферы RAW сигнала
 volatile unsigned long CC1101Manager::rawSignalTimings[CC1101Manager::MAX_RAW_SIGNAL_LENGTH];
@@ -70,6 +72,9 @@ volatile bool CC1101Manager::rawSignalReady = false;
 volatile unsigned long CC1101Manager::interruptCounter = 0;
 volatile bool CC1101Manager::firstEdgeCaptured = false;
 volatile bool CC1101Manager::lastSignalLevel = false;
+volatile unsigned long CC1101Manager::signalReadyAt = 0;
+volatile CC1101Manager::SignalReadyHook CC1101Manager::signalReadyHook = nullptr;
+unsigned long CC1101Manager::lastSignalAt = 0;
 // Флаг «слить следующий импульс того же уровня»: выставляется при склейке
 // короткого спайка, чтобы продолжение прерванного импульса не сохранялось
 // отдельной записью (иначе один LOW дробится на два → ломает CAME и др.).
@@ -879,11 +884,14 @@ bool CC1101Manager::checkReceived() {
     const int MIN_RSSI_FOR_VALID_SIGNAL = -100; // Минимальный RSSI для валидного сигнала
     if (currentRssi < MIN_RSSI_FOR_VALID_SIGNAL) {
         // Слишком слабый сигнал - вероятно шум
+        Metrics::inc(Metrics::RF_WEAK);
         resetRawBuffer();
         attachRawInterrupt();
         return false;
     }
 
+    if (pulseTap) pulseTap(rawSignalTimings, rawSignalLevels, signalLength, currentRssi);
+
     uint32_t decodedCode = 0;
     String protocolName = "RAW/Unknown";
     String bitSequence = "";
@@ -897,6 +905,9 @@ bool CC1101Manager::checkReceived() {
     float decodedTe = 0;
 
     if (LOG_RAW_SIGNALS) Serial.printf("[CC1101] Буфер: %d импульсов\n", signalLength);
+    Metrics::inc(Metrics::RF_BUFFERS);
+    lastSignalAt = signalReadyAt;
+    uint32_t decodeStart = micros();
     // (Nero Radio преамбула может быть в одном буфере, данные в следующем)
     for (int i = 0; i < signalLength; i++) {
         ::DecoderResult dr = multiDecoder.feed(rawSignalLevels[i], rawSignalTimings[i]);
@@ -921,6 +932,8 @@ bool CC1101Manager::checkReceived() {
             break; // Первый сработавший — победитель
         }
     }
+    Metrics::observe(Metrics::HIST_RF_DECODE, micros() - decodeStart);
+    if (decoded) Metrics::inc(Metrics::RF_DECODED);
 
     // Без fallback — только Flipper-декодеры
     
@@ -1407,6 +1420,11 @@ void CC1101Manager::printConfig() {
     Serial.println("╚════════════════════════════════════════════════════════════╝\n");
 }
 
+// Отвод импульсов для визуализатора
+void CC1101Manager::setPulseTap(PulseTap tap) {
+    pulseTap = tap;
+}
+
 // Получить счетчик прерываний (для отладки)
 unsigned long CC1101Manager::getInterruptCount() {
     return interruptCounter;
@@ -1568,6 +1586,14 @@ ModulationType CC1101Manager::getModulation() {
     return currentModulation;
 }
 
+unsigned long CC1101Manager::getLastSignalMicros() {
+    return lastSignalAt;
+}
+
+void CC1101Manager::setSignalReadyHook(SignalReadyHook hook) {
+    signalReadyHook = hook;
+}
+
 bool CC1101Manager::startReceive() {
     return enterRawReceive();
 }
@@ -1615,7 +1641,9 @@ void IRAM_ATTR CC1101Manager::onInterrupt() {
         if (rawSignalIndex >= MIN_PULSES_TO_ACCEPT) {
             rawSignalReady = true;
             receivedFlag = true;
+            signalReadyAt = now;
             detachRawInterrupt();
+            if (signalReadyHook) signalReadyHook();
         } else {
             // Мало данных — сброс
             rawSignalIndex = 0;
@@ -1644,7 +1672,9 @@ void IRAM_ATTR CC1101Manager::onInterrupt() {
         if (rawSignalIndex >= MIN_PULSES_TO_ACCEPT) {
             rawSignalReady = true;
             receivedFlag = true;
+            signalReadyAt = now;
             detachRawInterrupt();
+            if (signalReadyHook) signalReadyHook();
         } else {
             rawSignalIndex = 0;
             firstEdgeCaptured = false;
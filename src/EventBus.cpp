@@ -0,0 +1,129 @@
+#include "EventBus.h"
+#include "MpmcRing.h"
+#include <atomic>
+
+namespace EventBus {
+  static const char* const TOPIC_NAMES[TOPIC_COUNT] = { "gate_command", "gate_phase" };
+
+  struct Subscriber {
+    const char* name;
+    uint32_t topics;
+    Handler handler;
+    Notify notify;
+    MpmcRing<Event, QUEUE_CAPACITY> queue;
+  };
+
+  struct Counters {
+    std::atomic<uint32_t> published;
+    std::atomic<uint32_t> delivered;
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint32_t> maxDepth;
+  };
+
+  static Subscriber subscribers[MAX_SUBSCRIBERS];
+  static int subscriberCount = 0;
+  static Counters counters[TOPIC_COUNT];
+
+  int subscribe(const char* name, uint32_t topics, Handler handler, Notify notify) {
+    if (subscriberCount >= MAX_SUBSCRIBERS || !handler) {
+      Serial.printf("[EventBus] Нет слота для подписчика %s\n", name);
+      return -1;
+    }
+    Subscriber& s = subscribers[subscriberCount];
+    s.name = name;
+    s.topics = topics;
+    s.handler = handler;
+    s.notify = notify;
+    s.queue.reset();
+    return subscriberCount++;
+  }
+
+  static void raiseMax(std::atomic<uint32_t>& target, uint32_t value) {
+    uint32_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+  }
+
+  bool publish(const Event& event) {
+    if (event.topic >= TOPIC_COUNT) return false;
+    Counters& c = counters[event.topic];
+    c.published.fetch_add(1, std::memory_order_relaxed);
+    bool delivered = false, dropped = false;
+    for (int i = 0; i < subscriberCount; i++) {
+      Subscriber& s = subscribers[i];
+      if (!(s.topics & topicBit(event.topic))) continue;
+      uint32_t depth;
+      if (s.queue.push(event, &depth)) {
+        raiseMax(c.maxDepth, depth);
+        c.delivered.fetch_add(1, std::memory_order_relaxed);
+        delivered = true;
+        if (s.notify) s.notify();
+      } else {
+        c.dropped.fetch_add(1, std::memory_order_relaxed);
+        dropped = true;
+      }
+    }
+    return delivered && !dropped;
+  }
+
+  bool publishGateCommand(Source source, uint8_t gates) {
+    Event event;
+    event.topic = TOPIC_GATE_COMMAND;
+    event.timestamp = millis();
+    event.gateCommand = {source, gates};
+    return publish(event);
+  }
+
+  void publishGatePhase(uint8_t gate, const char* phase, const char* next, float position) {
+    Event event;
+    event.topic = TOPIC_GATE_PHASE;
+    event.timestamp = millis();
+    event.gatePhase = {gate, phase, next, position};
+    publish(event);
+  }
+
+  int dispatch(int subscriber, int maxEvents) {
+    if (subscriber < 0 || subscriber >= subscriberCount) return 0;
+    Subscriber& s = subscribers[subscriber];
+    Event event;
+    int handled = 0;
+    while (handled < maxEvents && s.queue.pop(event)) {
+      s.handler(event);
+      handled++;
+    }
+    return handled;
+  }
+
+  const char* topicName(Topic topic) {
+    return topic < TOPIC_COUNT ? TOPIC_NAMES[topic] : "";
+  }
+
+  TopicStats topicStats(Topic topic) {
+    if (topic >= TOPIC_COUNT) return {0, 0, 0, 0};
+    const Counters& c = counters[topic];
+    return {c.published.load(std::memory_order_relaxed), c.delivered.load(std::memory_order_relaxed),
+            c.dropped.load(std::memory_order_relaxed), c.maxDepth.load(std::memory_order_relaxed)};
+  }
+
+  void writeMetrics(Print& out) {
+    out.print("# TYPE gate_bus_published counter\n# HELP gate_bus_published Событий опубликовано в шину\n");
+    for (int t = 0; t < TOPIC_COUNT; t++) {
+      out.printf("gate_bus_published_total{topic=\"%s\"} %u\n", TOPIC_NAMES[t],
+                 (unsigned)counters[t].published.load(std::memory_order_relaxed));
+    }
+    out.print("# TYPE gate_bus_dropped counter\n# HELP gate_bus_dropped Событий потеряно: очередь подписчика полна\n");
+    for (int t = 0; t < TOPIC_COUNT; t++) {
+      out.printf("gate_bus_dropped_total{topic=\"%s\"} %u\n", TOPIC_NAMES[t],
+                 (unsigned)counters[t].dropped.load(std::memory_order_relaxed));
+    }
+    out.print("# TYPE gate_bus_queue_depth_max gauge\n# HELP gate_bus_queue_depth_max Наибольшая глубина очереди подписчика\n");
+    for (int t = 0; t < TOPIC_COUNT; t++) {
+      out.printf("gate_bus_queue_depth_max{topic=\"%s\"} %u\n", TOPIC_NAMES[t],
+                 (unsigned)counters[t].maxDepth.load(std::memory_order_relaxed));
+    }
+    out.print("# TYPE gate_bus_queue_depth gauge\n# HELP gate_bus_queue_depth Событий ждёт обработки\n");
+    for (int i = 0; i < subscriberCount; i++) {
+      Subscriber& s = subscribers[i];
+      out.printf("gate_bus_queue_depth{subscriber=\"%s\"} %u\n", s.name, (unsigned)s.queue.depth());
+    }
+  }
+}
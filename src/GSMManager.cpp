@@ -1,10 +1,35 @@
 #include <Arduino.h>
 #include "GSMManager.h"
+#include "AtQueue.h"
+#include "AtTokenizer.h"
 #include "infrastructure/Logger.h"
+#include "Metrics.h"
+#include "TimeSource.h"
 
 namespace GSMManager {
+#ifdef ARDUINO
   // UART2: аппаратный порт ESP32 (пины задаются в begin)
-  static HardwareSerial gsmSerial(2);
+  class UartPort : public GsmPort {
+  public:
+    UartPort() : serial(2) {}
+    void setPins(int rx, int tx) { rxPin = rx; txPin = tx; }
+    void begin(uint32_t baud) override { serial.begin(baud, SERIAL_8N1, rxPin, txPin); }
+    void setBaud(uint32_t baud) override { serial.updateBaudRate(baud); }
+    int available() override { return serial.available(); }
+    int read() override { return serial.read(); }
+    void write(const char* data, size_t len) override { serial.write((const uint8_t*)data, len); }
+  private:
+    HardwareSerial serial;
+    int rxPin = -1;
+    int txPin = -1;
+  };
+  static UartPort uartPort;
+#endif
+
+  static GsmPort* port = nullptr;
+
+  // Все команды модему — через очередь с приоритетами (см. AtQueue.h)
+  static At::CommandQueue commands;
 
   // SIM800L бывает и с автобаудом, и с жёстко прошитой скоростью (часто 115200).
   // При поиске модуля перебираем скорости: 2 пробы "AT" на каждой, по кругу.
@@ -18,33 +43,51 @@ namespace GSMManager {
 
   // --- State machine инициализации ---
   // SIM800L стартует 3-10 с и может быть вообще не подключён, поэтому
-  // конфигурация идёт асинхронно: команда → ждём "OK" в общем парсере строк.
+  // конфигурация идёт асинхронно: команды в очереди, переходы — в колбэках onDone.
   enum class State { OFFLINE, PROBING, CONFIGURING, READY };
   static State state = State::OFFLINE;
 
-  static const unsigned long PROBE_RETRY_MS = 5000; // повтор "AT", пока модуль молчит
-  static const unsigned long CMD_TIMEOUT_MS = 2000;  // ожидание "OK" на команду
-  static unsigned long lastCmdSentAt = 0;
+  static const uint32_t PROBE_RETRY_MS = 5000; // повтор "AT", пока модуль молчит
+  static const uint32_t CMD_TIMEOUT_MS = 2000;  // ожидание "OK" на команду
+  static const uint32_t HANGUP_TIMEOUT_MS = 1000;
 
-  // Команды конфигурации (по очереди, каждая ждёт OK):
+  // Команды конфигурации (по очереди, каждая ждёт OK, ERROR — один повтор):
   // ATE0        - выключить эхо
   // AT+CLIP=1   - АОН: номер звонящего в URC +CLIP
   // AT+CMGF=1   - SMS в текстовом режиме
   // AT+CNMI=2,2,0,0,0 - входящие SMS сразу в UART (+CMT), не копятся на SIM
   static const char* CONFIG_CMDS[] = { "ATE0", "AT+CLIP=1", "AT+CMGF=1", "AT+CNMI=2,2,0,0,0" };
   static const int CONFIG_CMD_COUNT = sizeof(CONFIG_CMDS) / sizeof(CONFIG_CMDS[0]);
-  static int configCmdIndex = 0;
 
-  // --- Парсер строк от модуля ---
-  static String lineBuf;
+  // --- Опрос состояния в READY ---
+  // Уровень сигнала и регистрация в сети раз в 30 с — фоновой полосой, короткий
+  // таймаут, не во время звонка. 3 команды опроса подряд без ответа — модуль потерян
+  // (отвалился провод, перезагрузка по питанию): заново ищем его пробой "AT".
+  static const uint32_t HEALTH_POLL_MS = 30000;
+  static const uint32_t HEALTH_TIMEOUT_MS = 1000;
+  static const int HEALTH_MAX_MISSES = 3;
+  static uint32_t lastHealthPollAt = 0;
+  static int healthMisses = 0;
+  static Health health = {-1, -1, 0};
+
+  // --- Часы сети для расписаний (TimeSource) ---
+  // AT+CLTS=1 — модем ставит часы по времени сети (NITZ) при регистрации;
+  // AT+CCLK? — раз в 10 мин и сразу после конфигурации. Без NITZ у оператора
+  // часы модема идут от 2004 года — TimeSource такое время отбрасывает.
+  static const uint32_t CLOCK_POLL_MS = 600000;
+  static uint32_t lastClockPollAt = 0;
+
+  // --- Парсер строк от модуля (фиксированный буфер, см. AtTokenizer.h) ---
+  static At::Tokenizer tokenizer;
+  static const size_t NUMBER_LEN = 24;
 
   // Ожидание тела SMS: после "+CMT: ..." следующая строка — текст сообщения
   static bool awaitingSmsBody = false;
-  static String smsSender;
+  static char smsSender[NUMBER_LEN];
 
   // Дедупликация: +CLIP повторяется с каждым RING (~раз в 4-5 с), пока звонок
   // не сброшен — реагируем на один и тот же номер не чаще раза в 10 с
-  static String lastCallNumber;
+  static char lastCallNumber[NUMBER_LEN];
   static unsigned long lastCallHandledAt = 0;
   static const unsigned long CALL_DEDUP_MS = 10000;
 
@@ -54,45 +97,178 @@ namespace GSMManager {
   static unsigned long firstRingAt = 0;
   static const unsigned long RING_NO_CLIP_TIMEOUT_MS = 8000;
 
-  static void sendCmd(const char* cmd) {
-    gsmSerial.print(cmd);
-    gsmSerial.print("\r\n");
-    lastCmdSentAt = millis();
+  static void probe();
+
+  static void submit(const char* text, At::Priority priority, uint32_t timeoutMs, uint8_t retries,
+                     At::CommandQueue::DoneFn onDone, int tag = 0) {
+    At::CommandQueue::Request request;
+    request.text = text;
+    request.priority = priority;
+    request.timeoutMs = timeoutMs;
+    request.retries = retries;
+    request.onDone = onDone;
+    request.tag = tag;
+    if (!commands.submit(request, millis())) {
+      Serial.printf("[GSM] Очередь команд заполнена, %s не отправлена\n", text);
+    }
+  }
+
+  // Сброс звонка — вперёд конфигурации и опроса; повторный ATH не ставим
+  static void hangUp() {
+    if (commands.contains("ATH")) return;
+    submit("ATH", At::PRIORITY_URGENT, HANGUP_TIMEOUT_MS, 1, nullptr);
+  }
+
+  static void onConfigDone(int index, At::Result result) {
+    if (state != State::CONFIGURING) return;
+    if (result != At::RESULT_OK) {
+      Logger::warning("[GSM] SIM800L не ответил на " + String(CONFIG_CMDS[index]) + ", повтор...");
+      commands.clear();
+      probe();
+      return;
+    }
+    if (index == CONFIG_CMD_COUNT - 1) {
+      state = State::READY;
+      healthMisses = 0;
+      lastHealthPollAt = millis() - HEALTH_POLL_MS;  // первый опрос — сразу
+      lastClockPollAt = millis() - CLOCK_POLL_MS;
+      submit("AT+CLTS=1", At::PRIORITY_BACKGROUND, CMD_TIMEOUT_MS, 0, nullptr);
+      Logger::success("[GSM] SIM800L готов: звонки и SMS отслеживаются");
+    }
+  }
+
+  static void onProbeDone(int, At::Result result) {
+    if (state != State::PROBING) return;
+    if (result == At::RESULT_OK) {
+      Logger::info("[GSM] Модуль ответил на скорости " + String(BAUDS[baudIndex]));
+      // Скорость верная — сбой конфигурации не должен уводить на следующую
+      probesAtThisBaud = 0;
+      state = State::CONFIGURING;
+      for (int i = 0; i < CONFIG_CMD_COUNT; i++) {
+        submit(CONFIG_CMDS[i], At::PRIORITY_NORMAL, CMD_TIMEOUT_MS, 1, onConfigDone, i);
+      }
+      return;
+    }
+    // Модуль молчит (грузится, не подключён или другая скорость) — пробуем
+    // снова; после 2 проб на текущей скорости переключаемся на следующую
+    probesAtThisBaud++;
+    if (probesAtThisBaud >= 2) {
+      probesAtThisBaud = 0;
+      baudIndex = (baudIndex + 1) % BAUD_COUNT;
+      port->setBaud(BAUDS[baudIndex]);
+      tokenizer.reset();
+      Serial.printf("[GSM] Пробуем скорость %lu\n", (unsigned long)BAUDS[baudIndex]);
+    }
+    probe();
+  }
+
+  static void probe() {
+    state = State::PROBING;
+    submit("AT", At::PRIORITY_NORMAL, PROBE_RETRY_MS, 0, onProbeDone);
+  }
+
+  // +CSQ: <rssi>,<ber> — rssi 0..31, 99 = неизвестно
+  static void onSignalQuality(const At::Tokenizer& line) {
+    char value[8];
+    line.field(0).copyTo(value, sizeof(value));
+    health.signal = atoi(value);
   }
 
-  // Извлечение номера из URC вида: +CLIP: "+79991234567",145,...
-  // или +CMT: "+79991234567","","24/07/05,12:00:00+12"
-  static String extractQuotedNumber(const String& line) {
-    int q1 = line.indexOf('"');
-    if (q1 < 0) return "";
-    int q2 = line.indexOf('"', q1 + 1);
-    if (q2 < 0) return "";
-    return line.substring(q1 + 1, q2);
+  // +CREG: <n>,<stat> — 1 дома, 5 роуминг, 2 поиск, 3 отказ, 0 не ищет
+  static void onRegistration(const At::Tokenizer& line) {
+    char value[8];
+    line.field(1).copyTo(value, sizeof(value));
+    health.registration = atoi(value);
   }
 
-  static void handleIncomingCall(const String& number) {
+  static void onHealthDone(int, At::Result result) {
+    if (state != State::READY) return;
+    if (result == At::RESULT_TIMEOUT) {
+      if (++healthMisses >= HEALTH_MAX_MISSES) {
+        Logger::warning("[GSM] SIM800L перестал отвечать — поиск модуля заново");
+        health.signal = -1;
+        health.registration = -1;
+        commands.clear();
+        probe();
+      }
+      return;
+    }
+    healthMisses = 0;
+    health.polledAt = millis();
+  }
+
+  // +CCLK: "24/05/17,14:03:22+12" — местное время модема и зона в четвертях часа.
+  // Опорная точка — момент прихода строки: задержка ответа — десятки мс
+  static void onClock(const At::Tokenizer& line) {
+    At::View value = line.field(0);
+    uint32_t utc;
+    if (!TimeSource::parseCclk(value.data, value.len, utc)) return;
+    bool wasSynced = TimeSource::synced();
+    if (TimeSource::sync(utc, TimeSource::ORIGIN_GSM, millis()) && !wasSynced) {
+      Logger::info("[GSM] Время получено от сети оператора");
+    }
+  }
+
+  static void pollClock() {
+    At::CommandQueue::Request request;
+    request.priority = At::PRIORITY_BACKGROUND;
+    request.timeoutMs = HEALTH_TIMEOUT_MS;
+    request.text = "AT+CCLK?";
+    request.infoKind = At::KIND_CCLK;
+    request.onInfo = onClock;
+    commands.submit(request, millis());
+  }
+
+  static void pollHealth() {
+    At::CommandQueue::Request request;
+    request.priority = At::PRIORITY_BACKGROUND;
+    request.timeoutMs = HEALTH_TIMEOUT_MS;
+    request.onDone = onHealthDone;
+
+    request.text = "AT+CSQ";
+    request.infoKind = At::KIND_CSQ;
+    request.onInfo = onSignalQuality;
+    commands.submit(request, millis());
+
+    request.text = "AT+CREG?";
+    request.infoKind = At::KIND_CREG;
+    request.onInfo = onRegistration;
+    commands.submit(request, millis());
+  }
+
+  // String для колбэков собирается только здесь — на реальный звонок/SMS,
+  // а не на каждую строку от модуля
+  static void handleIncomingCall(At::View numberView) {
     // Повторный +CLIP того же звонка — игнорируем
-    if (number == lastCallNumber && millis() - lastCallHandledAt < CALL_DEDUP_MS) {
+    if (numberView.equals(lastCallNumber) && millis() - lastCallHandledAt < CALL_DEDUP_MS) {
       return;
     }
-    lastCallNumber = number;
+    numberView.copyTo(lastCallNumber, sizeof(lastCallNumber));
+    String number = lastCallNumber;
     lastCallHandledAt = millis();
+    Metrics::inc(Metrics::GSM_CALLS);
 
     // Линию освобождаем в любом случае (не отвечаем — звонок бесплатный для звонящего)
-    sendCmd("ATH");
+    hangUp();
 
-    if (trustedCheckFn && trustedCheckFn(number, true)) {
+    uint8_t gates = trustedCheckFn ? trustedCheckFn(number, true) : 0;
+    if (gates) {
       Logger::success("[GSM] Звонок с доверенного номера: " + number);
-      if (gateOpenFn) gateOpenFn("звонок " + number);
+      if (gateOpenFn) gateOpenFn("звонок " + number, gates);
     } else {
       Logger::warning("[GSM] Звонок с неизвестного номера (сброшен): " + number);
     }
   }
 
-  static void handleIncomingSms(const String& sender, const String& text) {
-    if (trustedCheckFn && trustedCheckFn(sender, false)) {
+  static void handleIncomingSms(const char* senderNumber, At::View textView) {
+    Metrics::inc(Metrics::GSM_SMS);
+    String sender = senderNumber;
+    String text;
+    text.concat(textView.data, textView.len);
+    uint8_t gates = trustedCheckFn ? trustedCheckFn(sender, false) : 0;
+    if (gates) {
       Logger::success("[GSM] SMS с доверенного номера " + sender + ": " + text);
-      if (gateOpenFn) gateOpenFn("SMS " + sender);
+      if (gateOpenFn) gateOpenFn("SMS " + sender, gates);
     } else {
       Logger::warning("[GSM] SMS с неизвестного номера " + sender + ": " + text);
     }
@@ -103,19 +279,10 @@ namespace GSMManager {
   static unsigned long junkWindowStart = 0;
   static uint32_t junkLineCount = 0;
 
-  static bool isMostlyPrintable(const String& line) {
-    int printable = 0;
-    for (unsigned int i = 0; i < line.length(); i++) {
-      char c = line[i];
-      if (c >= 32 && c < 127) printable++;
-    }
-    return printable * 10 >= (int)line.length() * 7; // >= 70% печатаемых
-  }
+  static void processLine() {
+    At::View line = tokenizer.line();
 
-  static void processLine(const String& line) {
-    if (line.length() == 0) return;
-
-    if (!isMostlyPrintable(line)) {
+    if (tokenizer.kind() == At::KIND_JUNK) {
       junkLineCount++;
       if (millis() - junkWindowStart > 5000) {
         Serial.printf("[GSM] Шум на линии: %u строк за 5с (проверьте провод TXD-GPIO16 и землю)\n",
@@ -126,7 +293,7 @@ namespace GSMManager {
       return;
     }
 
-    Serial.println("[GSM] << " + line);
+    Serial.printf("[GSM] << %.*s\n", (int)line.len, line.data);
 
     // Тело SMS — строка, следующая за "+CMT:". Триггерим по факту SMS с
     // доверенного номера, содержимое не проверяем; многострочные SMS дают
@@ -137,120 +304,96 @@ namespace GSMManager {
       return;
     }
 
-    // Ответ "OK" двигает state machine конфигурации
-    if (line == "OK") {
-      if (state == State::PROBING) {
-        Logger::info("[GSM] Модуль ответил на скорости " + String(BAUDS[baudIndex]));
-        state = State::CONFIGURING;
-        configCmdIndex = 0;
-        sendCmd(CONFIG_CMDS[configCmdIndex]);
-      } else if (state == State::CONFIGURING) {
-        configCmdIndex++;
-        if (configCmdIndex >= CONFIG_CMD_COUNT) {
-          state = State::READY;
-          Logger::success("[GSM] SIM800L готов: звонки и SMS отслеживаются");
-        } else {
-          sendCmd(CONFIG_CMDS[configCmdIndex]);
-        }
-      }
+    // Ответ на команду в работе (OK/ERROR, +CSQ:, +CREG:); URC очередь не забирает
+    if (commands.consume(tokenizer, millis())) {
       return;
     }
 
-    if (line == "RING") {
-      // Ждём +CLIP с номером (приходит следом); если не придёт — сброс по таймауту
-      if (!ringPending) {
-        ringPending = true;
-        firstRingAt = millis();
-      }
-      return;
-    }
+    switch (tokenizer.kind()) {
+      case At::KIND_RING:
+        // Ждём +CLIP с номером (приходит следом); если не придёт — сброс по таймауту
+        if (!ringPending) {
+          ringPending = true;
+          firstRingAt = millis();
+        }
+        break;
 
-    if (line.startsWith("+CLIP:")) {
-      ringPending = false;
-      String number = extractQuotedNumber(line);
-      if (number.length() > 0) {
-        handleIncomingCall(number);
-      }
-      return;
-    }
+      case At::KIND_CLIP:
+        // +CLIP: "+79991234567",145,...
+        ringPending = false;
+        if (!tokenizer.field(0).empty()) {
+          handleIncomingCall(tokenizer.field(0));
+        }
+        break;
 
-    if (line.startsWith("+CMT:")) {
-      smsSender = extractQuotedNumber(line);
-      awaitingSmsBody = smsSender.length() > 0;
-      return;
-    }
+      case At::KIND_CMT:
+        // +CMT: "+79991234567","","24/07/05,12:00:00+12"
+        tokenizer.field(0).copyTo(smsSender, sizeof(smsSender));
+        awaitingSmsBody = smsSender[0] != '\0';
+        break;
 
-    // RING, Call Ready, SMS Ready, эхо команд и прочие URC — не интересны
+      default:
+        // Call Ready, SMS Ready, эхо команд и прочие URC — не интересны
+        break;
+    }
   }
 
+#ifdef ARDUINO
   void init(int rxPin, int txPin, TrustedCheckFn trustedCheck, GateOpenFn gateOpen) {
+    uartPort.setPins(rxPin, txPin);
+    Logger::info("[GSM] Поиск SIM800L на UART2 (RX=" + String(rxPin) + ", TX=" + String(txPin) + ")...");
+    init(&uartPort, trustedCheck, gateOpen);
+  }
+#endif
+
+  void init(GsmPort* gsmPort, TrustedCheckFn trustedCheck, GateOpenFn gateOpen) {
+    port = gsmPort;
     trustedCheckFn = trustedCheck;
     gateOpenFn = gateOpen;
 
-    gsmSerial.begin(BAUDS[baudIndex], SERIAL_8N1, rxPin, txPin);
-
-    state = State::PROBING;
-    sendCmd("AT");
-    Logger::info("[GSM] Поиск SIM800L на UART2 (RX=" + String(rxPin) + ", TX=" + String(txPin) + ")...");
+    port->begin(BAUDS[baudIndex]);
+    commands.attach(port);
+    probe();
   }
 
   void handleGSM() {
+    if (!port) return;
     // Чтение доступных байт без блокировки
-    while (gsmSerial.available()) {
-      char c = (char)gsmSerial.read();
-      if (c == '\n') {
-        lineBuf.trim();
-        processLine(lineBuf);
-        lineBuf = "";
-      } else if (c != '\r') {
-        lineBuf += c;
-        // Защита от мусора при отсутствии \n (наводки на висящем RX)
-        if (lineBuf.length() > 256) {
-          lineBuf = "";
-        }
+    // Строка длиннее буфера (наводки на висящем RX без \n) — KIND_JUNK
+    while (port->available()) {
+      if (tokenizer.feed((char)port->read())) {
+        processLine();
       }
     }
 
-    // Таймауты state machine
-    unsigned long now = millis();
-    switch (state) {
-      case State::PROBING:
-        // Модуль молчит (грузится, не подключён или другая скорость) — пробуем
-        // снова; после 2 проб на текущей скорости переключаемся на следующую
-        if (now - lastCmdSentAt > PROBE_RETRY_MS) {
-          probesAtThisBaud++;
-          if (probesAtThisBaud >= 2) {
-            probesAtThisBaud = 0;
-            baudIndex = (baudIndex + 1) % BAUD_COUNT;
-            gsmSerial.updateBaudRate(BAUDS[baudIndex]);
-            lineBuf = "";
-            Serial.printf("[GSM] Пробуем скорость %lu\n", (unsigned long)BAUDS[baudIndex]);
-          }
-          sendCmd("AT");
-        }
-        break;
-      case State::CONFIGURING:
-        // Команда без ответа — начинаем заново с пробы
-        if (now - lastCmdSentAt > CMD_TIMEOUT_MS) {
-          Logger::warning("[GSM] SIM800L не ответил на конфигурацию, повтор...");
-          state = State::PROBING;
-          lastCmdSentAt = now - PROBE_RETRY_MS; // немедленная повторная проба
-        }
-        break;
-      case State::READY:
-        // Звонок без определившегося номера — сбрасываем по таймауту
-        if (ringPending && now - firstRingAt > RING_NO_CLIP_TIMEOUT_MS) {
-          ringPending = false;
-          sendCmd("ATH");
-          Logger::warning("[GSM] Звонок без определения номера — сброшен");
-        }
-        break;
-      default:
-        break;
+    // Таймауты и повторы команд; переходы state machine — в колбэках onDone
+    commands.poll(millis());
+
+    if (state == State::READY) {
+      unsigned long now = millis();
+      // Звонок без определившегося номера — сбрасываем по таймауту
+      if (ringPending && now - firstRingAt > RING_NO_CLIP_TIMEOUT_MS) {
+        ringPending = false;
+        hangUp();
+        Logger::warning("[GSM] Звонок без определения номера — сброшен");
+      }
+      // Опрос — только когда очередь пуста и звонка нет
+      if (!ringPending && commands.idle() && now - lastHealthPollAt > HEALTH_POLL_MS) {
+        lastHealthPollAt = now;
+        pollHealth();
+      }
+      if (!ringPending && commands.idle() && now - lastClockPollAt > CLOCK_POLL_MS) {
+        lastClockPollAt = now;
+        pollClock();
+      }
     }
   }
 
   bool isReady() {
     return state == State::READY;
   }
+
+  Health getHealth() {
+    return health;
+  }
 }
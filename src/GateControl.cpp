@@ -3,39 +3,20 @@
 #include "infrastructure/Logger.h"
 
 namespace GateControl {
-  static int openPin = -1;
-  static int closePin = -1;
-
-  // Фазы цикла: открытие (канал 1) → открыто (оба выкл) → закрытие (канал 2).
-  // Пошаговая логика команд: движение → STOPPED → движение в обратную сторону.
-  // REVERSE_PAUSE — защитная пауза перед сменой направления:
-  // мгновенный реверс мотора без мёртвого времени даёт бросок тока.
-  enum class Phase { IDLE, OPENING, WAITING, CLOSING, STOPPED, REVERSE_PAUSE };
-  static Phase phase = Phase::IDLE;
-  static Phase nextDir = Phase::OPENING; // Куда ехать после STOPPED/REVERSE_PAUSE
-
-  static unsigned long phaseStart = 0;     // Начало текущей фазы (millis)
-  static unsigned long openDuration = 0;   // Время полного хода на открытие, мс
-  static unsigned long stayDuration = 0;   // Пауза «открыто», мс
-  static unsigned long closeDuration = 0;  // Время полного хода на закрытие, мс
-
-  // Позиция створки по времени хода: 0.0 = закрыто, 1.0 = открыто.
-  // Фаза движения длится остаток пути, а не полный тайминг: приоткрыли на 60% —
-  // закрытие займёт 60% времени закрытия (и симметрично для недозакрытых).
-  static float position = 0.0f;
-  static float phaseStartPos = 0.0f;       // Позиция на входе в фазу движения
-  static unsigned long phaseDuration = 0;  // Длительность текущей фазы движения, мс
-
   static const unsigned long REVERSE_PAUSE_MS = 500;
 
+  String Gate::logPrefix() const {
+    return "[Ворота " + String(gateId + 1) + "] ";
+  }
+
   // Interlock: любой активный канал включается только при выключенном втором
-  static void setChannels(bool open, bool close) {
+  void Gate::setChannels(bool open, bool close) {
     if (open && close) return; // одновременно — никогда
     digitalWrite(openPin, open ? HIGH : LOW);
     digitalWrite(closePin, close ? HIGH : LOW);
   }
 
-  static void enterPhase(Phase next) {
+  void Gate::enterPhase(Phase next) {
     phase = next;
     phaseStart = millis();
     switch (next) {
@@ -43,22 +24,22 @@ namespace GateControl {
         phaseStartPos = position;
         phaseDuration = (unsigned long)((1.0f - position) * (float)openDuration);
         setChannels(true, false);
-        Logger::success("[Ворота] Открытие (" + String(phaseDuration / 1000.0f, 1) + " с)");
+        Logger::success(logPrefix() + "Открытие (" + String(phaseDuration / 1000.0f, 1) + " с)");
         break;
       case Phase::WAITING:
         position = 1.0f;
         setChannels(false, false);
-        Logger::info("[Ворота] Открыто, автозакрытие через " + String(stayDuration / 1000) + " с");
+        Logger::info(logPrefix() + "Открыто, автозакрытие через " + String(stayDuration / 1000) + " с");
         break;
       case Phase::CLOSING:
         phaseStartPos = position;
         phaseDuration = (unsigned long)(position * (float)closeDuration);
         setChannels(false, true);
-        Logger::info("[Ворота] Закрытие (" + String(phaseDuration / 1000.0f, 1) + " с)");
+        Logger::info(logPrefix() + "Закрытие (" + String(phaseDuration / 1000.0f, 1) + " с)");
         break;
       case Phase::STOPPED:
         setChannels(false, false);
-        Logger::warning("[Ворота] Остановлено, следующая команда — " +
+        Logger::warning(logPrefix() + "Остановлено, следующая команда — " +
                         String(nextDir == Phase::CLOSING ? "закрытие" : "открытие"));
         break;
       case Phase::REVERSE_PAUSE:
@@ -67,13 +48,13 @@ namespace GateControl {
       case Phase::IDLE:
         position = 0.0f;
         setChannels(false, false);
-        Logger::info("[Ворота] Цикл завершен");
+        Logger::info(logPrefix() + "Цикл завершен");
         break;
     }
   }
 
   // Зафиксировать позицию створки в момент остановки движения
-  static void freezePosition() {
+  void Gate::freezePosition() {
     unsigned long elapsed = millis() - phaseStart;
     if (phase == Phase::OPENING && openDuration > 0) {
       position = phaseStartPos + (float)elapsed / (float)openDuration;
@@ -84,19 +65,21 @@ namespace GateControl {
     }
   }
 
-  void init(int _openPin, int _closePin) {
+  void Gate::begin(uint8_t id, int _openPin, int _closePin) {
+    gateId = id;
     openPin = _openPin;
     closePin = _closePin;
     pinMode(openPin, OUTPUT);
     pinMode(closePin, OUTPUT);
     setChannels(false, false);
     phase = Phase::IDLE;
+    position = 0.0f;
 
-    Logger::success("Gate Control инициализирован (2 реле: открыть/закрыть)");
-    Logger::logf("info", "[GateControl] Открыть: GPIO%d, закрыть: GPIO%d", openPin, closePin);
+    Logger::logf("info", "[GateControl] Ворота %d: открыть GPIO%d, закрыть GPIO%d",
+                 gateId + 1, openPin, closePin);
   }
 
-  void startCycle(unsigned long openMs, unsigned long stayMs, unsigned long closeMs) {
+  void Gate::startCycle(unsigned long openMs, unsigned long stayMs, unsigned long closeMs) {
     openDuration = openMs;
     stayDuration = stayMs;
     closeDuration = closeMs;
@@ -127,16 +110,16 @@ namespace GateControl {
         break;
       case Phase::REVERSE_PAUSE:
         // Переходные 500 мс — глотаем дребезг повторных нажатий
-        Logger::info("[Ворота] Переходная пауза, сигнал пропущен");
+        Logger::info(logPrefix() + "Переходная пауза, сигнал пропущен");
         break;
     }
   }
 
-  void update() {
-    if (phase == Phase::IDLE) return;
+  void Gate::update(unsigned long now) {
+    if (phase == Phase::IDLE || phase == Phase::STOPPED) return; // ждут только команды
 
     // Сравнение через беззнаковое вычитание корректно переживает переполнение millis()
-    unsigned long elapsed = millis() - phaseStart;
+    unsigned long elapsed = now - phaseStart;
 
     switch (phase) {
       case Phase::OPENING:
@@ -151,17 +134,17 @@ namespace GateControl {
       case Phase::REVERSE_PAUSE:
         if (elapsed >= REVERSE_PAUSE_MS) enterPhase(nextDir);
         break;
-      case Phase::STOPPED: // Стоим, пока не придёт следующая команда
+      case Phase::STOPPED:
       case Phase::IDLE:
         break;
     }
   }
 
-  bool isCycleActive() {
+  bool Gate::isCycleActive() const {
     return phase != Phase::IDLE;
   }
 
-  const char* phaseName() {
+  const char* Gate::phaseName() const {
     switch (phase) {
       case Phase::OPENING: return "opening";
       case Phase::WAITING: return "open";
@@ -174,11 +157,11 @@ namespace GateControl {
     return "closed";
   }
 
-  const char* nextDirName() {
+  const char* Gate::nextDirName() const {
     return nextDir == Phase::CLOSING ? "close" : "open";
   }
 
-  float positionNow() {
+  float Gate::positionNow() const {
     if (phase == Phase::OPENING && openDuration > 0) {
       float p = phaseStartPos + (float)(millis() - phaseStart) / (float)openDuration;
       return p > 1.0f ? 1.0f : p;
@@ -0,0 +1,56 @@
+#include <Arduino.h>
+#include "HttpStream.h"
+
+void ChunkedWriter::begin(int code, const char* contentType) {
+  if (started) return;
+  started = true;
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(code, contentType, "");
+}
+
+void ChunkedWriter::flush() {
+  if (len == 0) return;
+  server.sendContent(buf, len);
+  total += len;
+  len = 0;
+}
+
+size_t ChunkedWriter::write(uint8_t c) {
+  if (!started || finished) return 0;
+  if (len >= BUF_SIZE) flush();
+  buf[len++] = (char)c;
+  return 1;
+}
+
+size_t ChunkedWriter::write(const uint8_t* data, size_t n) {
+  if (!started || finished) return 0;
+  size_t done = 0;
+  while (done < n) {
+    if (len >= BUF_SIZE) flush();
+    size_t chunk = min(BUF_SIZE - len, n - done);
+    memcpy(buf + len, data + done, chunk);
+    len += chunk;
+    done += chunk;
+  }
+  return n;
+}
+
+void ChunkedWriter::end() {
+  if (!started || finished) return;
+  flush();
+  // Пустой чанк — конец тела для chunked transfer encoding
+  server.sendContent("");
+  finished = true;
+}
+
+void JsonArrayStream::begin(int code) {
+  out.begin(code, "application/json");
+  out.write('[');
+}
+
+void JsonArrayStream::end() {
+  if (closed) return;
+  closed = true;
+  out.write(']');
+  out.end();
+}
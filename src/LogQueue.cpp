@@ -0,0 +1,171 @@
+#include "LogQueue.h"
+#include "WsBus.h"
+#include "Metrics.h"
+#include "MpmcRing.h"
+#include <atomic>
+#include <stdarg.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace LogQueue {
+  static const uint32_t CAPACITY = 64;          // степень двойки
+  static const uint32_t DRAIN_TASK_STACK = 4096;
+  static const TickType_t DRAIN_IDLE_TICKS = pdMS_TO_TICKS(10);
+
+  struct Record {
+    uint32_t timestamp;
+    Level level;
+    uint8_t sinks;
+    char text[MSG_LEN];
+  };
+
+  static MpmcRing<Record, CAPACITY> queue;
+  static std::atomic<uint32_t> droppedCount(0);
+  static volatile bool ready = false;
+
+  static FileSink fileSink = nullptr;
+  static TaskHandle_t drainHandle = nullptr;
+
+  void init() {
+    queue.reset();
+    ready = true;
+  }
+
+  // Захват ячейки под запись: nullptr — очередь полна (потеря учитывается)
+  static Record* claim(uint32_t& pos) {
+    if (!ready) return nullptr;
+    Record* record = queue.claim(pos);
+    if (!record) droppedCount.fetch_add(1, std::memory_order_relaxed);
+    return record;
+  }
+
+  // Обрезанная строка не должна кончаться половиной символа UTF-8 —
+  // иначе в JSON уйдёт битая последовательность. len — полная длина исходной.
+  static void trimUtf8(char* text, size_t len) {
+    if (len < MSG_LEN) return; // поместилась целиком
+    size_t end = MSG_LEN - 1;  // позиция завершающего нуля
+    size_t i = end;
+    while (i > 0 && ((uint8_t)text[i - 1] & 0xC0) == 0x80) i--;
+    if (i == 0) return;
+    uint8_t lead = (uint8_t)text[i - 1];
+    size_t need = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    if (end - (i - 1) < need) text[i - 1] = '\0';
+  }
+
+  void post(Level level, uint8_t sinks, const char* message) {
+    uint32_t pos;
+    Record* record = claim(pos);
+    if (!record) return;
+    Record& r = *record;
+    r.timestamp = millis();
+    r.level = level;
+    r.sinks = sinks;
+    size_t len = strlcpy(r.text, message, MSG_LEN);
+    trimUtf8(r.text, len);
+    queue.commit(pos);
+  }
+
+  void postf(Level level, uint8_t sinks, const char* format, ...) {
+    uint32_t pos;
+    Record* record = claim(pos);
+    if (!record) return;
+    Record& r = *record;
+    r.timestamp = millis();
+    r.level = level;
+    r.sinks = sinks;
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(r.text, MSG_LEN, format, args);
+    va_end(args);
+    trimUtf8(r.text, len < 0 ? 0 : (size_t)len);
+    queue.commit(pos);
+  }
+
+  // Экранирование для JSON в фиксированный буфер (только задача вывода)
+  static size_t escapeJson(const char* in, char* out, size_t outSize) {
+    size_t o = 0;
+    for (; *in && o + 7 < outSize; in++) {
+      char c = *in;
+      switch (c) {
+        case '"':  out[o++] = '\\'; out[o++] = '"'; break;
+        case '\\': out[o++] = '\\'; out[o++] = '\\'; break;
+        case '\n': out[o++] = '\\'; out[o++] = 'n'; break;
+        case '\r': out[o++] = '\\'; out[o++] = 'r'; break;
+        case '\t': out[o++] = '\\'; out[o++] = 't'; break;
+        default:
+          if ((uint8_t)c < 0x20) {
+            o += snprintf(out + o, outSize - o, "\\u%04x", (uint8_t)c);
+          } else {
+            out[o++] = c;
+          }
+      }
+    }
+    out[o] = '\0';
+    return o;
+  }
+
+  static void emit(const Record& r) {
+    static char escaped[MSG_LEN * 2 + 8];
+    static char json[MSG_LEN * 2 + 48];
+
+    const char* text = r.text;
+
+    if (r.sinks & SINK_SERIAL) {
+      Serial.printf("[%s] %s\n", levelName(r.level), text);
+    }
+    if ((r.sinks & SINK_WS) && WsBus::hasSubscribers(WsBus::TOPIC_LOG)) {
+      escapeJson(text, escaped, sizeof(escaped));
+      snprintf(json, sizeof(json), "{\"message\":\"%s\",\"type\":\"%s\"}", escaped, levelName(r.level));
+      WsBus::publish("log", json);
+    }
+    if ((r.sinks & SINK_FILE) && fileSink) {
+      fileSink(text);
+    }
+  }
+
+  static void drainTask(void*) {
+    Record record;
+    uint32_t reportedDrops = 0;
+    for (;;) {
+      while (queue.pop(record)) emit(record);
+
+      uint32_t drops = droppedCount.load(std::memory_order_relaxed);
+      if (drops != reportedDrops) {
+        Serial.printf("[warning] Очередь лога переполнена: потеряно записей %u\n",
+                      (unsigned)(drops - reportedDrops));
+        reportedDrops = drops;
+      }
+      vTaskDelay(DRAIN_IDLE_TICKS);
+    }
+  }
+
+  void start(FileSink sink) {
+    fileSink = sink;
+    if (drainHandle) return;
+    // Минимальный рабочий приоритет на ядре 0: ядро 1 остаётся радио,
+    // а WiFi-стек и httpTask логами не вытесняются
+    xTaskCreatePinnedToCore(drainTask, "log", DRAIN_TASK_STACK, nullptr, 1, &drainHandle, 0);
+    Metrics::registerTask("log", drainHandle);
+  }
+
+  Level levelFromName(const char* type) {
+    if (!type) return LEVEL_INFO;
+    if (strcmp(type, "success") == 0) return LEVEL_SUCCESS;
+    if (strcmp(type, "warning") == 0) return LEVEL_WARNING;
+    if (strcmp(type, "error") == 0) return LEVEL_ERROR;
+    return LEVEL_INFO;
+  }
+
+  const char* levelName(Level level) {
+    switch (level) {
+      case LEVEL_SUCCESS: return "success";
+      case LEVEL_WARNING: return "warning";
+      case LEVEL_ERROR:   return "error";
+      default:            return "info";
+    }
+  }
+
+  uint32_t dropped() {
+    return droppedCount.load(std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,182 @@
+#include "Metrics.h"
+
+namespace Metrics {
+  static const int MAX_HTTP_HANDLERS = 48;
+  static const int MAX_TASKS = 8;
+  static const int MAX_WRITERS = 4;
+
+  struct MetricInfo {
+    const char* name;
+    const char* help;
+  };
+
+  static const MetricInfo HISTOGRAM_INFO[HIST_COUNT] = {
+    {"gate_loop_duration_seconds", "Длительность итерации loop()"},
+    {"gate_state_save_duration_seconds", "Длительность saveSystemState()"},
+    {"gate_rf_decode_duration_seconds", "Декодирование буфера импульсов"},
+    {"gate_rf_press_to_relay_seconds", "От конца пакета брелока до включения реле"}
+  };
+
+  // Имена без суффикса _total — он добавляется к отсчёту
+  static const MetricInfo COUNTER_INFO[COUNTER_COUNT] = {
+    {"gate_rf_buffers", "Буферов импульсов отдано декодерам"},
+    {"gate_rf_weak", "Буферов отброшено по RSSI"},
+    {"gate_rf_decoded", "Пакетов с распознанным протоколом"},
+    {"gate_rf_gate_opens", "Открытий ворот брелоком"},
+    {"gate_rf_key_disabled", "Нажатий отключённых ключей"},
+    {"gate_rf_out_of_schedule", "Нажатий ключей вне их расписания"},
+    {"gate_rf_unknown_key", "Распознанных ключей не из базы"},
+    {"gate_rf_duplicates", "Повторов пакета одного нажатия"},
+    {"gate_gsm_calls", "Входящих звонков"},
+    {"gate_gsm_sms", "Входящих SMS"},
+    {"gate_gsm_gate_opens", "Открытий ворот по звонку/SMS"},
+    {"gate_gsm_rejected", "Звонков/SMS с номеров не из белого списка"},
+    {"gate_gsm_out_of_schedule", "Звонков/SMS с номеров вне их расписания"}
+  };
+
+  static Histogram histograms[HIST_COUNT];
+  static std::atomic<uint32_t> counters[COUNTER_COUNT];
+
+  // Пул гистограмм HTTP — заполняется в setup() до запуска задачи HTTP
+  static Histogram httpHistograms[MAX_HTTP_HANDLERS];
+  static const char* httpPaths[MAX_HTTP_HANDLERS];
+  static int httpCount = 0;
+
+  struct TaskEntry {
+    const char* name;
+    TaskHandle_t handle;
+  };
+  static TaskEntry tasks[MAX_TASKS];
+  static int taskCount = 0;
+
+  static Writer writers[MAX_WRITERS];
+  static int writerCount = 0;
+
+  void Histogram::observe(uint32_t us) {
+    // Корзина i — значения до 2^i мкс включительно
+    int index = us <= 1 ? 0 : 32 - __builtin_clz(us - 1);
+    if (index > BUCKETS) index = BUCKETS;
+    buckets[index].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    uint32_t before = sumLow.fetch_add(us, std::memory_order_relaxed);
+    if (before + us < before) sumHigh.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static void writeLabels(Print& out, const char* labels, const char* le) {
+    if (!labels && !le) return;
+    out.print('{');
+    if (labels) out.print(labels);
+    if (labels && le) out.print(',');
+    if (le) {
+      out.print("le=\"");
+      out.print(le);
+      out.print('"');
+    }
+    out.print('}');
+  }
+
+  void Histogram::write(Print& out, const char* name, const char* labels) const {
+    char value[24];
+    uint32_t cumulative = 0;
+    for (int i = 0; i <= BUCKETS; i++) {
+      cumulative += buckets[i].load(std::memory_order_relaxed);
+      if (i < BUCKETS) {
+        snprintf(value, sizeof(value), "%.6f", (double)(1UL << i) / 1e6);
+      } else {
+        strlcpy(value, "+Inf", sizeof(value));
+      }
+      out.print(name);
+      out.print("_bucket");
+      writeLabels(out, labels, value);
+      out.printf(" %u\n", (unsigned)cumulative);
+    }
+    out.print(name);
+    out.print("_count");
+    writeLabels(out, labels, nullptr);
+    out.printf(" %u\n", (unsigned)cumulative);
+
+    uint64_t sum = ((uint64_t)sumHigh.load(std::memory_order_relaxed) << 32) |
+                   sumLow.load(std::memory_order_relaxed);
+    out.print(name);
+    out.print("_sum");
+    writeLabels(out, labels, nullptr);
+    out.printf(" %.6f\n", (double)sum / 1e6);
+  }
+
+  void observe(HistogramId id, uint32_t us) {
+    if (id < HIST_COUNT) histograms[id].observe(us);
+  }
+
+  void inc(CounterId id) {
+    if (id < COUNTER_COUNT) counters[id].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Histogram* httpHistogram(const char* path) {
+    for (int i = 0; i < httpCount; i++) {
+      if (strcmp(httpPaths[i], path) == 0) return &httpHistograms[i];
+    }
+    if (httpCount >= MAX_HTTP_HANDLERS) return nullptr;
+    httpPaths[httpCount] = path;
+    return &httpHistograms[httpCount++];
+  }
+
+  void registerTask(const char* name, TaskHandle_t handle) {
+    if (!handle || taskCount >= MAX_TASKS) return;
+    tasks[taskCount++] = {name, handle};
+  }
+
+  void registerWriter(Writer writer) {
+    if (!writer || writerCount >= MAX_WRITERS) return;
+    writers[writerCount++] = writer;
+  }
+
+  static void writeHeader(Print& out, const char* name, const char* type, const char* help, const char* unit) {
+    out.printf("# TYPE %s %s\n", name, type);
+    if (unit) out.printf("# UNIT %s %s\n", name, unit);
+    out.printf("# HELP %s %s\n", name, help);
+  }
+
+  static void writeGauge(Print& out, const char* name, const char* help, const char* unit, uint32_t value) {
+    writeHeader(out, name, "gauge", help, unit);
+    out.printf("%s %u\n", name, (unsigned)value);
+  }
+
+  void write(Print& out) {
+    for (int i = 0; i < HIST_COUNT; i++) {
+      writeHeader(out, HISTOGRAM_INFO[i].name, "histogram", HISTOGRAM_INFO[i].help, "seconds");
+      histograms[i].write(out, HISTOGRAM_INFO[i].name, nullptr);
+    }
+
+    // Обработчики без запросов не выводим — иначе десятки пустых гистограмм
+    const char* httpName = "gate_http_request_duration_seconds";
+    writeHeader(out, httpName, "histogram", "Длительность обработчика HTTP (с отправкой ответа)", "seconds");
+    char labels[96];
+    for (int i = 0; i < httpCount; i++) {
+      if (httpHistograms[i].count() == 0) continue;
+      snprintf(labels, sizeof(labels), "handler=\"%s\"", httpPaths[i]);
+      httpHistograms[i].write(out, httpName, labels);
+    }
+
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+      writeHeader(out, COUNTER_INFO[i].name, "counter", COUNTER_INFO[i].help, nullptr);
+      out.printf("%s_total %u\n", COUNTER_INFO[i].name, (unsigned)counters[i].load(std::memory_order_relaxed));
+    }
+
+    writeGauge(out, "gate_uptime_seconds", "Время с загрузки", "seconds", millis() / 1000);
+    writeGauge(out, "gate_heap_free_bytes", "Свободный heap", "bytes", ESP.getFreeHeap());
+    writeGauge(out, "gate_heap_min_free_bytes", "Минимум свободного heap с загрузки", "bytes", ESP.getMinFreeHeap());
+    writeGauge(out, "gate_heap_largest_free_block_bytes", "Наибольший свободный блок heap", "bytes", ESP.getMaxAllocHeap());
+
+    // В ESP-IDF high-water mark стека — в байтах
+    const char* stackName = "gate_task_stack_free_min_bytes";
+    writeHeader(out, stackName, "gauge", "Минимум свободного стека задачи с её запуска", "bytes");
+    for (int i = 0; i < taskCount; i++) {
+      out.printf("%s{task=\"%s\"} %u\n", stackName, tasks[i].name,
+                 (unsigned)uxTaskGetStackHighWaterMark(tasks[i].handle));
+    }
+
+    for (int i = 0; i < writerCount; i++) writers[i](out);
+
+    out.print("# EOF\n");
+  }
+}
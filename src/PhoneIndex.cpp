@@ -0,0 +1,73 @@
+#include "PhoneIndex.h"
+#include <algorithm>
+#include <vector>
+
+namespace PhoneIndex {
+  // Запись: (ключ << 10) | (расписание << 6) | (ворота << 2) | каналы;
+  // ключ = (число цифр << 40) | значение цифр. 10 цифр < 2^34, число цифр ≤ 10 —
+  // ключ укладывается в 44 бита, запись — в 54
+  static const int CHANNEL_BITS = 2;
+  static const int SCHEDULE_SHIFT = CHANNEL_BITS + GATE_BITS;
+  static const int PAYLOAD_BITS = SCHEDULE_SHIFT + SCHEDULE_BITS;
+  static const int MATCH_DIGITS = 10;
+
+  static std::vector<uint64_t> entries;
+
+  uint64_t keyOf(const char* number) {
+    if (!number) return 0;
+    // Последние 10 цифр: значение по модулю 10^10 отбрасывает старшие
+    const uint64_t modulo = 10000000000ULL;
+    uint64_t value = 0;
+    int count = 0;
+    for (const char* p = number; *p; p++) {
+      if (*p < '0' || *p > '9') continue;
+      value = (value * 10 + (uint64_t)(*p - '0')) % modulo;
+      if (count < MATCH_DIGITS) count++;
+    }
+    if (count == 0) return 0;
+    return ((uint64_t)count << 40) | value;
+  }
+
+  static uint64_t keyOfEntry(uint64_t entry) {
+    return entry >> PAYLOAD_BITS;
+  }
+
+  void begin(size_t expected) {
+    entries.clear();
+    entries.reserve(expected);
+  }
+
+  void add(const char* number, uint8_t channels, uint8_t gates, uint8_t schedule) {
+    uint64_t key = keyOf(number);
+    if (key == 0) return;  // номер без цифр ни с чем не совпадает
+    entries.push_back((key << PAYLOAD_BITS) |
+                      ((uint64_t)(schedule & ((1 << SCHEDULE_BITS) - 1)) << SCHEDULE_SHIFT) |
+                      ((uint64_t)(gates & ((1 << GATE_BITS) - 1)) << CHANNEL_BITS) |
+                      (channels & ((1 << CHANNEL_BITS) - 1)));
+  }
+
+  void commit() {
+    // stable_sort + unique: из одинаковых номеров остаётся первый по списку
+    std::stable_sort(entries.begin(), entries.end(), [](uint64_t a, uint64_t b) {
+      return keyOfEntry(a) < keyOfEntry(b);
+    });
+    entries.erase(std::unique(entries.begin(), entries.end(), [](uint64_t a, uint64_t b) {
+      return keyOfEntry(a) == keyOfEntry(b);
+    }), entries.end());
+    entries.shrink_to_fit();
+  }
+
+  int lookup(const char* number, uint8_t* gates, uint8_t* schedule) {
+    uint64_t key = keyOf(number);
+    if (key == 0) return -1;
+    auto it = std::lower_bound(entries.begin(), entries.end(), key << PAYLOAD_BITS);
+    if (it == entries.end() || keyOfEntry(*it) != key) return -1;
+    if (gates) *gates = (uint8_t)((*it >> CHANNEL_BITS) & ((1 << GATE_BITS) - 1));
+    if (schedule) *schedule = (uint8_t)((*it >> SCHEDULE_SHIFT) & ((1 << SCHEDULE_BITS) - 1));
+    return (int)(*it & ((1 << CHANNEL_BITS) - 1));
+  }
+
+  size_t size() {
+    return entries.size();
+  }
+}
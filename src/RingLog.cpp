@@ -0,0 +1,191 @@
+#include "RingLog.h"
+#include "Sync.h"
+#include <SPIFFS.h>
+
+namespace RingLog {
+  static const char* LOG_FILE = "/log.bin";
+  static const char* LEGACY_LOG_FILE = "/log.txt";
+  static const uint32_t MAGIC = 0x52474C31; // "RGL1"
+
+  // Заголовок — в начале первой (служебной) страницы файла
+  struct Header {
+    uint32_t magic;
+    uint16_t pageSize;
+    uint16_t pageCount;
+    uint32_t head;
+    uint32_t tail;
+  };
+
+  static File file;  // открыт всё время работы, доступ — под mutex
+  static SemaphoreHandle_t mutex = nullptr;
+  static Header header = {MAGIC, PAGE_SIZE, PAGE_COUNT, 0, 0};
+  static bool ready = false;
+
+  // Физическое смещение в файле для логического
+  static uint32_t physical(uint32_t offset) {
+    return PAGE_SIZE + offset % CAPACITY;
+  }
+
+  static void writeAt(uint32_t position, const uint8_t* data, size_t len) {
+    file.seek(position);
+    file.write(data, len);
+  }
+
+  static void writeHeader() {
+    writeAt(0, (const uint8_t*)&header, sizeof(header));
+  }
+
+  static bool headerValid(const Header& h) {
+    return h.magic == MAGIC && h.pageSize == PAGE_SIZE && h.pageCount == PAGE_COUNT &&
+           h.head >= h.tail && h.head - h.tail <= CAPACITY && h.tail % PAGE_SIZE == 0;
+  }
+
+  // Новый файл полного размера: дальше он только перезаписывается на месте
+  static bool create() {
+    File f = SPIFFS.open(LOG_FILE, "w");
+    if (!f) return false;
+    header = {MAGIC, PAGE_SIZE, PAGE_COUNT, 0, 0};
+    uint8_t page[PAGE_SIZE] = {0};
+    memcpy(page, &header, sizeof(header));
+    f.write(page, PAGE_SIZE);
+    memset(page, 0, sizeof(header));
+    for (size_t i = 0; i < PAGE_COUNT; i++) f.write(page, PAGE_SIZE);
+    f.close();
+    return true;
+  }
+
+  void init() {
+    if (!mutex) mutex = xSemaphoreCreateRecursiveMutex();
+    Sync::Lock lock(mutex);
+    if (SPIFFS.exists(LEGACY_LOG_FILE)) SPIFFS.remove(LEGACY_LOG_FILE);
+
+    bool valid = false;
+    if (SPIFFS.exists(LOG_FILE)) {
+      file = SPIFFS.open(LOG_FILE, "r+");
+      Header h;
+      if (file && file.size() == PAGE_SIZE + CAPACITY &&
+          file.read((uint8_t*)&h, sizeof(h)) == sizeof(h) && headerValid(h)) {
+        header = h;
+        valid = true;
+      } else if (file) {
+        file.close();
+      }
+    }
+    if (!valid) {
+      if (!create()) {
+        Serial.println("[ERROR] RingLog: не удалось создать файл лога");
+        return;
+      }
+      file = SPIFFS.open(LOG_FILE, "r+");
+      if (!file) return;
+    }
+    ready = true;
+    Serial.printf("[OK] RingLog: %u байт в логе\n", (unsigned)(header.head - header.tail));
+  }
+
+  void append(const char* message) {
+    if (!ready) return;
+
+    // Строка лога с uptime; на страницу помещается целиком (с переводом строки)
+    char line[PAGE_SIZE];
+    unsigned long sec = millis() / 1000;
+    int len = snprintf(line, sizeof(line), "[%luh%02lum] %s", sec / 3600, (sec % 3600) / 60, message);
+    size_t n = len < 0 ? 0 : min((size_t)len, PAGE_SIZE - 1);
+    line[n++] = '\n';
+
+    Sync::Lock lock(mutex);
+    size_t room = PAGE_SIZE - header.head % PAGE_SIZE;
+    if (n > room) {
+      static const uint8_t zeros[PAGE_SIZE] = {0};
+      writeAt(physical(header.head), zeros, room);
+      header.head += room;
+    }
+    // Начинаем страницу, занятую прошлым кругом — сначала сдвигаем tail,
+    // чтобы после сбоя питания заголовок не указывал на полузатёртую страницу
+    if (header.head % PAGE_SIZE == 0 && header.head >= CAPACITY) {
+      uint32_t newTail = header.head - CAPACITY + PAGE_SIZE;
+      if (newTail > header.tail) {
+        header.tail = newTail;
+        writeHeader();
+      }
+    }
+    writeAt(physical(header.head), (const uint8_t*)line, n);
+    header.head += n;
+    writeHeader();
+    file.flush();
+  }
+
+  uint32_t head() {
+    Sync::Lock lock(mutex);
+    return header.head;
+  }
+
+  uint32_t tail() {
+    Sync::Lock lock(mutex);
+    return header.tail;
+  }
+
+  size_t read(uint32_t& offset, uint8_t* buf, size_t len) {
+    if (!ready) return 0;
+    Sync::Lock lock(mutex);
+    if (offset < header.tail) offset = header.tail;
+    if (offset >= header.head) return 0;
+    size_t n = min((size_t)(header.head - offset), len);
+    n = min(n, (size_t)(CAPACITY - offset % CAPACITY)); // не через конец кольца
+    file.seek(physical(offset));
+    return file.read(buf, n);
+  }
+
+  uint32_t lastLinesOffset(size_t n) {
+    uint32_t end = head();
+    uint32_t start = tail();
+    if (n == 0) return end;
+    uint32_t last = end - 1;  // перевод строки последней строки не считаем
+    uint8_t buf[PAGE_SIZE];
+    size_t seen = 0;
+    while (end > start) {
+      // Кусок в пределах одной страницы — не пересекает конец кольца
+      uint32_t from = max(start, (uint32_t)(((end - 1) / PAGE_SIZE) * PAGE_SIZE));
+      uint32_t at = from;
+      size_t got = read(at, buf, end - from);
+      if (at != from || got != end - from) return tail(); // начало затёрто
+      for (size_t i = got; i > 0; i--) {
+        uint32_t position = from + i - 1;
+        if (buf[i - 1] == '\n' && position != last && ++seen == n) return position + 1;
+      }
+      end = from;
+    }
+    return start;
+  }
+
+  Reader::Reader(uint32_t from) : pos(from) {}
+
+  void Reader::seek(uint32_t offset) {
+    pos = offset;
+    bufLen = 0;
+  }
+
+  bool Reader::fill() {
+    uint32_t offset = pos;
+    bufLen = read(offset, buf, sizeof(buf));
+    bufStart = offset;
+    pos = offset;
+    return bufLen > 0;
+  }
+
+  bool Reader::readLine(String& line) {
+    line = "";
+    for (;;) {
+      if (bufLen == 0 || pos < bufStart || pos >= bufStart + bufLen) {
+        uint32_t expected = pos;
+        if (!fill()) return line.length() > 0;
+        if (pos != expected) line = ""; // данные затёрты — с начала страницы tail
+      }
+      uint8_t c = buf[pos - bufStart];
+      pos++;
+      if (c == 0) continue;  // паддинг конца страницы
+      if (c == '\n') return true;
+      line += (char)c;
+    }
+  }
+}
@@ -0,0 +1,161 @@
+#include "Schedule.h"
+#include <string.h>
+
+namespace Schedule {
+  // Имена дней: латиница (без учёта регистра) и кириллица, понедельник — 0
+  static const char* const DAY_NAMES[2][7] = {
+    {"mon", "tue", "wed", "thu", "fri", "sat", "sun"},
+    {"пн", "вт", "ср", "чт", "пт", "сб", "вс"}
+  };
+
+  static Week table[MAX_SCHEDULES];
+  static uint8_t tableCount = 0;
+
+  static bool fail(const char** error, const char* message) {
+    if (error) *error = message;
+    return false;
+  }
+
+  static const char* skipSpaces(const char* p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+  }
+
+  static bool startsWithWord(const char* p, const char* word) {
+    for (; *word; p++, word++) {
+      char c = *p;
+      if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+      if (c != *word) return false;
+    }
+    return true;
+  }
+
+  // День недели в начале p (p сдвигается за имя); -1 — не день
+  static int parseDay(const char*& p) {
+    for (const auto& names : DAY_NAMES) {
+      for (int day = 0; day < 7; day++) {
+        if (startsWithWord(p, names[day])) {
+          p += strlen(names[day]);
+          return day;
+        }
+      }
+    }
+    return -1;
+  }
+
+  // Час 0..24, допускается ":00" (08:00); минуты — не поддерживаются
+  static bool parseHour(const char*& p, int& hour) {
+    if (*p < '0' || *p > '9') return false;
+    hour = 0;
+    for (int digits = 0; *p >= '0' && *p <= '9'; digits++, p++) {
+      if (digits == 2) return false;
+      hour = hour * 10 + (*p - '0');
+    }
+    if (p[0] == ':' && p[1] == '0' && p[2] == '0') p += 3;
+    return hour <= 24;
+  }
+
+  static void setSlot(Week& week, int slot, bool on) {
+    uint32_t bit = 1u << (slot & 31);
+    if (on) week.words[slot >> 5] |= bit;
+    else week.words[slot >> 5] &= ~bit;
+  }
+
+  bool compile(const char* rules, Week& week, const char** error) {
+    memset(&week, 0, sizeof(week));
+    const char* p = rules ? rules : "";
+    int ruleCount = 0;
+
+    while (true) {
+      p = skipSpaces(p);
+      if (*p == '\0') break;
+      if (*p == ';') {
+        p++;
+        continue;
+      }
+
+      bool deny = *p == '!';
+      if (deny) p = skipSpaces(p + 1);
+
+      // Дни: маска, бит d — день d
+      uint8_t days = 0;
+      if (*p == '*') {
+        days = 0x7F;
+        p++;
+      } else {
+        while (true) {
+          int first = parseDay(p);
+          if (first < 0) return fail(error, "ожидается день недели: mon..sun, пн..вс или *");
+          int last = first;
+          if (*p == '-') {
+            p++;
+            last = parseDay(p);
+            if (last < 0) return fail(error, "ожидается день недели после '-'");
+          }
+          // sat-mon — через воскресенье
+          for (int day = first; ; day = (day + 1) % 7) {
+            days |= 1u << day;
+            if (day == last) break;
+          }
+          if (*p != ',') break;
+          p++;
+        }
+      }
+
+      // Часы: без них — сутки; конец не входит, from > to — через полночь
+      p = skipSpaces(p);
+      int from = 0;
+      int to = 24;
+      if (*p >= '0' && *p <= '9') {
+        if (!parseHour(p, from) || *p != '-') return fail(error, "часы — в виде 8-18");
+        p++;
+        if (!parseHour(p, to)) return fail(error, "часы — в виде 8-18");
+        if (from == 24 || from == to) return fail(error, "пустой интервал часов");
+      }
+
+      p = skipSpaces(p);
+      if (*p != ';' && *p != '\0') return fail(error, "лишние символы в правиле");
+
+      int length = to > from ? to - from : 24 - from + to;
+      for (int day = 0; day < 7; day++) {
+        if (!(days & (1u << day))) continue;
+        for (int h = 0; h < length; h++) {
+          setSlot(week, (day * 24 + from + h) % SLOTS, !deny);
+        }
+      }
+      ruleCount++;
+    }
+
+    if (ruleCount == 0) return fail(error, "пустое расписание");
+    return true;
+  }
+
+  int slotOf(uint32_t localSeconds) {
+    uint32_t days = localSeconds / 86400;
+    // 1970-01-01 — четверг (день 3 от понедельника)
+    int weekday = (int)((days + 3) % 7);
+    return weekday * 24 + (int)(localSeconds % 86400 / 3600);
+  }
+
+  int hours(const Week& week) {
+    int count = 0;
+    for (uint32_t word : week.words) count += __builtin_popcount(word);
+    return count;
+  }
+
+  void begin() {
+    tableCount = 0;
+  }
+
+  uint8_t add(const Week& week) {
+    if (tableCount >= MAX_SCHEDULES) return MISSING;
+    table[tableCount] = week;
+    return ++tableCount;
+  }
+
+  bool allowed(uint8_t id, int slot) {
+    if (id == ALWAYS) return true;
+    if (id > tableCount) return false;
+    return allows(table[id - 1], slot);
+  }
+}
@@ -0,0 +1,210 @@
+#include "Scheduler.h"
+
+namespace Scheduler {
+  struct Job {
+    const char* name;
+    JobFn fn;
+    uint32_t periodMs;   // 0 — разовое
+    uint32_t deadline;   // millis()
+    bool used;
+    bool queued;         // лежит в куче
+    uint32_t runs;
+    uint64_t totalUs;
+    uint32_t maxUs;
+  };
+
+  static Job jobs[MAX_JOBS];
+  static int jobsUsed = 0;  // верхняя граница занятых слотов
+
+  // Min-куча индексов заданий по дедлайну
+  static uint8_t heap[MAX_JOBS];
+  static int heapSize = 0;
+
+  static volatile TaskHandle_t sleeper = nullptr;
+  static uint64_t idleTotalUs = 0;
+
+  // Сравнение с переполнением millis() (раз в 49 дней)
+  static bool earlier(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+  }
+
+  static bool heapLess(int i, int j) {
+    return earlier(jobs[heap[i]].deadline, jobs[heap[j]].deadline);
+  }
+
+  static void heapSwap(int i, int j) {
+    uint8_t t = heap[i];
+    heap[i] = heap[j];
+    heap[j] = t;
+  }
+
+  static void siftUp(int i) {
+    while (i > 0) {
+      int parent = (i - 1) / 2;
+      if (!heapLess(i, parent)) break;
+      heapSwap(i, parent);
+      i = parent;
+    }
+  }
+
+  static void siftDown(int i) {
+    for (;;) {
+      int smallest = i;
+      int left = 2 * i + 1;
+      int right = left + 1;
+      if (left < heapSize && heapLess(left, smallest)) smallest = left;
+      if (right < heapSize && heapLess(right, smallest)) smallest = right;
+      if (smallest == i) break;
+      heapSwap(i, smallest);
+      i = smallest;
+    }
+  }
+
+  static void push(int id) {
+    heap[heapSize] = (uint8_t)id;
+    jobs[id].queued = true;
+    siftUp(heapSize++);
+  }
+
+  static void removeAt(int i) {
+    jobs[heap[i]].queued = false;
+    heapSize--;
+    if (i == heapSize) return;
+    heap[i] = heap[heapSize];
+    siftDown(i);
+    siftUp(i);
+  }
+
+  static int add(const char* name, uint32_t periodMs, uint32_t delayMs, JobFn fn) {
+    for (int id = 0; id < MAX_JOBS; id++) {
+      if (jobs[id].used) continue;
+      jobs[id] = {name, fn, periodMs, (uint32_t)(millis() + delayMs), true, false, 0, 0, 0};
+      if (id >= jobsUsed) jobsUsed = id + 1;
+      push(id);
+      return id;
+    }
+    Serial.printf("[Scheduler] Нет слота для задания %s\n", name);
+    return -1;
+  }
+
+  int every(const char* name, uint32_t periodMs, JobFn fn) {
+    return add(name, periodMs, periodMs, fn);
+  }
+
+  int after(const char* name, uint32_t delayMs, JobFn fn) {
+    return add(name, 0, delayMs, fn);
+  }
+
+  void cancel(int id) {
+    if (id < 0 || id >= MAX_JOBS || !jobs[id].used) return;
+    for (int i = 0; jobs[id].queued && i < heapSize; i++) {
+      if (heap[i] == id) {
+        removeAt(i);
+        break;
+      }
+    }
+    jobs[id].used = false;
+  }
+
+  void runDue() {
+    while (heapSize > 0) {
+      int id = heap[0];
+      Job& job = jobs[id];
+      uint32_t now = millis();
+      if (earlier(now, job.deadline)) break;
+      removeAt(0);
+
+      uint32_t start = micros();
+      job.fn();
+      uint32_t us = micros() - start;
+      job.runs++;
+      job.totalUs += us;
+      if (us > job.maxUs) job.maxUs = us;
+
+      // Задание могло отменить себя из fn()
+      if (!job.used) continue;
+      if (job.periodMs == 0) {
+        job.used = false;
+        continue;
+      }
+      // Ровный шаг от дедлайна; после долгой блокировки — без серии догоняющих запусков
+      job.deadline += job.periodMs;
+      if (earlier(job.deadline, now)) job.deadline = now + job.periodMs;
+      push(id);
+    }
+  }
+
+  void sleep(uint32_t maxMs) {
+    uint32_t waitMs = maxMs;
+    if (heapSize > 0) {
+      int32_t untilNext = (int32_t)(jobs[heap[0]].deadline - millis());
+      if (untilNext < 0) untilNext = 0;
+      if ((uint32_t)untilNext < waitMs) waitMs = (uint32_t)untilNext;
+    }
+    // Минимум 1 тик — отдать StateLock задаче HTTP, как прежний delay(1)
+    TickType_t ticks = pdMS_TO_TICKS(waitMs);
+    if (ticks == 0) ticks = 1;
+
+    sleeper = xTaskGetCurrentTaskHandle();
+    uint32_t start = micros();
+    ulTaskNotifyTake(pdTRUE, ticks);
+    idleTotalUs += micros() - start;
+  }
+
+  void wake() {
+    TaskHandle_t task = sleeper;
+    if (task) xTaskNotifyGive(task);
+  }
+
+  void IRAM_ATTR wakeFromIsr() {
+    TaskHandle_t task = sleeper;
+    if (!task) return;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &woken);
+    if (woken) portYIELD_FROM_ISR();
+  }
+
+  int jobCount() {
+    return jobsUsed;
+  }
+
+  bool jobStats(int id, JobStats& out) {
+    if (id < 0 || id >= jobsUsed || !jobs[id].used) return false;
+    out = {jobs[id].name, jobs[id].runs, jobs[id].totalUs, jobs[id].maxUs};
+    return true;
+  }
+
+  uint64_t idleUs() {
+    return idleTotalUs;
+  }
+
+  static void writeSeconds(Print& out, uint64_t us) {
+    out.printf("%lu.%06lu\n", (unsigned long)(us / 1000000), (unsigned long)(us % 1000000));
+  }
+
+  void writeMetrics(Print& out) {
+    out.print("# TYPE gate_job_runs counter\n# HELP gate_job_runs Запусков задания loop()\n");
+    for (int id = 0; id < jobsUsed; id++) {
+      if (!jobs[id].used) continue;
+      out.printf("gate_job_runs_total{job=\"%s\"} %u\n", jobs[id].name, (unsigned)jobs[id].runs);
+    }
+    out.print("# TYPE gate_job_cpu_seconds counter\n# UNIT gate_job_cpu_seconds seconds\n"
+              "# HELP gate_job_cpu_seconds Суммарное время выполнения задания\n");
+    for (int id = 0; id < jobsUsed; id++) {
+      if (!jobs[id].used) continue;
+      out.printf("gate_job_cpu_seconds_total{job=\"%s\"} ", jobs[id].name);
+      writeSeconds(out, jobs[id].totalUs);
+    }
+    out.print("# TYPE gate_job_max_seconds gauge\n# UNIT gate_job_max_seconds seconds\n"
+              "# HELP gate_job_max_seconds Самый долгий запуск задания\n");
+    for (int id = 0; id < jobsUsed; id++) {
+      if (!jobs[id].used) continue;
+      out.printf("gate_job_max_seconds{job=\"%s\"} ", jobs[id].name);
+      writeSeconds(out, jobs[id].maxUs);
+    }
+    out.print("# TYPE gate_loop_idle_seconds counter\n# UNIT gate_loop_idle_seconds seconds\n"
+              "# HELP gate_loop_idle_seconds Время сна задачи loop между итерациями\n");
+    out.print("gate_loop_idle_seconds_total ");
+    writeSeconds(out, idleTotalUs);
+  }
+}
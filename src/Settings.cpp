@@ -0,0 +1,165 @@
+#include "Settings.h"
+#include <math.h>
+
+namespace Settings {
+  struct Descriptor {
+    const char* name;   // имя поля в API
+    Type type;
+    float min;
+    float max;
+    bool persistent;
+  };
+
+  // Границы — как в UI и в возможностях CC1101 (RadioLib проверяет точнее)
+  static const Descriptor RADIO_DESCRIPTORS[GATE_OPEN_SEC] = {
+    {"frequency", TYPE_FLOAT, 300.0f, 928.0f, true},
+    {"bitRate", TYPE_FLOAT, 0.025f, 600.0f, true},
+    {"frequencyDeviation", TYPE_FLOAT, 1.5f, 381.0f, true},
+    {"rxBandwidth", TYPE_FLOAT, 58.0f, 812.0f, true},
+    {"outputPower", TYPE_INT, -30.0f, 10.0f, true}
+  };
+
+  // Одинаковы для всех ворот (имена — поля объекта ворот в /api/gate/config)
+  static const Descriptor GATE_DESCRIPTORS[GATE_FIELDS] = {
+    {"openDuration", TYPE_INT, 1.0f, 60.0f, true},
+    {"stayOpen", TYPE_INT, 1.0f, 300.0f, true},
+    {"closeDuration", TYPE_INT, 1.0f, 60.0f, true}
+  };
+
+  static const Descriptor LEARNING_DESCRIPTOR = {"learningMode", TYPE_BOOL, 0.0f, 1.0f, false};
+  static const Descriptor TIME_ZONE_DESCRIPTOR = {"timeZone", TYPE_INT, -720.0f, 840.0f, true};
+
+  static const Descriptor& descriptor(Id id) {
+    if (id < GATE_OPEN_SEC) return RADIO_DESCRIPTORS[id];
+    if (id < LEARNING_MODE) return GATE_DESCRIPTORS[(id - GATE_OPEN_SEC) % GATE_FIELDS];
+    if (id == LEARNING_MODE) return LEARNING_DESCRIPTOR;
+    return TIME_ZONE_DESCRIPTOR;
+  }
+
+  struct Binding {
+    void* field;
+    Applier apply;
+  };
+  static Binding bindings[COUNT];
+
+  static const int MAX_LISTENERS = 4;
+  static Listener listeners[MAX_LISTENERS];
+  static int listenerCount = 0;
+
+  // Отложенная запись
+  static const unsigned long COMMIT_DELAY_MS = 1500;      // тишина после последнего изменения
+  static const unsigned long COMMIT_MAX_DELAY_MS = 10000; // потолок от первого изменения
+  static bool isDirty = false;
+  static unsigned long firstChangeAt = 0;
+  static unsigned long lastChangeAt = 0;
+
+  static int batchDepth = 0;
+  static uint32_t pendingMask = 0;
+  static Stats counters = {0, 0};
+
+  static void bind(Id id, void* field, Applier apply) {
+    if (id >= COUNT) return;
+    bindings[id] = {field, apply};
+  }
+
+  void bindFloat(Id id, float* field, Applier apply) { bind(id, field, apply); }
+  void bindInt(Id id, int* field, Applier apply) { bind(id, field, apply); }
+  void bindBool(Id id, bool* field, Applier apply) { bind(id, field, apply); }
+
+  void subscribe(Listener listener) {
+    if (listener && listenerCount < MAX_LISTENERS) listeners[listenerCount++] = listener;
+  }
+
+  const char* name(Id id) {
+    return id < COUNT ? descriptor(id).name : "";
+  }
+
+  Type type(Id id) {
+    return id < COUNT ? descriptor(id).type : TYPE_FLOAT;
+  }
+
+  float get(Id id) {
+    if (id >= COUNT || !bindings[id].field) return 0.0f;
+    switch (descriptor(id).type) {
+      case TYPE_INT: return (float)*(int*)bindings[id].field;
+      case TYPE_BOOL: return *(bool*)bindings[id].field ? 1.0f : 0.0f;
+      default: return *(float*)bindings[id].field;
+    }
+  }
+
+  Result check(Id id, float value) {
+    if (id >= COUNT || isnan(value)) return RESULT_OUT_OF_RANGE;
+    const Descriptor& d = descriptor(id);
+    if (value < d.min || value > d.max) return RESULT_OUT_OF_RANGE;
+    if (d.type != TYPE_FLOAT && value != floorf(value)) return RESULT_OUT_OF_RANGE;
+    return get(id) == value ? RESULT_UNCHANGED : RESULT_CHANGED;
+  }
+
+  static void notify(uint32_t mask) {
+    for (int i = 0; i < listenerCount; i++) listeners[i](mask);
+  }
+
+  Result set(Id id, float value) {
+    Result result = check(id, value);
+    if (result != RESULT_CHANGED || !bindings[id].field) return result;
+
+    if (bindings[id].apply && !bindings[id].apply(value)) return RESULT_REJECTED;
+
+    switch (descriptor(id).type) {
+      case TYPE_INT: *(int*)bindings[id].field = (int)value; break;
+      case TYPE_BOOL: *(bool*)bindings[id].field = value != 0.0f; break;
+      default: *(float*)bindings[id].field = value; break;
+    }
+
+    if (descriptor(id).persistent) {
+      unsigned long now = millis();
+      if (!isDirty) firstChangeAt = now;
+      lastChangeAt = now;
+      isDirty = true;
+      counters.changes++;
+    }
+
+    if (batchDepth > 0) pendingMask |= bit(id);
+    else notify(bit(id));
+    return RESULT_CHANGED;
+  }
+
+  Batch::Batch() {
+    batchDepth++;
+  }
+
+  Batch::~Batch() {
+    if (--batchDepth > 0 || pendingMask == 0) return;
+    uint32_t mask = pendingMask;
+    pendingMask = 0;
+    notify(mask);
+  }
+
+  bool commitDue() {
+    if (!isDirty) return false;
+    unsigned long now = millis();
+    return now - lastChangeAt >= COMMIT_DELAY_MS || now - firstChangeAt >= COMMIT_MAX_DELAY_MS;
+  }
+
+  void commitDone(bool ok) {
+    if (ok) {
+      counters.commits++;
+      return;
+    }
+    // Сбой записи: повтор после следующей паузы, потолок считаем заново
+    Serial.println("[Settings] Ошибка записи настроек, повтор");
+    firstChangeAt = lastChangeAt = millis();
+  }
+
+  void markCommitted() {
+    isDirty = false;
+  }
+
+  bool dirty() {
+    return isDirty;
+  }
+
+  Stats stats() {
+    return counters;
+  }
+}
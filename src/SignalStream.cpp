@@ -0,0 +1,165 @@
+#include "SignalStream.h"
+#include "WsBus.h"
+#include <freertos/FreeRTOS.h>
+
+namespace SignalStream {
+  static const size_t HEADER_SIZE = 8;
+  static const size_t MAX_FRAME = HEADER_SIZE + MAX_PULSES_PER_FRAME * 2;
+  static const int QUEUE_SLOTS = 4;
+
+  // Бюджет клиента: ~12 КБ/с с запасом на пачку из нескольких пакетов брелока.
+  // RSSI-кадр — 18 байт 5 раз в секунду, пакет импульсов — до 1 КБ.
+  static const uint32_t CLIENT_BYTES_PER_SEC = 12288;
+  static const uint32_t CLIENT_BURST_BYTES = 4096;
+
+  struct Slot {
+    uint16_t len;
+    uint8_t data[MAX_FRAME];
+  };
+
+  // Очередь loop() → httpTask. Критическая секция — spinlock между ядрами,
+  // внутри только memcpy готового кадра.
+  static portMUX_TYPE queueMux = portMUX_INITIALIZER_UNLOCKED;
+  static Slot queue[QUEUE_SLOTS];
+  static int queueHead = 0;  // следующий на отправку
+  static int queueCount = 0;
+  static uint32_t droppedQueue = 0;   // под queueMux
+  static uint32_t droppedBudget = 0;  // только httpTask
+
+  // Заполняет только loop()
+  static uint8_t buildBuf[MAX_FRAME];
+  static int8_t rssiSamples[RSSI_SAMPLES_PER_FRAME];
+  static uint8_t rssiCount = 0;
+  static uint16_t pulseSeq = 0;
+
+  // Только httpTask
+  static uint8_t sendBuf[MAX_FRAME];
+  static uint32_t knownSubscribers = 0; // кому уже выдан стартовый бюджет
+  static uint32_t tokens[WEBSOCKETS_SERVER_CLIENT_MAX];
+  static unsigned long tokensAt[WEBSOCKETS_SERVER_CLIENT_MAX];
+
+  static void put16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+  }
+
+  static void put32(uint8_t* p, uint32_t v) {
+    put16(p, v & 0xFFFF);
+    put16(p + 2, v >> 16);
+  }
+
+  static int8_t clampRssi(int rssi) {
+    return (int8_t)constrain(rssi, -128, 127);
+  }
+
+  static void enqueue(const uint8_t* frame, size_t len) {
+    portENTER_CRITICAL(&queueMux);
+    if (queueCount == QUEUE_SLOTS) {
+      // Визуализатору важнее свежие данные — вытесняем самый старый кадр
+      queueHead = (queueHead + 1) % QUEUE_SLOTS;
+      queueCount--;
+      droppedQueue++;
+    }
+    Slot& slot = queue[(queueHead + queueCount) % QUEUE_SLOTS];
+    memcpy(slot.data, frame, len);
+    slot.len = len;
+    queueCount++;
+    portEXIT_CRITICAL(&queueMux);
+  }
+
+  static size_t dequeue(uint8_t* out) {
+    size_t len = 0;
+    portENTER_CRITICAL(&queueMux);
+    if (queueCount > 0) {
+      Slot& slot = queue[queueHead];
+      len = slot.len;
+      memcpy(out, slot.data, len);
+      queueHead = (queueHead + 1) % QUEUE_SLOTS;
+      queueCount--;
+    }
+    portEXIT_CRITICAL(&queueMux);
+    return len;
+  }
+
+  bool active() {
+    return WsBus::hasSubscribers(WsBus::TOPIC_SIGNAL);
+  }
+
+  void sampleRssi(int rssi, float frequencyMHz) {
+    rssiSamples[rssiCount++] = clampRssi(rssi);
+    if (rssiCount < RSSI_SAMPLES_PER_FRAME) return;
+
+    buildBuf[0] = FRAME_RSSI;
+    buildBuf[1] = rssiCount;
+    put16(buildBuf + 2, RSSI_SAMPLE_MS);
+    put32(buildBuf + 4, (uint32_t)(frequencyMHz * 1000.0f + 0.5f));
+    memcpy(buildBuf + HEADER_SIZE, rssiSamples, rssiCount);
+    enqueue(buildBuf, HEADER_SIZE + rssiCount);
+    rssiCount = 0;
+  }
+
+  void pushPulses(const volatile unsigned long* timings, const volatile bool* levels,
+                  int count, int rssi) {
+    if (!active() || count <= 0) return;
+
+    bool truncated = count > MAX_PULSES_PER_FRAME;
+    if (truncated) count = MAX_PULSES_PER_FRAME;
+
+    buildBuf[0] = FRAME_PULSES;
+    buildBuf[1] = truncated ? 0x01 : 0x00;
+    put16(buildBuf + 2, count);
+    buildBuf[4] = (uint8_t)clampRssi(rssi);
+    buildBuf[5] = 0;
+    put16(buildBuf + 6, pulseSeq++);
+    uint8_t* p = buildBuf + HEADER_SIZE;
+    for (int i = 0; i < count; i++) {
+      unsigned long us = timings[i];
+      uint16_t v = us > 0x7FFF ? 0x7FFF : (uint16_t)us;
+      if (levels[i]) v |= 0x8000;
+      put16(p, v);
+      p += 2;
+    }
+    enqueue(buildBuf, p - buildBuf);
+  }
+
+  // Пополнение бюджета клиента по прошедшему времени
+  static void refill(uint8_t client) {
+    unsigned long now = millis();
+    uint32_t add = (uint32_t)((now - tokensAt[client]) * CLIENT_BYTES_PER_SEC / 1000);
+    if (add == 0) return;
+    tokensAt[client] = now;
+    tokens[client] = min(tokens[client] + add, CLIENT_BURST_BYTES);
+  }
+
+  void drain(WebSocketsServer& ws) {
+    uint32_t subscribers = WsBus::subscribers(WsBus::TOPIC_SIGNAL);
+    uint32_t fresh = subscribers & ~knownSubscribers;
+    for (uint8_t client = 0; fresh && client < WEBSOCKETS_SERVER_CLIENT_MAX; client++) {
+      if (!(fresh & (1u << client))) continue;
+      fresh &= ~(1u << client);
+      tokens[client] = CLIENT_BURST_BYTES;
+      tokensAt[client] = millis();
+    }
+    knownSubscribers = subscribers;
+
+    size_t len;
+    while ((len = dequeue(sendBuf)) > 0) {
+      uint32_t mask = subscribers;
+      for (uint8_t client = 0; mask && client < WEBSOCKETS_SERVER_CLIENT_MAX; client++) {
+        if (!(mask & (1u << client))) continue;
+        mask &= ~(1u << client);
+        refill(client);
+        if (tokens[client] < len) {
+          droppedBudget++; // клиент не успевает — пропускаем кадр только для него
+          continue;
+        }
+        tokens[client] -= len;
+        ws.sendBIN(client, sendBuf, len);
+      }
+    }
+  }
+
+  uint32_t droppedFrames() {
+    return droppedQueue + droppedBudget;
+  }
+}
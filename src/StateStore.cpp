@@ -0,0 +1,247 @@
+#include <Arduino.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+#include "StateStore.h"
+#include "Crc32.h"
+
+namespace StateStore {
+  static const char* PARTITION = "userdata";
+  static const char* NAMESPACE = "state";
+  static const char* LEGACY_KEY = "state";              // старый формат: один blob на месте
+  static const char* HEADER_KEYS[2] = {"hdr0", "hdr1"};
+  static const char* BODY_KEYS[2] = {"body0", "body1"};
+
+  static const uint32_t MAGIC = 0x54534753; // "SGST"
+  static const uint16_t FORMAT_VERSION = 1;
+
+  // Заголовок слота. headerCrc считается по всем полям перед ним —
+  // недописанный заголовок не примется за валидный.
+  struct SlotHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t generation;
+    uint32_t length;     // длина тела без завершающего нуля
+    uint32_t bodyCrc;
+    uint32_t headerCrc;
+  };
+
+  static int active = -1;
+  static uint32_t activeGeneration = 0;
+  static uint32_t maxSeenGeneration = 0; // даже битые слоты: новая запись должна их обогнать
+  static bool legacyPresent = false;
+
+  static uint32_t headerChecksum(const SlotHeader& h) {
+    return crc32(&h, offsetof(SlotHeader, headerCrc));
+  }
+
+  static bool readHeader(nvs_handle_t handle, int slot, SlotHeader& h) {
+    size_t size = sizeof(h);
+    if (nvs_get_blob(handle, HEADER_KEYS[slot], &h, &size) != ESP_OK) return false;
+    if (size != sizeof(h) || h.magic != MAGIC || h.version != FORMAT_VERSION) {
+      Serial.printf("[NVS] Заголовок слота %d неизвестного формата — пропуск\n", slot);
+      return false;
+    }
+    if (h.headerCrc != headerChecksum(h)) {
+      Serial.printf("[NVS] Заголовок слота %d повреждён (CRC) — пропуск\n", slot);
+      return false;
+    }
+    return true;
+  }
+
+  // Чтение тела с проверкой длины и CRC. Пустая строка = слот не годится.
+  static String readBody(nvs_handle_t handle, int slot, const SlotHeader& h) {
+    size_t size = 0;
+    if (nvs_get_blob(handle, BODY_KEYS[slot], NULL, &size) != ESP_OK || size != h.length) {
+      Serial.printf("[NVS] Тело слота %d отсутствует или другой длины — пропуск\n", slot);
+      return String();
+    }
+    char* buf = (char*)malloc(size + 1);
+    if (!buf) {
+      Serial.printf("[NVS] Нет памяти на чтение слота %d (%u байт)\n", slot, (unsigned)size);
+      return String();
+    }
+    String result;
+    if (nvs_get_blob(handle, BODY_KEYS[slot], buf, &size) == ESP_OK) {
+      if (crc32(buf, size) == h.bodyCrc) {
+        buf[size] = '\0';
+        result = buf;
+      } else {
+        Serial.printf("[NVS] Тело слота %d повреждено (CRC) — пропуск\n", slot);
+      }
+    }
+    free(buf);
+    return result;
+  }
+
+  static String readLegacy(nvs_handle_t handle) {
+    size_t size = 0;
+    if (nvs_get_blob(handle, LEGACY_KEY, NULL, &size) != ESP_OK || size == 0) return String();
+    char* buf = (char*)malloc(size + 1);
+    if (!buf) return String();
+    String result;
+    if (nvs_get_blob(handle, LEGACY_KEY, buf, &size) == ESP_OK) {
+      buf[size] = '\0'; // старый формат писал завершающий ноль, но не полагаемся на это
+      result = buf;
+    }
+    free(buf);
+    return result;
+  }
+
+  void init() {
+    esp_err_t err = nvs_flash_init_partition(PARTITION);
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+      // Раздел повреждён — форматируем и инициализируем заново
+      Serial.println("[NVS] Форматирование раздела userdata...");
+      nvs_flash_erase_partition(PARTITION);
+      err = nvs_flash_init_partition(PARTITION);
+    }
+    if (err != ESP_OK) {
+      Serial.printf("[NVS] ОШИБКА инициализации userdata: %s\n", esp_err_to_name(err));
+    } else {
+      Serial.println("[NVS] Раздел userdata инициализирован");
+    }
+  }
+
+  LoadResult load(AcceptFn accept) {
+    active = -1;
+    activeGeneration = 0;
+    maxSeenGeneration = 0;
+    legacyPresent = false;
+
+    nvs_handle_t handle;
+    if (nvs_open_from_partition(PARTITION, NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+      // Namespace ещё не создан — первый запуск
+      return LoadResult::EMPTY;
+    }
+
+    // Сначала только заголовки (по 24 байта), тела — по мере надобности
+    SlotHeader headers[2];
+    bool valid[2];
+    bool anyData = false;
+    for (int slot = 0; slot < 2; slot++) {
+      size_t size = 0;
+      if (nvs_get_blob(handle, HEADER_KEYS[slot], NULL, &size) == ESP_OK) anyData = true;
+      valid[slot] = readHeader(handle, slot, headers[slot]);
+      if (valid[slot] && headers[slot].generation > maxSeenGeneration) {
+        maxSeenGeneration = headers[slot].generation;
+      }
+    }
+
+    int order[2] = {0, 1};
+    if (valid[1] && (!valid[0] || headers[1].generation > headers[0].generation)) {
+      order[0] = 1;
+      order[1] = 0;
+    }
+
+    int attempt = 0;
+    for (int i = 0; i < 2; i++) {
+      int slot = order[i];
+      if (!valid[slot]) continue;
+      attempt++;
+      String body = readBody(handle, slot, headers[slot]);
+      if (body.length() == 0) continue;
+      if (!accept(body)) {
+        Serial.printf("[NVS] Слот %d не принят (ошибка разбора) — пропуск\n", slot);
+        continue;
+      }
+      active = slot;
+      activeGeneration = headers[slot].generation;
+      size_t legacySize = 0;
+      legacyPresent = nvs_get_blob(handle, LEGACY_KEY, NULL, &legacySize) == ESP_OK;
+      nvs_close(handle);
+      Serial.printf("[NVS] Загружен слот %d, поколение %u (%u байт)\n",
+                    slot, (unsigned)activeGeneration, (unsigned)headers[slot].length);
+      return attempt == 1 ? LoadResult::OK : LoadResult::FALLBACK;
+    }
+
+    // Ни одного валидного слота — возможно, прошивка только что обновилась
+    // со старого формата
+    String legacy = readLegacy(handle);
+    nvs_close(handle);
+    if (legacy.length() > 0) {
+      legacyPresent = true;
+      if (accept(legacy)) {
+        Serial.printf("[NVS] Загружено состояние старого формата (%u байт), будет перенесено в слоты\n",
+                      (unsigned)legacy.length());
+        return LoadResult::LEGACY;
+      }
+      anyData = true;
+    }
+    return anyData ? LoadResult::CORRUPT : LoadResult::EMPTY;
+  }
+
+  bool save(const String& json) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open_from_partition(PARTITION, NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+      Serial.printf("[NVS] Ошибка открытия userdata: %s\n", esp_err_to_name(err));
+      return false;
+    }
+
+    int target = (active < 0) ? 0 : 1 - active;
+    uint32_t nextGeneration = max(activeGeneration, maxSeenGeneration) + 1;
+
+    SlotHeader h;
+    h.magic = MAGIC;
+    h.version = FORMAT_VERSION;
+    h.reserved = 0;
+    h.generation = nextGeneration;
+    h.length = json.length();
+    h.bodyCrc = crc32(json.c_str(), json.length());
+    h.headerCrc = headerChecksum(h);
+
+    // 1. Тело. Обрыв здесь: заголовок target старый (поколение ниже активного
+    //    или CRC не сойдётся) — загрузка возьмёт активный слот.
+    err = nvs_set_blob(handle, BODY_KEYS[target], json.c_str(), json.length());
+    if (err == ESP_OK) err = nvs_commit(handle);
+    if (err != ESP_OK) {
+      Serial.printf("[NVS] ОШИБКА записи тела слота %d: %s\n", target, esp_err_to_name(err));
+      nvs_close(handle);
+      return false;
+    }
+
+    // 2. Заголовок — точка фиксации новой версии
+    err = nvs_set_blob(handle, HEADER_KEYS[target], &h, sizeof(h));
+    if (err == ESP_OK) err = nvs_commit(handle);
+    if (err != ESP_OK) {
+      Serial.printf("[NVS] ОШИБКА записи заголовка слота %d: %s\n", target, esp_err_to_name(err));
+      nvs_close(handle);
+      return false;
+    }
+
+    active = target;
+    activeGeneration = nextGeneration;
+    maxSeenGeneration = nextGeneration;
+
+    // Миграция завершена — старый blob больше не нужен и занимает место
+    if (legacyPresent) {
+      if (nvs_erase_key(handle, LEGACY_KEY) == ESP_OK && nvs_commit(handle) == ESP_OK) {
+        legacyPresent = false;
+        Serial.println("[NVS] Старый blob состояния удалён после миграции");
+      }
+    }
+
+    nvs_close(handle);
+    return true;
+  }
+
+  int activeSlot() {
+    return active;
+  }
+
+  uint32_t generation() {
+    return activeGeneration;
+  }
+
+  const char* resultName(LoadResult result) {
+    switch (result) {
+      case LoadResult::OK:       return "ok";
+      case LoadResult::FALLBACK: return "fallback";
+      case LoadResult::LEGACY:   return "legacy";
+      case LoadResult::EMPTY:    return "empty";
+      case LoadResult::CORRUPT:  return "corrupt";
+    }
+    return "unknown";
+  }
+}
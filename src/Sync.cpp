@@ -0,0 +1,25 @@
+#include "Sync.h"
+
+namespace Sync {
+  static SemaphoreHandle_t stateHandle = nullptr;
+  static SemaphoreHandle_t wsHandle = nullptr;
+  static SemaphoreHandle_t storeHandle = nullptr;
+
+  void init() {
+    if (!stateHandle) stateHandle = xSemaphoreCreateRecursiveMutex();
+    if (!wsHandle) wsHandle = xSemaphoreCreateRecursiveMutex();
+    if (!storeHandle) storeHandle = xSemaphoreCreateRecursiveMutex();
+  }
+
+  SemaphoreHandle_t stateMutex() {
+    return stateHandle;
+  }
+
+  SemaphoreHandle_t wsMutex() {
+    return wsHandle;
+  }
+
+  SemaphoreHandle_t storeMutex() {
+    return storeHandle;
+  }
+}
@@ -0,0 +1,126 @@
+#include "TimeSource.h"
+#include "Schedule.h"
+
+namespace TimeSource {
+  static Origin currentOrigin = ORIGIN_NONE;
+  static uint32_t baseUtc = 0;     // секунды UTC в момент baseMs
+  static uint32_t baseMs = 0;
+  static uint32_t lastSyncMs = 0;
+  static int zoneMinutes = 0;
+
+  // Опора сдвигается вперёд раз в сутки: разность millis() в 32 битах
+  // переполняется через 49 дней, а синхронизации может и не быть
+  static const uint32_t REBASE_MS = 86400000UL;
+
+  // NTP точнее часов модема: свежую NTP-опору время сети не перебивает
+  static const uint32_t NTP_PRIORITY_MS = 2 * 3600000UL;
+
+  bool sync(uint32_t utc, Origin origin, uint32_t nowMs) {
+    if (utc < MIN_VALID_UTC || origin == ORIGIN_NONE) return false;
+    if (origin == ORIGIN_GSM && currentOrigin == ORIGIN_NTP && nowMs - lastSyncMs < NTP_PRIORITY_MS) {
+      return false;
+    }
+    baseUtc = utc;
+    baseMs = nowMs;
+    lastSyncMs = nowMs;
+    currentOrigin = origin;
+    return true;
+  }
+
+  void setZone(int minutes) {
+    zoneMinutes = minutes;
+  }
+
+  int zone() {
+    return zoneMinutes;
+  }
+
+  bool synced() {
+    return currentOrigin != ORIGIN_NONE;
+  }
+
+  Origin origin() {
+    return currentOrigin;
+  }
+
+  const char* originName(Origin origin) {
+    switch (origin) {
+      case ORIGIN_GSM: return "gsm";
+      case ORIGIN_NTP: return "ntp";
+      default:         return "none";
+    }
+  }
+
+  uint32_t syncedAtMs() {
+    return lastSyncMs;
+  }
+
+  uint32_t utcNow(uint32_t nowMs) {
+    if (currentOrigin == ORIGIN_NONE) return 0;
+    uint32_t elapsed = nowMs - baseMs;
+    if (elapsed >= REBASE_MS) {
+      baseUtc += elapsed / 1000;
+      baseMs += elapsed / 1000 * 1000;
+      elapsed = nowMs - baseMs;
+    }
+    return baseUtc + elapsed / 1000;
+  }
+
+  int weekSlot(uint32_t nowMs) {
+    uint32_t utc = utcNow(nowMs);
+    if (utc == 0) return -1;
+    int64_t local = (int64_t)utc + (int64_t)zoneMinutes * 60;
+    if (local < 0) return -1;
+    return Schedule::slotOf((uint32_t)local);
+  }
+
+  // Дни от 1970-01-01 — алгоритм days_from_civil (Howard Hinnant)
+  uint32_t fromCivil(int year, int month, int day, int hour, int minute, int second) {
+    year -= month <= 2;
+    int era = year / 400;
+    int yoe = year - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + doe - 719468;
+    return (uint32_t)(days * 86400 + hour * 3600 + minute * 60 + second);
+  }
+
+  static bool readNumber(const char* text, size_t len, size_t& pos, int digits, int& value) {
+    value = 0;
+    for (int i = 0; i < digits; i++, pos++) {
+      if (pos >= len || text[pos] < '0' || text[pos] > '9') return false;
+      value = value * 10 + (text[pos] - '0');
+    }
+    return true;
+  }
+
+  static bool expect(const char* text, size_t len, size_t& pos, char c) {
+    if (pos >= len || text[pos] != c) return false;
+    pos++;
+    return true;
+  }
+
+  bool parseCclk(const char* text, size_t len, uint32_t& utc) {
+    // yy/MM/dd,hh:mm:ss±zz — поле +CCLK без кавычек (их снимает AtTokenizer)
+    size_t pos = 0;
+    int year, month, day, hour, minute, second, quarters;
+    if (!readNumber(text, len, pos, 2, year) || !expect(text, len, pos, '/') ||
+        !readNumber(text, len, pos, 2, month) || !expect(text, len, pos, '/') ||
+        !readNumber(text, len, pos, 2, day) || !expect(text, len, pos, ',') ||
+        !readNumber(text, len, pos, 2, hour) || !expect(text, len, pos, ':') ||
+        !readNumber(text, len, pos, 2, minute) || !expect(text, len, pos, ':') ||
+        !readNumber(text, len, pos, 2, second)) {
+      return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 59) {
+      return false;
+    }
+    int sign = 0;
+    if (pos < len && (text[pos] == '+' || text[pos] == '-')) sign = text[pos++] == '-' ? -1 : 1;
+    if (sign == 0 || !readNumber(text, len, pos, 2, quarters)) return false;
+
+    int64_t local = fromCivil(2000 + year, month, day, hour, minute, second);
+    utc = (uint32_t)(local - (int64_t)sign * quarters * 15 * 60);
+    return true;
+  }
+}
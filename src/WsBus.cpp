@@ -0,0 +1,365 @@
+#include "WsBus.h"
+#include "MpmcRing.h"
+#include "Sync.h"
+#include <atomic>
+#include <stdarg.h>
+
+namespace WsBus {
+  static WebSocketsServer* server = nullptr;
+
+  // Пишет только httpTask (события WebSocketsServer), читают все —
+  // байт на клиента, чтение атомарно
+  static volatile uint8_t clientTopics[WEBSOCKETS_SERVER_CLIENT_MAX] = {0};
+
+  // Общие буферы кадра: переиспользуются под WsLock, после первых событий
+  // память под них больше не выделяется
+  static String frame;
+  static String stateData;
+
+  // Входящие: ~10 кадров/с на клиента, пачка до 20
+  static const uint32_t INBOUND_PER_SEC = 10;
+  static const uint32_t INBOUND_BURST = 20;
+  static uint32_t inboundTokens[WEBSOCKETS_SERVER_CLIENT_MAX];
+  static unsigned long inboundAt[WEBSOCKETS_SERVER_CLIENT_MAX];
+  static uint32_t inboundReceived[WEBSOCKETS_SERVER_CLIENT_MAX];
+  static uint32_t inboundDropped[WEBSOCKETS_SERVER_CLIENT_MAX];
+  static uint32_t clientIp[WEBSOCKETS_SERVER_CLIENT_MAX];
+  static unsigned long connectedAt[WEBSOCKETS_SERVER_CLIENT_MAX];
+  static bool connected[WEBSOCKETS_SERVER_CLIENT_MAX];  // темы могут быть пустыми и у подключённого
+
+  static Stats counters = {0, 0, 0, 0, 0, 0};
+
+  // Очередь отправки: пишут loop() и другие задачи, читает flush() в httpTask
+  struct Outgoing {
+    const char* event;  // nullptr — данные не поместились, пропустить
+    bool state;
+    char data[OUTBOX_DATA_LEN];
+  };
+  static MpmcRing<Outgoing, OUTBOX_CAPACITY> outbox;
+  static std::atomic<uint32_t> outboxDropped(0);
+
+  // Последнее значение события-состояния
+  struct StateSlot {
+    const char* event = nullptr;
+    JsonDocument current;   // последнее опубликованное
+    JsonDocument sent;      // последнее разосланное — от него считается разница
+    bool dirty = false;     // current ещё не разослан
+    unsigned long lastSentAt = 0;
+    uint16_t windowMs = 0;
+  };
+  static const int MAX_STATES = 4;
+  static StateSlot states[MAX_STATES];
+
+  struct TopicName {
+    const char* name;
+    Topic topic;
+  };
+
+  static const TopicName TOPIC_NAMES[] = {
+    {"log", TOPIC_LOG}, {"gate", TOPIC_GATE}, {"wifi", TOPIC_WIFI}, {"keys", TOPIC_KEYS},
+    {"data", TOPIC_DATA}, {"signal", TOPIC_SIGNAL}, {"system", TOPIC_SYSTEM}
+  };
+
+  struct EventTopic {
+    const char* event;
+    Topic topic;
+  };
+
+  static const EventTopic EVENT_TOPICS[] = {
+    {"log", TOPIC_LOG},
+    {"gate_status", TOPIC_GATE},
+    {"wifi_status", TOPIC_WIFI}, {"wifi_scan", TOPIC_WIFI},
+    {"key_received", TOPIC_KEYS}, {"key_added", TOPIC_KEYS},
+    {"generation", TOPIC_DATA}
+  };
+
+  void init(WebSocketsServer* ws) {
+    outbox.reset();
+    server = ws;
+    frame.reserve(256);
+    stateData.reserve(128);
+  }
+
+  // Слот состояния по имени события; create — занять свободный
+  static StateSlot* findState(const char* event, bool create) {
+    for (StateSlot& slot : states) {
+      if (slot.event && strcmp(slot.event, event) == 0) return &slot;
+    }
+    if (!create) return nullptr;
+    for (StateSlot& slot : states) {
+      if (!slot.event) {
+        slot.event = event;
+        return &slot;
+      }
+    }
+    return nullptr;
+  }
+
+  void setCoalesceWindow(const char* event, uint16_t windowMs) {
+    Sync::WsLock lock;
+    StateSlot* slot = findState(event, true);
+    if (slot) slot->windowMs = windowMs;
+  }
+
+  // Кадр в общий буфер: {"event":..,"data":..[,"delta":..]}
+  static void buildFrame(const char* event, const char* data, int delta) {
+    frame = "{\"event\":\"";
+    frame += event;
+    frame += "\",\"data\":";
+    frame += data;
+    if (delta >= 0) frame += delta ? ",\"delta\":true" : ",\"delta\":false";
+    frame += '}';
+  }
+
+  static void sendFrame(uint32_t mask) {
+    for (uint8_t client = 0; mask && client < WEBSOCKETS_SERVER_CLIENT_MAX; client++) {
+      if (!(mask & (1u << client))) continue;
+      mask &= ~(1u << client);
+      server->sendTXT(client, frame.c_str(), frame.length());
+      counters.sent++;
+    }
+  }
+
+  void clientConnected(uint8_t client) {
+    if (client >= WEBSOCKETS_SERVER_CLIENT_MAX) return;
+    clientTopics[client] = DEFAULT_TOPICS;
+    inboundTokens[client] = INBOUND_BURST;
+    inboundAt[client] = millis();
+    inboundReceived[client] = 0;
+    inboundDropped[client] = 0;
+    connectedAt[client] = millis();
+    connected[client] = true;
+    clientIp[client] = server ? (uint32_t)server->remoteIP(client) : 0;
+
+    // Снимки состояний — чтобы дальнейшие дельты было к чему применять
+    if (!server) return;
+    for (StateSlot& slot : states) {
+      if (!slot.event || slot.current.isNull()) continue;
+      stateData = "";
+      serializeJson(slot.current, stateData);
+      buildFrame(slot.event, stateData.c_str(), 0);
+      sendFrame(1u << client);
+    }
+  }
+
+  void clientDisconnected(uint8_t client) {
+    if (client >= WEBSOCKETS_SERVER_CLIENT_MAX) return;
+    clientTopics[client] = 0;
+    connected[client] = false;
+  }
+
+  static uint8_t topicByName(const char* name) {
+    for (const TopicName& t : TOPIC_NAMES) {
+      if (strcmp(t.name, name) == 0) return t.topic;
+    }
+    return 0;
+  }
+
+  // "topics": [...] или "topic": "..." → маска
+  static uint8_t parseTopics(JsonDocument& cmd) {
+    uint8_t mask = 0;
+    JsonArray list = cmd["topics"].as<JsonArray>();
+    for (JsonVariant v : list) {
+      mask |= topicByName(v | "");
+    }
+    mask |= topicByName(cmd["topic"] | "");
+    return mask;
+  }
+
+  bool handleCommand(uint8_t client, JsonDocument& cmd) {
+    if (client >= WEBSOCKETS_SERVER_CLIENT_MAX) return false;
+    const char* name = cmd["cmd"] | "";
+    uint8_t mask = parseTopics(cmd);
+    uint8_t current = clientTopics[client];
+
+    if (strcmp(name, "subscribe") == 0) {
+      current |= mask;
+    } else if (strcmp(name, "unsubscribe") == 0) {
+      current &= ~mask;
+    } else if (strcmp(name, "topics") == 0) {
+      current = mask;
+    } else {
+      return false;
+    }
+    clientTopics[client] = current;
+    Serial.printf("[WebSocket] Клиент %u: темы 0x%02X\n", client, current);
+    return true;
+  }
+
+  Topic topicOf(const char* event) {
+    for (const EventTopic& e : EVENT_TOPICS) {
+      if (strcmp(e.event, event) == 0) return e.topic;
+    }
+    return TOPIC_SYSTEM;
+  }
+
+  uint32_t subscribers(Topic topic) {
+    uint32_t mask = 0;
+    for (uint8_t client = 0; client < WEBSOCKETS_SERVER_CLIENT_MAX; client++) {
+      if (clientTopics[client] & topic) mask |= (1u << client);
+    }
+    return mask;
+  }
+
+  void publish(const char* event, const char* data) {
+    if (!server) return;
+    uint32_t mask = subscribers(topicOf(event));
+    if (!mask) return;
+
+    Sync::WsLock lock; // зовут и из loop(), и из задачи HTTP
+    buildFrame(event, data, -1);
+    sendFrame(mask);
+  }
+
+  // Рассылка разницы current − sent. Вызывается под WsLock.
+  static void emitState(StateSlot& slot) {
+    slot.dirty = false;
+    JsonObjectConst cur = slot.current.as<JsonObjectConst>();
+    JsonObjectConst prev = slot.sent.as<JsonObjectConst>();
+    bool full = prev.isNull();
+
+    JsonDocument delta;
+    JsonObject out = delta.to<JsonObject>();
+    for (JsonPairConst kv : cur) {
+      if (full || prev[kv.key()] != kv.value()) out[kv.key()] = kv.value();
+    }
+    if (!full) {
+      for (JsonPairConst kv : prev) {
+        if (cur[kv.key()].isNull()) out[kv.key()] = nullptr; // поле исчезло
+      }
+    }
+    if (out.size() == 0) {
+      counters.suppressed++;
+      return;
+    }
+
+    slot.sent.set(slot.current);
+    slot.lastSentAt = millis();
+    uint32_t mask = subscribers(topicOf(slot.event));
+    if (!mask) return;
+    stateData = "";
+    serializeJson(delta, stateData);
+    buildFrame(slot.event, stateData.c_str(), full ? 0 : 1);
+    sendFrame(mask);
+  }
+
+  void publishState(const char* event, const char* json) {
+    if (!server) return;
+    Sync::WsLock lock;
+    StateSlot* slot = findState(event, true);
+    if (!slot) {
+      // Слоты кончились — ведём себя как обычное событие
+      buildFrame(event, json, -1);
+      sendFrame(subscribers(topicOf(event)));
+      return;
+    }
+    if (slot->dirty) counters.coalesced++; // предыдущее значение так и не ушло
+    if (deserializeJson(slot->current, json)) return; // битый JSON — пропускаем
+    slot->dirty = true;
+    if (millis() - slot->lastSentAt >= slot->windowMs) emitState(*slot);
+  }
+
+  // Ячейка очереди отправки; обычное событие без подписчиков не ставится
+  static Outgoing* claimOutgoing(const char* event, bool state, uint32_t& pos) {
+    if (!server || (!state && !subscribers(topicOf(event)))) return nullptr;
+    Outgoing* out = outbox.claim(pos);
+    if (!out) {
+      outboxDropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    out->event = event;
+    out->state = state;
+    return out;
+  }
+
+  // len — полная длина данных: не поместились — кадр не уходит (обрезанный JSON хуже)
+  static bool commitOutgoing(Outgoing* out, uint32_t pos, int len) {
+    bool fits = len >= 0 && (size_t)len < OUTBOX_DATA_LEN;
+    if (!fits) {
+      out->event = nullptr;
+      outboxDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    outbox.commit(pos);
+    return fits;
+  }
+
+  bool post(const char* event, const char* data) {
+    uint32_t pos;
+    Outgoing* out = claimOutgoing(event, false, pos);
+    if (!out) return false;
+    return commitOutgoing(out, pos, (int)strlcpy(out->data, data, OUTBOX_DATA_LEN));
+  }
+
+  bool postf(const char* event, const char* format, ...) {
+    uint32_t pos;
+    Outgoing* out = claimOutgoing(event, false, pos);
+    if (!out) return false;
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(out->data, OUTBOX_DATA_LEN, format, args);
+    va_end(args);
+    return commitOutgoing(out, pos, len);
+  }
+
+  bool postState(const char* event, const char* json) {
+    uint32_t pos;
+    Outgoing* out = claimOutgoing(event, true, pos);
+    if (!out) return false;
+    return commitOutgoing(out, pos, (int)strlcpy(out->data, json, OUTBOX_DATA_LEN));
+  }
+
+  void flush() {
+    if (!server) return;
+    Sync::WsLock lock;
+    static Outgoing out;  // только httpTask; ~650 байт — не на стек задачи
+    for (uint32_t i = 0; i < OUTBOX_CAPACITY && outbox.pop(out); i++) {
+      if (!out.event) continue;
+      if (out.state) {
+        publishState(out.event, out.data);
+      } else {
+        buildFrame(out.event, out.data, -1);
+        sendFrame(subscribers(topicOf(out.event)));
+      }
+    }
+    for (StateSlot& slot : states) {
+      if (slot.dirty && millis() - slot.lastSentAt >= slot.windowMs) emitState(slot);
+    }
+  }
+
+  bool allowInbound(uint8_t client) {
+    if (client >= WEBSOCKETS_SERVER_CLIENT_MAX) return false;
+    counters.inboundReceived++;
+    inboundReceived[client]++;
+    unsigned long now = millis();
+    uint32_t add = (now - inboundAt[client]) * INBOUND_PER_SEC / 1000;
+    if (add > 0) {
+      inboundAt[client] = now;
+      inboundTokens[client] = min(inboundTokens[client] + add, INBOUND_BURST);
+    }
+    if (inboundTokens[client] == 0) {
+      counters.inboundDropped++;
+      inboundDropped[client]++;
+      return false;
+    }
+    inboundTokens[client]--;
+    return true;
+  }
+
+  Stats stats() {
+    Sync::WsLock lock;
+    Stats s = counters;
+    s.outboxDropped = outboxDropped.load(std::memory_order_relaxed);
+    return s;
+  }
+
+  int clientStats(ClientStats* out, int max) {
+    Sync::WsLock lock;
+    int count = 0;
+    for (uint8_t client = 0; client < WEBSOCKETS_SERVER_CLIENT_MAX && count < max; client++) {
+      if (!connected[client]) continue;
+      out[count++] = {client, clientIp[client], connectedAt[client],
+                      inboundReceived[client], inboundDropped[client]};
+    }
+    return count;
+  }
+}
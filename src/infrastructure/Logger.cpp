@@ -1,4 +1,5 @@
 #include "Logger.h"
+#include "LogQueue.h"
 #include <stdio.h>
 #include <stdarg.h>
 
@@ -9,36 +10,13 @@ void Logger::init(WebSocketsServer* ws) {
     webSocketInstance = ws;
 }
 
-// Вспомогательная функция для экранирования JSON строк
-static String escapeJsonString(const String& str) {
-    String escaped;
-    escaped.reserve(str.length() + 10); // Резервируем немного больше места
-    
-    for (size_t i = 0; i < str.length(); i++) {
-        char c = str.charAt(i);
-        switch (c) {
-            case '"':  escaped += "\\\""; break;
-            case '\\': escaped += "\\\\"; break;
-            case '\n': escaped += "\\n"; break;
-            case '\r': escaped += "\\r"; break;
-            case '\t': escaped += "\\t"; break;
-            default:   escaped += c; break;
-        }
-    }
-    return escaped;
+// Запись уходит в очередь LogQueue; в Serial и WebSocket её выводит задача log
+static uint8_t sinksFor(WebSocketsServer* ws) {
+    return LogQueue::SINK_SERIAL | (ws != nullptr ? LogQueue::SINK_WS : 0);
 }
 
 void Logger::log(String message, const char* type) {
-    // Выводим в Serial
-    Serial.printf("[%s] %s\n", type, message.c_str());
-    
-    // Отправляем через WebSocket, если он инициализирован
-    if (webSocketInstance != nullptr) {
-        String escapedMessage = escapeJsonString(message);
-        String logData = "{\"message\":\"" + escapedMessage + "\",\"type\":\"" + String(type) + "\"}";
-        String json = "{\"event\":\"log\",\"data\":" + logData + "}";
-        webSocketInstance->broadcastTXT(json);
-    }
+    LogQueue::post(LogQueue::levelFromName(type), sinksFor(webSocketInstance), message.c_str());
 }
 
 void Logger::info(String message) {
@@ -68,6 +46,6 @@ void Logger::logf(const char* type, const char* format, ...) {
     vsnprintf(buffer, sizeof(buffer), format, args);
     va_end(args);
     
-    log(String(buffer), type);
+    LogQueue::post(LogQueue::levelFromName(type), sinksFor(webSocketInstance), buffer);
 }
 
@@ -7,6 +7,7 @@
 
 // Универсальная система логирования
 // Выводит логи в Serial и отправляет через WebSocket на фронтенд
+// (асинхронно, через очередь LogQueue — вызов не блокируется)
 class Logger {
 public:
     // Инициализация (опционально, для настройки WebSocket)
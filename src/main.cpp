@@ -7,15 +7,32 @@
 #include <ESPmDNS.h>
 #include <WebSocketsServer.h>
 #include <Update.h>
+#include <time.h>
 #include <algorithm>
 #include <vector>
-#include <nvs_flash.h>
-#include <nvs.h>
 
 // Подключение кастомных модулей
 #include "CC1101Manager.h"
 #include "GateControl.h"
 #include "GSMManager.h"
+#include "BulkIO.h"
+#include "HttpStream.h"
+#include "StateStore.h"
+#include "Crc32.h"
+#include "Sync.h"
+#include "SignalStream.h"
+#include "WsBus.h"
+#include "LogQueue.h"
+#include "RingLog.h"
+#include "AuditLog.h"
+#include "Metrics.h"
+#include "PhoneIndex.h"
+#include "Scheduler.h"
+#include "Settings.h"
+#include "EventBus.h"
+#include "Schedule.h"
+#include "TimeSource.h"
+#include "AccessDecision.h"
 #include "infrastructure/Logger.h"
 
 // --- Константы пинов ---
@@ -32,6 +49,18 @@
 #define GATE_OPEN_PIN  12 // GPIO12 - ключ реле K1: канал «открыть»
 #define GATE_CLOSE_PIN 13 // GPIO13 - ключ реле K2: канал «закрыть»
 
+// Число ворот на объекте (въезд, выезд, калитка): флаг сборки -DGATE_COUNT=N.
+// Реле ворот 2-4 — на свободных GPIO, по паре на ворота: {«открыть», «закрыть»}
+#ifndef GATE_COUNT
+#define GATE_COUNT 1
+#endif
+#define GATE2_OPEN_PIN  25
+#define GATE2_CLOSE_PIN 26
+#define GATE3_OPEN_PIN  27
+#define GATE3_CLOSE_PIN 14
+#define GATE4_OPEN_PIN  32
+#define GATE4_CLOSE_PIN 33
+
 // Пины для GSM SIM800L (UART2)
 #define GSM_RX_PIN  16 // GPIO16 - RX пин для UART2 (подключается к TX GSM модуля)
 #define GSM_TX_PIN  17 // GPIO17 - TX пин для UART2 (подключается к RX GSM модуля)
@@ -42,10 +71,19 @@ WebServer server(80); // Веб-сервер на порту 80
 WebSocketsServer webSocket(81); // WebSocket сервер на порту 81
 
 // --- Структуры данных ---
+static_assert(GATE_COUNT >= 1 && GATE_COUNT <= GateControl::MAX_GATES, "GATE_COUNT: от 1 до GateControl::MAX_GATES");
+static_assert(GateControl::MAX_GATES <= PhoneIndex::GATE_BITS, "Маска ворот не помещается в PhoneIndex");
+static_assert(Schedule::ID_BITS <= PhoneIndex::SCHEDULE_BITS, "id расписания не помещается в PhoneIndex");
+
+// Маска всех установленных ворот (бит i — ворота i)
+static const uint8_t ALL_GATES = (1u << GATE_COUNT) - 1;
+
 struct PhoneEntry {
   String number;
   bool smsEnabled;
   bool callEnabled;
+  uint8_t gates = 1;          // Какие ворота открывает (бит i — ворота i)
+  String schedule;            // Имя расписания доступа, пусто — без ограничений
 };
 
 struct KeyEntry {
@@ -61,6 +99,9 @@ struct KeyEntry {
   String rawData;             // RAW данные (для отображения)
   int rssi;                   // RSSI при обучении
   unsigned long timestamp;    // Время добавления
+  uint8_t gates = 1;          // Какие ворота открывает (бит i — ворота i)
+  String schedule;            // Имя расписания доступа, пусто — без ограничений
+  uint8_t scheduleId = Schedule::ALWAYS;  // id в таблице Schedule (rebuildSchedules), не сохраняется
 };
 
 struct WiFiNetwork {
@@ -103,60 +144,43 @@ struct SystemState {
   int outputPower;
   uint32_t gateOpenCount;
 
-  // Тайминги цикла ворот, сек (NeoRelay2: открытие → открыто → закрытие)
-  int gateOpenSec = 3;
-  int gateStaySec = 15;
-  int gateCloseSec = 3;
+  // Настройки ворот: имя для UI и тайминги цикла, сек
+  // (NeoRelay2: открытие → открыто → закрытие)
+  struct GateConfig {
+    String name;
+    int openSec = 3;
+    int staySec = 15;
+    int closeSec = 3;
+  };
+  GateConfig gateConfig[GateControl::MAX_GATES];
+
+  // Расписания доступа (Schedule.h): ключи и телефоны ссылаются на имя
+  struct ScheduleEntry {
+    String name;
+    String rules;
+  };
+  std::vector<ScheduleEntry> schedules;
+  int timeZoneMin = 180;  // часовой пояс расписаний, минуты к UTC
 
   // Временное хранилище для верификации сигналов
   std::vector<KeyRecognition> pendingRecognitions;
 };
 
-// --- Ring-buffer лог файл ---
-// Хранит последние N строк в SPIFFS, автоматически удаляет старые
-namespace RingLog {
-  static const char* LOG_FILE = "/log.txt";
-  static const size_t MAX_LOG_SIZE = 32768; // 32KB макс размер файла
-  static const size_t TRIM_TO_SIZE = 24576; // Обрезаем до 24KB когда превышен лимит
-
-  void append(const char* message) {
-    File f = SPIFFS.open(LOG_FILE, "a");
-    if (!f) return;
-
-    // Формируем строку лога с uptime
-    unsigned long sec = millis() / 1000;
-    char timeBuf[16];
-    snprintf(timeBuf, sizeof(timeBuf), "[%luh%02lum] ", sec / 3600, (sec % 3600) / 60);
-    f.print(timeBuf);
-    f.println(message);
-    size_t sz = f.size();
-    f.close();
-
-    // Если файл превысил лимит — обрезаем (удаляем начало, оставляем конец)
-    if (sz > MAX_LOG_SIZE) {
-      File rf = SPIFFS.open(LOG_FILE, "r");
-      if (!rf) return;
-      // Пропускаем начало файла
-      rf.seek(sz - TRIM_TO_SIZE);
-      // Ищем начало следующей строки
-      while (rf.available()) {
-        if (rf.read() == '\n') break;
-      }
-      String tail = rf.readString();
-      rf.close();
-      // Перезаписываем файл
-      File wf = SPIFFS.open(LOG_FILE, "w");
-      if (wf) {
-        wf.print("--- лог обрезан ---\n");
-        wf.print(tail);
-        wf.close();
-      }
-    }
-  }
-}
-
 // --- Хранилище данных ---
 SystemState systemState;
+
+// Ворота: объект на пару реле, владелец — задача loop (подписчик gate_command)
+static GateControl::Gate gates[GATE_COUNT];
+static const int GATE_PINS[GateControl::MAX_GATES][2] = {
+  {GATE_OPEN_PIN, GATE_CLOSE_PIN},
+  {GATE2_OPEN_PIN, GATE2_CLOSE_PIN},
+  {GATE3_OPEN_PIN, GATE3_CLOSE_PIN},
+  {GATE4_OPEN_PIN, GATE4_CLOSE_PIN}
+};
+
+// Результат последней загрузки состояния (для /api/system/info)
+StateStore::LoadResult stateLoadResult = StateStore::LoadResult::EMPTY;
+
 std::vector<WiFiNetwork> wifiNetworks;
 
 // История обнаруженных сигналов (для remove duplicates)
@@ -173,15 +197,12 @@ struct RecentDetection {
 static std::vector<RecentDetection> detectionHistory;
 
 // --- Объявления функций ---
-void sendWebSocketEvent(const char* event, const char* data);
 void sendLog(String message, const char* type);
 bool saveSystemState();
 void loadSystemState();
+void rebuildPhoneIndex();
+void rebuildSchedules();
 
-// Функция улучшенного сравнения ключей (как во Flipper Zero)
-bool isKeyMatch(const KeyEntry& saved, const ReceivedKey& received, const String& receivedBitString, int receivedBitLength, float receivedTe);
-// Функция сравнения битовых строк с допуском
-bool compareBitStrings(const String& str1, const String& str2, float minSimilarity = 0.95f);
 // Функция верификации сигнала (требует повторения)
 bool verifyKeySignal(const ReceivedKey& received, const String& bitString, int bitLength, float te, bool learningMode = false);
 // Очистка истории обнаруженных сигналов
@@ -194,11 +215,13 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
   switch(type) {
     case WStype_DISCONNECTED:
       Serial.printf("[WebSocket] Клиент %u отключен\n", num);
+      WsBus::clientDisconnected(num);
       break;
     case WStype_CONNECTED:
       {
         IPAddress ip = webSocket.remoteIP(num);
         Serial.printf("[WebSocket] Клиент %u подключен из %d.%d.%d.%d\n", num, ip[0], ip[1], ip[2], ip[3]);
+        WsBus::clientConnected(num);
         
         // Отправляем приветственное сообщение новому клиенту
         String welcomeMsg = "🌐 Клиент подключен: " + String(ip[0]) + "." + String(ip[1]) + "." + String(ip[2]) + "." + String(ip[3]);
@@ -212,11 +235,20 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
       static uint32_t wsTextCount = 0;
       wsTextCount++;
       if (millis() - wsTextWindowStart > 1000) {
-        Serial.printf("[WebSocket] Кадров за окно: %u, последний (%u байт): %.80s\n",
-                      wsTextCount, (unsigned)length, (const char*)payload);
+        Serial.printf("[WebSocket] Кадров за окно: %u (сверх лимита всего: %u), последний от клиента %u (%u байт): %.80s\n",
+                      wsTextCount, WsBus::stats().inboundDropped, num, (unsigned)length, (const char*)payload);
         wsTextWindowStart = millis();
         wsTextCount = 0;
       }
+
+      // Лимит входящих на клиента: лишние кадры даже не разбираем
+      if (!WsBus::allowInbound(num)) break;
+
+      // Команды подписки на темы (см. WsBus.h)
+      JsonDocument cmdDoc;
+      if (deserializeJson(cmdDoc, payload, length) == DeserializationError::Ok) {
+        WsBus::handleCommand(num, cmdDoc);
+      }
       break;
     }
     default:
@@ -251,56 +283,239 @@ String jsonEscape(const String& s) {
   return out;
 }
 
-void sendWebSocketEvent(const char* event, const char* data) {
-  String json = "{\"event\":\"" + String(event) + "\",\"data\":" + String(data) + "}";
-  webSocket.broadcastTXT(json);
+// Журнал UI (событие "log"): запись уходит в очередь LogQueue, в WebSocket
+// её отправит задача log
+void sendLog(String message, const char* type = "info") {
+  LogQueue::post(LogQueue::levelFromName(type), LogQueue::SINK_WS, message.c_str());
+}
 
+// Окно склейки wifi_status: изменения чаще раза в 2 с уходят одним кадром
+static const uint16_t WIFI_STATUS_WINDOW_MS = 2000;
+
+// Тайминги loop(): максимум итерации за окно и время от готового пакета CC1101
+// до решения по ключу. Задержка распознавания ≤ loopMaxUs + rfDecisionUs —
+// по ним loadtest.py проверяет, что нагрузка на HTTP не влияет на радио.
+static const unsigned long LOOP_STATS_WINDOW_MS = 5000;
+// Потолок сна loop() между итерациями: при 115200 бод за 10 мс приходит
+// ~115 байт — буфер UART2 (256) модема не переполняется
+static const uint32_t LOOP_POLL_MS = 10;
+static uint32_t loopMaxUs = 0;        // максимум за прошлое окно (для API)
+static uint32_t loopMaxUsWindow = 0;  // копится в текущем окне
+static uint32_t rfDecisionUs = 0;     // последнее распознавание
+static uint32_t rfDecisionMaxUs = 0;
+
+// --- Поколения коллекций: ETag / 304 ---
+// Фронтенд перезапрашивает списки и конфиги при каждом переходе по страницам.
+// У каждой коллекции счётчик поколения, растущий при изменении; ETag =
+// nonce загрузки + поколение (+ CRC параметров запроса — у разных страниц и
+// фильтров разное тело). Совпал If-None-Match → 304 без сборки JSON.
+// Nonce нужен, чтобы ETag прошлой загрузки (поколения снова с нуля) не совпал.
+enum class Collection : uint8_t { KEYS, PHONES, GATE_CONFIG, RADIO_CONFIG, SCHEDULES, COUNT };
+static const char* const COLLECTION_NAMES[] = { "keys", "phones", "gate_config", "radio_config", "schedules" };
+static uint32_t collectionGeneration[(int)Collection::COUNT] = {0};
+static uint32_t bootNonce = 0;
+
+// Вызывать после каждого изменения коллекции. Клиенты узнают о нём по WS
+// ("generation") и перезапрашивают данные — получат 200 с новым ETag.
+// Событие — через очередь отправки WsBus: зовут и из loop()
+void bumpGeneration(Collection c) {
+  uint32_t gen;
+  {
+    Sync::StateLock lock;
+    gen = ++collectionGeneration[(int)c];
+  }
+  WsBus::postf("generation", "{\"collection\":\"%s\",\"generation\":%u}", COLLECTION_NAMES[(int)c], (unsigned)gen);
 }
 
-void sendLog(String message, const char* type = "info") {
-  String logData = "{\"message\":\"" + jsonEscape(message) + "\",\"type\":\"" + jsonEscape(String(type)) + "\"}";
-  sendWebSocketEvent("log", logData.c_str());
+static String collectionETag(Collection c) {
+  char buf[40];
+  uint32_t argsCrc = 0;
+  for (int i = 0; i < server.args(); i++) {
+    if (server.argName(i) == "plain") continue;
+    String pair = server.argName(i) + "=" + server.arg(i) + "&";
+    argsCrc = crc32Update(argsCrc, pair.c_str(), pair.length());
+  }
+  snprintf(buf, sizeof(buf), "\"%08x-%u-%08x\"", (unsigned)bootNonce,
+           (unsigned)collectionGeneration[(int)c], (unsigned)argsCrc);
+  return String(buf);
+}
+
+// Выставляет ETag и при совпадении с If-None-Match сразу отвечает 304.
+// @return true — ответ уже отправлен, обработчику делать ничего не нужно
+static bool respondNotModified(Collection c) {
+  String etag = collectionETag(c);
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", "no-cache"); // кэшировать можно, но всегда с ревалидацией
+  String inm = server.header("If-None-Match");
+  if (inm.length() > 0 && (inm == "*" || inm.indexOf(etag) >= 0)) {
+    server.send(304);
+    return true;
+  }
+  return false;
+}
+
+// --- Статика фронтенда ---
+// Сборка (make-ota.sh / upload.sh) сжимает js/css/html gzip'ом НА МЕСТЕ, имя
+// файла не меняется: у SPIFFS лимит 31 символ на путь, а
+// "/static/css/main.<hash>.css.gz" — уже 32. Сжатый файл узнаём по сигнатуре
+// gzip (1f 8b), так что образ старой несжатой сборки тоже отдаётся корректно.
+// Brotli браузеры просят только по HTTPS, поэтому только gzip.
+
+static const char* staticContentType(const String& path) {
+  static const struct { const char* ext; const char* type; } TYPES[] = {
+    { ".js",    "application/javascript" },
+    { ".css",   "text/css" },
+    { ".html",  "text/html" },
+    { ".json",  "application/json" },
+    { ".svg",   "image/svg+xml" },
+    { ".png",   "image/png" },
+    { ".ico",   "image/x-icon" },
+    { ".woff2", "font/woff2" },
+  };
+  for (const auto& t : TYPES) {
+    if (path.endsWith(t.ext)) return t.type;
+  }
+  return "text/plain";
+}
+
+static bool isGzipFile(File& file) {
+  uint8_t magic[2];
+  bool gz = file.read(magic, 2) == 2 && magic[0] == 0x1F && magic[1] == 0x8B;
+  file.seek(0);
+  return gz;
+}
+
+// Отдача файла SPIFFS как есть (сжатый — с Content-Encoding, браузер распакует сам).
+// Кэш-заголовки выставляет вызывающий.
+static void streamStaticFile(File& file, const String& path) {
+  if (isGzipFile(file)) server.sendHeader("Content-Encoding", "gzip");
+  server.streamFile(file, staticContentType(path));
 }
 
 // --- Функции веб-сервера ---
+// index.html не кэшируется насовсем (в нём ссылки на текущие хэши бандла), но
+// ревалидируется по ETag: повторный визит — 304 без тела. ETag — CRC32 файла,
+// считается один раз: SPIFFS меняется только через OTA, а после неё перезагрузка.
 void handleRoot() {
-  if (SPIFFS.exists("/index.html")) {
-    File file = SPIFFS.open("/index.html", "r");
-    server.streamFile(file, "text/html");
-    file.close();
-  } else {
+  if (!SPIFFS.exists("/index.html")) {
     server.send(404, "text/plain", "index.html not found");
+    return;
+  }
+  File file = SPIFFS.open("/index.html", "r");
+
+  static String indexETag;
+  if (indexETag.length() == 0) {
+    uint8_t buf[256];
+    uint32_t crc = 0;
+    int n;
+    while ((n = file.read(buf, sizeof(buf))) > 0) crc = crc32Update(crc, buf, n);
+    file.seek(0);
+    char etag[12];
+    snprintf(etag, sizeof(etag), "\"%08x\"", (unsigned)crc);
+    indexETag = etag;
+  }
+
+  server.sendHeader("ETag", indexETag);
+  server.sendHeader("Cache-Control", "no-cache");
+  if (server.header("If-None-Match").indexOf(indexETag) >= 0) {
+    file.close();
+    server.send(304);
+    return;
   }
+  streamStaticFile(file, "/index.html");
+  file.close();
 }
 
-// Обработка WiFi сканирования
-void handleWiFiScan() {
-  Serial.println("[API] WiFi Scan запрошен");
+// --- Асинхронное сканирование WiFi ---
+// WiFi.scanNetworks() блокирует вызывающего на 2-5 с, поэтому запрос только
+// запускает сканирование (scanNetworks(true)) и сразу отвечает последним
+// известным списком; httpTask опрашивает scanComplete() и по готовности
+// кладёт результат в кэш wifiNetworks и рассылает его событием "wifi_scan".
+// Все переменные ниже трогает только httpTask — блокировки не нужны.
+static const unsigned long WIFI_SCAN_FRESH_MS = 15000;   // кэш моложе — новый скан не запускаем
+static const unsigned long WIFI_SCAN_TIMEOUT_MS = 20000; // драйвер не ответил — сбрасываем
+static bool wifiScanRunning = false;
+static bool wifiScanValid = false;          // в wifiNetworks есть результат хотя бы одного скана
+static unsigned long wifiScanStartedAt = 0;
+static unsigned long wifiScanAt = 0;        // время завершения последнего скана
+
+static void startWiFiScan() {
+  if (wifiScanRunning) return;
+  WiFi.scanDelete();
+  if (WiFi.scanNetworks(true) == WIFI_SCAN_FAILED) {
+    sendLog("❌ Не удалось запустить сканирование WiFi", "error");
+    return;
+  }
+  wifiScanRunning = true;
+  wifiScanStartedAt = millis();
   sendLog("🔍 Сканирование WiFi сетей...", "info");
-  
-  int n = WiFi.scanNetworks();
+}
+
+// Вызывается из httpTask на каждой итерации
+void pollWiFiScan() {
+  if (!wifiScanRunning) return;
+
+  int n = WiFi.scanComplete();
+  if (n == WIFI_SCAN_RUNNING) {
+    if (millis() - wifiScanStartedAt > WIFI_SCAN_TIMEOUT_MS) {
+      WiFi.scanDelete();
+      wifiScanRunning = false;
+      sendLog("⚠️ Сканирование WiFi не завершилось вовремя", "warning");
+    }
+    return;
+  }
+  wifiScanRunning = false;
+  if (n < 0) {
+    sendLog("❌ Ошибка сканирования WiFi", "error");
+    return;
+  }
+
   wifiNetworks.clear();
-  sendLog("📡 Найдено сетей: " + String(n), "success");
-  
-  JsonDocument doc;
-  JsonArray networks = doc.to<JsonArray>();
-  
+  wifiNetworks.reserve(n);
   for (int i = 0; i < n; i++) {
-    JsonObject network = networks.add<JsonObject>();
-    network["ssid"] = WiFi.SSID(i);
-    network["rssi"] = WiFi.RSSI(i);
-    network["encryption"] = (WiFi.encryptionType(i) == WIFI_AUTH_OPEN) ? 0 : 1;
-    
     WiFiNetwork wifiNet;
     wifiNet.ssid = WiFi.SSID(i);
     wifiNet.rssi = WiFi.RSSI(i);
     wifiNet.encryption = (WiFi.encryptionType(i) == WIFI_AUTH_OPEN) ? 0 : 1;
     wifiNetworks.push_back(wifiNet);
   }
-  
-  String response;
-  serializeJson(doc, response);
-  server.send(200, "application/json", response);
+  WiFi.scanDelete(); // копия уже в кэше — освобождаем результаты драйвера
+  wifiScanValid = true;
+  wifiScanAt = millis();
+  sendLog("📡 Найдено сетей: " + String(n), "success");
+
+  JsonDocument doc;
+  JsonArray networks = doc["networks"].to<JsonArray>();
+  for (const WiFiNetwork& wifiNet : wifiNetworks) {
+    JsonObject network = networks.add<JsonObject>();
+    network["ssid"] = wifiNet.ssid;
+    network["rssi"] = wifiNet.rssi;
+    network["encryption"] = wifiNet.encryption;
+  }
+  String data;
+  serializeJson(doc, data);
+  WsBus::publish("wifi_scan", data.c_str());
+}
+
+// Обработка WiFi сканирования: 200 — свежий кэш, 202 — скан запущен,
+// в теле последний известный список (возможно пустой), результат придёт по WS
+void handleWiFiScan() {
+  bool fresh = wifiScanValid && millis() - wifiScanAt < WIFI_SCAN_FRESH_MS;
+  if (!fresh) startWiFiScan();
+
+  server.sendHeader("X-Scan-State", wifiScanRunning ? "scanning" : "ready");
+  if (wifiScanValid) server.sendHeader("X-Scan-Age", String((millis() - wifiScanAt) / 1000));
+
+  JsonArrayStream stream(server);
+  stream.begin(wifiScanRunning ? 202 : 200);
+  for (const WiFiNetwork& wifiNet : wifiNetworks) {
+    stream.add([&wifiNet](JsonObject network) {
+      network["ssid"] = wifiNet.ssid;
+      network["rssi"] = wifiNet.rssi;
+      network["encryption"] = wifiNet.encryption;
+    });
+  }
+  stream.end();
 }
 
 
@@ -342,9 +557,12 @@ void handleWiFiConnect() {
   JsonDocument response;
   if (WiFi.status() == WL_CONNECTED) {
     // Сохраняем только заведомо рабочие креды
-    systemState.wifiSSID = ssid;
-    systemState.wifiPassword = password;
-    systemState.wifiConnected = true;
+    {
+      Sync::StateLock lock;
+      systemState.wifiSSID = ssid;
+      systemState.wifiPassword = password;
+      systemState.wifiConnected = true;
+    }
     saveSystemState();
 
     response["success"] = true;
@@ -356,7 +574,7 @@ void handleWiFiConnect() {
     
     // Отправляем обновление статуса через WebSocket
     String wifiStatus = "{\"status\":\"connected\",\"ssid\":\"" + jsonEscape(WiFi.SSID()) + "\",\"rssi\":" + String(WiFi.RSSI()) + ",\"ip\":\"" + WiFi.localIP().toString() + "\"}";
-    sendWebSocketEvent("wifi_status", wifiStatus.c_str());
+    WsBus::publishState("wifi_status", wifiStatus.c_str());
   } else {
     response["success"] = false;
     response["error"] = "Connection failed";
@@ -369,66 +587,14 @@ void handleWiFiConnect() {
   server.send(200, "application/json", responseStr);
 }
 
-// Инициализация раздела userdata (вызывается один раз в setup)
-void initUserDataPartition() {
-  esp_err_t err = nvs_flash_init_partition("userdata");
-  if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-    // Раздел повреждён — форматируем и инициализируем заново
-    Serial.println("[NVS] Форматирование раздела userdata...");
-    nvs_flash_erase_partition("userdata");
-    err = nvs_flash_init_partition("userdata");
-  }
-  if (err != ESP_OK) {
-    Serial.printf("[NVS] ОШИБКА инициализации userdata: %s\n", esp_err_to_name(err));
-  } else {
-    Serial.println("[NVS] Раздел userdata инициализирован");
-  }
-}
-
-// Сохранение строки в раздел userdata
-bool saveToUserData(const char* key, const String& value) {
-  nvs_handle_t handle;
-  esp_err_t err = nvs_open_from_partition("userdata", "state", NVS_READWRITE, &handle);
-  if (err != ESP_OK) {
-    Serial.printf("[NVS] Ошибка открытия userdata: %s\n", esp_err_to_name(err));
-    return false;
-  }
-  err = nvs_set_blob(handle, key, value.c_str(), value.length() + 1);
-  if (err == ESP_OK) {
-    nvs_commit(handle);
-  }
-  nvs_close(handle);
-  return err == ESP_OK;
-}
-
-// Чтение строки из раздела userdata
-String loadFromUserData(const char* key) {
-  nvs_handle_t handle;
-  esp_err_t err = nvs_open_from_partition("userdata", "state", NVS_READONLY, &handle);
-  if (err != ESP_OK) {
-    return "{}";
-  }
-  size_t required_size = 0;
-  err = nvs_get_blob(handle, key, NULL, &required_size);
-  if (err != ESP_OK || required_size == 0) {
-    nvs_close(handle);
-    return "{}";
-  }
-  char* buf = (char*)malloc(required_size);
-  if (!buf) {
-    nvs_close(handle);
-    return "{}";
-  }
-  err = nvs_get_blob(handle, key, buf, &required_size);
-  String result = (err == ESP_OK) ? String(buf) : String("{}");
-  free(buf);
-  nvs_close(handle);
-  return result;
-}
+// Номер последнего снимка состояния (под StateLock) и последнего записанного
+// во флеш (под StoreLock): снимок старше записанного не пишется
+static uint32_t stateSnapshotSeq = 0;
+static uint32_t stateWrittenSeq = 0;
 
-// Сохранение всего состояния системы в раздел userdata
-// Возвращает true при успешной записи, false при ошибке (переполнение JSON или сбой NVS).
-bool saveSystemState() {
+// Снимок systemState в JSON (под StateLock). false — JSON переполнен
+static bool snapshotSystemState(String& jsonString) {
+  Sync::StateLock lock;
   JsonDocument doc;
 
   // Сохраняем телефоны
@@ -438,6 +604,8 @@ bool saveSystemState() {
     phoneObj["number"] = phone.number;
     phoneObj["smsEnabled"] = phone.smsEnabled;
     phoneObj["callEnabled"] = phone.callEnabled;
+    phoneObj["gates"] = phone.gates;
+    if (phone.schedule.length() > 0) phoneObj["schedule"] = phone.schedule;
   }
 
   // Сохраняем ключи
@@ -456,6 +624,8 @@ bool saveSystemState() {
     keyObj["rawData"] = key.rawData;
     keyObj["rssi"] = key.rssi;
     keyObj["timestamp"] = key.timestamp;
+    keyObj["gates"] = key.gates;
+    if (key.schedule.length() > 0) keyObj["schedule"] = key.schedule;
   }
 
   // Сохраняем WiFi настройки
@@ -478,155 +648,181 @@ bool saveSystemState() {
   // Сохраняем счётчик открытий
   doc["gateOpenCount"] = systemState.gateOpenCount;
 
-  // Тайминги цикла ворот
-  doc["gateTimings"]["open"] = systemState.gateOpenSec;
-  doc["gateTimings"]["stay"] = systemState.gateStaySec;
-  doc["gateTimings"]["close"] = systemState.gateCloseSec;
+  // Настройки ворот — все MAX_GATES: сборка с меньшим GATE_COUNT их не теряет
+  JsonArray gatesArray = doc["gates"].to<JsonArray>();
+  for (const auto& gate : systemState.gateConfig) {
+    JsonObject gateObj = gatesArray.add<JsonObject>();
+    gateObj["name"] = gate.name;
+    gateObj["open"] = gate.openSec;
+    gateObj["stay"] = gate.staySec;
+    gateObj["close"] = gate.closeSec;
+  }
+
+  // Расписания доступа — текстом, карты недели строятся при загрузке
+  JsonArray schedulesArray = doc["schedules"].to<JsonArray>();
+  for (const auto& schedule : systemState.schedules) {
+    JsonObject scheduleObj = schedulesArray.add<JsonObject>();
+    scheduleObj["name"] = schedule.name;
+    scheduleObj["rules"] = schedule.rules;
+  }
+  doc["timeZone"] = systemState.timeZoneMin;
 
   // Защита от потери данных: при нехватке heap ArduinoJson молча пропускает
   // добавление элементов и serializeJson выдаёт синтаксически валидный, но
-  // НЕПОЛНЫЙ JSON. Записать его поверх единственной копии состояния = потерять
-  // часть ключей/телефонов навсегда. Поэтому при переполнении не пишем.
+  // НЕПОЛНЫЙ JSON. CRC слота его не спасёт (он честно посчитан по неполным
+  // данным), и через одну запись он вытеснит обе копии. Поэтому при переполнении не пишем.
   if (doc.overflowed()) {
     Serial.println("[NVS] ОШИБКА: JSON состояния переполнен (нехватка памяти) — запись отменена, чтобы не потерять данные!");
     sendLog("❌ Недостаточно памяти для сохранения — данные НЕ перезаписаны", "error");
     return false;
   }
 
-  String jsonString;
   serializeJson(doc, jsonString);
+  return true;
+}
 
-  if (saveToUserData("state", jsonString)) {
-    Serial.println("[NVS] Состояние сохранено в userdata (" + String(jsonString.length()) + " байт)");
-    return true;
-  } else {
+// Сохранение всего состояния системы в раздел userdata
+// Возвращает true при успешной записи, false при ошибке (переполнение JSON или сбой NVS).
+// Под StateLock — только снимок; запись во флеш (десятки мс) идёт без него,
+// чтобы HTTP-запрос на запись не держал loop() и приём брелоков. Вызывать
+// ПОСЛЕ своей секции StateLock: внутри неё запись снова держала бы loop().
+bool saveSystemState() {
+  Metrics::ScopedTimer timer(Metrics::HIST_STATE_SAVE);
+  String jsonString;
+  uint32_t seq;
+  uint32_t settingsChanges;
+  {
+    Sync::StateLock lock;
+    if (!snapshotSystemState(jsonString)) return false;
+    seq = ++stateSnapshotSeq;
+    settingsChanges = Settings::stats().changes;
+  }
+
+  bool saved;
+  {
+    Sync::StoreLock store;
+    // Другая задача уже записала более новый снимок — в нём есть и эти изменения
+    if (seq < stateWrittenSeq) return true;
+    saved = StateStore::save(jsonString);
+    if (saved) {
+      stateWrittenSeq = seq;
+      Serial.printf("[NVS] Состояние сохранено в слот %d, поколение %u (%u байт)\n",
+                    StateStore::activeSlot(), (unsigned)StateStore::generation(), (unsigned)jsonString.length());
+    }
+  }
+  if (!saved) {
     Serial.println("[NVS] ОШИБКА сохранения в userdata!");
     return false;
   }
+
+  // Настройки, изменённые после снимка, в него не попали — остаются «грязными»
+  Sync::StateLock lock;
+  if (Settings::stats().changes == settingsChanges) Settings::markCommitted();
+  return true;
 }
 
-// Троттлинг записи счётчика открытий: полный blob состояния (все ключи/телефоны)
-// писать в NVS на КАЖДОЕ открытие ворот — это износ флеша и блокировка приёмного
-// цикла на время nvs_commit. Инкремент держим в RAM, во флеш сбрасываем не чаще
-// раза в 5 минут (см. также периодический flush в loop()).
-static unsigned long lastGateCountSave = 0;
+// Счётчик открытий: полный blob состояния (все ключи/телефоны) писать в NVS
+// на КАЖДОЕ открытие ворот — это износ флеша и nvs_commit на пути решения по
+// брелоку. Открытие только помечает счётчик, во флеш его сбрасывает задание
+// gate_count_flush раз в 5 минут (jobGateCountFlush). Только задача loop
 static bool gateCountDirty = false;
 static const unsigned long GATE_COUNT_SAVE_INTERVAL_MS = 300000; // 5 минут
 
-void persistGateCountThrottled() {
-  gateCountDirty = true;
-  unsigned long now = millis();
-  if (now - lastGateCountSave >= GATE_COUNT_SAVE_INTERVAL_MS) {
-    if (saveSystemState()) {
-      lastGateCountSave = now;
-      gateCountDirty = false;
-    }
-  }
+// Запуск полного цикла ворот gate с их таймингами из настроек (страница «Настройки»)
+void startGateCycle(int gate) {
+  const SystemState::GateConfig& cfg = systemState.gateConfig[gate];
+  gates[gate].startCycle((unsigned long)cfg.openSec * 1000UL,
+                         (unsigned long)cfg.staySec * 1000UL,
+                         (unsigned long)cfg.closeSec * 1000UL);
 }
 
-// Запуск полного цикла ворот с таймингами из настроек (страница «Настройки»)
-void startGateCycle() {
-  GateControl::startCycle((unsigned long)systemState.gateOpenSec * 1000UL,
-                          (unsigned long)systemState.gateStaySec * 1000UL,
-                          (unsigned long)systemState.gateCloseSec * 1000UL);
+// Текущая фаза ворот (под StateLock)
+static EventBus::GatePhase gatePhaseNow(int gate) {
+  return {(uint8_t)gate, gates[gate].phaseName(), gates[gate].nextDirName(), gates[gate].positionNow()};
 }
 
-// Текущая фаза цикла ворот в JSON (для события gate_status и /api/gate/status)
-String gateStatusJson() {
-  return String("{\"phase\":\"") + GateControl::phaseName() +
-         "\",\"next\":\"" + GateControl::nextDirName() +
-         "\",\"position\":" + String(GateControl::positionNow(), 2) + "}";
+// Фаза одних ворот в JSON (для события gate_status и /api/gate/status)
+String gateStatusJson(const EventBus::GatePhase& p) {
+  return String("{\"gate\":") + p.gate + ",\"phase\":\"" + p.phase + "\",\"next\":\"" + p.next +
+         "\",\"position\":" + String(p.position, 2) + "}";
 }
 
-// Рассылка реальной фазы ворот в UI при каждой её смене (вызывается из loop)
-void broadcastGateStatus() {
-  static const char* lastPhase = nullptr;
-  const char* current = GateControl::phaseName(); // строковые литералы — сравнение по указателю корректно
-  if (current != lastPhase) {
-    lastPhase = current;
-    sendWebSocketEvent("gate_status", gateStatusJson().c_str());
+// Все ворота: поля ворот 1 на верхнем уровне (как при одних воротах) + массив "gates"
+String gateStatusJson(const EventBus::GatePhase phases[GATE_COUNT]) {
+  String json = String("{\"phase\":\"") + phases[0].phase + "\",\"next\":\"" + phases[0].next +
+                "\",\"position\":" + String(phases[0].position, 2) + ",\"gates\":[";
+  for (int i = 0; i < GATE_COUNT; i++) {
+    if (i > 0) json += ',';
+    json += gateStatusJson(phases[i]);
   }
+  json += "]}";
+  return json;
 }
 
-// Функция сравнения битовых строк с допуском
-bool compareBitStrings(const String& str1, const String& str2, float minSimilarity) {
-  if (str1.length() == 0 || str2.length() == 0) {
-    return false;
-  }
-  
-  int minLen = min(str1.length(), str2.length());
-  int maxLen = max(str1.length(), str2.length());
-  
-  if (minLen == 0) return false;
-  
-  // Сравниваем по минимальной длине
-  int matches = 0;
-  for (int i = 0; i < minLen; i++) {
-    if (str1[i] == str2[i]) {
-      matches++;
+// Публикация смены фазы ворот в шину (вызывается из loop); в UI её
+// рассылает подписчик в задаче http
+void broadcastGateStatus() {
+  static const char* lastPhase[GATE_COUNT] = {};
+  for (int i = 0; i < GATE_COUNT; i++) {
+    const char* current = gates[i].phaseName(); // строковые литералы — сравнение по указателю корректно
+    if (current != lastPhase[i]) {
+      lastPhase[i] = current;
+      EventBus::publishGatePhase(i, current, gates[i].nextDirName(), gates[i].positionNow());
     }
   }
-  
-  float similarity = static_cast<float>(matches) / maxLen;
-  return similarity >= minSimilarity;
-}
-
-// Функция улучшенного сравнения ключей
-// Проблема: один и тот же пульт может декодироваться как разные протоколы
-// (CAME 24-bit vs X10 20-bit и т.д.) из-за нестабильности декодера.
-// Решение: мягкое сравнение — приоритет bitString/code, протокол вторичен.
-bool isKeyMatch(const KeyEntry& saved, const ReceivedKey& received, const String& receivedBitString, int receivedBitLength, float receivedTe) {
-  // 1. Частота должна совпадать (допуск ±1 МГц)
-  float currentFreq = CC1101Manager::getFrequency();
-  float freqDiff = (saved.frequency > currentFreq) ?
-                   (saved.frequency - currentFreq) :
-                   (currentFreq - saved.frequency);
-  if (freqDiff > 1.0f) {
-    return false;
-  }
+}
 
-  // 2. Точное совпадение: протокол + bitString
-  if (saved.protocol == received.protocol &&
-      saved.bitString.length() > 0 && receivedBitString.length() > 0) {
-    if (saved.bitLength <= 32) {
-      if (saved.bitString == receivedBitString) return true;
-    } else {
-      if (compareBitStrings(saved.bitString, receivedBitString, 0.95f)) return true;
-    }
+// --- Подписчики EventBus ---
+static int gateSubscriber = -1;  // задача loop
+static int uiSubscriber = -1;    // задача http
+
+// Последние фазы всех ворот для gate_status — только задача http
+// (начальные значения — в setup(), до её запуска)
+static EventBus::GatePhase uiGatePhases[GATE_COUNT];
+
+// Команда «открыть ворота» — выполняется только в loop(), под StateLock.
+// Шаг цикла получают все ворота из маски команды
+static void onGateCommand(const EventBus::Event& event) {
+  uint8_t mask = event.gateCommand.gates & ALL_GATES;
+  if (mask == 0) {
+    LogQueue::postf(LogQueue::LEVEL_WARNING, LogQueue::SINK_SERIAL | LogQueue::SINK_WS,
+                    "[Ворота] Команда для ворот 0x%02X — их нет в этой сборке (GATE_COUNT=%d)",
+                    event.gateCommand.gates, GATE_COUNT);
+    return;
   }
-
-  // 3. Совпадение по коду (протокол может быть другим!)
-  // Один пульт CAME может детектиться то как CAME то как X10 — код при этом частично совпадает
-  if (saved.code != 0 && saved.code == received.code) {
-    // TE должен быть примерно одинаковым (допуск ±40%)
-    if (saved.te > 0 && receivedTe > 0) {
-      float teDiff = (saved.te > receivedTe) ? (saved.te / receivedTe) : (receivedTe / saved.te);
-      if (teDiff > 1.4f) return false;
-    }
-    return true;
+  for (int i = 0; i < GATE_COUNT; i++) {
+    if (mask & (1u << i)) startGateCycle(i);
   }
+  if (event.gateCommand.source == EventBus::SOURCE_RF) {
+    Metrics::observe(Metrics::HIST_PRESS_TO_RELAY, micros() - CC1101Manager::getLastSignalMicros());
+  }
+  systemState.gateOpenCount++;
+  gateCountDirty = true;
+}
 
-  // 4. Совпадение по bitString содержанию (разные протоколы, одни данные)
-  // Если одна bitString содержит другую — это тот же пульт, просто декодировалось
-  // разное количество бит (напр. CAME 24 vs X10 20 — первые 20 бит одинаковые)
-  if (saved.bitString.length() >= 12 && receivedBitString.length() >= 12) {
-    const String& shorter = (saved.bitString.length() <= receivedBitString.length()) ? saved.bitString : receivedBitString;
-    const String& longer = (saved.bitString.length() > receivedBitString.length()) ? saved.bitString : receivedBitString;
+// Смена фазы ворот → событие gate_status (задача http, без StateLock)
+static void onGatePhase(const EventBus::Event& event) {
+  const EventBus::GatePhase& p = event.gatePhase;
+  if (p.gate >= GATE_COUNT) return;
+  uiGatePhases[p.gate] = p;
+  WsBus::publishState("gate_status", gateStatusJson(uiGatePhases).c_str());
+}
 
-    // Проверяем что короткая строка является подстрокой длинной (начиная с начала или конца)
-    if (longer.startsWith(shorter) || longer.endsWith(shorter)) {
-      // Дополнительно проверяем TE (допуск ±40%)
-      if (saved.te > 0 && receivedTe > 0) {
-        float teDiff = (saved.te > receivedTe) ? (saved.te / receivedTe) : (receivedTe / saved.te);
-        if (teDiff > 1.4f) return false;
-      }
-      Serial.printf("[KeyMatch] Совпадение по bitString подстроке: saved=%s recv=%s\n",
-                    saved.protocol.c_str(), received.protocol.c_str());
-      return true;
-    }
-  }
+// Событие key_received — в очередь отправки WsBus (разошлёт httpTask), без
+// String. Поля от декодера (имена протоколов, биты) в экранировании не нуждаются
+static void postKeyReceived(const ReceivedKey& key) {
+  WsBus::postf("key_received",
+               "{\"code\":%u,\"rawData\":\"%s\",\"bitString\":\"%s\",\"bitLength\":%d,\"rssi\":%d,"
+               "\"snr\":%.2f,\"frequency\":%.2f,\"protocol\":\"%s\",\"modulation\":\"%s\","
+               "\"timestamp\":%lu,\"hash\":%u}",
+               (unsigned)key.code, key.rawData.c_str(), key.bitString.c_str(), key.bitLength, key.rssi,
+               key.snr, CC1101Manager::getFrequency(), key.protocol.c_str(), key.modulation.c_str(),
+               key.timestamp, (unsigned)key.hash);
+}
 
-  return false;
+// Отпечаток сохранённого ключа для AccessDecision::findKey
+static AccessDecision::Signature keySignature(const KeyEntry& key) {
+  return {key.protocol.c_str(), key.bitString.c_str(), key.bitLength, key.code, key.te, key.frequency};
 }
 
 // Функция верификации сигнала (адаптивная)
@@ -680,7 +876,8 @@ bool verifyKeySignal(const ReceivedKey& received, const String& bitString, int b
   for (auto& rec : systemState.pendingRecognitions) {
     if (rec.protocol == received.protocol &&
         rec.code == received.code &&
-        (bitString.length() == 0 || compareBitStrings(rec.bitString, bitString, 0.95f))) {
+        (bitString.length() == 0 ||
+         AccessDecision::bitStringsSimilar(rec.bitString.c_str(), bitString.c_str(), 0.95f))) {
       recognition = &rec;
       break;
     }
@@ -854,16 +1051,22 @@ bool isDuplicateForDisplay(const ReceivedKey& key) {
 
 // Загрузка всего состояния системы из раздела userdata
 void loadSystemState() {
-  String jsonString = loadFromUserData("state");
-
   JsonDocument doc;
-  DeserializationError parseErr = deserializeJson(doc, jsonString);
-  if (parseErr && jsonString != "{}") {
-    // Повреждённый blob: не молчим (иначе состояние тихо станет пустым и при
-    // следующей записи затрёт данные). Предупреждаем в Serial; парсинг пустого
-    // doc ниже даст дефолты, существующие ключи в blob не трогаются до записи.
-    Serial.printf("[NVS] ВНИМАНИЕ: не удалось разобрать состояние (%s). Используются значения по умолчанию.\n",
-                  parseErr.c_str());
+  stateLoadResult = StateStore::load([&doc](const String& json) {
+    DeserializationError parseErr = deserializeJson(doc, json);
+    if (parseErr) {
+      Serial.printf("[NVS] Не удалось разобрать состояние (%s)\n", parseErr.c_str());
+      doc.clear();
+      return false;
+    }
+    return true;
+  });
+  if (stateLoadResult == StateStore::LoadResult::FALLBACK) {
+    Serial.println("[NVS] ВНИМАНИЕ: последняя запись состояния повреждена, загружена предыдущая версия");
+  } else if (stateLoadResult == StateStore::LoadResult::CORRUPT) {
+    // Ни один слот не прошёл CRC/разбор: работаем на дефолтах. Данные в NVS
+    // не трогаются, пока не будет первой записи (и то только в один слот).
+    Serial.println("[NVS] ВНИМАНИЕ: состояние повреждено во всех слотах. Используются значения по умолчанию.");
   }
 
   // Очищаем текущее состояние
@@ -878,6 +1081,8 @@ void loadSystemState() {
       phone.number = phoneObj["number"].as<String>();
       phone.smsEnabled = phoneObj["smsEnabled"].as<bool>();
       phone.callEnabled = phoneObj["callEnabled"].as<bool>();
+      phone.gates = phoneObj["gates"] | 1;
+      phone.schedule = phoneObj["schedule"] | "";
       systemState.phones.push_back(phone);
     }
   }
@@ -899,6 +1104,8 @@ void loadSystemState() {
       key.rawData = keyObj["rawData"] | "";
       key.rssi = keyObj["rssi"] | 0;
       key.timestamp = keyObj["timestamp"].as<unsigned long>();
+      key.gates = keyObj["gates"] | 1;
+      key.schedule = keyObj["schedule"] | "";
       
       // Миграция старых ключей: если нет bitLength, пытаемся определить из протокола
       if (key.bitLength == 0 && key.protocol != "RAW/Custom" && key.protocol != "RAW/Unknown") {
@@ -950,10 +1157,30 @@ void loadSystemState() {
   // Загружаем счётчик открытий
   systemState.gateOpenCount = doc["gateOpenCount"] | 0;
 
-  // Тайминги цикла ворот (дефолты совпадают с фронтендом)
-  systemState.gateOpenSec = doc["gateTimings"]["open"] | 3;
-  systemState.gateStaySec = doc["gateTimings"]["stay"] | 15;
-  systemState.gateCloseSec = doc["gateTimings"]["close"] | 3;
+  // Настройки ворот (дефолты таймингов совпадают с фронтендом). Состояние
+  // прошивки с одними воротами хранило только "gateTimings" — это ворота 1
+  JsonArray gatesArray = doc["gates"].as<JsonArray>();
+  for (int i = 0; i < GateControl::MAX_GATES; i++) {
+    JsonObject gateObj = gatesArray[i].as<JsonObject>();
+    if (gateObj.isNull() && i == 0) gateObj = doc["gateTimings"].as<JsonObject>();
+    SystemState::GateConfig& gate = systemState.gateConfig[i];
+    gate.name = gateObj["name"] | "";
+    if (gate.name.length() == 0) gate.name = "Ворота " + String(i + 1);
+    gate.openSec = gateObj["open"] | 3;
+    gate.staySec = gateObj["stay"] | 15;
+    gate.closeSec = gateObj["close"] | 3;
+  }
+
+  // Расписания доступа и их id у ключей и телефонов (заодно индекс телефонов)
+  systemState.schedules.clear();
+  for (JsonObject scheduleObj : doc["schedules"].as<JsonArray>()) {
+    SystemState::ScheduleEntry schedule;
+    schedule.name = scheduleObj["name"].as<String>();
+    schedule.rules = scheduleObj["rules"].as<String>();
+    systemState.schedules.push_back(schedule);
+  }
+  systemState.timeZoneMin = doc["timeZone"] | 180;
+  rebuildSchedules();
   
   // Принудительно сбрасываем режим обучения при загрузке
   systemState.learningMode = false;
@@ -964,23 +1191,212 @@ void loadSystemState() {
 
 
 
+// --- Выборка списков: пагинация, фильтры, проекция полей ---
+// GET /api/keys, /api/phones и /api/system/log принимают:
+//   limit=N     — размер страницы (без limit/after — весь список, как раньше)
+//   after=C     — курсор из заголовка X-Next-Cursor предыдущей страницы
+//   fields=a,b  — только перечисленные поля записи
+// Ключи с limit/after идут по возрастанию code, телефоны — по номеру: курсор —
+// сам ключ записи, а не позиция в векторе, поэтому удаление между запросами
+// страницы не сдвигает. Страница набирается за один проход кучей на limit
+// элементов: память пропорциональна странице, а не базе.
+
+static const size_t LIST_MAX_LIMIT = 500;
+static const uint32_t ALL_FIELDS = 0xFFFFFFFF;
+
+static const char* const KEY_FIELD_NAMES[] = {
+  "code", "name", "enabled", "protocol", "bitString", "bitLength",
+  "te", "frequency", "modulation", "rawData", "rssi", "timestamp", "gates", "schedule"
+};
+static const int KEY_FIELD_COUNT = sizeof(KEY_FIELD_NAMES) / sizeof(KEY_FIELD_NAMES[0]);
+
+static const char* const PHONE_FIELD_NAMES[] = { "number", "smsEnabled", "callEnabled", "gates", "schedule" };
+static const int PHONE_FIELD_COUNT = sizeof(PHONE_FIELD_NAMES) / sizeof(PHONE_FIELD_NAMES[0]);
+
+static const char* const LOG_FIELD_NAMES[] = { "time", "message" };
+static const int LOG_FIELD_COUNT = sizeof(LOG_FIELD_NAMES) / sizeof(LOG_FIELD_NAMES[0]);
+
+// Маска полей из ?fields= (бит i ↔ names[i]). Без параметра — все поля.
+// Неизвестное имя → false, имя возвращается в unknown для ответа 400.
+static bool parseFieldsArg(const char* const names[], int count, uint32_t& mask, String& unknown) {
+  mask = ALL_FIELDS;
+  if (!server.hasArg("fields")) return true;
+  String list = server.arg("fields");
+  mask = 0;
+  int start = 0;
+  while (start <= (int)list.length()) {
+    int comma = list.indexOf(',', start);
+    if (comma < 0) comma = list.length();
+    String name = list.substring(start, comma);
+    name.trim();
+    if (name.length() > 0) {
+      int i = 0;
+      while (i < count && name != names[i]) i++;
+      if (i == count) {
+        unknown = name;
+        return false;
+      }
+      mask |= (1u << i);
+    }
+    start = comma + 1;
+  }
+  return true;
+}
+
+// limit/after → режим страниц. false — весь список без курсора (старое поведение).
+static bool parsePageArgs(size_t& limit) {
+  long requested = server.hasArg("limit") ? server.arg("limit").toInt() : 0;
+  if (requested <= 0 && !server.hasArg("after")) return false;
+  limit = (requested <= 0 || requested > (long)LIST_MAX_LIMIT) ? LIST_MAX_LIMIT : (size_t)requested;
+  return true;
+}
+
+// Индексы следующей страницы по возрастанию keyOf(i), строго после after.
+// more = true, если за страницей остались подходящие записи.
+template <typename KeyT, typename KeyOf, typename Match>
+static std::vector<size_t> selectPage(size_t itemCount, KeyOf keyOf, Match match,
+                                      bool hasAfter, const KeyT& after, size_t limit, bool& more) {
+  // max-heap: на вершине наибольший из отобранных — его и вытесняем
+  auto byKey = [&keyOf](size_t a, size_t b) { return keyOf(a) < keyOf(b); };
+  std::vector<size_t> page;
+  page.reserve(limit);
+  more = false;
+  for (size_t i = 0; i < itemCount; i++) {
+    if (!match(i)) continue;
+    if (hasAfter && !(after < keyOf(i))) continue;
+    if (page.size() < limit) {
+      page.push_back(i);
+      std::push_heap(page.begin(), page.end(), byKey);
+    } else {
+      more = true;
+      if (keyOf(i) < keyOf(page.front())) {
+        std::pop_heap(page.begin(), page.end(), byKey);
+        page.back() = i;
+        std::push_heap(page.begin(), page.end(), byKey);
+      }
+    }
+  }
+  std::sort_heap(page.begin(), page.end(), byKey);
+  return page;
+}
+
+static void sendFieldError(const String& unknown) {
+  server.send(400, "application/json", "{\"success\":false,\"error\":\"Неизвестное поле: " + jsonEscape(unknown) + "\"}");
+}
+
+static void fillKeyJson(JsonObject obj, const KeyEntry& key, uint32_t fields = ALL_FIELDS) {
+  if (fields & (1u << 0))  obj["code"] = key.code;
+  if (fields & (1u << 1))  obj["name"] = key.name;
+  if (fields & (1u << 2))  obj["enabled"] = key.enabled;
+  if (fields & (1u << 3))  obj["protocol"] = key.protocol;
+  if (fields & (1u << 4))  obj["bitString"] = key.bitString;
+  if (fields & (1u << 5))  obj["bitLength"] = key.bitLength;
+  if (fields & (1u << 6))  obj["te"] = key.te;
+  if (fields & (1u << 7))  obj["frequency"] = key.frequency;
+  if (fields & (1u << 8))  obj["modulation"] = key.modulation;
+  if (fields & (1u << 9))  obj["rawData"] = key.rawData;
+  if (fields & (1u << 10)) obj["rssi"] = key.rssi;
+  if (fields & (1u << 11)) obj["timestamp"] = key.timestamp;
+  if (fields & (1u << 12)) obj["gates"] = key.gates;
+  if (fields & (1u << 13)) obj["schedule"] = key.schedule;
+}
+
+static void fillPhoneJson(JsonObject obj, const PhoneEntry& phone, uint32_t fields = ALL_FIELDS) {
+  if (fields & (1u << 0)) {
+    obj["id"] = phone.number; // Используем номер как ID
+    obj["number"] = phone.number;
+  }
+  if (fields & (1u << 1)) obj["smsEnabled"] = phone.smsEnabled;
+  if (fields & (1u << 2)) obj["callEnabled"] = phone.callEnabled;
+  if (fields & (1u << 3)) obj["gates"] = phone.gates;
+  if (fields & (1u << 4)) obj["schedule"] = phone.schedule;
+}
+
+// Маска ворот ключа/телефона: бит i — ворота i, хотя бы одни. Биты ворот,
+// которых нет в этой сборке, допустимы (команда на них просто не уходит)
+static bool validGateMask(long mask) {
+  return mask > 0 && mask < (1L << GateControl::MAX_GATES);
+}
+
+// id расписания по имени: позиция в systemState.schedules + 1 (таблица Schedule
+// строится в том же порядке). Пустое имя — без ограничений, неизвестное — MISSING
+static uint8_t scheduleIdOf(const String& name) {
+  if (name.length() == 0) return Schedule::ALWAYS;
+  for (size_t i = 0; i < systemState.schedules.size() && i < (size_t)Schedule::MAX_SCHEDULES; i++) {
+    if (systemState.schedules[i].name == name) return (uint8_t)(i + 1);
+  }
+  return Schedule::MISSING;
+}
+
+// Ссылка ключа/телефона на расписание: пусто (без ограничений) или имя
+// существующего расписания. Вызывать под StateLock
+static bool validScheduleRef(const String& name) {
+  return scheduleIdOf(name) != Schedule::MISSING;
+}
+
 // Обработка списка телефонов
 void handlePhonesAPI() {
   if (server.method() == HTTP_GET) {
-    JsonDocument doc;
-    JsonArray phonesArray = doc.to<JsonArray>();
-    
-    for (const auto& phone : systemState.phones) {
-      JsonObject obj = phonesArray.add<JsonObject>();
-      obj["id"] = phone.number; // Используем номер как ID
-      obj["number"] = phone.number;
-      obj["smsEnabled"] = phone.smsEnabled;
-      obj["callEnabled"] = phone.callEnabled;
+    if (respondNotModified(Collection::PHONES)) return;
+    uint32_t fields;
+    String unknown;
+    if (!parseFieldsArg(PHONE_FIELD_NAMES, PHONE_FIELD_COUNT, fields, unknown)) {
+      sendFieldError(unknown);
+      return;
     }
-    
-    String response;
-    serializeJson(doc, response);
-    server.send(200, "application/json", response);
+    String prefix = server.arg("prefix");
+    const std::vector<PhoneEntry>& phones = systemState.phones;
+    auto match = [&](size_t i) { return prefix.length() == 0 || phones[i].number.startsWith(prefix); };
+
+    // Потоково, по одной записи: память не зависит от размера списка.
+    // Запись копируется под StateLock, в сеть уходит уже без него.
+    JsonArrayStream stream(server);
+    size_t limit;
+    if (parsePageArgs(limit)) {
+      std::vector<size_t> page;
+      std::vector<String> numbers;  // номера страницы: индексы сдвигает удаление
+      {
+        Sync::StateLock lock;
+        bool more;
+        String after = server.arg("after");
+        page = selectPage(phones.size(),
+            [&phones](size_t i) -> const String& { return phones[i].number; },
+            match, server.hasArg("after"), after, limit, more);
+        if (more) server.sendHeader("X-Next-Cursor", phones[page.back()].number);
+        numbers.reserve(page.size());
+        for (size_t i : page) numbers.push_back(phones[i].number);
+      }
+      stream.begin();
+      for (size_t n = 0; n < page.size(); n++) {
+        PhoneEntry phone;
+        {
+          Sync::StateLock lock;
+          // Пока отдавали страницу, список мог измениться: запись ищется по
+          // номеру заново и снова проверяется фильтром
+          size_t i = page[n];
+          if (i >= phones.size() || phones[i].number != numbers[n]) {
+            i = std::find_if(phones.begin(), phones.end(),
+                             [&](const PhoneEntry& p) { return p.number == numbers[n]; }) - phones.begin();
+          }
+          if (i >= phones.size() || !match(i)) continue;
+          phone = phones[i];
+        }
+        stream.add([&](JsonObject obj) { fillPhoneJson(obj, phone, fields); });
+      }
+    } else {
+      stream.begin();
+      for (size_t i = 0; ; i++) {
+        PhoneEntry phone;
+        {
+          Sync::StateLock lock;
+          if (i >= phones.size()) break;
+          if (!match(i)) continue;
+          phone = phones[i];
+        }
+        stream.add([&](JsonObject obj) { fillPhoneJson(obj, phone, fields); });
+      }
+    }
+    stream.end();
   } 
   else if (server.method() == HTTP_POST) {
     JsonDocument doc;
@@ -990,8 +1406,27 @@ void handlePhonesAPI() {
     phone.number = doc["number"].as<String>();
     phone.smsEnabled = doc["smsEnabled"].as<bool>();
     phone.callEnabled = doc["callEnabled"].as<bool>();
-    systemState.phones.push_back(phone);
-    
+    long gateMask = doc["gates"] | 1L;
+    if (!validGateMask(gateMask)) {
+      server.send(400, "application/json", "{\"error\":\"Invalid gates mask\"}");
+      return;
+    }
+    phone.gates = (uint8_t)gateMask;
+    phone.schedule = doc["schedule"] | "";
+    bool knownSchedule;
+    {
+      Sync::StateLock lock;
+      knownSchedule = validScheduleRef(phone.schedule);
+      if (knownSchedule) {
+        systemState.phones.push_back(phone);
+        rebuildPhoneIndex();
+        bumpGeneration(Collection::PHONES);
+      }
+    }
+    if (!knownSchedule) {
+      server.send(400, "application/json", "{\"error\":\"Unknown schedule\"}");
+      return;
+    }
     // Сохраняем состояние
     saveSystemState();
     
@@ -1004,6 +1439,8 @@ void handlePhonesAPI() {
     responseDoc["number"] = phone.number;
     responseDoc["smsEnabled"] = phone.smsEnabled;
     responseDoc["callEnabled"] = phone.callEnabled;
+    responseDoc["gates"] = phone.gates;
+    responseDoc["schedule"] = phone.schedule;
     
     String response;
     serializeJson(responseDoc, response);
@@ -1022,27 +1459,53 @@ void handlePhoneUpdate() {
     server.send(400, "application/json", "{\"error\":\"Invalid phone number\"}");
     return;
   }
+  if (!doc["gates"].isNull() && !validGateMask(doc["gates"] | 0L)) {
+    server.send(400, "application/json", "{\"error\":\"Invalid gates mask\"}");
+    return;
+  }
   
-  for (auto& phone : systemState.phones) {
-    if (phone.number == phoneNumber) {
-      if (doc["smsEnabled"].is<bool>()) {
-        phone.smsEnabled = doc["smsEnabled"].as<bool>();
-      }
-      if (doc["callEnabled"].is<bool>()) {
-        phone.callEnabled = doc["callEnabled"].as<bool>();
+  bool found = false;
+  bool knownSchedule;
+  PhoneEntry updated;
+  {
+    Sync::StateLock lock;
+    knownSchedule = !doc["schedule"].is<String>() || validScheduleRef(doc["schedule"].as<String>());
+    for (auto& phone : systemState.phones) {
+      if (!knownSchedule) break;
+      if (phone.number == phoneNumber) {
+        if (doc["smsEnabled"].is<bool>()) {
+          phone.smsEnabled = doc["smsEnabled"].as<bool>();
+        }
+        if (doc["callEnabled"].is<bool>()) {
+          phone.callEnabled = doc["callEnabled"].as<bool>();
+        }
+        if (!doc["gates"].isNull()) {
+          phone.gates = (uint8_t)(doc["gates"] | 1L);
+        }
+        if (doc["schedule"].is<String>()) {
+          phone.schedule = doc["schedule"].as<String>();
+        }
+        rebuildPhoneIndex();
+        bumpGeneration(Collection::PHONES);
+        updated = phone;
+        found = true;
+        break;
       }
-      
-      // Сохраняем состояние
-      saveSystemState();
-      
-      Serial.println("[API] Обновлен телефон " + phoneNumber + ": SMS=" + String(phone.smsEnabled) + ", Call=" + String(phone.callEnabled));
-      sendLog("📱 Обновлены настройки телефона: " + phone.number, "success");
-      server.send(200, "application/json", "{\"success\":true}");
-      return;
     }
   }
-  
-  server.send(404, "application/json", "{\"error\":\"Phone not found\"}");
+
+  if (!knownSchedule) {
+    server.send(400, "application/json", "{\"error\":\"Unknown schedule\"}");
+    return;
+  }
+  if (!found) {
+    server.send(404, "application/json", "{\"error\":\"Phone not found\"}");
+    return;
+  }
+  saveSystemState();
+  Serial.println("[API] Обновлен телефон " + phoneNumber + ": SMS=" + String(updated.smsEnabled) + ", Call=" + String(updated.callEnabled) + ", ворота=0x" + String(updated.gates, HEX) + ", расписание=" + updated.schedule);
+  sendLog("📱 Обновлены настройки телефона: " + updated.number, "success");
+  server.send(200, "application/json", "{\"success\":true}");
 }
 
 // Обработка удаления телефонов
@@ -1052,49 +1515,106 @@ void handlePhonesDelete() {
   
   String phoneNumber = doc["id"].as<String>();
   
-  for (auto it = systemState.phones.begin(); it != systemState.phones.end(); ++it) {
-    if (it->number == phoneNumber) {
-      String number = it->number;
-      systemState.phones.erase(it);
-      
-      // Сохраняем состояние
-      saveSystemState();
-      
-      Serial.println("[API] Удален телефон: " + number);
-      sendLog("🗑️ Удален телефон: " + number, "warning");
-      server.send(200, "application/json", "{\"success\":true}");
-      return;
+  bool found = false;
+  {
+    Sync::StateLock lock;
+    for (auto it = systemState.phones.begin(); it != systemState.phones.end(); ++it) {
+      if (it->number == phoneNumber) {
+        systemState.phones.erase(it);
+        rebuildPhoneIndex();
+        bumpGeneration(Collection::PHONES);
+        found = true;
+        break;
+      }
     }
   }
-  
-  server.send(404, "application/json", "{\"success\":false,\"error\":\"Not found\"}");
+
+  if (!found) {
+    server.send(404, "application/json", "{\"success\":false,\"error\":\"Not found\"}");
+    return;
+  }
+  saveSystemState();
+  Serial.println("[API] Удален телефон: " + phoneNumber);
+  sendLog("🗑️ Удален телефон: " + phoneNumber, "warning");
+  server.send(200, "application/json", "{\"success\":true}");
 }
 
 // Обработка списка ключей
 void handleKeysAPI() {
   if (server.method() == HTTP_GET) {
-    JsonDocument doc;
-    JsonArray keysArray = doc.to<JsonArray>();
-    
-    for (const auto& key : systemState.keys433) {
-      JsonObject keyObj = keysArray.add<JsonObject>();
-      keyObj["code"] = key.code;
-      keyObj["name"] = key.name;
-      keyObj["enabled"] = key.enabled;
-      keyObj["protocol"] = key.protocol;
-      keyObj["bitString"] = key.bitString;
-      keyObj["bitLength"] = key.bitLength;
-      keyObj["te"] = key.te;
-      keyObj["frequency"] = key.frequency;
-      keyObj["modulation"] = key.modulation;
-      keyObj["rawData"] = key.rawData;
-      keyObj["rssi"] = key.rssi;
-      keyObj["timestamp"] = key.timestamp;
+    if (respondNotModified(Collection::KEYS)) return;
+    // По одной записи: без JsonDocument и String на весь список
+    uint32_t fields;
+    String unknown;
+    if (!parseFieldsArg(KEY_FIELD_NAMES, KEY_FIELD_COUNT, fields, unknown)) {
+      sendFieldError(unknown);
+      return;
     }
-    
-    String response;
-    serializeJson(doc, response);
-    server.send(200, "application/json", response);
+    // Фильтры: protocol (без учёта регистра), enabled, prefix имени
+    String protocol = server.arg("protocol");
+    String prefix = server.arg("prefix");
+    bool filterEnabled = server.hasArg("enabled");
+    bool enabledValue = false;
+    if (filterEnabled && !BulkIO::parseBool(server.arg("enabled").c_str(), enabledValue)) {
+      server.send(400, "application/json", "{\"success\":false,\"error\":\"enabled: ожидается true/false\"}");
+      return;
+    }
+    const std::vector<KeyEntry>& keys = systemState.keys433;
+    auto match = [&](size_t i) {
+      const KeyEntry& key = keys[i];
+      if (protocol.length() > 0 && !key.protocol.equalsIgnoreCase(protocol)) return false;
+      if (filterEnabled && key.enabled != enabledValue) return false;
+      if (prefix.length() > 0 && !key.name.startsWith(prefix)) return false;
+      return true;
+    };
+
+    JsonArrayStream stream(server);
+    size_t limit;
+    if (parsePageArgs(limit)) {
+      std::vector<size_t> page;
+      std::vector<uint32_t> codes;  // коды страницы: индексы сдвигает удаление
+      {
+        Sync::StateLock lock;
+        bool more;
+        uint32_t after = strtoul(server.arg("after").c_str(), nullptr, 0);
+        page = selectPage(keys.size(),
+            [&keys](size_t i) { return keys[i].code; },
+            match, server.hasArg("after"), after, limit, more);
+        if (more) server.sendHeader("X-Next-Cursor", String(keys[page.back()].code));
+        codes.reserve(page.size());
+        for (size_t i : page) codes.push_back(keys[i].code);
+      }
+      stream.begin();
+      for (size_t n = 0; n < page.size(); n++) {
+        KeyEntry key;
+        {
+          Sync::StateLock lock;
+          // Пока отдавали страницу, список мог измениться: ключ ищется по
+          // коду заново и снова проверяется фильтром
+          size_t i = page[n];
+          if (i >= keys.size() || keys[i].code != codes[n]) {
+            i = std::find_if(keys.begin(), keys.end(),
+                             [&](const KeyEntry& k) { return k.code == codes[n]; }) - keys.begin();
+          }
+          if (i >= keys.size() || !match(i)) continue;
+          key = keys[i];
+        }
+        stream.add([&](JsonObject keyObj) { fillKeyJson(keyObj, key, fields); });
+      }
+    } else {
+      stream.begin();
+      for (size_t i = 0; ; i++) {
+        KeyEntry key;
+        {
+          Sync::StateLock lock;
+          if (i >= keys.size()) break;
+          if (!match(i)) continue;
+          key = keys[i];
+        }
+        stream.add([&](JsonObject keyObj) { fillKeyJson(keyObj, key, fields); });
+      }
+    }
+    stream.end();
   }
 }
 
@@ -1102,24 +1622,24 @@ void handleKeysAPI() {
 void handleKeysLearn() {
   Serial.println("[API] Получен запрос на обучение ключа");
   
-  systemState.learningMode = true;
-  CC1101Manager::resetReceived();
-  
-  // Сохраняем состояние
-  saveSystemState();
+  {
+    Sync::StateLock lock;
+    // Режим обучения не сохраняется (при загрузке всегда выключен) — без записи во флеш
+    Settings::set(Settings::LEARNING_MODE, 1);
+    CC1101Manager::resetReceived();
+  }
   
   Serial.println("[API] Режим обучения ключа активирован");
-  Serial.println("[API] learningMode = " + String(systemState.learningMode));
   sendLog("🎓 Режим обучения: нажмите кнопку на брелке", "warning");
   server.send(200, "application/json", "{\"success\":true,\"message\":\"Нажмите кнопку на брелке\"}");
 }
 
 // Обработка остановки режима обучения
 void handleKeysStop() {
-  systemState.learningMode = false;
-  
-  // Сохраняем состояние
-  saveSystemState();
+  {
+    Sync::StateLock lock;
+    Settings::set(Settings::LEARNING_MODE, 0);
+  }
   
   Serial.println("[API] Режим обучения ключа остановлен");
   sendLog("🛑 Режим обучения остановлен", "warning");
@@ -1129,11 +1649,13 @@ void handleKeysStop() {
 // Обработка получения статуса режима обучения
 void handleKeysStatus() {
   Serial.println("[API] Запрос статуса режима обучения");
-  Serial.println("[API] learningMode = " + String(systemState.learningMode));
   
   JsonDocument doc;
-  doc["learningMode"] = systemState.learningMode;
-  doc["keyCount"] = systemState.keys433.size();
+  {
+    Sync::StateLock lock;
+    doc["learningMode"] = systemState.learningMode;
+    doc["keyCount"] = systemState.keys433.size();
+  }
   
   String response;
   serializeJson(doc, response);
@@ -1148,23 +1670,30 @@ void handleKeysDelete() {
   
   unsigned long keyCode = doc["code"].as<unsigned long>();
   
-  for (auto it = systemState.keys433.begin(); it != systemState.keys433.end(); ++it) {
-    if (it->code == keyCode) {
-      String keyName = it->name;
-      systemState.keys433.erase(it);
-      
-      // Сохраняем состояние
-      saveSystemState();
-      
-      Serial.println("[API] Удален ключ: " + String(keyCode) + " (" + keyName + ")");
-      sendLog("🗑️ Удален ключ: " + keyName, "warning");
-      server.send(200, "application/json", "{\"success\":true}");
-      return;
+  bool found = false;
+  String keyName;
+  {
+    Sync::StateLock lock;
+    for (auto it = systemState.keys433.begin(); it != systemState.keys433.end(); ++it) {
+      if (it->code == keyCode) {
+        keyName = it->name;
+        systemState.keys433.erase(it);
+        bumpGeneration(Collection::KEYS);
+        found = true;
+        break;
+      }
     }
   }
-  
-  server.send(404, "application/json", "{\"success\":false,\"error\":\"Not found\"}");
-}
+
+  if (!found) {
+    server.send(404, "application/json", "{\"success\":false,\"error\":\"Not found\"}");
+    return;
+  }
+  saveSystemState();
+  Serial.println("[API] Удален ключ: " + String(keyCode) + " (" + keyName + ")");
+  sendLog("🗑️ Удален ключ: " + keyName, "warning");
+  server.send(200, "application/json", "{\"success\":true}");
+}
 
 // Обработка обновления настроек ключа
 void handleKeyUpdate() {
@@ -1177,43 +1706,100 @@ void handleKeyUpdate() {
     server.send(400, "application/json", "{\"error\":\"Invalid key code\"}");
     return;
   }
+  if (!doc["gates"].isNull() && !validGateMask(doc["gates"] | 0L)) {
+    server.send(400, "application/json", "{\"error\":\"Invalid gates mask\"}");
+    return;
+  }
   
-  for (auto& key : systemState.keys433) {
-    if (key.code == keyCode) {
-      if (doc["enabled"].is<bool>()) {
-        key.enabled = doc["enabled"].as<bool>();
-      }
-      if (doc["name"].is<String>()) {
-        key.name = doc["name"].as<String>();
+  bool found = false;
+  bool knownSchedule;
+  KeyEntry updated;
+  {
+    Sync::StateLock lock;
+    knownSchedule = !doc["schedule"].is<String>() || validScheduleRef(doc["schedule"].as<String>());
+    for (auto& key : systemState.keys433) {
+      if (!knownSchedule) break;
+      if (key.code == keyCode) {
+        if (doc["enabled"].is<bool>()) {
+          key.enabled = doc["enabled"].as<bool>();
+        }
+        if (doc["name"].is<String>()) {
+          key.name = doc["name"].as<String>();
+        }
+        if (!doc["gates"].isNull()) {
+          key.gates = (uint8_t)(doc["gates"] | 1L);
+        }
+        if (doc["schedule"].is<String>()) {
+          key.schedule = doc["schedule"].as<String>();
+          key.scheduleId = scheduleIdOf(key.schedule);
+        }
+        bumpGeneration(Collection::KEYS);
+        updated = key;
+        found = true;
+        break;
       }
-      
-      // Сохраняем состояние
-      saveSystemState();
-      
-      Serial.println("[API] Обновлен ключ " + String(keyCode) + ": enabled=" + String(key.enabled) + ", name=" + key.name);
-      sendLog("🔑 Обновлены настройки ключа: " + key.name, "success");
-      server.send(200, "application/json", "{\"success\":true}");
-      return;
     }
   }
-  
-  server.send(404, "application/json", "{\"error\":\"Key not found\"}");
+
+  if (!knownSchedule) {
+    server.send(400, "application/json", "{\"error\":\"Unknown schedule\"}");
+    return;
+  }
+  if (!found) {
+    server.send(404, "application/json", "{\"error\":\"Key not found\"}");
+    return;
+  }
+  saveSystemState();
+  Serial.println("[API] Обновлен ключ " + String(keyCode) + ": enabled=" + String(updated.enabled) + ", name=" + updated.name + ", ворота=0x" + String(updated.gates, HEX) + ", расписание=" + updated.schedule);
+  sendLog("🔑 Обновлены настройки ключа: " + updated.name, "success");
+  server.send(200, "application/json", "{\"success\":true}");
+}
+
+// Номер ворот из ?gate= (по умолчанию ворота 0); -1 — нет таких ворот
+static int gateArg() {
+  if (!server.hasArg("gate")) return 0;
+  String arg = server.arg("gate");
+  long gate = arg.toInt();
+  if (gate < 0 || gate >= GATE_COUNT || (gate == 0 && arg != "0")) return -1;
+  return (int)gate;
 }
 
-// Обработка активации ворот
+// Обработка активации ворот: ?gate=N — какие (по умолчанию ворота 0)
 void handleGateTrigger() {
-  Serial.println("[API] Активация ворот");
-  sendLog("⚡ Сигнал на ворота отправлен", "success");
-  startGateCycle();
-  systemState.gateOpenCount++;
-  persistGateCountThrottled();
-  RingLog::append("Ворота активированы (API)");
+  int gate = gateArg();
+  if (gate < 0) {
+    server.send(400, "application/json", "{\"success\":false,\"error\":\"Invalid gate\"}");
+    return;
+  }
+  Serial.printf("[API] Активация ворот %d\n", gate);
+  // Ворота запускает loop() (подписчик gate_command) — без StateLock здесь.
+  // Очередь loop полна — команда не выполнится: ни успеха, ни записи в журнал
+  if (!EventBus::publishGateCommand(EventBus::SOURCE_HTTP, 1u << gate)) {
+    sendLog("⚠️ Ворота " + String(gate + 1) + ": очередь команд переполнена, сигнал не отправлен", "warning");
+    server.send(503, "application/json", "{\"success\":false,\"error\":\"Gate command queue full\"}");
+    return;
+  }
+  sendLog("⚡ Сигнал на ворота " + String(gate + 1) + " отправлен", "success");
+  AuditLog::record(AuditLog::SOURCE_HTTP, 0, 0, AuditLog::DECISION_OPENED);
+  LogQueue::post(LogQueue::LEVEL_INFO, LogQueue::SINK_FILE, "Ворота активированы (API)");
   server.send(200, "application/json", "{\"success\":true}");
 }
 
-// Текущее состояние цикла ворот (инициализация UI при загрузке/реконнекте)
+// Текущее состояние цикла ворот (инициализация UI при загрузке/реконнекте):
+// без параметров — все ворота (как gate_status), ?gate=N — одни
 void handleGateStatus() {
-  server.send(200, "application/json", gateStatusJson());
+  int gate = gateArg();
+  if (gate < 0) {
+    server.send(400, "application/json", "{\"error\":\"Invalid gate\"}");
+    return;
+  }
+  EventBus::GatePhase phases[GATE_COUNT];
+  {
+    Sync::StateLock lock;
+    for (int i = 0; i < GATE_COUNT; i++) phases[i] = gatePhaseNow(i);
+  }
+  String status = server.hasArg("gate") ? gateStatusJson(phases[gate]) : gateStatusJson(phases);
+  server.send(200, "application/json", status);
 }
 
 // --- OTA: обновление прошивки и SPIFFS из веб-интерфейса ---
@@ -1279,45 +1865,84 @@ String phoneDigits(const String& number) {
   return digits;
 }
 
-// Сравнение номеров по последним 10 цифрам: форматы +79991234567 / 89991234567 /
-// 79991234567 обозначают один номер и различаются только префиксом
-bool phoneNumbersMatch(const String& a, const String& b) {
-  String da = phoneDigits(a);
-  String db = phoneDigits(b);
-  if (da.length() == 0 || db.length() == 0) return false;
-  if (da.length() >= 10 && db.length() >= 10) {
-    return da.substring(da.length() - 10) == db.substring(db.length() - 10);
+// Индекс белого списка (см. PhoneIndex.h) — перестраивается при каждом
+// изменении systemState.phones, вызывать под StateLock
+void rebuildPhoneIndex() {
+  PhoneIndex::begin(systemState.phones.size());
+  for (const auto& phone : systemState.phones) {
+    PhoneIndex::add(phone.number.c_str(),
+                    (phone.callEnabled ? PhoneIndex::CHANNEL_CALL : 0) |
+                    (phone.smsEnabled ? PhoneIndex::CHANNEL_SMS : 0),
+                    phone.gates, scheduleIdOf(phone.schedule));
   }
-  return da == db; // короткие номера (сервисные) — только точное совпадение
+  PhoneIndex::commit();
+}
+
+// Карты недели расписаний (Schedule.h) и id расписаний у ключей и телефонов —
+// при загрузке и при изменении расписаний, под StateLock. Правила проверены
+// при сохранении; не разобралось (правка blob'а руками) — карта пустая, запрет
+void rebuildSchedules() {
+  Schedule::begin();
+  for (const auto& schedule : systemState.schedules) {
+    Schedule::Week week;
+    if (!Schedule::compile(schedule.rules.c_str(), week)) memset(&week, 0, sizeof(week));
+    Schedule::add(week);
+  }
+  for (auto& key : systemState.keys433) key.scheduleId = scheduleIdOf(key.schedule);
+  rebuildPhoneIndex();
 }
 
 // Колбэк для GSMManager: доверен ли номер для данного канала (звонок/SMS)
-bool gsmTrustedCheck(const String& number, bool isCall) {
-  for (const auto& phone : systemState.phones) {
-    if (phoneNumbersMatch(phone.number, number)) {
-      return isCall ? phone.callEnabled : phone.smsEnabled;
-    }
-  }
-  return false;
+// и сейчас — в его расписании (AccessDecision, как и в симуляторе).
+// Маска ворот номера — из того же поиска в индексе, её получит gsmGateOpen
+uint8_t gsmTrustedCheck(const String& number, bool isCall) {
+  uint8_t gates = 0;
+  AccessDecision::Outcome outcome = AccessDecision::decidePhone(number.c_str(), isCall, millis(), &gates);
+  if (outcome == AccessDecision::OPEN) return gates;
+  AccessDecision::recordPhone(outcome, number);
+  if (outcome == AccessDecision::OUT_OF_SCHEDULE) {
+    LogQueue::postf(LogQueue::LEVEL_WARNING, LogQueue::SINK_SERIAL | LogQueue::SINK_WS,
+                    "⏰ Номер вне расписания: %s", number.c_str());
+  }
+  return 0;
 }
 
-// Колбэк для GSMManager: открытие ворот (зеркалит радио-путь в loop)
-void gsmGateOpen(const String& source) {
+// Колбэк для GSMManager: открытие ворот gateMask (зеркалит радио-путь в loop)
+void gsmGateOpen(const String& source, uint8_t gateMask) {
+  if (!EventBus::publishGateCommand(EventBus::SOURCE_GSM, gateMask)) {
+    sendLog("⚠️ Очередь команд ворот переполнена, не открыто: " + source, "warning");
+    return;
+  }
   Serial.println("[GSM] ✅ Активация ворот: " + source);
   sendLog("🚪 Ворота активированы: " + source, "success");
-  startGateCycle();
-  systemState.gateOpenCount++;
-  persistGateCountThrottled();
-  RingLog::append(("Ворота: " + source).c_str());
+  AccessDecision::recordPhone(AccessDecision::OPEN, source);
+  LogQueue::postf(LogQueue::LEVEL_INFO, LogQueue::SINK_FILE, "Ворота: %s", source.c_str());
 }
 
-// Тайминги цикла ворот: GET — текущие, POST — сохранить (сек)
+// Настройки ворот: GET — все ворота, POST — одни ворота ("gate", по умолчанию 0):
+// тайминги (сек) и имя
 void handleGateConfig() {
   if (server.method() == HTTP_GET) {
+    if (respondNotModified(Collection::GATE_CONFIG)) return;
     JsonDocument doc;
-    doc["openDuration"] = systemState.gateOpenSec;
-    doc["stayOpen"] = systemState.gateStaySec;
-    doc["closeDuration"] = systemState.gateCloseSec;
+    {
+      Sync::StateLock lock;
+      // Ворота 0 — и на верхнем уровне, как при одних воротах
+      doc["openDuration"] = systemState.gateConfig[0].openSec;
+      doc["stayOpen"] = systemState.gateConfig[0].staySec;
+      doc["closeDuration"] = systemState.gateConfig[0].closeSec;
+      doc["count"] = GATE_COUNT;
+      JsonArray list = doc["gates"].to<JsonArray>();
+      for (int i = 0; i < GATE_COUNT; i++) {
+        const SystemState::GateConfig& cfg = systemState.gateConfig[i];
+        JsonObject obj = list.add<JsonObject>();
+        obj["gate"] = i;
+        obj["name"] = cfg.name;
+        obj["openDuration"] = cfg.openSec;
+        obj["stayOpen"] = cfg.staySec;
+        obj["closeDuration"] = cfg.closeSec;
+      }
+    }
 
     String response;
     serializeJson(doc, response);
@@ -1331,67 +1956,514 @@ void handleGateConfig() {
     server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
     return;
   }
+  int gate = doc["gate"] | 0;
+  if (gate < 0 || gate >= GATE_COUNT) {
+    server.send(400, "application/json", "{\"error\":\"Invalid gate\"}");
+    return;
+  }
+  bool hasName = doc["name"].is<const char*>();
+  String name = doc["name"] | "";
+  name.trim();
+  if (hasName && (name.length() == 0 || name.length() > 32)) {
+    server.send(400, "application/json", "{\"error\":\"Name must be 1-32 characters\"}");
+    return;
+  }
 
-  int openSec = doc["openDuration"] | systemState.gateOpenSec;
-  int staySec = doc["stayOpen"] | systemState.gateStaySec;
-  int closeSec = doc["closeDuration"] | systemState.gateCloseSec;
-
-  // Границы как в UI: движение 1-60 с, пауза «открыто» 1-300 с
-  if (openSec < 1 || openSec > 60 || closeSec < 1 || closeSec > 60 || staySec < 1 || staySec > 300) {
+  const Settings::Id openId = Settings::gateSetting(Settings::GATE_OPEN_SEC, gate);
+  const Settings::Id stayId = Settings::gateSetting(Settings::GATE_STAY_SEC, gate);
+  const Settings::Id closeId = Settings::gateSetting(Settings::GATE_CLOSE_SEC, gate);
+  int openSec, staySec, closeSec;
+  bool valid;
+  bool renamed = false;
+  {
+    Sync::StateLock lock;
+    SystemState::GateConfig& cfg = systemState.gateConfig[gate];
+    openSec = doc["openDuration"] | cfg.openSec;
+    staySec = doc["stayOpen"] | cfg.staySec;
+    closeSec = doc["closeDuration"] | cfg.closeSec;
+
+    // Все три или ничего: сначала только проверка границ реестра
+    valid = Settings::check(openId, openSec) != Settings::RESULT_OUT_OF_RANGE &&
+            Settings::check(stayId, staySec) != Settings::RESULT_OUT_OF_RANGE &&
+            Settings::check(closeId, closeSec) != Settings::RESULT_OUT_OF_RANGE;
+    if (valid) {
+      // Запись таймингов во флеш — отложенная (Settings::commitDue)
+      Settings::Batch batch;
+      Settings::set(openId, openSec);
+      Settings::set(stayId, staySec);
+      Settings::set(closeId, closeSec);
+      // Имя меняют редко, реестр строк не хранит — пишем сразу
+      if (hasName && name != cfg.name) {
+        cfg.name = name;
+        bumpGeneration(Collection::GATE_CONFIG);
+        renamed = true;
+      }
+    }
+  }
+  if (!valid) {
     server.send(400, "application/json", "{\"error\":\"Values out of range\"}");
     return;
   }
+  if (renamed) saveSystemState();
+
+  Serial.printf("[API] Тайминги ворот %d: открытие %d с, открыто %d с, закрытие %d с\n",
+                gate, openSec, staySec, closeSec);
+  sendLog("⚙️ Ворота " + String(gate + 1) + (renamed ? " («" + name + "»)" : String("")) + ": тайминги " +
+          String(openSec) + "/" + String(staySec) + "/" + String(closeSec) + " с", "success");
+  server.send(200, "application/json", "{\"success\":true}");
+}
 
-  systemState.gateOpenSec = openSec;
-  systemState.gateStaySec = staySec;
-  systemState.gateCloseSec = closeSec;
+// --- Расписания доступа (Schedule.h) ---
 
-  if (!saveSystemState()) {
-    server.send(500, "application/json", "{\"error\":\"NVS save failed\"}");
+// Сколько ключей и телефонов ссылается на расписание (под StateLock)
+static size_t scheduleUsers(const String& name) {
+  size_t count = 0;
+  for (const auto& key : systemState.keys433) count += key.schedule == name;
+  for (const auto& phone : systemState.phones) count += phone.schedule == name;
+  return count;
+}
+
+// GET — расписания и часовой пояс. POST — расписание {"name","rules"}
+// (нет такого имени — добавить, есть — заменить правила) и/или часовой
+// пояс {"timeZone": минуты к UTC}
+void handleSchedulesAPI() {
+  if (server.method() == HTTP_GET) {
+    if (respondNotModified(Collection::SCHEDULES)) return;
+    JsonDocument doc;
+    {
+      Sync::StateLock lock;
+      doc["timeZone"] = systemState.timeZoneMin;
+      doc["max"] = Schedule::MAX_SCHEDULES;
+      JsonArray list = doc["schedules"].to<JsonArray>();
+      for (const auto& schedule : systemState.schedules) {
+        JsonObject obj = list.add<JsonObject>();
+        Schedule::Week week;
+        obj["name"] = schedule.name;
+        obj["rules"] = schedule.rules;
+        obj["hours"] = Schedule::compile(schedule.rules.c_str(), week) ? Schedule::hours(week) : 0;
+        obj["users"] = scheduleUsers(schedule.name);
+      }
+    }
+
+    String response;
+    serializeJson(doc, response);
+    server.send(200, "application/json", response);
     return;
   }
 
-  Serial.printf("[API] Тайминги ворот: открытие %d с, открыто %d с, закрытие %d с\n",
-                openSec, staySec, closeSec);
-  sendLog("⚙️ Тайминги ворот: " + String(openSec) + "/" + String(staySec) + "/" + String(closeSec) + " с", "success");
+  JsonDocument doc;
+  if (deserializeJson(doc, server.arg("plain"))) {
+    server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+    return;
+  }
+  bool hasSchedule = doc["name"].is<const char*>() || doc["rules"].is<const char*>();
+  bool hasZone = !doc["timeZone"].isNull();
+  String name = doc["name"] | "";
+  String rules = doc["rules"] | "";
+  name.trim();
+  rules.trim();
+  if (hasSchedule && (name.length() == 0 || name.length() > 32)) {
+    server.send(400, "application/json", "{\"error\":\"Name must be 1-32 characters\"}");
+    return;
+  }
+  // Разбор правил — до StateLock: ошибка возвращается клиенту как есть
+  Schedule::Week week;
+  const char* compileError = nullptr;
+  if (hasSchedule && !Schedule::compile(rules.c_str(), week, &compileError)) {
+    server.send(400, "application/json", "{\"error\":\"" + jsonEscape(compileError) + "\"}");
+    return;
+  }
+
+  const char* error = nullptr;
+  {
+    Sync::StateLock lock;
+    float zone = doc["timeZone"] | (float)systemState.timeZoneMin;
+    if (hasZone && Settings::check(Settings::TIME_ZONE, zone) == Settings::RESULT_OUT_OF_RANGE) {
+      error = "timeZone out of range";
+    }
+    auto it = std::find_if(systemState.schedules.begin(), systemState.schedules.end(),
+                           [&name](const SystemState::ScheduleEntry& s) { return s.name == name; });
+    if (!error && hasSchedule && it == systemState.schedules.end() &&
+        systemState.schedules.size() >= (size_t)Schedule::MAX_SCHEDULES) {
+      error = "Too many schedules";
+    }
+    if (!error && hasSchedule) {
+      if (it != systemState.schedules.end()) {
+        it->rules = rules;
+      } else {
+        systemState.schedules.push_back({name, rules});
+      }
+      rebuildSchedules();
+      bumpGeneration(Collection::SCHEDULES);
+    }
+    // Пояс — через реестр: отложенная запись, поколение — в onSettingsChanged
+    if (!error && hasZone) Settings::set(Settings::TIME_ZONE, zone);
+  }
+  if (error) {
+    server.send(400, "application/json", "{\"error\":\"" + String(error) + "\"}");
+    return;
+  }
+
+  if (hasSchedule) {
+    saveSystemState();
+    Serial.println("[API] Расписание " + name + ": " + rules + " (" + String(Schedule::hours(week)) + " ч в неделю)");
+    sendLog("⏰ Расписание «" + name + "»: " + rules, "success");
+  }
+  server.send(200, "application/json",
+              "{\"success\":true,\"hours\":" + String(hasSchedule ? Schedule::hours(week) : 0) + "}");
+}
+
+// Удаление расписания; пока на него ссылаются ключи или телефоны — 409
+void handleSchedulesDelete() {
+  JsonDocument doc;
+  deserializeJson(doc, server.arg("plain"));
+  String name = doc["name"] | "";
+
+  int status = 200;
+  {
+    Sync::StateLock lock;
+    auto it = std::find_if(systemState.schedules.begin(), systemState.schedules.end(),
+                           [&name](const SystemState::ScheduleEntry& s) { return s.name == name; });
+    if (it == systemState.schedules.end()) {
+      status = 404;
+    } else if (scheduleUsers(name) > 0) {
+      status = 409;
+    } else {
+      // id — позиции в списке: после удаления пересчитываются у всех записей
+      systemState.schedules.erase(it);
+      rebuildSchedules();
+      bumpGeneration(Collection::SCHEDULES);
+    }
+  }
+
+  if (status == 404) {
+    server.send(404, "application/json", "{\"success\":false,\"error\":\"Not found\"}");
+    return;
+  }
+  if (status == 409) {
+    server.send(409, "application/json", "{\"success\":false,\"error\":\"Schedule in use\"}");
+    return;
+  }
+  saveSystemState();
+  Serial.println("[API] Удалено расписание: " + name);
+  sendLog("🗑️ Удалено расписание: " + name, "warning");
   server.send(200, "application/json", "{\"success\":true}");
 }
 
+// Текущее время для расписаний: откуда получено и какой сейчас слот недели
+void handleTimeStatus() {
+  JsonDocument doc;
+  {
+    Sync::StateLock lock;
+    uint32_t now = millis();
+    doc["synced"] = TimeSource::synced();
+    doc["source"] = TimeSource::originName(TimeSource::origin());
+    doc["timeZone"] = TimeSource::zone();
+    if (TimeSource::synced()) {
+      int slot = TimeSource::weekSlot(now);
+      doc["utc"] = TimeSource::utcNow(now);
+      doc["weekday"] = slot / 24;  // 0 — понедельник
+      doc["hour"] = slot % 24;
+      doc["syncedAgo"] = (now - TimeSource::syncedAtMs()) / 1000;
+    }
+  }
+
+  String response;
+  serializeJson(doc, response);
+  server.send(200, "application/json", response);
+}
+
 // Системная информация
 void handleSystemInfo() {
   JsonDocument doc;
   doc["uptime"] = millis() / 1000;
   doc["freeHeap"] = ESP.getFreeHeap();
   doc["totalHeap"] = ESP.getHeapSize();
-  doc["rssi"] = CC1101Manager::getRSSI();
   doc["firmware"] = "v1.0";
-  doc["openCount"] = systemState.gateOpenCount;
   doc["spiffsFree"] = SPIFFS.totalBytes() - SPIFFS.usedBytes();
   doc["spiffsTotal"] = SPIFFS.totalBytes();
-  doc["keyCount"] = systemState.keys433.size();
-  doc["phoneCount"] = systemState.phones.size();
+  {
+    Sync::StateLock lock;
+    doc["rssi"] = CC1101Manager::getRSSI();
+    doc["openCount"] = systemState.gateOpenCount;
+    doc["keyCount"] = systemState.keys433.size();
+    doc["phoneCount"] = systemState.phones.size();
+    doc["stateSlot"] = StateStore::activeSlot();
+    doc["stateGeneration"] = StateStore::generation();
+  }
+  doc["stateLoad"] = StateStore::resultName(stateLoadResult);
+  doc["loopMaxUs"] = loopMaxUs;
+  doc["rfDecisionUs"] = rfDecisionUs;
+  doc["rfDecisionMaxUs"] = rfDecisionMaxUs;
+  doc["signalDropped"] = SignalStream::droppedFrames();
+  doc["logDropped"] = LogQueue::dropped();
+  doc["auditDropped"] = AuditLog::dropped();
+  GSMManager::Health gsm = GSMManager::getHealth();
+  doc["gsmReady"] = GSMManager::isReady();
+  doc["gsmSignal"] = gsm.signal;
+  doc["gsmRegistration"] = gsm.registration;
+  WsBus::Stats ws = WsBus::stats();
+  doc["wsSent"] = ws.sent;
+  doc["wsSuppressed"] = ws.suppressed;
+  doc["wsCoalesced"] = ws.coalesced;
+  doc["wsInbound"] = ws.inboundReceived;
+  doc["wsInboundDropped"] = ws.inboundDropped;
+  doc["wsOutboxDropped"] = ws.outboxDropped;
+  WsBus::ClientStats clients[WEBSOCKETS_SERVER_CLIENT_MAX];
+  int clientCount = WsBus::clientStats(clients, WEBSOCKETS_SERVER_CLIENT_MAX);
+  JsonArray wsClients = doc["wsClients"].to<JsonArray>();
+  for (int i = 0; i < clientCount; i++) {
+    JsonObject obj = wsClients.add<JsonObject>();
+    obj["id"] = clients[i].client;
+    obj["ip"] = IPAddress(clients[i].ip).toString();
+    obj["connectedSec"] = (millis() - clients[i].connectedAt) / 1000;
+    obj["inbound"] = clients[i].inboundReceived;
+    obj["inboundDropped"] = clients[i].inboundDropped;
+  }
 
   String response;
   serializeJson(doc, response);
   server.send(200, "application/json", response);
 }
 
-// Получение лог-файла
+// Начало сообщения в строке лога: после префикса времени "[1h05m] "
+static int logMessageStart(const String& line) {
+  if (!line.startsWith("[")) return 0;
+  int close = line.indexOf("] ");
+  return close > 0 ? close + 2 : 0;
+}
+
+static bool logLineMatches(const String& line, const String& query) {
+  if (line.length() == 0) return false;
+  return query.length() == 0 || line.indexOf(query, logMessageStart(line)) >= 0;
+}
+
+// Получение лога (кольцевой файл RingLog), строки от старых к новым.
+// since (или after) — курсор, логическое смещение в байтах: курсор из
+// X-Next-Cursor / X-Log-Head не устаревает при переходе кольца, затёртое
+// начало пропускается. tail=N — только последние N строк. limit/fields/q —
+// выборка строк: q — подстрока сообщения, fields=message убирает "[1h05m] ".
 void handleLogFile() {
-  if (SPIFFS.exists(RingLog::LOG_FILE)) {
-    File f = SPIFFS.open(RingLog::LOG_FILE, "r");
-    server.streamFile(f, "text/plain");
-    f.close();
-  } else {
-    server.send(200, "text/plain", "");
+  uint32_t fields;
+  String unknown;
+  if (!parseFieldsArg(LOG_FIELD_NAMES, LOG_FIELD_COUNT, fields, unknown)) {
+    sendFieldError(unknown);
+    return;
+  }
+  size_t limit = LIST_MAX_LIMIT;
+  bool paged = parsePageArgs(limit);
+  if (!paged && server.hasArg("since")) paged = true;
+  if (!paged) limit = SIZE_MAX;
+  String query = server.arg("q");
+
+  uint32_t from = RingLog::tail();
+  String since = server.hasArg("since") ? server.arg("since") : server.arg("after");
+  if (since.length() > 0) from = max(from, (uint32_t)strtoul(since.c_str(), nullptr, 10));
+  if (server.hasArg("tail")) {
+    long lines = server.arg("tail").toInt();
+    if (lines > 0) from = max(from, RingLog::lastLinesOffset((size_t)lines));
+  }
+  uint32_t head = RingLog::head();
+
+  // Строки читаются по одной — лог целиком в RAM не попадает. Заголовок с
+  // курсором уходит до тела, поэтому сначала проход без вывода: где кончится
+  // страница и есть ли что-то после неё. Лог ≤ 32 КБ, второй проход дёшев.
+  RingLog::Reader reader(from);
+  String line;
+  size_t matched = 0;
+  while (matched < limit && reader.position() < head && reader.readLine(line)) {
+    if (logLineMatches(line, query)) matched++;
+  }
+  uint32_t endPos = min(reader.position(), head);
+  if (endPos < head && paged) {
+    server.sendHeader("X-Next-Cursor", String((unsigned)endPos));
+  }
+  server.sendHeader("X-Log-Head", String((unsigned)head));
+  server.sendHeader("X-Log-Tail", String((unsigned)RingLog::tail()));
+
+  reader.seek(from);
+  ChunkedWriter out(server);
+  out.begin(200, "text/plain; charset=utf-8");
+  while (reader.position() < endPos && reader.readLine(line)) {
+    if (!logLineMatches(line, query)) continue;
+    int msgStart = logMessageStart(line);
+    if (!(fields & (1u << 0))) {
+      out.print(line.c_str() + msgStart);       // только сообщение
+    } else if (!(fields & (1u << 1))) {
+      out.print(line.substring(0, msgStart > 0 ? msgStart - 1 : 0)); // только время
+    } else {
+      out.print(line);
+    }
+    out.print('\n');
   }
+  out.end();
+}
+
+// Журнал доступа (AuditLog): записи по возрастанию времени, JSON-массив.
+// from/to — секунды устройства (X-Audit-Now — текущее), key — код ключа,
+// phone — номер, source — rf/gsm/http, limit/after — страница и курсор
+// (номер записи из X-Next-Cursor). Начало выборки — сразу страница, в
+// которую попадает from, без сканирования кольца.
+void handleAudit() {
+  uint32_t from = server.hasArg("from") ? strtoul(server.arg("from").c_str(), nullptr, 10) : 0;
+  uint32_t to = server.hasArg("to") ? strtoul(server.arg("to").c_str(), nullptr, 10) : UINT32_MAX;
+  bool bySubject = server.hasArg("key") || server.hasArg("phone");
+  uint32_t subject = server.hasArg("key") ? strtoul(server.arg("key").c_str(), nullptr, 10)
+                                          : AuditLog::phoneId(server.arg("phone"));
+  uint8_t source = server.hasArg("phone") ? (uint8_t)AuditLog::SOURCE_GSM
+                 : server.hasArg("key") ? (uint8_t)AuditLog::SOURCE_RF : 0;
+  String sourceArg = server.arg("source");
+  for (uint8_t s = AuditLog::SOURCE_RF; s <= AuditLog::SOURCE_HTTP; s++) {
+    if (sourceArg == AuditLog::sourceName(s)) source = s;
+  }
+  size_t limit = LIST_MAX_LIMIT;
+  parsePageArgs(limit);
+
+  uint32_t start = AuditLog::seekTime(from);
+  if (server.hasArg("after")) start = max(start, (uint32_t)strtoul(server.arg("after").c_str(), nullptr, 10));
+
+  auto matches = [&](const AuditLog::Record& r) {
+    return r.time >= from && r.time <= to &&
+           (source == 0 || r.source == source) && (!bySubject || r.subject == subject);
+  };
+
+  // Первый проход — только границы страницы (курсор уходит заголовком до тела)
+  AuditLog::Record r;
+  AuditLog::Reader scan(start);
+  size_t matched = 0;
+  uint32_t endSeq = start;
+  bool more = false;
+  while (scan.next(r)) {
+    if (r.time > to) break;
+    if (!matches(r)) continue;
+    if (matched == limit) {
+      more = true;
+      break;
+    }
+    matched++;
+    endSeq = scan.position();
+  }
+  if (more) server.sendHeader("X-Next-Cursor", String((unsigned)endSeq));
+  server.sendHeader("X-Audit-Now", String((unsigned)AuditLog::now()));
+  server.sendHeader("X-Audit-Boot", String((unsigned)AuditLog::bootNumber()));
+
+  ChunkedWriter out(server);
+  out.begin(200, "application/json");
+  out.print('[');
+  bool first = true;
+  AuditLog::Reader reader(start);
+  while (reader.position() < endSeq && reader.next(r)) {
+    if (!matches(r)) continue;
+    char item[200];
+    snprintf(item, sizeof(item),
+             "%s{\"seq\":%u,\"time\":%u,\"source\":\"%s\",\"subject\":%u,\"rssi\":%d,"
+             "\"decision\":\"%s\",\"latencyUs\":%u,\"boot\":%u}",
+             first ? "" : ",", (unsigned)(reader.position() - 1), (unsigned)r.time,
+             AuditLog::sourceName(r.source), (unsigned)r.subject, (int)r.rssi,
+             AuditLog::decisionName(r.decision), (unsigned)r.latencyUs, (unsigned)r.boot);
+    out.print(item);
+    first = false;
+  }
+  out.print(']');
+  out.end();
+}
+
+// Использование по ключам/номерам из журнала доступа: число открытий
+// (по записям, что ещё в кольце) и время последнего. Для ключей — имя.
+void handleAuditStats() {
+  std::vector<AuditLog::SubjectStats> list = AuditLog::stats();
+  JsonDocument doc;
+  doc["now"] = AuditLog::now();
+  JsonArray items = doc["subjects"].to<JsonArray>();
+  {
+    Sync::StateLock lock; // имена — под блокировкой, ответ — без неё
+    // Индексы (код/phoneId → позиция в списке) строятся один раз на запрос:
+    // по субъекту — бинарный поиск, а не проход по всему списку
+    typedef std::pair<uint32_t, uint32_t> IdPos;
+    std::vector<IdPos> keyIds;
+    std::vector<IdPos> phoneIds;
+    bool needKeys = false, needPhones = false;
+    for (const AuditLog::SubjectStats& s : list) {
+      needKeys |= s.source == AuditLog::SOURCE_RF;
+      needPhones |= s.source == AuditLog::SOURCE_GSM;
+    }
+    if (needKeys) {
+      keyIds.reserve(systemState.keys433.size());
+      for (size_t i = 0; i < systemState.keys433.size(); i++) {
+        keyIds.push_back(IdPos(systemState.keys433[i].code, i));
+      }
+      std::stable_sort(keyIds.begin(), keyIds.end(),
+                       [](const IdPos& a, const IdPos& b) { return a.first < b.first; });
+    }
+    if (needPhones) {
+      phoneIds.reserve(systemState.phones.size());
+      for (size_t i = 0; i < systemState.phones.size(); i++) {
+        phoneIds.push_back(IdPos(AuditLog::phoneId(systemState.phones[i].number), i));
+      }
+      std::stable_sort(phoneIds.begin(), phoneIds.end(),
+                       [](const IdPos& a, const IdPos& b) { return a.first < b.first; });
+    }
+    // Первая запись списка с этим id (stable_sort сохраняет порядок повторов)
+    auto findPos = [](const std::vector<IdPos>& ids, uint32_t id) -> int {
+      auto it = std::lower_bound(ids.begin(), ids.end(), id,
+                                 [](const IdPos& p, uint32_t v) { return p.first < v; });
+      return (it != ids.end() && it->first == id) ? it->second : -1;
+    };
+    for (const AuditLog::SubjectStats& s : list) {
+      JsonObject item = items.add<JsonObject>();
+      item["source"] = AuditLog::sourceName(s.source);
+      item["subject"] = s.subject;
+      item["opened"] = s.opened;
+      item["lastUsed"] = s.lastUsed;
+      if (s.source == AuditLog::SOURCE_RF) {
+        int pos = findPos(keyIds, s.subject);
+        if (pos >= 0) item["name"] = systemState.keys433[pos].name;
+      } else if (s.source == AuditLog::SOURCE_GSM) {
+        int pos = findPos(phoneIds, s.subject);
+        if (pos >= 0) item["number"] = systemState.phones[pos].number;
+      }
+    }
+  }
+  String response;
+  serializeJson(doc, response);
+  server.send(200, "application/json", response);
+}
+
+// Метрики в формате OpenMetrics (для сборщика Prometheus по LAN)
+void handleMetrics() {
+  ChunkedWriter out(server);
+  out.begin(200, "application/openmetrics-text; version=1.0.0; charset=utf-8");
+  Metrics::write(out);
+  out.end();
+}
+
+// Обработчик маршрута с замером длительности (гистограмма на путь)
+// Тело JSON-запроса: объекты API — сотни байт. Больше — 413 без разбора,
+// чтобы JsonDocument и копии строк одного клиента не съедали heap
+// (файлы — multipart: импорт и OTA читаются кусками и сюда не попадают)
+static const size_t MAX_REQUEST_BODY = 4096;
+
+static WebServer::THandlerFunction timed(const char* path, WebServer::THandlerFunction handler) {
+  Metrics::Histogram* histogram = Metrics::httpHistogram(path);
+  return [histogram, handler]() {
+    uint32_t start = micros();
+    if (server.hasArg("plain") && server.arg("plain").length() > MAX_REQUEST_BODY) {
+      server.send(413, "application/json", "{\"error\":\"Request body too large\"}");
+      return;
+    }
+    handler();
+    if (histogram) histogram->observe(micros() - start);
+  };
 }
 
 // Обработка получения частоты
 void handleFrequencyGet() {
   JsonDocument doc;
-  doc["frequency"] = CC1101Manager::getFrequency();
-  doc["rssi"] = CC1101Manager::getRSSI();
+  {
+    Sync::StateLock lock;
+    doc["frequency"] = CC1101Manager::getFrequency();
+    doc["rssi"] = CC1101Manager::getRSSI();
+  }
   
   String response;
   serializeJson(doc, response);
@@ -1410,17 +2482,20 @@ void handleFrequencySet() {
   
   float frequency = doc["frequency"].as<float>();
   
-  if (frequency < 300.0 || frequency > 928.0) {
+  Settings::Result result;
+  {
+    Sync::StateLock lock;
+    result = Settings::set(Settings::FREQUENCY, frequency);
+  }
+
+  if (result == Settings::RESULT_OUT_OF_RANGE) {
     server.send(400, "application/json", "{\"success\":false,\"error\":\"Частота должна быть в диапазоне 300-928 МГц\"}");
     return;
   }
   
   Serial.println("[API] Установка частоты: " + String(frequency) + " МГц");
-  
-  if (CC1101Manager::setFrequency(frequency)) {
-    systemState.currentFrequency = frequency;
-    saveSystemState();
-    
+
+  if (result != Settings::RESULT_REJECTED) {
     sendLog("📡 Частота изменена на " + String(frequency) + " МГц", "success");
     
     JsonDocument response;
@@ -1438,14 +2513,20 @@ void handleFrequencySet() {
 
 // Обработка получения конфигурации CC1101
 void handleCC1101Config() {
+  // rssi здесь — моментальный снимок; при 304 клиент видит прежний.
+  // Живой RSSI идёт по WebSocket, а конфиг меняется только через API.
+  if (respondNotModified(Collection::RADIO_CONFIG)) return;
   JsonDocument doc;
-  doc["frequency"] = CC1101Manager::getFrequency();
-  doc["rssi"] = CC1101Manager::getRSSI();
-  doc["status"] = "active";
-  doc["bitRate"] = systemState.bitRate;
-  doc["frequencyDeviation"] = systemState.freqDeviation;
-  doc["rxBandwidth"] = systemState.rxBandwidth;
-  doc["outputPower"] = systemState.outputPower;
+  {
+    Sync::StateLock lock;
+    doc["frequency"] = CC1101Manager::getFrequency();
+    doc["rssi"] = CC1101Manager::getRSSI();
+    doc["status"] = "active";
+    doc["bitRate"] = systemState.bitRate;
+    doc["frequencyDeviation"] = systemState.freqDeviation;
+    doc["rxBandwidth"] = systemState.rxBandwidth;
+    doc["outputPower"] = systemState.outputPower;
+  }
 
   String response;
   serializeJson(doc, response);
@@ -1465,63 +2546,812 @@ void handleCC1101Settings() {
   bool ok = true;
   JsonDocument resp;
 
-  // Частота
-  if (doc.containsKey("frequency")) {
-    float freq = doc["frequency"].as<float>();
-    if (freq >= 300.0 && freq <= 928.0) {
-      if (CC1101Manager::setFrequency(freq)) {
-        systemState.currentFrequency = freq;
-      } else { ok = false; }
+  static const Settings::Id RADIO_FIELDS[] = {
+    Settings::FREQUENCY, Settings::BIT_RATE, Settings::FREQ_DEVIATION,
+    Settings::RX_BANDWIDTH, Settings::OUTPUT_POWER
+  };
+
+  // Радио и systemState — под StateLock (loop() в это время читает CC1101)
+  {
+    Sync::StateLock lock;
+    {
+      // Одно уведомление (поколение RADIO_CONFIG) на весь запрос
+      Settings::Batch batch;
+      for (Settings::Id id : RADIO_FIELDS) {
+        const char* key = Settings::name(id);
+        if (!doc[key].is<float>()) continue;
+        Settings::Result result = Settings::set(id, doc[key].as<float>());
+        if (result == Settings::RESULT_OUT_OF_RANGE || result == Settings::RESULT_REJECTED) ok = false;
+      }
+    }
+
+    resp["success"] = ok;
+    resp["frequency"] = CC1101Manager::getFrequency();
+    resp["bitRate"] = systemState.bitRate;
+    resp["frequencyDeviation"] = systemState.freqDeviation;
+    resp["rxBandwidth"] = systemState.rxBandwidth;
+    resp["outputPower"] = systemState.outputPower;
+  }
+
+  String response;
+  serializeJson(resp, response);
+  sendLog("Настройки CC1101 обновлены", "success");
+  server.send(200, "application/json", response);
+}
+
+// --- Массовый импорт/экспорт ключей и телефонов ---
+// Импорт — multipart-загрузка файла (как OTA), CSV или NDJSON. Тело целиком в RAM
+// не держим: строки разбираются по мере прихода кусков, в памяти копятся только
+// уже провалидированные записи. Коммит — одной транзакцией в конце загрузки:
+// либо все записи и ОДИН saveSystemState(), либо ничего (первая ошибка → 400).
+// 300 брелоков — одна перезапись blob'а, без циклов обучения.
+
+static const size_t IMPORT_MAX_RECORDS = 2000;
+// Запас heap, который staging не трогает: коммит (blob NVS), WiFi/HTTP и
+// остальные задачи; копию списка при слиянии отдельно проверяет коммит.
+// Записи с длинным rawData весят по ~1 КБ, поэтому число записей само по
+// себе не предел — перед каждой проверяется heap
+static const uint32_t IMPORT_HEAP_RESERVE = 48 * 1024;
+
+struct BulkImportState {
+  bool active = false;
+  bool isKeys = true;
+  bool replace = false;            // ?mode=replace — заменить коллекцию целиком
+  bool formatKnown = false;
+  bool headerChecked = false;
+  BulkIO::Format format = BulkIO::Format::CSV;
+  BulkIO::LineReader reader;
+  size_t lineNo = 0;
+  int csvMap[BulkIO::MAX_FIELDS];  // колонка CSV → индекс поля в *_FIELD_NAMES (-1 = игнор)
+  int csvMapSize = 0;
+  std::vector<KeyEntry> keys;
+  std::vector<PhoneEntry> phones;
+  std::vector<String> phoneKeys;   // нормализованные номера staged-записей (дедуп внутри файла)
+  String error;
+  bool outOfMemory = false;        // staging упёрся в IMPORT_HEAP_RESERVE → 413
+};
+static BulkImportState bulkImport;
+
+// Нормализованный номер для дедупликации (та же семантика, что PhoneIndex::keyOf)
+static String phoneMatchKey(const String& number) {
+  String d = phoneDigits(number);
+  return d.length() >= 10 ? d.substring(d.length() - 10) : d;
+}
+
+static void resetBulkImport() {
+  bulkImport.active = false;
+  bulkImport.formatKnown = false;
+  bulkImport.headerChecked = false;
+  bulkImport.reader.reset();
+  bulkImport.lineNo = 0;
+  bulkImport.csvMapSize = 0;
+  // swap с пустым — вернуть capacity в heap, clear() её не освобождает
+  std::vector<KeyEntry>().swap(bulkImport.keys);
+  std::vector<PhoneEntry>().swap(bulkImport.phones);
+  std::vector<String>().swap(bulkImport.phoneKeys);
+  bulkImport.error = "";
+  bulkImport.outOfMemory = false;
+}
+
+// Хватит ли heap ещё на одну запись: её строки (до MAX_LINE) плюс, если
+// вектор полон, новый непрерывный блок удвоенной ёмкости
+template <typename T>
+static bool importHeapAllows(const std::vector<T>& staged) {
+  size_t growBytes = 0;
+  if (staged.size() == staged.capacity()) growBytes = std::max<size_t>(staged.capacity() * 2, 8) * sizeof(T);
+  return ESP.getFreeHeap() >= IMPORT_HEAP_RESERVE + growBytes + BulkIO::MAX_LINE &&
+         ESP.getMaxAllocHeap() >= growBytes + BulkIO::MAX_LINE;
+}
+
+// Сколько heap займёт копия списка при слиянии: записи и их строки
+static size_t listHeapBytes(const std::vector<KeyEntry>& keys) {
+  size_t bytes = keys.size() * sizeof(KeyEntry);
+  for (const KeyEntry& k : keys) {
+    bytes += k.name.length() + k.protocol.length() + k.bitString.length() + k.modulation.length() +
+             k.rawData.length() + k.schedule.length();
+  }
+  return bytes;
+}
+
+static size_t listHeapBytes(const std::vector<PhoneEntry>& phones) {
+  size_t bytes = phones.size() * sizeof(PhoneEntry);
+  for (const PhoneEntry& p : phones) bytes += p.number.length() + p.schedule.length();
+  return bytes;
+}
+
+static KeyEntry defaultImportedKey() {
+  KeyEntry key;
+  key.code = 0;
+  key.enabled = true;
+  key.protocol = "RAW/Custom";
+  key.bitLength = 0;
+  key.te = 400.0f;
+  key.frequency = 433.92f;
+  key.modulation = "ASK/OOK";
+  key.rssi = 0;
+  key.timestamp = 0;
+  return key;
+}
+
+// Проверка и нормализация импортированного ключа; err — причина отказа
+static bool finalizeImportedKey(KeyEntry& key, String& err) {
+  if (key.code == 0) { err = "code обязателен и не может быть 0"; return false; }
+  if (key.name.length() > 64) { err = "name длиннее 64 символов"; return false; }
+  for (unsigned int i = 0; i < key.bitString.length(); i++) {
+    if (key.bitString[i] != '0' && key.bitString[i] != '1') {
+      err = "bitString должен состоять из 0/1";
+      return false;
+    }
+  }
+  if (key.bitLength == 0 && key.bitString.length() > 0) key.bitLength = key.bitString.length();
+  if (key.bitLength < 0 || key.bitLength > 512) { err = "bitLength вне диапазона 0-512"; return false; }
+  if (key.frequency < 300.0f || key.frequency > 928.0f) { err = "frequency вне диапазона 300-928 МГц"; return false; }
+  if (key.te < 0.0f || key.te > 100000.0f) { err = "te вне диапазона"; return false; }
+  if (key.gates == 0) { err = "gates: маска ворот 1-" + String((1 << GateControl::MAX_GATES) - 1); return false; }
+  {
+    Sync::StateLock lock;
+    if (!validScheduleRef(key.schedule)) { err = "schedule: нет расписания " + key.schedule; return false; }
+  }
+  if (key.name.length() == 0) key.name = key.protocol + "-0x" + String(key.code, HEX);
+  return true;
+}
+
+static bool finalizeImportedPhone(PhoneEntry& phone, String& err) {
+  int digits = 0;
+  for (unsigned int i = 0; i < phone.number.length(); i++) {
+    char c = phone.number[i];
+    if (isdigit((unsigned char)c)) digits++;
+    else if (c != '+' && c != ' ' && c != '-' && c != '(' && c != ')') {
+      err = "недопустимый символ в номере";
+      return false;
+    }
+  }
+  if (digits < 3 || digits > 20) { err = "номер должен содержать 3-20 цифр"; return false; }
+  if (phone.gates == 0) { err = "gates: маска ворот 1-" + String((1 << GateControl::MAX_GATES) - 1); return false; }
+  {
+    Sync::StateLock lock;
+    if (!validScheduleRef(phone.schedule)) { err = "schedule: нет расписания " + phone.schedule; return false; }
+  }
+  return true;
+}
+
+// Маска ворот из импорта; вне диапазона → 0 (запись отклонит finalize*)
+static uint8_t importedGateMask(long mask) {
+  return validGateMask(mask) ? (uint8_t)mask : 0;
+}
+
+// Разбор значения CSV-колонки ключа (idx — индекс в KEY_FIELD_NAMES)
+static bool setKeyCsvField(KeyEntry& key, int idx, const char* v, String& err) {
+  char* end = nullptr;
+  switch (idx) {
+    case 0: key.code = strtoul(v, &end, 0); break; // 0x... тоже принимаем
+    case 1: key.name = v; return true;
+    case 2:
+      if (*v && !BulkIO::parseBool(v, key.enabled)) { err = "enabled: ожидается true/false"; return false; }
+      return true;
+    case 3: if (*v) key.protocol = v; return true;
+    case 4: key.bitString = v; return true;
+    case 5: key.bitLength = (int)strtol(v, &end, 10); break;
+    case 6: key.te = strtof(v, &end); break;
+    case 7: key.frequency = strtof(v, &end); break;
+    case 8: if (*v) key.modulation = v; return true;
+    case 9: key.rawData = v; return true;
+    case 10: key.rssi = (int)strtol(v, &end, 10); break;
+    case 11: key.timestamp = strtoul(v, &end, 10); break;
+    case 12: if (*v) key.gates = importedGateMask(strtol(v, &end, 0)); break;
+    case 13: key.schedule = v; return true;
+    default: return true;
+  }
+  // Числовые колонки: пустое значение = дефолт, мусор = ошибка
+  if (*v && end && *end != '\0') {
+    err = String(KEY_FIELD_NAMES[idx]) + ": не число";
+    return false;
+  }
+  return true;
+}
+
+static bool setPhoneCsvField(PhoneEntry& phone, int idx, const char* v, String& err) {
+  switch (idx) {
+    case 0: phone.number = v; return true;
+    case 1:
+      if (*v && !BulkIO::parseBool(v, phone.smsEnabled)) { err = "smsEnabled: ожидается true/false"; return false; }
+      return true;
+    case 2:
+      if (*v && !BulkIO::parseBool(v, phone.callEnabled)) { err = "callEnabled: ожидается true/false"; return false; }
+      return true;
+    case 3: {
+      char* end = nullptr;
+      if (*v) phone.gates = importedGateMask(strtol(v, &end, 0));
+      if (*v && *end != '\0') { err = "gates: не число"; return false; }
+      return true;
     }
+    case 4: phone.schedule = v; return true;
   }
+  return true;
+}
 
-  // Битрейт
-  if (doc.containsKey("bitRate")) {
-    float br = doc["bitRate"].as<float>();
-    if (CC1101Manager::setBitRate(br)) {
-      systemState.bitRate = br;
+// Первая строка CSV: заголовок с именами колонок (любой порядок) или сразу данные
+static bool detectCsvHeader(char* fields[], int n) {
+  const char* const* names = bulkImport.isKeys ? KEY_FIELD_NAMES : PHONE_FIELD_NAMES;
+  int count = bulkImport.isKeys ? KEY_FIELD_COUNT : PHONE_FIELD_COUNT;
+  bool isHeader = false;
+  for (int c = 0; c < n; c++) {
+    bulkImport.csvMap[c] = -1;
+    for (int i = 0; i < count; i++) {
+      if (strcasecmp(fields[c], names[i]) == 0) {
+        bulkImport.csvMap[c] = i;
+        isHeader = true;
+        break;
+      }
     }
   }
+  if (isHeader) {
+    bulkImport.csvMapSize = n;
+    return true;
+  }
+  // Заголовка нет — позиционный порядок колонок как в экспорте
+  for (int c = 0; c < BulkIO::MAX_FIELDS; c++) bulkImport.csvMap[c] = (c < count) ? c : -1;
+  bulkImport.csvMapSize = BulkIO::MAX_FIELDS;
+  return false;
+}
+
+// Одна строка импорта → провалидированная запись в staging
+static bool importLine(char* line, size_t len) {
+  bulkImport.lineNo++;
+  if (bulkImport.keys.size() + bulkImport.phones.size() >= IMPORT_MAX_RECORDS) {
+    bulkImport.error = "слишком много записей (максимум " + String((unsigned)IMPORT_MAX_RECORDS) + ")";
+    return false;
+  }
+
+  String err;
+  KeyEntry key = defaultImportedKey();
+  PhoneEntry phone;
+  phone.smsEnabled = true;
+  phone.callEnabled = true;
 
-  // Девиация
-  if (doc.containsKey("frequencyDeviation")) {
-    float fd = doc["frequencyDeviation"].as<float>();
-    if (CC1101Manager::setFrequencyDeviation(fd)) {
-      systemState.freqDeviation = fd;
+  if (bulkImport.format == BulkIO::Format::NDJSON) {
+    JsonDocument doc;
+    if (deserializeJson(doc, line, len)) {
+      err = "некорректный JSON";
+    } else if (bulkImport.isKeys) {
+      key.code = doc["code"] | 0UL;
+      key.name = doc["name"] | "";
+      key.enabled = doc["enabled"] | true;
+      key.protocol = doc["protocol"] | "RAW/Custom";
+      key.bitString = doc["bitString"] | "";
+      key.bitLength = doc["bitLength"] | 0;
+      key.te = doc["te"] | 400.0f;
+      key.frequency = doc["frequency"] | 433.92f;
+      key.modulation = doc["modulation"] | "ASK/OOK";
+      key.rawData = doc["rawData"] | "";
+      key.rssi = doc["rssi"] | 0;
+      key.timestamp = doc["timestamp"] | 0UL;
+      key.gates = importedGateMask(doc["gates"] | 1L);
+      key.schedule = doc["schedule"] | "";
+    } else {
+      phone.number = doc["number"] | "";
+      phone.smsEnabled = doc["smsEnabled"] | true;
+      phone.callEnabled = doc["callEnabled"] | true;
+      phone.gates = importedGateMask(doc["gates"] | 1L);
+      phone.schedule = doc["schedule"] | "";
+    }
+  } else {
+    char* fields[BulkIO::MAX_FIELDS];
+    int n = BulkIO::splitCsv(line, fields, BulkIO::MAX_FIELDS);
+    if (!bulkImport.headerChecked) {
+      bulkImport.headerChecked = true;
+      if (detectCsvHeader(fields, n)) return true;
+    }
+    for (int c = 0; c < n && c < bulkImport.csvMapSize && err.length() == 0; c++) {
+      int idx = bulkImport.csvMap[c];
+      if (idx < 0) continue;
+      if (bulkImport.isKeys) setKeyCsvField(key, idx, fields[c], err);
+      else setPhoneCsvField(phone, idx, fields[c], err);
     }
   }
 
-  // RX bandwidth
-  if (doc.containsKey("rxBandwidth")) {
-    float rxBw = doc["rxBandwidth"].as<float>();
-    if (CC1101Manager::setRxBandwidth(rxBw)) {
-      systemState.rxBandwidth = rxBw;
+  bool heapOk = bulkImport.isKeys ? importHeapAllows(bulkImport.keys) : importHeapAllows(bulkImport.phones);
+  if (err.length() == 0 && !heapOk) {
+    bulkImport.outOfMemory = true;
+    err = "недостаточно памяти (принято " + String((unsigned)(bulkImport.keys.size() + bulkImport.phones.size())) +
+          " записей) — разбейте файл на части";
+  }
+
+  if (err.length() == 0) {
+    if (bulkImport.isKeys) {
+      if (finalizeImportedKey(key, err)) {
+        for (const auto& k : bulkImport.keys) {
+          if (k.code == key.code) { err = "повтор code в файле"; break; }
+        }
+      }
+      if (err.length() == 0) bulkImport.keys.push_back(key);
+    } else {
+      if (finalizeImportedPhone(phone, err)) {
+        String mk = phoneMatchKey(phone.number);
+        if (std::find(bulkImport.phoneKeys.begin(), bulkImport.phoneKeys.end(), mk) != bulkImport.phoneKeys.end()) {
+          err = "повтор номера в файле";
+        } else {
+          bulkImport.phoneKeys.push_back(mk);
+          bulkImport.phones.push_back(phone);
+        }
+      }
     }
   }
 
-  // Output power (через RadioLib напрямую)
-  if (doc.containsKey("outputPower")) {
-    systemState.outputPower = doc["outputPower"].as<int>();
+  if (err.length() > 0) {
+    bulkImport.error = "строка " + String((unsigned)bulkImport.lineNo) + ": " + err;
+    return false;
   }
+  return true;
+}
 
-  saveSystemState();
+// Потоковый приём файла импорта (общий для ключей и телефонов)
+void handleBulkImportUpload() {
+  HTTPUpload& up = server.upload();
 
-  resp["success"] = ok;
-  resp["frequency"] = CC1101Manager::getFrequency();
-  resp["bitRate"] = systemState.bitRate;
-  resp["frequencyDeviation"] = systemState.freqDeviation;
-  resp["rxBandwidth"] = systemState.rxBandwidth;
-  resp["outputPower"] = systemState.outputPower;
+  if (up.status == UPLOAD_FILE_START) {
+    resetBulkImport();
+    bulkImport.active = true;
+    bulkImport.isKeys = server.uri().startsWith("/api/keys");
+    bulkImport.replace = server.arg("mode") == "replace";
+    Serial.printf("[API] Импорт %s: приём %s (%s)\n", bulkImport.isKeys ? "ключей" : "телефонов",
+                  up.filename.c_str(), bulkImport.replace ? "замена" : "слияние");
+  } else if (up.status == UPLOAD_FILE_WRITE) {
+    if (!bulkImport.active || bulkImport.error.length() > 0) return; // после ошибки тело дочитываем вхолостую
+    if (!bulkImport.formatKnown) {
+      bulkImport.format = BulkIO::detectFormat(up.filename, up.buf, up.currentSize);
+      bulkImport.reader.setCsvQuotes(bulkImport.format == BulkIO::Format::CSV);
+      bulkImport.formatKnown = true;
+    }
+    if (!bulkImport.reader.feed(up.buf, up.currentSize, importLine) && bulkImport.error.length() == 0) {
+      bulkImport.error = "строка " + String((unsigned)(bulkImport.lineNo + 1)) +
+                         ": длиннее " + String((unsigned)BulkIO::MAX_LINE) + " байт";
+    }
+  } else if (up.status == UPLOAD_FILE_END) {
+    if (bulkImport.active && bulkImport.error.length() == 0 &&
+        !bulkImport.reader.finish(importLine) && bulkImport.error.length() == 0) {
+      bulkImport.error = "строка " + String((unsigned)(bulkImport.lineNo + 1)) + ": слишком длинная";
+    }
+  } else if (up.status == UPLOAD_FILE_ABORTED) {
+    resetBulkImport();
+    sendLog("❌ Импорт прерван клиентом", "error");
+  }
+}
 
-  String response;
-  serializeJson(resp, response);
-  sendLog("Настройки CC1101 обновлены", "success");
-  server.send(200, "application/json", response);
+// Коммит импорта одной транзакцией. Под StateLock — только слияние в копию
+// списка и снимок состояния с этой копией; снимок пишется во флеш без
+// StateLock (loop() и приём брелоков не ждут запись blob'а), и только после
+// успешной записи копия подменяет список — снова под StateLock. Если за время
+// записи список (или расписания) кто-то изменил, копия устарела: импорт не
+// применяется, во флеш возвращается текущее состояние, ответ 409.
+void handleBulkImportFinish() {
+  if (!bulkImport.active) {
+    server.send(400, "application/json", "{\"success\":false,\"error\":\"Файл не получен (нужна multipart-загрузка)\"}");
+    return;
+  }
+  if (bulkImport.error.length() > 0) {
+    String body = "{\"success\":false,\"error\":\"" + jsonEscape(bulkImport.error) +
+                  "\",\"line\":" + String((unsigned)bulkImport.lineNo) + "}";
+    Serial.println("[API] Импорт отклонён: " + bulkImport.error);
+    sendLog("❌ Импорт отклонён: " + bulkImport.error, "error");
+    int status = bulkImport.outOfMemory ? 413 : 400;
+    resetBulkImport();
+    server.send(status, "application/json", body);
+    return;
+  }
+
+  size_t added = 0, updated = 0;
+  Collection changed = bulkImport.isKeys ? Collection::KEYS : Collection::PHONES;
+  uint32_t generation, schedulesGeneration;
+  String jsonString;
+  uint32_t seq;
+  bool snapshotted;
+
+  // Слияние — в копию: loop() до подмены видит прежний список целиком.
+  // Копии нужен heap размером с текущий список (replace обходится без неё)
+  size_t copyBytes = 0;
+  if (!bulkImport.replace) {
+    Sync::StateLock lock;
+    copyBytes = bulkImport.isKeys ? listHeapBytes(systemState.keys433) : listHeapBytes(systemState.phones);
+  }
+  if (ESP.getFreeHeap() < IMPORT_HEAP_RESERVE + copyBytes) {
+    resetBulkImport();
+    sendLog("❌ Импорт отклонён: недостаточно памяти для слияния", "error");
+    server.send(413, "application/json",
+                "{\"success\":false,\"error\":\"Not enough memory to merge; use mode=replace or split the file\"}");
+    return;
+  }
+
+  std::vector<KeyEntry> keys;
+  std::vector<PhoneEntry> phones;
+  {
+    Sync::StateLock lock;
+    generation = collectionGeneration[(int)changed];
+    schedulesGeneration = collectionGeneration[(int)Collection::SCHEDULES];
+    if (bulkImport.isKeys) {
+      if (bulkImport.replace) {
+        keys.swap(bulkImport.keys);
+        added = keys.size();
+      } else {
+        keys = systemState.keys433;
+        size_t originalSize = keys.size();
+        for (auto& key : bulkImport.keys) {
+          bool found = false;
+          for (size_t i = 0; i < originalSize; i++) {
+            if (keys[i].code == key.code) {
+              keys[i] = key;
+              updated++;
+              found = true;
+              break;
+            }
+          }
+          if (!found) {
+            keys.push_back(key);
+            added++;
+          }
+        }
+      }
+      systemState.keys433.swap(keys);
+      snapshotted = snapshotSystemState(jsonString);
+      systemState.keys433.swap(keys);
+    } else {
+      if (bulkImport.replace) {
+        phones.swap(bulkImport.phones);
+        added = phones.size();
+      } else {
+        phones = systemState.phones;
+        // Ключи сопоставления существующих номеров считаем один раз, а не на каждую запись
+        std::vector<String> existing;
+        existing.reserve(phones.size());
+        for (const auto& p : phones) existing.push_back(phoneMatchKey(p.number));
+        for (size_t s = 0; s < bulkImport.phones.size(); s++) {
+          auto it = std::find(existing.begin(), existing.end(), bulkImport.phoneKeys[s]);
+          if (it != existing.end()) {
+            size_t i = it - existing.begin();
+            phones[i].smsEnabled = bulkImport.phones[s].smsEnabled;
+            phones[i].callEnabled = bulkImport.phones[s].callEnabled;
+            phones[i].gates = bulkImport.phones[s].gates;
+            phones[i].schedule = bulkImport.phones[s].schedule;
+            updated++;
+          } else {
+            phones.push_back(bulkImport.phones[s]);
+            added++;
+          }
+        }
+      }
+      systemState.phones.swap(phones);
+      snapshotted = snapshotSystemState(jsonString);
+      systemState.phones.swap(phones);
+    }
+    seq = ++stateSnapshotSeq;
+  }
+  // Staging больше не нужен — освобождаем до записи blob'а
+  const char* what = bulkImport.isKeys ? "ключей" : "телефонов";
+  bool isKeys = bulkImport.isKeys;
+  resetBulkImport();
+
+  // Запись без StateLock. Уже записан более новый снимок — в нём нет импорта,
+  // а наш затёр бы его изменения: это тоже конфликт
+  bool saved = false, conflict = false;
+  if (snapshotted) {
+    Metrics::ScopedTimer timer(Metrics::HIST_STATE_SAVE);
+    Sync::StoreLock store;
+    if (seq < stateWrittenSeq) {
+      conflict = true;
+    } else if (StateStore::save(jsonString)) {
+      stateWrittenSeq = seq;
+      saved = true;
+      Serial.printf("[NVS] Импорт сохранён в слот %d, поколение %u (%u байт)\n",
+                    StateStore::activeSlot(), (unsigned)StateStore::generation(), (unsigned)jsonString.length());
+    }
+  }
+
+  // Подмена списка — только если за время записи его никто не менял
+  bool resave = false;
+  if (saved) {
+    Sync::StateLock lock;
+    if (collectionGeneration[(int)changed] != generation ||
+        collectionGeneration[(int)Collection::SCHEDULES] != schedulesGeneration) {
+      conflict = true;
+    } else {
+      if (isKeys) {
+        systemState.keys433.swap(keys);
+        rebuildSchedules();
+      } else {
+        systemState.phones.swap(phones);
+        rebuildPhoneIndex();
+      }
+      bumpGeneration(changed);
+    }
+    // Снимок, взятый другой задачей после нашего, импорта не содержит —
+    // если он запишется последним, импорт пропадёт после перезагрузки
+    resave = conflict || stateSnapshotSeq != seq;
+  }
+  // Конфликт: во флеше импорт, в RAM — нет; после подмены: переписать свежим
+  if (resave) saveSystemState();
+
+  if (conflict) {
+    sendLog(String("⚠️ Импорт ") + what + " не применён: список изменился во время записи — повторите", "warning");
+    server.send(409, "application/json", "{\"success\":false,\"error\":\"List changed during import, retry\"}");
+    return;
+  }
+  if (!saved) {
+    sendLog(String("❌ Импорт ") + what + " не сохранён (ошибка NVS) — список не изменён", "error");
+    server.send(500, "application/json", "{\"success\":false,\"error\":\"NVS save failed\"}");
+    return;
+  }
+
+  Serial.printf("[API] Импорт %s: добавлено %u, обновлено %u\n", what, (unsigned)added, (unsigned)updated);
+  sendLog(String("📥 Импорт ") + what + ": добавлено " + String((unsigned)added) +
+          ", обновлено " + String((unsigned)updated), "success");
+  server.send(200, "application/json",
+              "{\"success\":true,\"added\":" + String((unsigned)added) +
+              ",\"updated\":" + String((unsigned)updated) + "}");
+}
+
+// Экспорт: ?format=ndjson (по умолчанию) | csv. Отдаётся потоком (chunked),
+// по одной записи — память не растёт с размером базы.
+void handleBulkExport() {
+  bool isKeys = server.uri().startsWith("/api/keys");
+  bool csv = server.arg("format") == "csv";
+  String filename = String(isKeys ? "keys" : "phones") + (csv ? ".csv" : ".ndjson");
+  server.sendHeader("Content-Disposition", "attachment; filename=\"" + filename + "\"");
+
+  ChunkedWriter out(server);
+  out.begin(200, csv ? "text/csv; charset=utf-8" : "application/x-ndjson");
+
+  if (csv) {
+    const char* const* names = isKeys ? KEY_FIELD_NAMES : PHONE_FIELD_NAMES;
+    int count = isKeys ? KEY_FIELD_COUNT : PHONE_FIELD_COUNT;
+    for (int i = 0; i < count; i++) {
+      if (i > 0) out.print(',');
+      out.print(names[i]);
+    }
+    out.print('\n');
+  }
+
+  // Запись копируется под StateLock, в сеть уходит без него
+  if (isKeys) {
+    for (size_t i = 0; ; i++) {
+      KeyEntry key;
+      {
+        Sync::StateLock lock;
+        if (i >= systemState.keys433.size()) break;
+        key = systemState.keys433[i];
+      }
+      if (csv) {
+        out.print(String(key.code)); out.print(',');
+        out.print(BulkIO::csvField(key.name)); out.print(',');
+        out.print(key.enabled ? "true" : "false"); out.print(',');
+        out.print(BulkIO::csvField(key.protocol)); out.print(',');
+        out.print(key.bitString); out.print(',');
+        out.print(String(key.bitLength)); out.print(',');
+        out.print(String(key.te, 1)); out.print(',');
+        out.print(String(key.frequency, 2)); out.print(',');
+        out.print(BulkIO::csvField(key.modulation)); out.print(',');
+        out.print(BulkIO::csvField(key.rawData)); out.print(',');
+        out.print(String(key.rssi)); out.print(',');
+        out.print(String(key.timestamp)); out.print(',');
+        out.print(String(key.gates)); out.print(',');
+        out.print(BulkIO::csvField(key.schedule)); out.print('\n');
+      } else {
+        JsonDocument doc;
+        fillKeyJson(doc.to<JsonObject>(), key);
+        serializeJson(doc, out);
+        out.print('\n');
+      }
+    }
+  } else {
+    for (size_t i = 0; ; i++) {
+      PhoneEntry phone;
+      {
+        Sync::StateLock lock;
+        if (i >= systemState.phones.size()) break;
+        phone = systemState.phones[i];
+      }
+      if (csv) {
+        out.print(BulkIO::csvField(phone.number)); out.print(',');
+        out.print(phone.smsEnabled ? "true" : "false"); out.print(',');
+        out.print(phone.callEnabled ? "true" : "false"); out.print(',');
+        out.print(String(phone.gates)); out.print(',');
+        out.print(BulkIO::csvField(phone.schedule)); out.print('\n');
+      } else {
+        JsonDocument doc;
+        doc["number"] = phone.number;
+        doc["smsEnabled"] = phone.smsEnabled;
+        doc["callEnabled"] = phone.callEnabled;
+        doc["gates"] = phone.gates;
+        doc["schedule"] = phone.schedule;
+        serializeJson(doc, out);
+        out.print('\n');
+      }
+    }
+  }
+
+  out.end();
+}
+
+// --- Задача HTTP/WebSocket ---
+// Веб-сервер и WebSocket обслуживаются в отдельной задаче на ядре 0 (там же
+// стек WiFi), loop() на ядре 1 занят только радио, GSM и воротами. Медленный
+// или зависший клиент, большой streamFile или долгий обработчик
+// больше не задерживают распознавание брелоков. Общие данные — через Sync.
+static const uint32_t HTTP_TASK_STACK = 8192;
+static TaskHandle_t httpTaskHandle = nullptr;
+
+static void httpTask(void*) {
+  for (;;) {
+    server.handleClient();
+    pollWiFiScan();
+    {
+      Sync::WsLock lock;
+      webSocket.loop();
+      SignalStream::drain(webSocket);
+    }
+    EventBus::dispatch(uiSubscriber);
+    WsBus::flush();
+    AuditLog::flush();
+    // Без клиентов handleClient возвращается сразу — отдаём ядро на 1 тик
+    vTaskDelay(1);
+  }
+}
+
+// --- Реестр настроек ---
+static const uint32_t RADIO_SETTINGS =
+  Settings::bit(Settings::FREQUENCY) | Settings::bit(Settings::BIT_RATE) |
+  Settings::bit(Settings::FREQ_DEVIATION) | Settings::bit(Settings::RX_BANDWIDTH) |
+  Settings::bit(Settings::OUTPUT_POWER);
+// Тайминги всех ворот — id подряд от GATE_OPEN_SEC до LEARNING_MODE
+static const uint32_t GATE_SETTINGS =
+  Settings::bit(Settings::LEARNING_MODE) - Settings::bit(Settings::GATE_OPEN_SEC);
+
+// Изменение настроек → поколение затронутой коллекции (ETag, WS "generation")
+static void onSettingsChanged(uint32_t changed) {
+  if (changed & RADIO_SETTINGS) bumpGeneration(Collection::RADIO_CONFIG);
+  if (changed & GATE_SETTINGS) bumpGeneration(Collection::GATE_CONFIG);
+  if (changed & Settings::bit(Settings::TIME_ZONE)) bumpGeneration(Collection::SCHEDULES);
+}
+
+static bool applyTimeZone(float minutes) {
+  TimeSource::setZone((int)minutes);
+  return true;
+}
+
+static void bindSettings() {
+  // Радио применяется к CC1101 до записи поля; мощность только хранится
+  Settings::bindFloat(Settings::FREQUENCY, &systemState.currentFrequency, CC1101Manager::setFrequency);
+  Settings::bindFloat(Settings::BIT_RATE, &systemState.bitRate, CC1101Manager::setBitRate);
+  Settings::bindFloat(Settings::FREQ_DEVIATION, &systemState.freqDeviation, CC1101Manager::setFrequencyDeviation);
+  Settings::bindFloat(Settings::RX_BANDWIDTH, &systemState.rxBandwidth, CC1101Manager::setRxBandwidth);
+  Settings::bindInt(Settings::OUTPUT_POWER, &systemState.outputPower);
+  // Тайминги ворот читаются при старте цикла (startGateCycle)
+  for (int i = 0; i < GateControl::MAX_GATES; i++) {
+    SystemState::GateConfig& cfg = systemState.gateConfig[i];
+    Settings::bindInt(Settings::gateSetting(Settings::GATE_OPEN_SEC, i), &cfg.openSec);
+    Settings::bindInt(Settings::gateSetting(Settings::GATE_STAY_SEC, i), &cfg.staySec);
+    Settings::bindInt(Settings::gateSetting(Settings::GATE_CLOSE_SEC, i), &cfg.closeSec);
+  }
+  Settings::bindBool(Settings::LEARNING_MODE, &systemState.learningMode);
+  Settings::bindInt(Settings::TIME_ZONE, &systemState.timeZoneMin, applyTimeZone);
+  TimeSource::setZone(systemState.timeZoneMin);
+  Settings::subscribe(onSettingsChanged);
 }
 
 // --- Setup Function ---
+// --- Периодические задания loop() (см. Scheduler.h), регистрируются в setup() ---
+// Выполняются вне StateLock итерации: каждое берёт его только на то, что
+// трогает, а запись во флеш (saveSystemState) идёт уже без него.
+
+// Сброс счётчика открытий во флеш (см. gateCountDirty; флаг — только задачи loop)
+static void jobGateCountFlush() {
+  if (gateCountDirty && saveSystemState()) gateCountDirty = false;
+}
+
+// Отложенная запись настроек (см. Settings.h)
+static void jobSettingsCommit() {
+  {
+    Sync::StateLock lock;
+    if (!Settings::commitDue()) return;
+  }
+  bool saved = saveSystemState();
+  Sync::StateLock lock;
+  Settings::commitDone(saved);
+}
+
+// Статус WiFi в UI и переподключение. Задание loop(): статус — в очередь
+// отправки WsBus, рассылает httpTask (медленный клиент не держит loop())
+static void jobWiFiStatus() {
+  static bool wasConnected = false;
+
+  if (WiFi.status() == WL_CONNECTED) {
+    // Статус подключения: шина разошлёт только изменившиеся поля (обычно rssi),
+    // неизменный статус не уходит в эфир вовсе
+    String wifiStatus = "{\"status\":\"connected\",\"ssid\":\"" + jsonEscape(WiFi.SSID()) + "\",\"rssi\":" + String(WiFi.RSSI()) + ",\"ip\":\"" + WiFi.localIP().toString() + "\"}";
+    WsBus::postState("wifi_status", wifiStatus.c_str());
+    
+    if (!wasConnected) {
+      wasConnected = true;
+      Serial.println("[WiFi] Успешное подключение к: " + WiFi.SSID());
+    }
+  } else {
+    // Если было подключение, пытаемся переподключиться — но не чаще раза в 30с.
+    // Вызов WiFi.begin() каждые 5с перезапускал ассоциацию, не давая ей завершиться.
+    static unsigned long lastReconnectAttempt = 0;
+    String ssid, password;
+    {
+      Sync::StateLock lock;  // креды меняет /api/wifi/connect из httpTask
+      ssid = systemState.wifiSSID;
+      password = systemState.wifiPassword;
+    }
+    if (ssid.length() > 0) {
+      if (wasConnected) {
+        Serial.println("[WiFi] Соединение потеряно, попытка переподключения к: " + ssid);
+        sendLog("⚠️ WiFi отключен, переподключение к " + ssid + "...", "warning");
+        wasConnected = false;
+      }
+      if (millis() - lastReconnectAttempt > 30000) {
+        lastReconnectAttempt = millis();
+        WiFi.begin(ssid.c_str(), password.c_str());
+      }
+    }
+    
+    // Отправляем статус отключения
+    WsBus::postState("wifi_status", "{\"status\":\"disconnected\"}");
+  }
+}
+
+// Время для расписаний по NTP, пока есть WiFi (часы сети GSM — в GSMManager).
+// SNTP ESP-IDF сам переспрашивает сервер раз в час; задание переносит его
+// время в TimeSource. WiFi пропал — часы ESP32 идут дальше от последней синхронизации
+static void jobTimeSync() {
+  static bool sntpStarted = false;
+  if (WiFi.status() != WL_CONNECTED) return;
+  if (!sntpStarted) {
+    configTime(0, 0, "pool.ntp.org", "time.google.com");
+    sntpStarted = true;
+    return;
+  }
+  time_t now = time(nullptr);
+  Sync::StateLock lock;
+  bool wasSynced = TimeSource::synced();
+  if (now > 0 && TimeSource::sync((uint32_t)now, TimeSource::ORIGIN_NTP, millis()) && !wasSynced) {
+    Serial.println("[NTP] Время получено, расписания доступа работают");
+  }
+}
+
+// Отсчёты RSSI для визуализатора (режим обучения, только при подписчиках
+// бинарного канала signal — рассылает httpTask)
+static void jobRssiSample() {
+  Sync::StateLock lock;  // learningMode и SPI CC1101
+  if (systemState.learningMode && SignalStream::active()) {
+    SignalStream::sampleRssi(CC1101Manager::getRSSI(), CC1101Manager::getFrequency());
+  }
+}
+
+// Очистка устаревших распознаваний
+static void jobCleanup() {
+  Sync::StateLock lock;
+  cleanupOldRecognitions();
+  cleanupDetectionHistory();
+}
+
+// Периодическая диагностика CC1101
+static void jobDiagnostics() {
+  int rssi;
+  float frequency;
+  {
+    Sync::StateLock lock;  // SPI CC1101
+    rssi = CC1101Manager::getRSSI();
+    frequency = CC1101Manager::getFrequency();
+  }
+  Serial.println("[CC1101] Диагностика - RSSI: " + String(rssi) + " dBm, Частота: " + String(frequency) + " МГц");
+}
+
 void setup() {
+  LogQueue::init();
   Serial.begin(115200);
+  Sync::init();
+  Metrics::registerTask("loop", xTaskGetCurrentTaskHandle()); // setup() идёт в задаче loop
   Serial.println("=================================");
   Serial.println("Проект: Умные Ворота (Web + React)");
   Serial.println("ESP32 DevKit 38 pin");
@@ -1529,15 +3359,19 @@ void setup() {
   Serial.println("Запуск системы...");
 
   // Инициализация раздела userdata для хранения ключей/телефонов/настроек
-  initUserDataPartition();
+  StateStore::init();
 
   // Загрузка состояния системы из постоянной памяти (раздел userdata)
   loadSystemState();
-  
+  bindSettings();
+
 
-  // Инициализация GateControl
-  GateControl::init(GATE_OPEN_PIN, GATE_CLOSE_PIN);
-  Serial.println("[OK] GateControl инициализирован");
+  // Инициализация ворот: по паре реле на ворота
+  for (int i = 0; i < GATE_COUNT; i++) {
+    gates[i].begin(i, GATE_PINS[i][0], GATE_PINS[i][1]);
+    uiGatePhases[i] = gatePhaseNow(i);
+  }
+  Serial.printf("[OK] GateControl инициализирован: ворот %d\n", GATE_COUNT);
 
   // Инициализация CC1101
   Serial.println("[INIT] Инициализация CC1101 радиомодуля...");
@@ -1564,6 +3398,7 @@ void setup() {
     Serial.printf("[OK] Настройки радио применены: %.2f kbps / %.1f кГц BW / %.1f кГц дев.\n",
                   systemState.bitRate, systemState.rxBandwidth, systemState.freqDeviation);
     Serial.println("[INFO] Первые 3 секунды сигналы будут игнорироваться (фильтрация начальных артефактов)");
+    CC1101Manager::setPulseTap(SignalStream::pushPulses);
   } else {
     Serial.println("[ERROR] Ошибка инициализации CC1101!");
   }
@@ -1613,12 +3448,20 @@ void setup() {
     Serial.println("[ERROR] Ошибка инициализации SPIFFS");
   } else {
     Serial.println("[OK] SPIFFS инициализирован");
+    RingLog::init();
+    AuditLog::init();
   }
   
   // Инициализация WebSocket сервера (до веб-сервера для логов)
   webSocket.begin();
   webSocket.onEvent(webSocketEvent);
+  WsBus::init(&webSocket);
+  WsBus::setCoalesceWindow("gate_status", 0);     // каждая фаза важна UI (счётчик открытий)
+  WsBus::setCoalesceWindow("wifi_status", WIFI_STATUS_WINDOW_MS);
   Serial.println("[OK] WebSocket сервер запущен на порту 81");
+
+  // Задача вывода логов (после SPIFFS и шины WebSocket): до этого записи копятся в очереди
+  LogQueue::start(RingLog::append);
   
   // Инициализация Logger (после WebSocket)
   Logger::init(&webSocket);
@@ -1635,19 +3478,10 @@ void setup() {
     if (path.startsWith("/static/")) {
       if (SPIFFS.exists(path)) {
         File file = SPIFFS.open(path, "r");
-        String contentType = "text/plain";
-        
-        if (path.endsWith(".css")) {
-          contentType = "text/css";
-        } else if (path.endsWith(".js")) {
-          contentType = "application/javascript";
-        } else if (path.endsWith(".html")) {
-          contentType = "text/html";
-        } else if (path.endsWith(".json")) {
-          contentType = "application/json";
-        }
-        
-        server.streamFile(file, contentType);
+        // В именах /static/* хэш содержимого (CRA): новый бандл = новое имя,
+        // поэтому файл можно кэшировать навсегда и не ревалидировать
+        server.sendHeader("Cache-Control", "public, max-age=31536000, immutable");
+        streamStaticFile(file, path);
         file.close();
         return;
       }
@@ -1656,29 +3490,44 @@ void setup() {
     server.send(404, "text/plain", "Not Found: " + path);
   });
   
-  // API endpoints
-  server.on("/api/wifi/scan", HTTP_GET, handleWiFiScan);
-  server.on("/api/wifi/connect", HTTP_POST, handleWiFiConnect);
-  server.on("/api/phones", handlePhonesAPI);
-  server.on("/api/phones/delete", HTTP_POST, handlePhonesDelete);
-  server.on("/api/phones/update", HTTP_PUT, handlePhoneUpdate);
-  server.on("/api/keys", handleKeysAPI);
-  server.on("/api/keys/learn", HTTP_POST, handleKeysLearn);
-  server.on("/api/keys/stop", HTTP_POST, handleKeysStop);
-  server.on("/api/keys/status", HTTP_GET, handleKeysStatus);
-  server.on("/api/keys/delete", HTTP_POST, handleKeysDelete);
-  server.on("/api/keys/update", HTTP_PUT, handleKeyUpdate);
-  server.on("/api/gate/trigger", HTTP_POST, handleGateTrigger);
-  server.on("/api/gate/status", HTTP_GET, handleGateStatus);
-  server.on("/api/ota/firmware", HTTP_POST, handleOTAFinish, handleOTAUpload);
-  server.on("/api/ota/spiffs", HTTP_POST, handleOTAFinish, handleOTAUpload);
-  server.on("/api/gate/config", handleGateConfig);
-  server.on("/api/frequency", HTTP_GET, handleFrequencyGet);
-  server.on("/api/frequency/set", HTTP_POST, handleFrequencySet);
-  server.on("/api/cc1101/config", HTTP_GET, handleCC1101Config);
-  server.on("/api/cc1101/settings", HTTP_POST, handleCC1101Settings);
-  server.on("/api/system/info", HTTP_GET, handleSystemInfo);
-  server.on("/api/system/log", HTTP_GET, handleLogFile);
+  // API endpoints (timed — длительность каждого обработчика в /metrics)
+  server.on("/api/wifi/scan", HTTP_GET, timed("/api/wifi/scan", handleWiFiScan));
+  server.on("/api/wifi/connect", HTTP_POST, timed("/api/wifi/connect", handleWiFiConnect));
+  server.on("/api/phones", timed("/api/phones", handlePhonesAPI));
+  server.on("/api/phones/delete", HTTP_POST, timed("/api/phones/delete", handlePhonesDelete));
+  server.on("/api/phones/update", HTTP_PUT, timed("/api/phones/update", handlePhoneUpdate));
+  server.on("/api/keys", timed("/api/keys", handleKeysAPI));
+  server.on("/api/keys/learn", HTTP_POST, timed("/api/keys/learn", handleKeysLearn));
+  server.on("/api/keys/stop", HTTP_POST, timed("/api/keys/stop", handleKeysStop));
+  server.on("/api/keys/status", HTTP_GET, timed("/api/keys/status", handleKeysStatus));
+  server.on("/api/keys/delete", HTTP_POST, timed("/api/keys/delete", handleKeysDelete));
+  server.on("/api/keys/update", HTTP_PUT, timed("/api/keys/update", handleKeyUpdate));
+  server.on("/api/keys/import", HTTP_POST, timed("/api/keys/import", handleBulkImportFinish), handleBulkImportUpload);
+  server.on("/api/keys/export", HTTP_GET, timed("/api/keys/export", handleBulkExport));
+  server.on("/api/phones/import", HTTP_POST, timed("/api/phones/import", handleBulkImportFinish), handleBulkImportUpload);
+  server.on("/api/phones/export", HTTP_GET, timed("/api/phones/export", handleBulkExport));
+  server.on("/api/gate/trigger", HTTP_POST, timed("/api/gate/trigger", handleGateTrigger));
+  server.on("/api/gate/status", HTTP_GET, timed("/api/gate/status", handleGateStatus));
+  server.on("/api/ota/firmware", HTTP_POST, timed("/api/ota/firmware", handleOTAFinish), handleOTAUpload);
+  server.on("/api/ota/spiffs", HTTP_POST, timed("/api/ota/spiffs", handleOTAFinish), handleOTAUpload);
+  server.on("/api/gate/config", timed("/api/gate/config", handleGateConfig));
+  server.on("/api/schedules", timed("/api/schedules", handleSchedulesAPI));
+  server.on("/api/schedules/delete", HTTP_POST, timed("/api/schedules/delete", handleSchedulesDelete));
+  server.on("/api/time", HTTP_GET, timed("/api/time", handleTimeStatus));
+  server.on("/api/frequency", HTTP_GET, timed("/api/frequency", handleFrequencyGet));
+  server.on("/api/frequency/set", HTTP_POST, timed("/api/frequency/set", handleFrequencySet));
+  server.on("/api/cc1101/config", HTTP_GET, timed("/api/cc1101/config", handleCC1101Config));
+  server.on("/api/cc1101/settings", HTTP_POST, timed("/api/cc1101/settings", handleCC1101Settings));
+  server.on("/api/system/info", HTTP_GET, timed("/api/system/info", handleSystemInfo));
+  server.on("/api/system/log", HTTP_GET, timed("/api/system/log", handleLogFile));
+  server.on("/api/audit", HTTP_GET, timed("/api/audit", handleAudit));
+  server.on("/api/audit/stats", HTTP_GET, timed("/api/audit/stats", handleAuditStats));
+  server.on("/metrics", HTTP_GET, handleMetrics);
+
+  // WebServer сохраняет только явно запрошенные заголовки запроса
+  static const char* collectedHeaders[] = { "If-None-Match" };
+  server.collectHeaders(collectedHeaders, 1);
+  bootNonce = esp_random();
   
   server.begin();
   Serial.println("[OK] Веб-сервер запущен на порту 80");
@@ -1688,6 +3537,28 @@ void setup() {
   // ищется в фоне, остальная система работает как обычно.
   GSMManager::init(GSM_RX_PIN, GSM_TX_PIN, gsmTrustedCheck, gsmGateOpen);
   Serial.println("[OK] GSM модуль: поиск SIM800L запущен");
+
+  // Периодические задания loop() и пробуждение loop() по готовому пакету CC1101
+  Scheduler::every("wifi_status", 5000, jobWiFiStatus);
+  Scheduler::every("rssi_sample", SignalStream::RSSI_SAMPLE_MS, jobRssiSample);
+  Scheduler::every("cleanup", 5000, jobCleanup);
+  Scheduler::every("cc1101_diagnostics", 30000, jobDiagnostics);
+  Scheduler::every("gate_count_flush", GATE_COUNT_SAVE_INTERVAL_MS, jobGateCountFlush);
+  Scheduler::every("settings_commit", 250, jobSettingsCommit);
+  Scheduler::every("time_sync", 60000, jobTimeSync);
+  Metrics::registerWriter(Scheduler::writeMetrics);
+
+  // Шина событий: команды ворот выполняет loop(), фазы ворот рассылает httpTask
+  gateSubscriber = EventBus::subscribe("gate", EventBus::topicBit(EventBus::TOPIC_GATE_COMMAND),
+                                       onGateCommand, Scheduler::wake);
+  uiSubscriber = EventBus::subscribe("ui", EventBus::topicBit(EventBus::TOPIC_GATE_PHASE), onGatePhase);
+  Metrics::registerWriter(EventBus::writeMetrics);
+  CC1101Manager::setSignalReadyHook(Scheduler::wakeFromIsr);
+
+  // С этого момента HTTP/WebSocket работают параллельно с loop()
+  xTaskCreatePinnedToCore(httpTask, "http", HTTP_TASK_STACK, nullptr, 1, &httpTaskHandle, 0);
+  Metrics::registerTask("http", httpTaskHandle);
+  Serial.println("[OK] Задача HTTP/WebSocket запущена на ядре 0");
   
   Serial.println("=================================");
   Serial.println("Инициализация завершена!");
@@ -1705,95 +3576,77 @@ void setup() {
 }
 
 // --- Loop Function ---
-void loop() {
-  // Обработка веб-запросов
-  server.handleClient();
+static void processLoop();
+static void saveLearnedKey();
 
-  // Обработка WebSocket
-  webSocket.loop();
-
-  // Неблокирующее обслуживание импульса ворот (выключение реле по таймеру)
-  GateControl::update();
-  broadcastGateStatus();
-
-  // Периодический сброс счётчика открытий во флеш (см. persistGateCountThrottled)
-  static unsigned long lastGateCountFlush = 0;
-  if (gateCountDirty && millis() - lastGateCountFlush > GATE_COUNT_SAVE_INTERVAL_MS) {
-    lastGateCountFlush = millis();
-    if (saveSystemState()) { gateCountDirty = false; lastGateCountSave = millis(); }
-  }
-
-  // Периодическая отправка статуса WiFi и переподключение (каждые 5 секунд)
-  static unsigned long lastWiFiUpdate = 0;
-  static bool wasConnected = false;
+// Ключ, выученный в processLoop(): пишется во флеш после выхода из StateLock
+static String learnedKeyName;
 
-  if (millis() - lastWiFiUpdate > 5000) {
-    lastWiFiUpdate = millis();
+void loop() {
+  // HTTP и WebSocket обслуживает httpTask (ядро 0), здесь только радио/GSM/ворота.
+  // Итерация под StateLock: checkReceived() каждый раз ходит в CC1101 по SPI.
+  // Запись во флеш — после него: выученный ключ и задания Scheduler
+  // (счётчик открытий, настройки) берут снимок под замком и пишут без него.
+  uint32_t loopStart = micros();
+  {
+    Sync::StateLock lock;
+    processLoop();
+  }
+  if (learnedKeyName.length() > 0) saveLearnedKey();
+
+  // WiFi, визуализатор, очистка, диагностика, счётчик открытий, настройки
+  Scheduler::runDue();
+
+  uint32_t loopUs = micros() - loopStart;
+  Metrics::observe(Metrics::HIST_LOOP, loopUs);
+  if (loopUs > loopMaxUsWindow) loopMaxUsWindow = loopUs;
+
+  static unsigned long loopWindowStart = 0;
+  if (millis() - loopWindowStart > LOOP_STATS_WINDOW_MS) {
+    loopWindowStart = millis();
+    loopMaxUs = loopMaxUsWindow;
+    loopMaxUsWindow = 0;
+  }
+
+  // Сон до ближайшего задания или готового пакета CC1101 (будит ISR), но не
+  // дольше LOOP_POLL_MS — UART модема и фазы ворот по-прежнему опрашиваются.
+  // Заодно отдаёт StateLock задаче HTTP: без паузы loop() тут же захватил бы его снова.
+  Scheduler::sleep(LOOP_POLL_MS);
+}
 
-    if (WiFi.status() == WL_CONNECTED) {
-      // Отправляем статус подключения
-      String wifiStatus = "{\"status\":\"connected\",\"ssid\":\"" + jsonEscape(WiFi.SSID()) + "\",\"rssi\":" + String(WiFi.RSSI()) + ",\"ip\":\"" + WiFi.localIP().toString() + "\"}";
-      sendWebSocketEvent("wifi_status", wifiStatus.c_str());
-      
-      if (!wasConnected) {
-        wasConnected = true;
-        Serial.println("[WiFi] Успешное подключение к: " + WiFi.SSID());
-      }
-    } else {
-      // Если было подключение, пытаемся переподключиться — но не чаще раза в 30с.
-      // Вызов WiFi.begin() каждые 5с перезапускал ассоциацию, не давая ей завершиться.
-      static unsigned long lastReconnectAttempt = 0;
-      if (systemState.wifiSSID.length() > 0) {
-        if (wasConnected) {
-          Serial.println("[WiFi] Соединение потеряно, попытка переподключения к: " + systemState.wifiSSID);
-          sendLog("⚠️ WiFi отключен, переподключение к " + systemState.wifiSSID + "...", "warning");
-          wasConnected = false;
-        }
-        if (millis() - lastReconnectAttempt > 30000) {
-          lastReconnectAttempt = millis();
-          WiFi.begin(systemState.wifiSSID.c_str(), systemState.wifiPassword.c_str());
-        }
-      }
-      
-      // Отправляем статус отключения
-      String wifiStatus = "{\"status\":\"disconnected\"}";
-      sendWebSocketEvent("wifi_status", wifiStatus.c_str());
-    }
+// При сбое NVS честно сообщаем в UI, а не рапортуем успех
+static void saveLearnedKey() {
+  if (saveSystemState()) {
+    sendLog("🔑 Новый ключ добавлен: " + learnedKeyName, "success");
+  } else {
+    sendLog("⚠️ Ключ добавлен в память, но НЕ сохранён (ошибка NVS) — после перезагрузки пропадёт", "error");
   }
+  learnedKeyName = "";
+}
 
-  // RSSI стриминг в WebSocket (режим обучения — для визуализатора сигнала)
-  static unsigned long lastRssiStream = 0;
-  if (systemState.learningMode && millis() - lastRssiStream > 200) {
-    lastRssiStream = millis();
-    int rssi = CC1101Manager::getRSSI();
-    String rssiEvent = "{\"rssi\":" + String(rssi) + ",\"freq\":" + String(CC1101Manager::getFrequency()) + "}";
-    sendWebSocketEvent("rssi", rssiEvent.c_str());
-  }
+static void processLoop() {
+  // Команды ворот из других задач (HTTP)
+  EventBus::dispatch(gateSubscriber);
 
-  // Очистка устаревших распознаваний (каждые 5 секунд)
-  static unsigned long lastCleanup = 0;
-  if (millis() - lastCleanup > 5000) {
-    cleanupOldRecognitions();
-    cleanupDetectionHistory();
-    lastCleanup = millis();
-  }
+  // Неблокирующее обслуживание циклов ворот (переключение реле по таймерам)
+  unsigned long now = millis();
+  for (GateControl::Gate& gate : gates) gate.update(now);
+  broadcastGateStatus();
 
   // Обработка CC1101 RF сигналов
   if (CC1101Manager::checkReceived()) {
+    uint32_t rfStart = micros();
     ReceivedKey receivedKey = CC1101Manager::getReceivedKey();
     
     if (receivedKey.code != 0) {
-      // Используем улучшенное сравнение ключей
-      KeyEntry* existingKey = nullptr;
-      bool keyExists = false;
-      
-      for (auto& key : systemState.keys433) {
-        if (isKeyMatch(key, receivedKey, receivedKey.bitString, receivedKey.bitLength, receivedKey.te)) {
-          keyExists = true;
-          existingKey = &key;
-          break;
-        }
-      }
+      // Поиск ключа с допусками (AccessDecision::keyMatches) — тем же кодом,
+      // что и в симуляторе ворот
+      AccessDecision::Signature received = {receivedKey.protocol.c_str(), receivedKey.bitString.c_str(),
+                                            receivedKey.bitLength, receivedKey.code, receivedKey.te,
+                                            CC1101Manager::getFrequency()};
+      int found = AccessDecision::findKey(systemState.keys433, received, keySignature);
+      KeyEntry* existingKey = found >= 0 ? &systemState.keys433[found] : nullptr;
+      bool keyExists = existingKey != nullptr;
       
       if (systemState.learningMode) {
         // В режиме обучения принимаем ТОЛЬКО декодированные протоколы,
@@ -1802,7 +3655,7 @@ void loop() {
           // RAW/Unknown — шум эфира: НЕ логируем в Serial и НЕ шлём в UI-журнал
           // (иначе журнал захлёбывается шумом). Просто игнорируем.
           CC1101Manager::resetReceived();
-          return; // Выходим из loop(), обработаем следующий сигнал на следующей итерации
+          return; // Выходим из итерации, обработаем следующий сигнал на следующей
         }
 
         Serial.println("[CC1101] Режим обучения: декодирован " + receivedKey.protocol);
@@ -1832,157 +3685,94 @@ void loop() {
           systemState.keys433.push_back(newKey);
 
           // Выключаем режим обучения
-          systemState.learningMode = false;
+          Settings::set(Settings::LEARNING_MODE, 0);
+          bumpGeneration(Collection::KEYS);
 
-          // Сохраняем состояние; при сбое NVS честно сообщаем в UI, а не рапортуем успех
-          bool saved = saveSystemState();
+          // Запись во флеш — в loop() после StateLock (saveLearnedKey)
+          learnedKeyName = newKey.name;
 
           Serial.println("[CC1101] ✅ Новый ключ добавлен: " + newKey.name);
           Serial.printf("[CC1101] Протокол: %s, Бит: %d, TE: %.1f мкс\n",
                        newKey.protocol.c_str(), newKey.bitLength, newKey.te);
-          if (saved) {
-            sendLog("🔑 Новый ключ добавлен: " + newKey.name, "success");
-          } else {
-            sendLog("⚠️ Ключ добавлен в память, но НЕ сохранён (ошибка NVS) — после перезагрузки пропадёт", "error");
-          }
           
-          // Отправляем событие о добавлении ключа
-          String keyData = "{\"code\":" + String(receivedKey.code) +
-                          ",\"name\":\"" + jsonEscape(newKey.name) + "\"" +
-                          ",\"enabled\":" + String(newKey.enabled) +
-                          ",\"protocol\":\"" + jsonEscape(newKey.protocol) + "\"" +
-                          ",\"bitLength\":" + String(newKey.bitLength) +
-                          ",\"rawData\":\"" + jsonEscape(newKey.rawData) + "\"" +
-                          ",\"rssi\":" + String(newKey.rssi) +
-                          ",\"frequency\":" + String(newKey.frequency) +
-                          ",\"modulation\":\"" + newKey.modulation + "\"" +
-                          ",\"timestamp\":" + String(newKey.timestamp) + "}";
-          sendWebSocketEvent("key_added", keyData.c_str());
-
-          String learnEvent = "{\"code\":" + String(receivedKey.code) +
-                               ",\"rawData\":\"" + jsonEscape(receivedKey.rawData) + "\"" +
-                               ",\"bitString\":\"" + jsonEscape(receivedKey.bitString) + "\"" +
-                               ",\"bitLength\":" + String(receivedKey.bitLength) +
-                               ",\"rssi\":" + String(receivedKey.rssi) +
-                               ",\"snr\":" + String(receivedKey.snr) +
-                               ",\"frequency\":" + String(CC1101Manager::getFrequency()) +
-                               ",\"protocol\":\"" + jsonEscape(receivedKey.protocol) + "\"" +
-                               ",\"modulation\":\"" + jsonEscape(receivedKey.modulation) + "\"" +
-                               ",\"timestamp\":" + String(receivedKey.timestamp) +
-                               ",\"hash\":" + String(receivedKey.hash) + "}";
-          sendWebSocketEvent("key_received", learnEvent.c_str());
+          // Событие о добавлении ключа (имя — из протокола и кода, без кавычек)
+          WsBus::postf("key_added",
+                       "{\"code\":%u,\"name\":\"%s\",\"enabled\":%d,\"protocol\":\"%s\",\"bitLength\":%d,"
+                       "\"rawData\":\"%s\",\"rssi\":%d,\"frequency\":%.2f,\"modulation\":\"%s\",\"timestamp\":%lu}",
+                       (unsigned)receivedKey.code, newKey.name.c_str(), (int)newKey.enabled, newKey.protocol.c_str(),
+                       newKey.bitLength, newKey.rawData.c_str(), newKey.rssi, newKey.frequency,
+                       newKey.modulation.c_str(), newKey.timestamp);
+
+          postKeyReceived(receivedKey);
         } else {
           Serial.println("[CC1101] ⚠️ Ключ уже существует в режиме обучения");
-          systemState.learningMode = false;
-          saveSystemState();
+          Settings::set(Settings::LEARNING_MODE, 0);
           sendLog("⚠️ Ключ уже существует: " + existingKey->name, "warning");
-          String learnEvent = "{\"code\":" + String(receivedKey.code) +
-                               ",\"rawData\":\"" + jsonEscape(receivedKey.rawData) + "\"" +
-                               ",\"bitString\":\"" + jsonEscape(receivedKey.bitString) + "\"" +
-                               ",\"bitLength\":" + String(receivedKey.bitLength) +
-                               ",\"rssi\":" + String(receivedKey.rssi) +
-                               ",\"snr\":" + String(receivedKey.snr) +
-                               ",\"frequency\":" + String(CC1101Manager::getFrequency()) +
-                               ",\"protocol\":\"" + jsonEscape(receivedKey.protocol) + "\"" +
-                               ",\"modulation\":\"" + jsonEscape(receivedKey.modulation) + "\"" +
-                               ",\"timestamp\":" + String(receivedKey.timestamp) +
-                               ",\"hash\":" + String(receivedKey.hash) + "}";
-          sendWebSocketEvent("key_received", learnEvent.c_str());
+          postKeyReceived(receivedKey);
         }
       } else {
-        bool gateTriggered = false;
-        bool hasSerialMessage = false;
-        String serialMessage;
-        bool hasLogMessage = false;
-        String logMessage;
-        const char* logType = nullptr;
-        bool sendEventToUI = true;
-
-        if (keyExists && existingKey != nullptr) {
-          // Ключ найден в базе — активируем сразу без верификации (как Flipper Zero)
-          if (existingKey->enabled) {
-            gateTriggered = true;
-            serialMessage = "[CC1101] ✅ Активация ворот ключом: " + existingKey->name +
-                            " (RSSI: " + String(receivedKey.rssi) + " dBm, " + receivedKey.protocol + ")";
-            hasSerialMessage = true;
-            logMessage = "🚪 Ворота активированы: " + existingKey->name;
-            logType = "success";
-            hasLogMessage = true;
-            startGateCycle();
-            systemState.gateOpenCount++;
-            persistGateCountThrottled();
-            RingLog::append(("Ворота: " + existingKey->name + " RSSI:" + String(receivedKey.rssi)).c_str());
-          } else {
-            serialMessage = "[CC1101] ⚠️ Ключ отключен: " + existingKey->name;
-            hasSerialMessage = true;
-            logMessage = "⚠️ Ключ отключен: " + existingKey->name;
-            logType = "warning";
-            hasLogMessage = true;
-          }
-        } else {
-          // Неизвестный ключ — логируем только в Serial, не спамим WebSocket.
+        // Повтор пакета того же нажатия в журнал не пишем; срабатывание ворот — всегда
+        AccessDecision::Outcome outcome =
+          AccessDecision::decideKey(found, keyExists && existingKey->enabled,
+                                    keyExists ? existingKey->scheduleId : Schedule::ALWAYS, millis());
+        bool gateTriggered = outcome == AccessDecision::OPEN;
+        bool suppressDuplicate = isDuplicateForDisplay(receivedKey) && !gateTriggered;
+
+        // Логи здесь — только через очередь LogQueue (printf в ячейку, без String
+        // и без записи во флеш на пути решения); выводит их задача log
+        if (gateTriggered && !EventBus::publishGateCommand(EventBus::SOURCE_RF, existingKey->gates)) {
+          // Очередь loop полна — команда не выполнится, открытия в журнале нет
+          LogQueue::postf(LogQueue::LEVEL_WARNING, LogQueue::SINK_SERIAL | LogQueue::SINK_WS,
+                          "⚠️ Очередь команд ворот переполнена, ключ %s не открыл ворота",
+                          existingKey->name.c_str());
+        } else if (gateTriggered) {
+          // Ключ найден в базе — активируем сразу без верификации (как Flipper Zero).
+          // Подписчик gate_command — эта же задача: выполняем сразу, реле не ждёт
+          EventBus::dispatch(gateSubscriber);
+          AccessDecision::recordKey(outcome, receivedKey.code, receivedKey.rssi, micros() - rfStart);
+          const char* name = existingKey->name.c_str();
+          LogQueue::postf(LogQueue::LEVEL_SUCCESS, LogQueue::SINK_SERIAL,
+                          "[CC1101] ✅ Активация ворот ключом: %s (RSSI: %d dBm, %s)",
+                          name, receivedKey.rssi, receivedKey.protocol.c_str());
+          LogQueue::postf(LogQueue::LEVEL_SUCCESS, LogQueue::SINK_WS, "🚪 Ворота активированы: %s", name);
+          LogQueue::postf(LogQueue::LEVEL_INFO, LogQueue::SINK_FILE, "Ворота: %s RSSI:%d", name, receivedKey.rssi);
+        } else if (suppressDuplicate) {
+          Metrics::inc(Metrics::RF_DUPLICATES);
+          LogQueue::postf(LogQueue::LEVEL_INFO, LogQueue::SINK_SERIAL,
+                          "[CC1101] 🔁 Дубликат сигнала: %s 0x%X (подавлен)",
+                          receivedKey.protocol.c_str(), (unsigned)receivedKey.code);
+        } else if (outcome == AccessDecision::OUT_OF_SCHEDULE) {
+          AccessDecision::recordKey(outcome, receivedKey.code, receivedKey.rssi, micros() - rfStart);
+          LogQueue::postf(LogQueue::LEVEL_WARNING, LogQueue::SINK_SERIAL | LogQueue::SINK_WS,
+                          "⏰ Ключ вне расписания: %s", existingKey->name.c_str());
+        } else if (outcome == AccessDecision::DISABLED) {
+          AccessDecision::recordKey(outcome, receivedKey.code, receivedKey.rssi, micros() - rfStart);
+          LogQueue::postf(LogQueue::LEVEL_WARNING, LogQueue::SINK_SERIAL | LogQueue::SINK_WS,
+                          "⚠️ Ключ отключен: %s", existingKey->name.c_str());
+        } else if (receivedKey.protocol != "RAW/Unknown" && receivedKey.protocol != "RAW/Custom") {
+          // Неизвестный ключ — только в Serial, не спамим WebSocket.
           // RAW/Unknown (шум эфира) не логируем вовсе — только реально
           // декодированные, но отсутствующие в базе протоколы.
-          if (receivedKey.protocol != "RAW/Unknown" && receivedKey.protocol != "RAW/Custom") {
-            serialMessage = "[CC1101] ❓ Неизвестный ключ: " + receivedKey.protocol +
-                            " 0x" + String(receivedKey.code, HEX) +
-                            " (RSSI: " + String(receivedKey.rssi) + " dBm)";
-            hasSerialMessage = true;
-          }
-          hasLogMessage = false;
-        }
-
-        bool suppressDuplicate = isDuplicateForDisplay(receivedKey);
-        if (gateTriggered) {
-          suppressDuplicate = false;
-        }
-
-        if (suppressDuplicate) {
-          Serial.printf("[CC1101] 🔁 Дубликат сигнала: %s 0x%X (подавлен)\n",
-                        receivedKey.protocol.c_str(), receivedKey.code);
-          sendEventToUI = false;
-          hasSerialMessage = false;
-          hasLogMessage = false;
-        }
-
-        if (hasSerialMessage) {
-          Serial.println(serialMessage);
-        }
-
-        if (hasLogMessage && logType != nullptr) {
-          sendLog(logMessage, logType);
+          AccessDecision::recordKey(outcome, receivedKey.code, receivedKey.rssi, micros() - rfStart);
+          LogQueue::postf(LogQueue::LEVEL_INFO, LogQueue::SINK_SERIAL,
+                          "[CC1101] ❓ Неизвестный ключ: %s 0x%X (RSSI: %d dBm)",
+                          receivedKey.protocol.c_str(), (unsigned)receivedKey.code, receivedKey.rssi);
         }
 
         // RAW/Unknown (шум эфира) в UI-журнал не шлём — только реально декодированные
         bool isRawNoise = (receivedKey.protocol == "RAW/Unknown" || receivedKey.protocol == "RAW/Custom");
-        if (!suppressDuplicate && sendEventToUI && !isRawNoise) {
-          String keyData = "{\"code\":" + String(receivedKey.code) +
-                           ",\"rawData\":\"" + jsonEscape(receivedKey.rawData) + "\"" +
-                           ",\"bitString\":\"" + jsonEscape(receivedKey.bitString) + "\"" +
-                           ",\"bitLength\":" + String(receivedKey.bitLength) +
-                           ",\"rssi\":" + String(receivedKey.rssi) +
-                           ",\"snr\":" + String(receivedKey.snr) +
-                           ",\"frequency\":" + String(CC1101Manager::getFrequency()) +
-                           ",\"protocol\":\"" + jsonEscape(receivedKey.protocol) + "\"" +
-                           ",\"modulation\":\"" + jsonEscape(receivedKey.modulation) + "\"" +
-                           ",\"timestamp\":" + String(receivedKey.timestamp) +
-                           ",\"hash\":" + String(receivedKey.hash) + "}";
-          sendWebSocketEvent("key_received", keyData.c_str());
+        if (!suppressDuplicate && !isRawNoise) {
+          postKeyReceived(receivedKey);
         }
       }
     }
     
     CC1101Manager::resetReceived();
+    rfDecisionUs = micros() - rfStart;
+    if (rfDecisionUs > rfDecisionMaxUs) rfDecisionMaxUs = rfDecisionUs;
   }
   
-  // Периодическая диагностика CC1101 (каждые 30 секунд)
-  static unsigned long lastDiagnostic = 0;
-  if (millis() - lastDiagnostic > 30000) {
-    lastDiagnostic = millis();
-    int rssi = CC1101Manager::getRSSI();
-    Serial.println("[CC1101] Диагностика - RSSI: " + String(rssi) + " dBm, Частота: " + String(CC1101Manager::getFrequency()) + " МГц");
-  }
-
   // Обработка GSM: инициализация SIM800L, входящие звонки (+CLIP) и SMS (+CMT)
   GSMManager::handleGSM();
+  EventBus::dispatch(gateSubscriber);
 }
\ No newline at end of file